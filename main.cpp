@@ -4,8 +4,13 @@
 #include <stdexcept>
 #include <vector>
 #include <iostream>
+#include <chrono>
+#include <cstring>
+#include <cstdlib>
 
 #include "VulkanRenderer.h"
+#include "RenderThread.h"
+#include "FixedTimestep.h"
 
 #include <glm/gtc/matrix_transform.hpp>
 
@@ -29,42 +34,245 @@ int32_t InitWindow(std::string wName = "Test Window", const int width = 800, con
 	return EXIT_SUCCESS;
 }
 
-int main()
+// everything the simulation advances with each fixed step
+struct SimulationState
 {
+	float Angle_deg = 0.0f;
+
+	void Step(float deltaTime_s)
+	{
+		Angle_deg += 10.f * deltaTime_s;
+		if(Angle_deg > 360)
+		{
+			Angle_deg -= 360;
+		}
+	}
+
+	glm::mat4 GetModel() const
+	{
+		return glm::rotate(glm::mat4(1.f), glm::radians(Angle_deg), glm::vec3(0.f, 0.f, 1.f));
+	}
+};
+
+// run the simulation without window or renderer, feeding the scheduler a fixed frame time
+// the number of steps (and the final state) only depends on the arguments, so runs are comparable
+int RunHeadless(uint32_t frameCount, double frameTime_s)
+{
+	FixedTimestep timestep;
+	SimulationState state;
+
+	auto start = std::chrono::steady_clock::now();
+	for(uint32_t i = 0; i < frameCount; i++)
+	{
+		uint32_t steps = timestep.Advance(frameTime_s);
+		for(uint32_t s = 0; s < steps; s++)
+		{
+			state.Step(static_cast<float>(timestep.GetStepDuration()));
+		}
+	}
+	std::chrono::duration<double, std::milli> elapsed = std::chrono::steady_clock::now() - start;
+
+	printf("headless: %u frames, %llu steps, final angle %f deg, %.3f ms\n", frameCount,
+		static_cast<unsigned long long>(timestep.GetStepCount()), state.Angle_deg, elapsed.count());
+
+	return 0;
+}
+
+bool HasArgument(int argc, char* argv[], const char* argument)
+{
+	for (int i = 1; i < argc; i++)
+	{
+		if (strcmp(argv[i], argument) == 0)
+		{
+			return true;
+		}
+	}
+	return false;
+}
+
+// the argument following the flag, nullptr if the flag isn't given. missing is set if the flag is given
+// without a value
+const char* GetArgumentValue(int argc, char* argv[], const char* argument, bool& missing)
+{
+	missing = false;
+	for (int i = 1; i < argc; i++)
+	{
+		if (strcmp(argv[i], argument) == 0)
+		{
+			missing = i + 1 >= argc || strncmp(argv[i + 1], "--", 2) == 0;
+			return missing ? nullptr : argv[i + 1];
+		}
+	}
+	return nullptr;
+}
+
+int main(int argc, char* argv[])
+{
+	// --headless <frames> [frame time in s]: benchmark the simulation only
+	if (argc > 1 && strcmp(argv[1], "--headless") == 0)
+	{
+		// the whole argument has to be a number, atoi would silently turn typos into 0
+		char* end = nullptr;
+		unsigned long frameCount = argc > 2 ? strtoul(argv[2], &end, 10) : 0;
+		bool bValid = argc > 2 && end != argv[2] && *end == '\0' && argv[2][0] != '-' && frameCount <= UINT32_MAX;
+
+		double frameTime_s = 1.0 / 60.0;
+		if (bValid && argc > 3)
+		{
+			frameTime_s = strtod(argv[3], &end);
+			bValid = end != argv[3] && *end == '\0' && frameTime_s > 0.0;
+		}
+
+		if (!bValid)
+		{
+			printf("usage: %s --headless <frames> [frame time in s]\n", argv[0]);
+			return EXIT_FAILURE;
+		}
+		return RunHeadless(static_cast<uint32_t>(frameCount), frameTime_s);
+	}
+
+	// --capture <directory>: write every rendered frame to disk
+	bool bCaptureDirectoryMissing = false;
+	const char* captureDirectory = GetArgumentValue(argc, argv, "--capture", bCaptureDirectoryMissing);
+	if (bCaptureDirectoryMissing)
+	{
+		printf("usage: %s --capture <directory>\n", argv[0]);
+		return EXIT_FAILURE;
+	}
+
 	//create window
 	if (InitWindow() == EXIT_FAILURE)
 	{
 		return EXIT_FAILURE;
 	}
 
+	// --particles: add the gpu particle system
+	bool bParticles = HasArgument(argc, argv, "--particles");
+
+	// --hot-reload: rebuild the pipelines when the shaders change
+	bool bHotReload = HasArgument(argc, argv, "--hot-reload");
+
+	// --alloc-stats: print the vulkan host allocations on exit
+	bool bAllocationStats = HasArgument(argc, argv, "--alloc-stats");
+
+	// --pipeline-stats: print the creation times and the number of unique pipelines on exit
+	bool bPipelineStats = HasArgument(argc, argv, "--pipeline-stats");
+
+	// --instances: draw 10000 copies of the first mesh, all in a single draw call
+	bool bInstances = HasArgument(argc, argv, "--instances");
+
+	// --startup-times: print how long the initialisation took, step by step, and the jobs that ran meanwhile
+	if (HasArgument(argc, argv, "--startup-times"))
+	{
+		Renderer.EnableStartupReport();
+	}
+
 	//create vulkan Renderer instance
-	if (Renderer.Init(Window) == EXIT_FAILURE)
+	// capturing needs frames read back to host memory, a ring of 4 gives the encoders some slack
+	if (Renderer.Init(Window, 4, captureDirectory ? 4 : 0) == EXIT_FAILURE)
 	{
 		return EXIT_FAILURE;
 	}
 
-	float angle_deg = 0.0f;
-	float deltaTime_s = 0.0f;
-	float lastTime = 0.0f;
+	if (bParticles && Renderer.EnableParticles() == EXIT_FAILURE)
+	{
+		return EXIT_FAILURE;
+	}
 
-	//loop until closed
-	while (!glfwWindowShouldClose(Window))
+	if (bInstances)
 	{
-		glfwPollEvents();
+		// a 100 x 100 grid of small copies in front of the mesh, tinted from red to blue
+		const uint32_t gridSize = 100;
+		for (uint32_t x = 0; x < gridSize; x++)
+		{
+			for (uint32_t y = 0; y < gridSize; y++)
+			{
+				if (x == 0 && y == 0)
+				{
+					continue;		// the mesh itself
+				}
 
-		float now = glfwGetTime();
-		deltaTime_s = now - lastTime;
+				float u = static_cast<float>(x) / (gridSize - 1);
+				float v = static_cast<float>(y) / (gridSize - 1);
+				glm::mat4 transform = glm::translate(glm::mat4(1.0f), glm::vec3(u * 4.0f - 2.0f, v * 4.0f - 2.0f, -1.0f));
+				transform = glm::scale(transform, glm::vec3(0.02f));
+				Renderer.AddMeshInstance(0, transform, glm::vec4(1.0f - u, 0.5f, u, 1.0f));
+			}
+		}
+	}
+
+	if (bHotReload)
+	{
+		Renderer.EnableShaderHotReload();
+	}
+
+	if (captureDirectory)
+	{
+		CaptureSettings captureSettings;
+		captureSettings.Directory = captureDirectory;
+		Renderer.StartCapture(captureSettings);
+	}
+
+	// from here on, the renderer is only used by the render thread.
+	// the main thread handles events and simulates, then hands its results over as snapshots
+	// the scene root never changes, ask for it before the render thread owns the renderer
+	const SceneNode sceneRoot = Renderer.GetSceneRoot();
+	RenderThread renderThread;
+	renderThread.Start(&Renderer);
+
+	// the simulation runs in fixed steps, independent of how often we get here
+	FixedTimestep timestep;
+	SimulationState previousState;
+	SimulationState currentState;
+	double lastTime = glfwGetTime();
+	uint64_t frameIndex = 0;
+
+	//loop until closed (or the render thread failed)
+	while (!glfwWindowShouldClose(Window) && renderThread.IsRunning())
+	{
+		// the simulation doesn't wait for the gpu anymore, so limit it to ~120 updates per second
+		glfwWaitEventsTimeout(1.0 / 120.0);
+
+		double now = glfwGetTime();
+		uint32_t steps = timestep.Advance(now - lastTime);
 		lastTime = now;
 
-		angle_deg += 10.f * deltaTime_s;
-		if(angle_deg > 360)
+		for(uint32_t i = 0; i < steps; i++)
 		{
-			angle_deg -= 360;
+			previousState = currentState;
+			currentState.Step(static_cast<float>(timestep.GetStepDuration()));
 		}
 
-		Renderer.UpdateModel(glm::rotate(glm::mat4(1.f), glm::radians(angle_deg), glm::vec3(0.f, 0.f, 1.f)));
+		// the render thread blends the last two steps with the time that is left over
+		FrameSnapshot& snapshot = renderThread.BeginSnapshot();
+		snapshot.FrameIndex = frameIndex++;
+		snapshot.Alpha = timestep.GetAlpha();
+		snapshot.Transforms.push_back({sceneRoot, previousState.GetModel(), currentState.GetModel()});
+		renderThread.PublishSnapshot();
+	}
+
+	renderThread.Stop();
+
+	if (captureDirectory)
+	{
+		Renderer.StopCapture();
+		// frames are dropped by the readback ring (overwritten before they were taken) and by the encoders
+		printf("captured %llu frames, dropped %llu (readback %llu, encoders %llu)\n",
+			static_cast<unsigned long long>(Renderer.GetFrameCapture().GetWrittenFrameCount()),
+			static_cast<unsigned long long>(Renderer.GetFrameReadback().GetDroppedFrameCount() + Renderer.GetFrameCapture().GetDroppedFrameCount()),
+			static_cast<unsigned long long>(Renderer.GetFrameReadback().GetDroppedFrameCount()),
+			static_cast<unsigned long long>(Renderer.GetFrameCapture().GetDroppedFrameCount()));
+	}
+
+	if (bAllocationStats)
+	{
+		Renderer.GetHostAllocator().PrintStats();
+	}
 
-		Renderer.Draw();
+	if (bPipelineStats)
+	{
+		Renderer.GetPipelineCompiler().PrintStats();
+		Renderer.GetPipelineRegistry().PrintStats();
 	}
 
 	Renderer.CleanUp();
@@ -7,5 +7,15 @@ echo ""
 echo "COMPILING FRAGMENT SHADER"
 glslc shader.frag -o frag.spv
 
-# wait for user input before closing
-read
\ No newline at end of file
+echo ""
+echo "COMPILING PARTICLE SHADERS"
+glslc particle_simulate.comp -o particle_simulate.spv
+glslc particle_emit.comp -o particle_emit.spv
+glslc particle_finish.comp -o particle_finish.spv
+glslc particle.vert -o particle_vert.spv
+glslc particle.frag -o particle_frag.spv
+
+# wait for user input before closing (only when run from a terminal, e.g. by double click)
+if [ -t 0 ]; then
+	read
+fi
\ No newline at end of file
@@ -0,0 +1,18 @@
+#version 450
+
+layout(location = 0) in vec4 vColour;
+layout(location = 1) in vec2 vCorner;
+
+layout(location = 0) out vec4 outColour;
+
+void main()
+{
+	// round, soft particles
+	float radius = length(vCorner);
+	if(radius > 1.0)
+	{
+		discard;
+	}
+
+	outColour = vec4(vColour.rgb, vColour.a * (1.0 - radius));
+}
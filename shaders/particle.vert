@@ -0,0 +1,52 @@
+#version 450
+
+// the renderer's per view data
+layout(binding = 0) uniform ViewData {
+	mat4 ViewProjection;
+	mat4 View;
+} uView;
+
+struct Particle {
+	vec4 PositionLife;
+	vec4 VelocityLifetime;
+	vec4 Colour;
+};
+
+layout(std430, binding = 1) readonly buffer ParticleBuffer {
+	Particle Particles[];
+} uParticles;
+
+layout(std430, binding = 2) readonly buffer CounterBuffer {
+	uint AliveCount[2];
+	uint Current;
+} uCounters;
+
+layout(push_constant) uniform ParticleDraw {
+	float Size;
+	uint MaxParticles;
+} uDraw;
+
+layout(location = 0) out vec4 vColour;
+layout(location = 1) out vec2 vCorner;
+
+// corners of the two triangles of a quad
+const vec2 Corners[6] = vec2[](
+	vec2(-1.0, -1.0), vec2(1.0, -1.0), vec2(1.0, 1.0),
+	vec2(-1.0, -1.0), vec2(1.0, 1.0), vec2(-1.0, 1.0)
+);
+
+// no vertex buffer: every instance is one particle, expanded to a camera facing quad
+void main()
+{
+	Particle particle = uParticles.Particles[uCounters.Current * uDraw.MaxParticles + gl_InstanceIndex];
+
+	vec2 corner = Corners[gl_VertexIndex];
+	vec3 cameraRight = vec3(uView.View[0][0], uView.View[1][0], uView.View[2][0]);
+	vec3 cameraUp = vec3(uView.View[0][1], uView.View[1][1], uView.View[2][1]);
+	vec3 position = particle.PositionLife.xyz + (cameraRight * corner.x + cameraUp * corner.y) * uDraw.Size;
+
+	gl_Position = uView.ViewProjection * vec4(position, 1.0);
+
+	vColour = particle.Colour;
+	vCorner = corner;
+}
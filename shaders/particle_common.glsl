@@ -0,0 +1,33 @@
+// buffers shared by the particle compute shaders
+
+struct Particle {
+	vec4 PositionLife;		// xyz: position, w: remaining life in seconds
+	vec4 VelocityLifetime;	// xyz: velocity, w: total life in seconds
+	vec4 Colour;
+};
+
+// particles are stored twice (MaxParticles each): the alive ones of the current frame
+// and the compacted ones of the next frame. Current flips every frame
+layout(std430, binding = 0) buffer ParticleBuffer {
+	Particle Particles[];
+} uParticles;
+
+layout(std430, binding = 1) buffer CounterBuffer {
+	uint AliveCount[2];
+	uint Current;
+	uint Pad;
+	uvec4 SimulateArgs;		// VkDispatchIndirectCommand of the next simulate pass
+	uvec4 DrawArgs;			// VkDrawIndirectCommand of the particle draw
+} uCounters;
+
+// written by the cpu every frame
+layout(std430, binding = 2) readonly buffer ParameterBuffer {
+	vec4 EmitterPosition;	// w: radius of the emitting sphere
+	vec4 EmitterVelocity;	// w: random velocity added on top
+	vec4 Gravity;			// w: delta time of this frame
+	vec4 Colour;
+	uint EmitCount;
+	uint Seed;
+	uint MaxParticles;
+	float Lifetime;
+} uParameters;
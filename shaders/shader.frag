@@ -1,6 +1,23 @@
 #version 450
 
 layout (location = 0) in vec3 vColour;
+layout (location = 1) in float vViewDepth;
+layout (location = 2) in vec4 vTint;
+
+// shader features (see ShaderPermutation.h), set per pipeline
+// disabled ones are compiled out of the pipeline
+layout(constant_id = 0) const bool VERTEX_COLOUR = true;
+layout(constant_id = 1) const bool FOG = false;
+layout(constant_id = 2) const bool GREYSCALE = false;
+
+// per frame data (set 0), the fog fades into its colour between the two view distances
+layout(set = 0, binding = 0) uniform FrameData {
+	vec4 FogColour;
+	float FogStart;
+	float FogEnd;
+	float Time;
+	uint FrameIndex;
+} uFrame;
 
 //out layouts (note locations are not the same as ins!)
 //it equals the attachments however! location 0 writes to attachment 0
@@ -8,5 +25,24 @@ layout(location = 0) out vec4 outColour;
 
 void main()
 {
-	outColour = vec4(vColour, 1.0);
+	vec3 colour = vec3(1.0);
+	if(VERTEX_COLOUR)
+	{
+		colour = vColour;
+	}
+	colour *= vTint.rgb;
+
+	if(FOG)
+	{
+		float fog = clamp((vViewDepth - uFrame.FogStart) / (uFrame.FogEnd - uFrame.FogStart), 0.0, 1.0);
+		colour = mix(colour, uFrame.FogColour.rgb, fog);
+	}
+
+	if(GREYSCALE)
+	{
+		colour = vec3(dot(colour, vec3(0.299, 0.587, 0.114)));
+	}
+
+	// the alpha only matters for the blended variants
+	outColour = vec4(colour, vTint.a);
 }
\ No newline at end of file
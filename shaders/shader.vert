@@ -3,17 +3,37 @@
  layout(location = 0) in vec3 aPos;
  layout(location = 1) in vec3 aColour;
  
- layout(binding = 0) uniform MatrixSetup {
-	mat4 Projection;
-	mat4 View;
-	mat4 Model;
- } uModelViewProjectionMatrix;
+ // per instance (binding 1): the instance's scene node and tint
+ layout(location = 2) in uint aInstanceNode;
+ layout(location = 3) in vec4 aInstanceColour;
+ 
+ // sets by update frequency: 0 per frame, 1 per view, 2 per object
+ // the view projection (set 1) is already baked into the object matrices, so only set 2 is needed here
+ 
+ // model view projection matrices of all scene nodes, indexed by the instance's node
+ layout(std430, set = 2, binding = 0) readonly buffer ObjectBuffer {
+	mat4 ModelViewProjection[];
+ } uObjects;
+ 
+ // shader features (see ShaderPermutation.h), set per pipeline
+ layout(constant_id = 1) const bool FOG = false;
  
  layout(location = 0) out vec3 vColour;
+ layout(location = 1) out float vViewDepth;
+ layout(location = 2) out vec4 vTint;
  
  void main()
  {
-	gl_Position = uModelViewProjectionMatrix.Projection * uModelViewProjectionMatrix.View * uModelViewProjectionMatrix.Model * vec4(aPos, 1.0);
+	// the matrices were multiplied once per object on the cpu, instead of three times per vertex
+	gl_Position = uObjects.ModelViewProjection[aInstanceNode] * vec4(aPos, 1.0);
 	
 	vColour = aColour;
+	vTint = aInstanceColour;
+	
+	// a perspective projection moves the view depth into w
+	vViewDepth = 0.0;
+	if(FOG)
+	{
+		vViewDepth = gl_Position.w;
+	}
  }
\ No newline at end of file
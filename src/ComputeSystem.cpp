@@ -0,0 +1,385 @@
+#include "ComputeSystem.h"
+
+#include <algorithm>
+#include <cstring>
+#include <stdexcept>
+
+#include "Utilities.h"
+
+ComputeSystem::ComputeSystem()
+{
+
+}
+
+ComputeSystem::~ComputeSystem()
+{
+
+}
+
+void ComputeSystem::Create(VkPhysicalDevice physicalDevice, VkDevice logicalDevice, uint32_t imageCount,
+	const VkAllocationCallbacks* allocator, MemoryBudget* memory)
+{
+	PhysicalDevice = physicalDevice;
+	LogicalDevice = logicalDevice;
+	Allocator = allocator;
+	Memory = memory;
+	ImageCount = imageCount;
+}
+
+void ComputeSystem::Destroy()
+{
+	for(ComputePipeline& pipeline : Pipelines)
+	{
+		vkDestroyPipeline(LogicalDevice, pipeline.Pipeline, Allocator);
+		vkDestroyPipelineLayout(LogicalDevice, pipeline.Layout, Allocator);
+		vkDestroyDescriptorPool(LogicalDevice, pipeline.DescriptorPool, Allocator);
+		vkDestroyDescriptorSetLayout(LogicalDevice, pipeline.SetLayout, Allocator);
+	}
+	Pipelines.clear();
+
+	for(StorageBuffer& buffer : StorageBuffers)
+	{
+		for(size_t i = 0; i < buffer.Buffers.size(); i++)
+		{
+			if(buffer.Mapped[i] != nullptr)
+			{
+				vkUnmapMemory(LogicalDevice, buffer.Memories[i]);
+			}
+			Memory->TrackBufferFree(LogicalDevice, buffer.Buffers[i], buffer.MemoryProperties);
+			vkDestroyBuffer(LogicalDevice, buffer.Buffers[i], Allocator);
+			vkFreeMemory(LogicalDevice, buffer.Memories[i], Allocator);
+		}
+	}
+	StorageBuffers.clear();
+
+	Dispatches.clear();
+}
+
+StorageBufferHandle ComputeSystem::CreateStorageBuffer(VkDeviceSize size, bool hostVisible, bool perImage,
+	VkBufferUsageFlags usage)
+{
+	StorageBuffer buffer;
+	buffer.Size = size;
+
+	uint32_t copies = perImage ? ImageCount : 1;
+	buffer.Buffers.resize(copies);
+	buffer.Memories.resize(copies);
+	buffer.Mapped.resize(copies, nullptr);
+
+	buffer.MemoryProperties = hostVisible
+		? VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT
+		: VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT;
+
+	for(uint32_t i = 0; i < copies; i++)
+	{
+		// TRANSFER_DST, so it can be filled with vkCmdFillBuffer / copies
+		CreateBufferAndAllocateMemory(PhysicalDevice, LogicalDevice, size,
+			VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT | usage, buffer.MemoryProperties,
+			&buffer.Buffers[i], &buffer.Memories[i], Allocator);
+		Memory->TrackBuffer(LogicalDevice, buffer.Buffers[i], buffer.MemoryProperties);
+
+		if(hostVisible)
+		{
+			vkMapMemory(LogicalDevice, buffer.Memories[i], 0, size, 0, &buffer.Mapped[i]);
+		}
+	}
+
+	StorageBuffers.push_back(buffer);
+
+	return static_cast<StorageBufferHandle>(StorageBuffers.size() - 1);
+}
+
+VkBuffer ComputeSystem::GetStorageBuffer(StorageBufferHandle buffer, uint32_t imageIndex) const
+{
+	const StorageBuffer& storageBuffer = StorageBuffers.at(buffer);
+
+	return storageBuffer.Buffers[storageBuffer.Buffers.size() > 1 ? imageIndex : 0];
+}
+
+void* ComputeSystem::GetStorageBufferMapped(StorageBufferHandle buffer, uint32_t imageIndex) const
+{
+	const StorageBuffer& storageBuffer = StorageBuffers.at(buffer);
+
+	return storageBuffer.Mapped[storageBuffer.Mapped.size() > 1 ? imageIndex : 0];
+}
+
+ComputePipelineHandle ComputeSystem::CreateComputePipeline(const ShaderCode& spirv,
+	const std::vector<StorageBufferHandle>& storageBuffers, uint32_t pushConstantSize)
+{
+	ComputePipeline pipeline;
+	pipeline.PushConstantSize = pushConstantSize;
+
+	// -- Descriptor set layout: one storage buffer per binding
+	std::vector<VkDescriptorSetLayoutBinding> bindings(storageBuffers.size());
+	for(uint32_t i = 0; i < bindings.size(); i++)
+	{
+		bindings[i].binding = i;
+		bindings[i].descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+		bindings[i].descriptorCount = 1;
+		bindings[i].stageFlags = VK_SHADER_STAGE_COMPUTE_BIT;
+		bindings[i].pImmutableSamplers = nullptr;
+	}
+
+	VkDescriptorSetLayoutCreateInfo layoutCreateInfo = {};
+	layoutCreateInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO;
+	layoutCreateInfo.bindingCount = static_cast<uint32_t>(bindings.size());
+	layoutCreateInfo.pBindings = bindings.data();
+
+	if(vkCreateDescriptorSetLayout(LogicalDevice, &layoutCreateInfo, Allocator, &pipeline.SetLayout) != VK_SUCCESS)
+	{
+		throw std::runtime_error("failed to create a compute descriptor set layout!");
+	}
+
+	// -- Pipeline layout
+	VkPushConstantRange pushConstantRange = {};
+	pushConstantRange.stageFlags = VK_SHADER_STAGE_COMPUTE_BIT;
+	pushConstantRange.offset = 0;
+	pushConstantRange.size = pushConstantSize;
+
+	VkPipelineLayoutCreateInfo pipelineLayoutCreateInfo = {};
+	pipelineLayoutCreateInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
+	pipelineLayoutCreateInfo.setLayoutCount = 1;
+	pipelineLayoutCreateInfo.pSetLayouts = &pipeline.SetLayout;
+	pipelineLayoutCreateInfo.pushConstantRangeCount = pushConstantSize > 0 ? 1 : 0;
+	pipelineLayoutCreateInfo.pPushConstantRanges = pushConstantSize > 0 ? &pushConstantRange : nullptr;
+
+	if(vkCreatePipelineLayout(LogicalDevice, &pipelineLayoutCreateInfo, Allocator, &pipeline.Layout) != VK_SUCCESS)
+	{
+		throw std::runtime_error("failed to create a compute pipeline layout!");
+	}
+
+	// -- Pipeline
+	VkShaderModuleCreateInfo shaderModuleCreateInfo = {};
+	shaderModuleCreateInfo.sType = VK_STRUCTURE_TYPE_SHADER_MODULE_CREATE_INFO;
+	shaderModuleCreateInfo.codeSize = spirv.GetSize();
+	shaderModuleCreateInfo.pCode = spirv.GetCode();
+
+	VkShaderModule shaderModule;
+	if(vkCreateShaderModule(LogicalDevice, &shaderModuleCreateInfo, Allocator, &shaderModule) != VK_SUCCESS)
+	{
+		throw std::runtime_error("failed to create shader module!");
+	}
+
+	VkComputePipelineCreateInfo pipelineCreateInfo = {};
+	pipelineCreateInfo.sType = VK_STRUCTURE_TYPE_COMPUTE_PIPELINE_CREATE_INFO;
+	pipelineCreateInfo.stage.sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
+	pipelineCreateInfo.stage.stage = VK_SHADER_STAGE_COMPUTE_BIT;
+	pipelineCreateInfo.stage.module = shaderModule;
+	pipelineCreateInfo.stage.pName = "main";
+	pipelineCreateInfo.layout = pipeline.Layout;
+
+	VkResult result = vkCreateComputePipelines(LogicalDevice, VK_NULL_HANDLE, 1, &pipelineCreateInfo, Allocator, &pipeline.Pipeline);
+
+	// the module isn't needed anymore once the pipeline exists
+	vkDestroyShaderModule(LogicalDevice, shaderModule, Allocator);
+
+	if(result != VK_SUCCESS)
+	{
+		throw std::runtime_error("failed to create compute pipeline!");
+	}
+
+	// -- Descriptor sets: one per image, so per image buffers can be bound
+	VkDescriptorPoolSize poolSize = {};
+	poolSize.type = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+	poolSize.descriptorCount = static_cast<uint32_t>(std::max<size_t>(storageBuffers.size(), 1)) * ImageCount;
+
+	VkDescriptorPoolCreateInfo poolCreateInfo = {};
+	poolCreateInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO;
+	poolCreateInfo.maxSets = ImageCount;
+	poolCreateInfo.poolSizeCount = 1;
+	poolCreateInfo.pPoolSizes = &poolSize;
+
+	if(vkCreateDescriptorPool(LogicalDevice, &poolCreateInfo, Allocator, &pipeline.DescriptorPool) != VK_SUCCESS)
+	{
+		throw std::runtime_error("failed to create a compute descriptor pool!");
+	}
+
+	std::vector<VkDescriptorSetLayout> setLayouts(ImageCount, pipeline.SetLayout);
+	pipeline.DescriptorSets.resize(ImageCount);
+
+	VkDescriptorSetAllocateInfo setAllocateInfo = {};
+	setAllocateInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO;
+	setAllocateInfo.descriptorPool = pipeline.DescriptorPool;
+	setAllocateInfo.descriptorSetCount = ImageCount;
+	setAllocateInfo.pSetLayouts = setLayouts.data();
+
+	if(vkAllocateDescriptorSets(LogicalDevice, &setAllocateInfo, pipeline.DescriptorSets.data()) != VK_SUCCESS)
+	{
+		throw std::runtime_error("failed to allocate compute descriptor sets!");
+	}
+
+	for(uint32_t image = 0; image < ImageCount; image++)
+	{
+		std::vector<VkDescriptorBufferInfo> bufferInfos(storageBuffers.size());
+		std::vector<VkWriteDescriptorSet> writes(storageBuffers.size());
+		for(uint32_t i = 0; i < storageBuffers.size(); i++)
+		{
+			bufferInfos[i].buffer = GetStorageBuffer(storageBuffers[i], image);
+			bufferInfos[i].offset = 0;
+			bufferInfos[i].range = VK_WHOLE_SIZE;
+
+			writes[i] = {};
+			writes[i].sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+			writes[i].dstSet = pipeline.DescriptorSets[image];
+			writes[i].dstBinding = i;
+			writes[i].dstArrayElement = 0;
+			writes[i].descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+			writes[i].descriptorCount = 1;
+			writes[i].pBufferInfo = &bufferInfos[i];
+		}
+
+		vkUpdateDescriptorSets(LogicalDevice, static_cast<uint32_t>(writes.size()), writes.data(), 0, nullptr);
+	}
+
+	Pipelines.push_back(pipeline);
+
+	return static_cast<ComputePipelineHandle>(Pipelines.size() - 1);
+}
+
+ComputeDispatchHandle ComputeSystem::AddDispatch(ComputeStage stage, ComputePipelineHandle pipeline,
+	uint32_t groupCountX, uint32_t groupCountY, uint32_t groupCountZ, const void* pushConstants)
+{
+	ComputeDispatch dispatch;
+	dispatch.Stage = stage;
+	dispatch.Pipeline = pipeline;
+	dispatch.GroupCount[0] = groupCountX;
+	dispatch.GroupCount[1] = groupCountY;
+	dispatch.GroupCount[2] = groupCountZ;
+
+	return AddDispatch(std::move(dispatch), pushConstants);
+}
+
+ComputeDispatchHandle ComputeSystem::AddIndirectDispatch(ComputeStage stage, ComputePipelineHandle pipeline,
+	StorageBufferHandle indirectBuffer, VkDeviceSize offset, const void* pushConstants)
+{
+	if(indirectBuffer >= StorageBuffers.size())
+	{
+		throw std::runtime_error("invalid indirect dispatch buffer!");
+	}
+
+	ComputeDispatch dispatch;
+	dispatch.Stage = stage;
+	dispatch.Pipeline = pipeline;
+	dispatch.GroupCount[0] = dispatch.GroupCount[1] = dispatch.GroupCount[2] = 0;
+	dispatch.IndirectBuffer = indirectBuffer;
+	dispatch.IndirectOffset = offset;
+
+	return AddDispatch(std::move(dispatch), pushConstants);
+}
+
+ComputeDispatchHandle ComputeSystem::AddDispatch(ComputeDispatch&& dispatch, const void* pushConstants)
+{
+	if(dispatch.Pipeline >= Pipelines.size())
+	{
+		throw std::runtime_error("invalid compute pipeline!");
+	}
+
+	uint32_t pushConstantSize = Pipelines[dispatch.Pipeline].PushConstantSize;
+	if(pushConstantSize > 0)
+	{
+		if(pushConstants == nullptr)
+		{
+			throw std::runtime_error("compute dispatch is missing its push constants!");
+		}
+
+		dispatch.PushConstants.resize(pushConstantSize);
+		memcpy(dispatch.PushConstants.data(), pushConstants, pushConstantSize);
+	}
+
+	dispatch.bActive = true;
+	Dispatches.push_back(std::move(dispatch));
+	Version++;
+
+	return static_cast<ComputeDispatchHandle>(Dispatches.size() - 1);
+}
+
+void ComputeSystem::RemoveDispatch(ComputeDispatchHandle dispatch)
+{
+	if(dispatch >= Dispatches.size() || !Dispatches[dispatch].bActive)
+	{
+		throw std::runtime_error("invalid compute dispatch!");
+	}
+
+	// keep the slot, so the other handles stay valid
+	Dispatches[dispatch].bActive = false;
+	Dispatches[dispatch].PushConstants.clear();
+	Version++;
+}
+
+void ComputeSystem::RecordDispatches(VkCommandBuffer commandBuffer, uint32_t imageIndex, ComputeStage stage) const
+{
+	bool bFirst = true;
+
+	for(const ComputeDispatch& dispatch : Dispatches)
+	{
+		if(!dispatch.bActive || dispatch.Stage != stage)
+		{
+			continue;
+		}
+
+		VkMemoryBarrier barrier = {};
+		barrier.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
+		if(bFirst)
+		{
+			// buffers written here may still be read by the draws of the previous frame (or this frame's render pass,
+			// after it), and the previous frame's dispatches may still write them
+			barrier.srcAccessMask = VK_ACCESS_SHADER_WRITE_BIT | VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT;
+			barrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT | VK_ACCESS_INDIRECT_COMMAND_READ_BIT;
+			vkCmdPipelineBarrier(commandBuffer,
+				VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT | VK_PIPELINE_STAGE_ALL_GRAPHICS_BIT,
+				VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT | VK_PIPELINE_STAGE_DRAW_INDIRECT_BIT, 0,
+				1, &barrier, 0, nullptr, 0, nullptr);
+			bFirst = false;
+		}
+		else
+		{
+			// dispatches of a stage depend on each other in order (e.g. emit -> simulate -> compact)
+			// indirect dispatches read their group counts in the DRAW_INDIRECT stage
+			barrier.srcAccessMask = VK_ACCESS_SHADER_WRITE_BIT;
+			barrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT | VK_ACCESS_INDIRECT_COMMAND_READ_BIT;
+			vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+				VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT | VK_PIPELINE_STAGE_DRAW_INDIRECT_BIT, 0,
+				1, &barrier, 0, nullptr, 0, nullptr);
+		}
+
+		const ComputePipeline& pipeline = Pipelines[dispatch.Pipeline];
+		vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, pipeline.Pipeline);
+		vkCmdBindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, pipeline.Layout,
+			0, 1, &pipeline.DescriptorSets[imageIndex], 0, nullptr);
+
+		if(!dispatch.PushConstants.empty())
+		{
+			vkCmdPushConstants(commandBuffer, pipeline.Layout, VK_SHADER_STAGE_COMPUTE_BIT, 0,
+				static_cast<uint32_t>(dispatch.PushConstants.size()), dispatch.PushConstants.data());
+		}
+
+		if(dispatch.IndirectBuffer != INVALID_COMPUTE_HANDLE)
+		{
+			vkCmdDispatchIndirect(commandBuffer, GetStorageBuffer(dispatch.IndirectBuffer, imageIndex), dispatch.IndirectOffset);
+		}
+		else
+		{
+			vkCmdDispatch(commandBuffer, dispatch.GroupCount[0], dispatch.GroupCount[1], dispatch.GroupCount[2]);
+		}
+	}
+
+	// make the results visible to whatever comes next: the draws (as vertex, index, indirect or shader data)
+	// before the render pass, or the next frame's dispatches after it
+	if(!bFirst)
+	{
+		VkMemoryBarrier barrier = {};
+		barrier.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
+		barrier.srcAccessMask = VK_ACCESS_SHADER_WRITE_BIT;
+		barrier.dstAccessMask = VK_ACCESS_INDIRECT_COMMAND_READ_BIT | VK_ACCESS_INDEX_READ_BIT
+			| VK_ACCESS_VERTEX_ATTRIBUTE_READ_BIT | VK_ACCESS_SHADER_READ_BIT;
+		vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+			VK_PIPELINE_STAGE_DRAW_INDIRECT_BIT | VK_PIPELINE_STAGE_VERTEX_INPUT_BIT | VK_PIPELINE_STAGE_VERTEX_SHADER_BIT
+			| VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT | VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, 0,
+			1, &barrier, 0, nullptr, 0, nullptr);
+	}
+}
+
+uint64_t ComputeSystem::GetVersion() const
+{
+	return Version;
+}
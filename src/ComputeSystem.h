@@ -0,0 +1,123 @@
+#pragma once
+
+#define GLFW_INCLUDE_VULKAN
+#include <GLFW/glfw3.h>
+
+#include <cstdint>
+#include <vector>
+
+#include "MemoryBudget.h"
+#include "ShaderCompiler.h"
+
+// handles into the compute system, they stay valid until Destroy
+typedef uint32_t StorageBufferHandle;
+typedef uint32_t ComputePipelineHandle;
+typedef uint32_t ComputeDispatchHandle;
+const uint32_t INVALID_COMPUTE_HANDLE = UINT32_MAX;
+
+// where in the frame's command buffer a dispatch is recorded
+enum ComputeStage
+{
+	COMPUTE_STAGE_BEFORE_RENDER_PASS,	// e.g. simulation or culling, results can be read by the draws
+	COMPUTE_STAGE_AFTER_RENDER_PASS		// e.g. post processing or reductions of what was drawn
+};
+
+// compute pipelines, storage buffers and the dispatches recorded into every frame
+// dispatches are persistent: they're recorded into the frame command buffers until they're removed
+// (changing them bumps the version, which makes the renderer re-record its command buffers)
+// everything but GetStorageBufferMapped has to be called from the thread that draws
+class ComputeSystem
+{
+public:
+	ComputeSystem();
+	~ComputeSystem();
+
+	// imageCount: number of swapchain images, i.e. of copies per-image buffers have
+	// everything is made with allocator, the storage buffers are counted in memory's budget
+	void Create(VkPhysicalDevice physicalDevice, VkDevice logicalDevice, uint32_t imageCount,
+		const VkAllocationCallbacks* allocator, MemoryBudget* memory);
+
+	// the device has to be idle
+	void Destroy();
+
+	// - storage buffers
+	// perImage: one copy per swapchain image, so the cpu can update it while other frames are in flight
+	// (only makes sense together with hostVisible). usage can add e.g. VERTEX_BUFFER or INDIRECT_BUFFER
+	StorageBufferHandle CreateStorageBuffer(VkDeviceSize size, bool hostVisible = false, bool perImage = false,
+		VkBufferUsageFlags usage = 0);
+
+	VkBuffer GetStorageBuffer(StorageBufferHandle buffer, uint32_t imageIndex = 0) const;
+
+	// persistently mapped memory of a host visible buffer (nullptr otherwise)
+	void* GetStorageBufferMapped(StorageBufferHandle buffer, uint32_t imageIndex = 0) const;
+
+	// - pipelines
+	// storageBuffers are bound to bindings 0..n-1 of set 0, in order. the bindings can't be changed later
+	// pushConstantSize: bytes of push constants the shader uses (0 for none)
+	ComputePipelineHandle CreateComputePipeline(const ShaderCode& spirv,
+		const std::vector<StorageBufferHandle>& storageBuffers, uint32_t pushConstantSize = 0);
+
+	// - dispatches
+	// pushConstants are copied and have to be pushConstantSize bytes of the pipeline
+	ComputeDispatchHandle AddDispatch(ComputeStage stage, ComputePipelineHandle pipeline,
+		uint32_t groupCountX, uint32_t groupCountY = 1, uint32_t groupCountZ = 1, const void* pushConstants = nullptr);
+
+	// the group counts are read from a VkDispatchIndirectCommand in the buffer at the given offset
+	// (e.g. written by a previous dispatch). the buffer needs INDIRECT_BUFFER usage
+	ComputeDispatchHandle AddIndirectDispatch(ComputeStage stage, ComputePipelineHandle pipeline,
+		StorageBufferHandle indirectBuffer, VkDeviceSize offset = 0, const void* pushConstants = nullptr);
+
+	void RemoveDispatch(ComputeDispatchHandle dispatch);
+
+	// record all dispatches of the stage in order, with the barriers around them
+	// (outside of a render pass)
+	void RecordDispatches(VkCommandBuffer commandBuffer, uint32_t imageIndex, ComputeStage stage) const;
+
+	// changes whenever a dispatch is added or removed
+	uint64_t GetVersion() const;
+
+private:
+	struct StorageBuffer
+	{
+		std::vector<VkBuffer> Buffers;				// one, or one per swapchain image
+		std::vector<VkDeviceMemory> Memories;
+		std::vector<void*> Mapped;
+		VkDeviceSize Size = 0;
+		VkMemoryPropertyFlags MemoryProperties = 0;
+	};
+
+	struct ComputePipeline
+	{
+		VkPipeline Pipeline = VK_NULL_HANDLE;
+		VkPipelineLayout Layout = VK_NULL_HANDLE;
+		VkDescriptorSetLayout SetLayout = VK_NULL_HANDLE;
+		VkDescriptorPool DescriptorPool = VK_NULL_HANDLE;
+		std::vector<VkDescriptorSet> DescriptorSets;		// one per swapchain image
+		uint32_t PushConstantSize = 0;
+	};
+
+	struct ComputeDispatch
+	{
+		bool bActive = false;
+		ComputeStage Stage;
+		ComputePipelineHandle Pipeline;
+		uint32_t GroupCount[3];
+		StorageBufferHandle IndirectBuffer = INVALID_COMPUTE_HANDLE;
+		VkDeviceSize IndirectOffset = 0;
+		std::vector<uint8_t> PushConstants;
+	};
+
+	ComputeDispatchHandle AddDispatch(ComputeDispatch&& dispatch, const void* pushConstants);
+
+private:
+	VkPhysicalDevice PhysicalDevice = VK_NULL_HANDLE;
+	VkDevice LogicalDevice = VK_NULL_HANDLE;
+	const VkAllocationCallbacks* Allocator = nullptr;
+	MemoryBudget* Memory = nullptr;
+	uint32_t ImageCount = 0;
+
+	std::vector<StorageBuffer> StorageBuffers;
+	std::vector<ComputePipeline> Pipelines;
+	std::vector<ComputeDispatch> Dispatches;		// in recording order, removed ones stay inactive
+	uint64_t Version = 0;
+};
@@ -0,0 +1,47 @@
+#include "DeletionQueue.h"
+
+#include <stdexcept>
+
+DeletionQueue::DeletionQueue()
+{
+
+}
+
+DeletionQueue::~DeletionQueue()
+{
+
+}
+
+void DeletionQueue::Push(uint64_t retireFrame, std::function<void()> destroy)
+{
+	if(!Deletions.empty() && Deletions.back().RetireFrame > retireFrame)
+	{
+		throw std::runtime_error("deletions have to be queued in frame order!");
+	}
+
+	Deletions.push_back({retireFrame, std::move(destroy)});
+}
+
+void DeletionQueue::Flush(uint64_t completedFrames)
+{
+	// sorted by frame, so only the front needs to be checked
+	while(!Deletions.empty() && Deletions.front().RetireFrame <= completedFrames)
+	{
+		Deletions.front().Destroy();
+		Deletions.pop_front();
+	}
+}
+
+void DeletionQueue::FlushAll()
+{
+	while(!Deletions.empty())
+	{
+		Deletions.front().Destroy();
+		Deletions.pop_front();
+	}
+}
+
+size_t DeletionQueue::GetSize() const
+{
+	return Deletions.size();
+}
@@ -0,0 +1,35 @@
+#pragma once
+
+#include <cstdint>
+#include <deque>
+#include <functional>
+
+// resources the gpu may still be using can't be destroyed right away
+// instead they are queued with the frame they were last used in and destroyed once that frame has finished
+class DeletionQueue
+{
+public:
+	DeletionQueue();
+	~DeletionQueue();
+
+	// destroy is run once the first retireFrame frames have finished on the gpu
+	// (usually the number of frames submitted so far). retire frames have to be pushed in increasing order
+	void Push(uint64_t retireFrame, std::function<void()> destroy);
+
+	// run all deletions that are retired once the first completedFrames frames have finished
+	void Flush(uint64_t completedFrames);
+
+	// run all deletions, the device has to be idle
+	void FlushAll();
+
+	size_t GetSize() const;
+
+private:
+	struct Deletion
+	{
+		uint64_t RetireFrame;
+		std::function<void()> Destroy;
+	};
+
+	std::deque<Deletion> Deletions;
+};
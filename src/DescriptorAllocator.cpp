@@ -0,0 +1,398 @@
+#include "DescriptorAllocator.h"
+
+#include <algorithm>
+#include <cmath>
+#include <stdexcept>
+
+// the pools double in size when they run out, until they hold this many sets
+static const uint32_t MAX_SETS_PER_POOL = 4096;
+
+// which of the info structs a descriptor type is written with
+enum DescriptorInfoKind
+{
+	DESCRIPTOR_INFO_BUFFER,			// VkDescriptorBufferInfo
+	DESCRIPTOR_INFO_IMAGE,			// VkDescriptorImageInfo
+	DESCRIPTOR_INFO_TEXEL_BUFFER	// VkBufferView
+};
+
+static DescriptorInfoKind GetDescriptorInfoKind(VkDescriptorType type)
+{
+	switch(type)
+	{
+	case VK_DESCRIPTOR_TYPE_SAMPLER:
+	case VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER:
+	case VK_DESCRIPTOR_TYPE_SAMPLED_IMAGE:
+	case VK_DESCRIPTOR_TYPE_STORAGE_IMAGE:
+	case VK_DESCRIPTOR_TYPE_INPUT_ATTACHMENT:
+		return DESCRIPTOR_INFO_IMAGE;
+	case VK_DESCRIPTOR_TYPE_UNIFORM_TEXEL_BUFFER:
+	case VK_DESCRIPTOR_TYPE_STORAGE_TEXEL_BUFFER:
+		return DESCRIPTOR_INFO_TEXEL_BUFFER;
+	default:
+		return DESCRIPTOR_INFO_BUFFER;
+	}
+}
+
+// -- DescriptorLayoutCache
+
+DescriptorLayoutCache::DescriptorLayoutCache()
+{
+
+}
+
+DescriptorLayoutCache::~DescriptorLayoutCache()
+{
+
+}
+
+void DescriptorLayoutCache::Create(VkDevice device, const VkAllocationCallbacks* allocator)
+{
+	Device = device;
+	Allocator = allocator;
+}
+
+void DescriptorLayoutCache::Destroy()
+{
+	std::lock_guard<std::mutex> lock(Mutex);
+
+	for(auto& layout : Layouts)
+	{
+		vkDestroyDescriptorSetLayout(Device, layout.second, Allocator);
+	}
+	Layouts.clear();
+}
+
+VkDescriptorSetLayout DescriptorLayoutCache::Get(const VkDescriptorSetLayoutBinding* bindings, uint32_t bindingCount)
+{
+	LayoutKey key;
+	key.Bindings.assign(bindings, bindings + bindingCount);
+	std::sort(key.Bindings.begin(), key.Bindings.end(),
+		[](const VkDescriptorSetLayoutBinding& a, const VkDescriptorSetLayoutBinding& b)
+		{
+			return a.binding < b.binding;
+		});
+
+	std::lock_guard<std::mutex> lock(Mutex);
+
+	auto found = Layouts.find(key);
+	if(found != Layouts.end())
+	{
+		return found->second;
+	}
+
+	VkDescriptorSetLayoutCreateInfo layoutCreateInfo = {};
+	layoutCreateInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO;
+	layoutCreateInfo.bindingCount = bindingCount;
+	layoutCreateInfo.pBindings = key.Bindings.data();
+
+	VkDescriptorSetLayout layout;
+	VkResult result = vkCreateDescriptorSetLayout(Device, &layoutCreateInfo, Allocator, &layout);
+	if(result != VK_SUCCESS)
+	{
+		throw std::runtime_error("failed to create a descriptor set layout!");
+	}
+	Layouts[key] = layout;
+
+	return layout;
+}
+
+uint32_t DescriptorLayoutCache::GetLayoutCount() const
+{
+	std::lock_guard<std::mutex> lock(Mutex);
+
+	return static_cast<uint32_t>(Layouts.size());
+}
+
+bool DescriptorLayoutCache::LayoutKey::operator==(const LayoutKey& other) const
+{
+	if(Bindings.size() != other.Bindings.size())
+	{
+		return false;
+	}
+
+	for(size_t i = 0; i < Bindings.size(); i++)
+	{
+		const VkDescriptorSetLayoutBinding& a = Bindings[i];
+		const VkDescriptorSetLayoutBinding& b = other.Bindings[i];
+		if(a.binding != b.binding || a.descriptorType != b.descriptorType || a.descriptorCount != b.descriptorCount
+			|| a.stageFlags != b.stageFlags || a.pImmutableSamplers != b.pImmutableSamplers)
+		{
+			return false;
+		}
+	}
+
+	return true;
+}
+
+size_t DescriptorLayoutCache::LayoutKeyHash::operator()(const LayoutKey& key) const
+{
+	// fnv-1a over the fields that make a binding
+	uint64_t hash = 0xCBF29CE484222325ull;
+	auto add = [&hash](uint64_t value)
+	{
+		hash ^= value;
+		hash *= 0x100000001B3ull;
+	};
+
+	for(const VkDescriptorSetLayoutBinding& binding : key.Bindings)
+	{
+		add(binding.binding);
+		add(binding.descriptorType);
+		add(binding.descriptorCount);
+		add(binding.stageFlags);
+	}
+
+	return static_cast<size_t>(hash);
+}
+
+// -- DescriptorAllocator
+
+DescriptorAllocator::DescriptorAllocator()
+{
+
+}
+
+DescriptorAllocator::~DescriptorAllocator()
+{
+
+}
+
+void DescriptorAllocator::Create(VkDevice device, const VkAllocationCallbacks* allocator, uint32_t setsPerPool,
+	const std::vector<DescriptorPoolRatio>& ratios)
+{
+	Device = device;
+	Allocator = allocator;
+	SetsPerPool = std::max(setsPerPool, 1u);
+	Ratios = ratios;
+}
+
+void DescriptorAllocator::Destroy()
+{
+	for(VkDescriptorPool pool : ReadyPools)
+	{
+		vkDestroyDescriptorPool(Device, pool, Allocator);
+	}
+	for(VkDescriptorPool pool : FullPools)
+	{
+		vkDestroyDescriptorPool(Device, pool, Allocator);
+	}
+	ReadyPools.clear();
+	FullPools.clear();
+}
+
+VkDescriptorSet DescriptorAllocator::Allocate(VkDescriptorSetLayout layout)
+{
+	VkDescriptorPool pool = GetPool();
+
+	VkDescriptorSetAllocateInfo allocInfo = {};
+	allocInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO;
+	allocInfo.descriptorPool = pool;
+	allocInfo.descriptorSetCount = 1;
+	allocInfo.pSetLayouts = &layout;
+
+	VkDescriptorSet set;
+	VkResult result = vkAllocateDescriptorSets(Device, &allocInfo, &set);
+
+	// the pool ran out: retire it and try again with a fresh one. without maintenance1 (vulkan 1.0) an exhausted
+	// pool doesn't have to report VK_ERROR_OUT_OF_POOL_MEMORY, it may be fragmented or any other error
+	if(result != VK_SUCCESS)
+	{
+		ReadyPools.pop_back();
+		FullPools.push_back(pool);
+
+		allocInfo.descriptorPool = GetPool();
+		result = vkAllocateDescriptorSets(Device, &allocInfo, &set);
+	}
+
+	if(result != VK_SUCCESS)
+	{
+		throw std::runtime_error("could not allocate a descriptor set!");
+	}
+
+	return set;
+}
+
+void DescriptorAllocator::Reset()
+{
+	for(VkDescriptorPool pool : ReadyPools)
+	{
+		vkResetDescriptorPool(Device, pool, 0);
+	}
+	for(VkDescriptorPool pool : FullPools)
+	{
+		vkResetDescriptorPool(Device, pool, 0);
+		ReadyPools.push_back(pool);
+	}
+	FullPools.clear();
+}
+
+uint32_t DescriptorAllocator::GetPoolCount() const
+{
+	return static_cast<uint32_t>(ReadyPools.size() + FullPools.size());
+}
+
+VkDescriptorPool DescriptorAllocator::GetPool()
+{
+	if(!ReadyPools.empty())
+	{
+		return ReadyPools.back();
+	}
+
+	// every new pool is bigger, so a growing number of sets needs only a few pools
+	VkDescriptorPool pool = CreatePool(SetsPerPool);
+	SetsPerPool = std::min(SetsPerPool * 2, MAX_SETS_PER_POOL);
+	ReadyPools.push_back(pool);
+
+	return pool;
+}
+
+VkDescriptorPool DescriptorAllocator::CreatePool(uint32_t setCount)
+{
+	std::vector<VkDescriptorPoolSize> poolSizes;
+	poolSizes.reserve(Ratios.size());
+	for(const DescriptorPoolRatio& ratio : Ratios)
+	{
+		VkDescriptorPoolSize poolSize = {};
+		poolSize.type = ratio.Type;
+		poolSize.descriptorCount = std::max(static_cast<uint32_t>(std::ceil(ratio.PerSet * setCount)), 1u);
+		poolSizes.push_back(poolSize);
+	}
+
+	VkDescriptorPoolCreateInfo createInfo = {};
+	createInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO;
+	createInfo.maxSets = setCount;
+	createInfo.poolSizeCount = static_cast<uint32_t>(poolSizes.size());
+	createInfo.pPoolSizes = poolSizes.data();
+
+	VkDescriptorPool pool;
+	VkResult result = vkCreateDescriptorPool(Device, &createInfo, Allocator, &pool);
+	if(result != VK_SUCCESS)
+	{
+		throw std::runtime_error("failed to create a descriptor pool!");
+	}
+
+	return pool;
+}
+
+// -- DescriptorUpdateTemplate
+
+DescriptorUpdateTemplate::DescriptorUpdateTemplate()
+{
+
+}
+
+DescriptorUpdateTemplate::~DescriptorUpdateTemplate()
+{
+
+}
+
+void DescriptorUpdateTemplate::Create(VkDevice device, const VkAllocationCallbacks* allocator, VkDescriptorSetLayout layout,
+	const std::vector<Entry>& entries, bool useTemplate)
+{
+	Device = device;
+	Allocator = allocator;
+	Entries = entries;
+
+	if(!useTemplate)
+	{
+		return;
+	}
+
+	// core in 1.1, so they have to be fetched from the device
+	auto createTemplate = (PFN_vkCreateDescriptorUpdateTemplate) vkGetDeviceProcAddr(Device, "vkCreateDescriptorUpdateTemplate");
+	UpdateWithTemplate = (PFN_vkUpdateDescriptorSetWithTemplate) vkGetDeviceProcAddr(Device, "vkUpdateDescriptorSetWithTemplate");
+	DestroyTemplate = (PFN_vkDestroyDescriptorUpdateTemplate) vkGetDeviceProcAddr(Device, "vkDestroyDescriptorUpdateTemplate");
+	if(createTemplate == nullptr || UpdateWithTemplate == nullptr || DestroyTemplate == nullptr)
+	{
+		UpdateWithTemplate = nullptr;
+		return;
+	}
+
+	std::vector<VkDescriptorUpdateTemplateEntry> templateEntries;
+	templateEntries.reserve(Entries.size());
+	for(const Entry& entry : Entries)
+	{
+		VkDescriptorUpdateTemplateEntry templateEntry = {};
+		templateEntry.dstBinding = entry.Binding;
+		templateEntry.dstArrayElement = 0;
+		templateEntry.descriptorCount = entry.DescriptorCount;
+		templateEntry.descriptorType = entry.Type;
+		templateEntry.offset = entry.Offset;
+		switch(GetDescriptorInfoKind(entry.Type))
+		{
+		case DESCRIPTOR_INFO_IMAGE:
+			templateEntry.stride = sizeof(VkDescriptorImageInfo);
+			break;
+		case DESCRIPTOR_INFO_TEXEL_BUFFER:
+			templateEntry.stride = sizeof(VkBufferView);
+			break;
+		default:
+			templateEntry.stride = sizeof(VkDescriptorBufferInfo);
+			break;
+		}
+		templateEntries.push_back(templateEntry);
+	}
+
+	VkDescriptorUpdateTemplateCreateInfo createInfo = {};
+	createInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_UPDATE_TEMPLATE_CREATE_INFO;
+	createInfo.descriptorUpdateEntryCount = static_cast<uint32_t>(templateEntries.size());
+	createInfo.pDescriptorUpdateEntries = templateEntries.data();
+	createInfo.templateType = VK_DESCRIPTOR_UPDATE_TEMPLATE_TYPE_DESCRIPTOR_SET;
+	createInfo.descriptorSetLayout = layout;
+
+	VkResult result = createTemplate(Device, &createInfo, Allocator, &Template);
+	if(result != VK_SUCCESS)
+	{
+		throw std::runtime_error("failed to create a descriptor update template!");
+	}
+}
+
+void DescriptorUpdateTemplate::Destroy()
+{
+	if(Template != VK_NULL_HANDLE)
+	{
+		DestroyTemplate(Device, Template, Allocator);
+		Template = VK_NULL_HANDLE;
+	}
+	UpdateWithTemplate = nullptr;
+	Entries.clear();
+}
+
+void DescriptorUpdateTemplate::Update(VkDescriptorSet set, const void* data) const
+{
+	if(Template != VK_NULL_HANDLE)
+	{
+		UpdateWithTemplate(Device, set, Template, data);
+		return;
+	}
+
+	// one write per entry, pointing into the same data the template would read
+	const char* bytes = static_cast<const char*>(data);
+	std::vector<VkWriteDescriptorSet> writes(Entries.size());
+	for(size_t i = 0; i < Entries.size(); i++)
+	{
+		const Entry& entry = Entries[i];
+
+		VkWriteDescriptorSet& write = writes[i];
+		write.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+		write.dstSet = set;
+		write.dstBinding = entry.Binding;
+		write.dstArrayElement = 0;
+		write.descriptorType = entry.Type;
+		write.descriptorCount = entry.DescriptorCount;
+		switch(GetDescriptorInfoKind(entry.Type))
+		{
+		case DESCRIPTOR_INFO_IMAGE:
+			write.pImageInfo = reinterpret_cast<const VkDescriptorImageInfo*>(bytes + entry.Offset);
+			break;
+		case DESCRIPTOR_INFO_TEXEL_BUFFER:
+			write.pTexelBufferView = reinterpret_cast<const VkBufferView*>(bytes + entry.Offset);
+			break;
+		default:
+			write.pBufferInfo = reinterpret_cast<const VkDescriptorBufferInfo*>(bytes + entry.Offset);
+			break;
+		}
+	}
+
+	vkUpdateDescriptorSets(Device, static_cast<uint32_t>(writes.size()), writes.data(), 0, nullptr);
+}
@@ -0,0 +1,127 @@
+#pragma once
+
+#define GLFW_INCLUDE_VULKAN
+#include <GLFW/glfw3.h>
+
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <unordered_map>
+#include <vector>
+
+// descriptor set layouts, one per unique set of bindings. whoever asks for the same bindings
+// gets the same layout, which also makes the pipeline layouts built from them shareable
+class DescriptorLayoutCache
+{
+public:
+	DescriptorLayoutCache();
+	~DescriptorLayoutCache();
+
+	void Create(VkDevice device, const VkAllocationCallbacks* allocator);
+	void Destroy();
+
+	// the order of the bindings doesn't matter. can be called from any thread
+	VkDescriptorSetLayout Get(const VkDescriptorSetLayoutBinding* bindings, uint32_t bindingCount);
+
+	uint32_t GetLayoutCount() const;
+
+private:
+	struct LayoutKey
+	{
+		std::vector<VkDescriptorSetLayoutBinding> Bindings;		// sorted by binding
+
+		bool operator==(const LayoutKey& other) const;
+	};
+
+	struct LayoutKeyHash
+	{
+		size_t operator()(const LayoutKey& key) const;
+	};
+
+private:
+	VkDevice Device = VK_NULL_HANDLE;
+	const VkAllocationCallbacks* Allocator = nullptr;
+
+	mutable std::mutex Mutex;
+	std::unordered_map<LayoutKey, VkDescriptorSetLayout, LayoutKeyHash> Layouts;
+};
+
+// descriptors of one type a pool holds per descriptor set, e.g. { VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER, 2.0f }
+struct DescriptorPoolRatio
+{
+	VkDescriptorType Type;
+	float PerSet;
+};
+
+// allocates descriptor sets from a chain of pools: when the current pool is exhausted, the next one
+// (twice as big, up to a limit) is created instead of failing. Reset hands all sets back at once and keeps
+// the pools for the next round, so per frame sets cost nothing but the allocation.
+// not thread safe, every thread (or frame) needs its own allocator
+class DescriptorAllocator
+{
+public:
+	DescriptorAllocator();
+	~DescriptorAllocator();
+
+	// setsPerPool: size of the first pool, pools are only created once they are needed
+	void Create(VkDevice device, const VkAllocationCallbacks* allocator, uint32_t setsPerPool,
+		const std::vector<DescriptorPoolRatio>& ratios);
+	void Destroy();
+
+	VkDescriptorSet Allocate(VkDescriptorSetLayout layout);
+
+	// free all sets of all pools. none of them may still be in use by the gpu
+	void Reset();
+
+	uint32_t GetPoolCount() const;
+
+private:
+	// a pool with room left, or a new one
+	VkDescriptorPool GetPool();
+	VkDescriptorPool CreatePool(uint32_t setCount);
+
+private:
+	VkDevice Device = VK_NULL_HANDLE;
+	const VkAllocationCallbacks* Allocator = nullptr;
+	std::vector<DescriptorPoolRatio> Ratios;
+	uint32_t SetsPerPool = 0;
+
+	std::vector<VkDescriptorPool> ReadyPools;		// with room left, the last one is allocated from
+	std::vector<VkDescriptorPool> FullPools;
+};
+
+// writes every descriptor of a set in one call from a struct of the caller's, instead of filling a
+// VkWriteDescriptorSet per binding: the entries give the offset of each binding's descriptor info in it.
+// falls back to vkUpdateDescriptorSets where templates aren't available (vulkan 1.0)
+class DescriptorUpdateTemplate
+{
+public:
+	// descriptorCount infos of the type's info struct (VkDescriptorBufferInfo, VkDescriptorImageInfo or
+	// VkBufferView), tightly packed starting at offset
+	struct Entry
+	{
+		uint32_t Binding;
+		VkDescriptorType Type;
+		uint32_t DescriptorCount;
+		size_t Offset;
+	};
+
+	DescriptorUpdateTemplate();
+	~DescriptorUpdateTemplate();
+
+	void Create(VkDevice device, const VkAllocationCallbacks* allocator, VkDescriptorSetLayout layout,
+		const std::vector<Entry>& entries, bool useTemplate);
+	void Destroy();
+
+	// data: the caller's struct the entries point into
+	void Update(VkDescriptorSet set, const void* data) const;
+
+private:
+	VkDevice Device = VK_NULL_HANDLE;
+	const VkAllocationCallbacks* Allocator = nullptr;
+	std::vector<Entry> Entries;
+
+	VkDescriptorUpdateTemplate Template = VK_NULL_HANDLE;
+	PFN_vkUpdateDescriptorSetWithTemplate UpdateWithTemplate = nullptr;
+	PFN_vkDestroyDescriptorUpdateTemplate DestroyTemplate = nullptr;
+};
@@ -0,0 +1,104 @@
+#include "FixedTimestep.h"
+
+#include <algorithm>
+#include <cmath>
+
+#include <glm/gtc/quaternion.hpp>
+
+FixedTimestep::FixedTimestep(double stepDuration_s, uint32_t maxStepsPerFrame)
+	: StepDuration_s(stepDuration_s), MaxStepsPerFrame(maxStepsPerFrame)
+{
+
+}
+
+uint32_t FixedTimestep::Advance(double frameTime_s)
+{
+	Accumulator_s += std::max(frameTime_s, 0.0);
+
+	uint32_t steps = 0;
+	while(Accumulator_s >= StepDuration_s && steps < MaxStepsPerFrame)
+	{
+		Accumulator_s -= StepDuration_s;
+		steps++;
+	}
+
+	// don't try to catch up on more than we can simulate in one frame,
+	// otherwise every following frame gets slower (and has to simulate even more)
+	if(Accumulator_s >= StepDuration_s)
+	{
+		Accumulator_s = std::fmod(Accumulator_s, StepDuration_s);
+	}
+
+	StepCount += steps;
+
+	return steps;
+}
+
+float FixedTimestep::GetAlpha() const
+{
+	return static_cast<float>(Accumulator_s / StepDuration_s);
+}
+
+double FixedTimestep::GetStepDuration() const
+{
+	return StepDuration_s;
+}
+
+uint64_t FixedTimestep::GetStepCount() const
+{
+	return StepCount;
+}
+
+double FixedTimestep::GetSimulationTime() const
+{
+	return StepCount * StepDuration_s;
+}
+
+// the rotation can only be taken out of a transform that scales every axis by something and doesn't mirror
+// (a negative determinant would make the rotation the mirror image of the real one)
+static bool DecomposeScale(const glm::mat4& transform, glm::vec3& scale)
+{
+	glm::vec3 x(transform[0]);
+	glm::vec3 y(transform[1]);
+	glm::vec3 z(transform[2]);
+	scale = glm::vec3(glm::length(x), glm::length(y), glm::length(z));
+
+	const float epsilon = 1e-6f;
+	return scale.x > epsilon && scale.y > epsilon && scale.z > epsilon && glm::dot(glm::cross(x, y), z) > 0.0f;
+}
+
+glm::mat4 InterpolateTransform(const glm::mat4& previous, const glm::mat4& current, float alpha)
+{
+	if(alpha <= 0.0f || previous == current)
+	{
+		return previous;
+	}
+	if(alpha >= 1.0f)
+	{
+		return current;
+	}
+
+	// split both matrices into translation, rotation and scale
+	glm::vec3 previousScale;
+	glm::vec3 currentScale;
+	if(!DecomposeScale(previous, previousScale) || !DecomposeScale(current, currentScale))
+	{
+		// no rotation to slerp, the division by the scale would give NaNs
+		return previous * (1.0f - alpha) + current * alpha;
+	}
+
+	glm::mat3 previousRotation(glm::vec3(previous[0]) / previousScale.x, glm::vec3(previous[1]) / previousScale.y, glm::vec3(previous[2]) / previousScale.z);
+	glm::mat3 currentRotation(glm::vec3(current[0]) / currentScale.x, glm::vec3(current[1]) / currentScale.y, glm::vec3(current[2]) / currentScale.z);
+
+	glm::quat rotation = glm::slerp(glm::quat_cast(previousRotation), glm::quat_cast(currentRotation), alpha);
+	glm::vec3 scale = glm::mix(previousScale, currentScale, alpha);
+	glm::vec3 translation = glm::mix(glm::vec3(previous[3]), glm::vec3(current[3]), alpha);
+
+	glm::mat4 result = glm::mat4_cast(rotation);
+	result[0] *= scale.x;
+	result[1] *= scale.y;
+	result[2] *= scale.z;
+	result[3] = glm::vec4(translation, 1.0f);
+
+	return result;
+}
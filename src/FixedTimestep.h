@@ -0,0 +1,43 @@
+#pragma once
+
+#include <cstdint>
+
+#include <glm/glm.hpp>
+
+// decouples the simulation rate from the frame rate:
+// the elapsed (real or benchmark) time is accumulated and consumed in steps of a fixed duration,
+// so every simulation step does the same amount of work and gives the same result, whatever the frame rate.
+// the time that is left over is used to interpolate between the last two simulated states when rendering
+class FixedTimestep
+{
+public:
+	// maxStepsPerFrame limits how far the simulation may catch up in a single frame.
+	// if it falls further behind (e.g. after a breakpoint or a very slow frame), the rest is dropped
+	FixedTimestep(double stepDuration_s = 1.0 / 60.0, uint32_t maxStepsPerFrame = 8);
+
+	// add the time that passed since the last frame and return the number of steps to simulate now
+	// the scheduler doesn't read a clock itself, so headless runs can feed it a fixed frame time
+	uint32_t Advance(double frameTime_s);
+
+	// how far the render time lies between the previous and the current simulation step [0, 1]
+	float GetAlpha() const;
+
+	double GetStepDuration() const;
+
+	// number of simulation steps run so far, i.e. the simulation time in steps
+	uint64_t GetStepCount() const;
+
+	double GetSimulationTime() const;
+
+private:
+	double StepDuration_s;
+	uint32_t MaxStepsPerFrame;
+
+	double Accumulator_s = 0.0;
+	uint64_t StepCount = 0;
+};
+
+// blend between two transforms of the same node
+// translation and scale are interpolated linearly, the rotation is slerped (so it doesn't shear or shrink).
+// transforms without a proper rotation (zero scale, mirrored) are blended component-wise instead
+glm::mat4 InterpolateTransform(const glm::mat4& previous, const glm::mat4& current, float alpha);
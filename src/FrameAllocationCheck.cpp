@@ -0,0 +1,177 @@
+#include "FrameAllocationCheck.h"
+
+FrameAllocationScope::FrameAllocationScope()
+{
+	FrameAllocationCheck::BeginFrame();
+}
+
+FrameAllocationScope::~FrameAllocationScope()
+{
+	FrameAllocationCheck::EndFrame();
+}
+
+#ifdef FRAME_ALLOCATION_CHECK
+
+#include <cassert>
+#include <cstdio>
+#include <cstdlib>
+#include <new>
+
+#ifdef _WIN32
+#include <malloc.h>
+#endif
+
+static thread_local bool bInFrame = false;
+static thread_local uint32_t AllowanceDepth = 0;
+static thread_local uint64_t FrameAllocations = 0;
+static thread_local uint64_t TotalFrameAllocations = 0;
+
+static void CountAllocation(size_t size)
+{
+	if(!bInFrame || AllowanceDepth > 0)
+	{
+		return;
+	}
+
+	FrameAllocations++;
+	TotalFrameAllocations++;
+
+	// printf doesn't allocate through operator new, so it's safe in here
+	fprintf(stderr, "heap allocation of %zu bytes inside a frame\n", size);
+	assert(!"heap allocation inside a frame");
+}
+
+void FrameAllocationCheck::BeginFrame()
+{
+	bInFrame = true;
+	FrameAllocations = 0;
+}
+
+void FrameAllocationCheck::EndFrame()
+{
+	bInFrame = false;
+}
+
+uint64_t FrameAllocationCheck::GetFrameAllocationCount()
+{
+	return FrameAllocations;
+}
+
+uint64_t FrameAllocationCheck::GetTotalFrameAllocationCount()
+{
+	return TotalFrameAllocations;
+}
+
+bool FrameAllocationCheck::IsEnabled()
+{
+	return true;
+}
+
+FrameAllocationAllowance::FrameAllocationAllowance()
+{
+	AllowanceDepth++;
+}
+
+FrameAllocationAllowance::~FrameAllocationAllowance()
+{
+	AllowanceDepth--;
+}
+
+// replacements of the global allocation functions. the array and nothrow versions call these by default
+void* operator new(size_t size)
+{
+	CountAllocation(size);
+
+	void* memory = malloc(size > 0 ? size : 1);
+	if(memory == nullptr)
+	{
+		throw std::bad_alloc();
+	}
+	return memory;
+}
+
+void* operator new(size_t size, std::align_val_t alignment)
+{
+	CountAllocation(size);
+
+	size_t align = static_cast<size_t>(alignment);
+#ifdef _WIN32
+	// msvc has no aligned_alloc, its aligned blocks have to be freed with _aligned_free
+	void* memory = _aligned_malloc(size > 0 ? size : 1, align);
+#else
+	// aligned_alloc needs the size to be a multiple of the alignment
+	void* memory = aligned_alloc(align, ((size > 0 ? size : 1) + align - 1) / align * align);
+#endif
+	if(memory == nullptr)
+	{
+		throw std::bad_alloc();
+	}
+	return memory;
+}
+
+void operator delete(void* memory) noexcept
+{
+	free(memory);
+}
+
+void operator delete(void* memory, size_t size) noexcept
+{
+	free(memory);
+}
+
+void operator delete(void* memory, std::align_val_t alignment) noexcept
+{
+#ifdef _WIN32
+	_aligned_free(memory);
+#else
+	free(memory);
+#endif
+}
+
+void operator delete(void* memory, size_t size, std::align_val_t alignment) noexcept
+{
+#ifdef _WIN32
+	_aligned_free(memory);
+#else
+	free(memory);
+#endif
+}
+
+#else
+
+void FrameAllocationCheck::BeginFrame()
+{
+
+}
+
+void FrameAllocationCheck::EndFrame()
+{
+
+}
+
+uint64_t FrameAllocationCheck::GetFrameAllocationCount()
+{
+	return 0;
+}
+
+uint64_t FrameAllocationCheck::GetTotalFrameAllocationCount()
+{
+	return 0;
+}
+
+bool FrameAllocationCheck::IsEnabled()
+{
+	return false;
+}
+
+FrameAllocationAllowance::FrameAllocationAllowance()
+{
+
+}
+
+FrameAllocationAllowance::~FrameAllocationAllowance()
+{
+
+}
+
+#endif
@@ -0,0 +1,44 @@
+#pragma once
+
+#include <cstdint>
+
+// counts global heap allocations (operator new) made by the thread that draws while a frame is being drawn
+// the counting replaces the global operator new and is only built with FRAME_ALLOCATION_CHECK
+// (cmake -DFRAME_ALLOCATION_CHECK=ON), otherwise every function here is a no-op.
+// with the check, a heap allocation inside a frame asserts (in debug builds)
+class FrameAllocationCheck
+{
+public:
+	// frame scope on the calling thread
+	static void BeginFrame();
+	static void EndFrame();
+
+	// heap allocations inside the last (or current) frame of the calling thread, and all frames so far
+	static uint64_t GetFrameAllocationCount();
+	static uint64_t GetTotalFrameAllocationCount();
+
+	static bool IsEnabled();
+};
+
+// BeginFrame / EndFrame for a scope, also when it is left through an exception
+class FrameAllocationScope
+{
+public:
+	FrameAllocationScope();
+	~FrameAllocationScope();
+
+	FrameAllocationScope(const FrameAllocationScope&) = delete;
+	FrameAllocationScope& operator=(const FrameAllocationScope&) = delete;
+};
+
+// allows heap allocations on the calling thread while it is alive
+// for the parts of a frame that only run when something changes (uploads, evictions, shader reloads, ...)
+class FrameAllocationAllowance
+{
+public:
+	FrameAllocationAllowance();
+	~FrameAllocationAllowance();
+
+	FrameAllocationAllowance(const FrameAllocationAllowance&) = delete;
+	FrameAllocationAllowance& operator=(const FrameAllocationAllowance&) = delete;
+};
@@ -0,0 +1,202 @@
+#include "FrameCapture.h"
+
+#include <cstdio>
+#include <filesystem>
+#include <fstream>
+#include <stdexcept>
+
+FrameCapture::FrameCapture()
+	: bRunning(false), WrittenFrames(0), DroppedFrames(0)
+{
+
+}
+
+FrameCapture::~FrameCapture()
+{
+	Stop();
+}
+
+void FrameCapture::Start(const CaptureSettings& settings, FrameReadback* readback)
+{
+	if(bRunning)
+	{
+		throw std::runtime_error("frame capture is running already!");
+	}
+	if(readback == nullptr || !readback->IsEnabled())
+	{
+		throw std::runtime_error("frame capture needs frame readback to be enabled!");
+	}
+	if(settings.EncoderCount == 0 || settings.QueueSize == 0)
+	{
+		throw std::runtime_error("frame capture needs at least one encoder and queue entry!");
+	}
+
+	std::filesystem::create_directories(settings.Directory);
+
+	Settings = settings;
+	Readback = readback;
+	bStopRequested = false;
+
+	for(uint32_t i = 0; i < Settings.EncoderCount; i++)
+	{
+		Encoders.emplace_back(&FrameCapture::EncoderLoop, this);
+	}
+
+	bRunning = true;
+}
+
+void FrameCapture::Stop()
+{
+	if(Encoders.empty())
+	{
+		return;
+	}
+
+	bRunning = false;
+	{
+		std::lock_guard<std::mutex> lock(QueueMutex);
+		bStopRequested = true;
+	}
+	QueueCondition.notify_all();
+
+	for(std::thread& encoder : Encoders)
+	{
+		encoder.join();
+	}
+	Encoders.clear();
+}
+
+bool FrameCapture::IsRunning() const
+{
+	return bRunning;
+}
+
+void FrameCapture::Poll()
+{
+	if(!bRunning)
+	{
+		return;
+	}
+
+	ReadbackFrame frame;
+	while(Readback->Acquire(frame))
+	{
+		std::unique_lock<std::mutex> lock(QueueMutex);
+
+		// stopped while we were acquiring, nobody would encode the frame anymore
+		if(bStopRequested)
+		{
+			lock.unlock();
+			Readback->Release(frame);
+			return;
+		}
+
+		if(Queue.size() >= Settings.QueueSize)
+		{
+			DroppedFrames++;
+
+			if(Settings.DropPolicy == CAPTURE_DROP_NEWEST)
+			{
+				lock.unlock();
+				Readback->Release(frame);
+				continue;
+			}
+
+			Readback->Release(Queue.front());
+			Queue.pop_front();
+		}
+
+		Queue.push_back(frame);
+		lock.unlock();
+		QueueCondition.notify_one();
+	}
+}
+
+uint64_t FrameCapture::GetWrittenFrameCount() const
+{
+	return WrittenFrames;
+}
+
+uint64_t FrameCapture::GetDroppedFrameCount() const
+{
+	return DroppedFrames;
+}
+
+void FrameCapture::EncoderLoop()
+{
+	while(true)
+	{
+		ReadbackFrame frame;
+		{
+			std::unique_lock<std::mutex> lock(QueueMutex);
+			QueueCondition.wait(lock, [this]() { return !Queue.empty() || bStopRequested; });
+
+			// drain the queue before stopping
+			if(Queue.empty())
+			{
+				return;
+			}
+
+			frame = Queue.front();
+			Queue.pop_front();
+		}
+
+		try
+		{
+			WriteFrame(frame);
+			WrittenFrames++;
+		}
+		catch(const std::runtime_error &e)
+		{
+			printf("ERROR: %s\n", e.what());
+			DroppedFrames++;
+		}
+
+		// the slot can be reused by the readback now
+		Readback->Release(frame);
+	}
+}
+
+void FrameCapture::WriteFrame(const ReadbackFrame& frame)
+{
+	char fileName[64];
+	snprintf(fileName, sizeof(fileName), "frame_%06llu.%s", static_cast<unsigned long long>(frame.FrameNumber),
+		Settings.Format == CAPTURE_FORMAT_PPM ? "ppm" : "raw");
+	std::filesystem::path path = std::filesystem::path(Settings.Directory) / fileName;
+
+	std::ofstream file(path, std::ios::binary);
+	if(!file.is_open())
+	{
+		throw std::runtime_error("failed to open capture file at " + path.string());
+	}
+
+	if(Settings.Format == CAPTURE_FORMAT_RAW)
+	{
+		file.write(reinterpret_cast<const char*>(frame.Data), frame.Size);
+	}
+	else
+	{
+		file << "P6\n" << frame.Width << " " << frame.Height << "\n255\n";
+
+		// ppm is rgb without alpha, the swapchain may be bgra
+		const bool bSwapRedBlue = frame.Format == VK_FORMAT_B8G8R8A8_UNORM || frame.Format == VK_FORMAT_B8G8R8A8_SRGB;
+
+		std::vector<char> row(frame.Width * 3);
+		for(uint32_t y = 0; y < frame.Height; y++)
+		{
+			const uint8_t* pixel = frame.Data + static_cast<size_t>(y) * frame.RowPitch;
+			for(uint32_t x = 0; x < frame.Width; x++, pixel += 4)
+			{
+				row[x * 3 + 0] = pixel[bSwapRedBlue ? 2 : 0];
+				row[x * 3 + 1] = pixel[1];
+				row[x * 3 + 2] = pixel[bSwapRedBlue ? 0 : 2];
+			}
+			file.write(row.data(), row.size());
+		}
+	}
+
+	if(!file)
+	{
+		throw std::runtime_error("failed to write capture file at " + path.string());
+	}
+}
@@ -0,0 +1,77 @@
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "FrameReadback.h"
+
+enum CaptureFormat
+{
+	CAPTURE_FORMAT_PPM,		// binary rgb, readable by most image tools
+	CAPTURE_FORMAT_RAW		// the pixels exactly as read back, no header
+};
+
+// what to do with a finished frame if the encoders are too slow and the queue is full
+enum CaptureDropPolicy
+{
+	CAPTURE_DROP_NEWEST,	// keep the queued frames, skip the new one
+	CAPTURE_DROP_OLDEST		// make room by skipping the oldest queued frame
+};
+
+struct CaptureSettings
+{
+	std::string Directory = "capture";
+	CaptureFormat Format = CAPTURE_FORMAT_PPM;
+	CaptureDropPolicy DropPolicy = CAPTURE_DROP_NEWEST;
+	uint32_t EncoderCount = 2;
+	uint32_t QueueSize = 2;		// frames waiting for an encoder (they hold on to their readback slots)
+};
+
+// writes read back frames to disk on a pool of encoder threads
+// the render thread only moves finished frames into a bounded queue, it never waits for encoding or io.
+// queued frames are not copied, the encoders read straight from the mapped readback memory
+class FrameCapture
+{
+public:
+	FrameCapture();
+	~FrameCapture();
+
+	void Start(const CaptureSettings& settings, FrameReadback* readback);
+
+	// encode everything that is queued already, then join the encoders
+	void Stop();
+
+	bool IsRunning() const;
+
+	// - render thread
+	// queue all frames the readback has finished since the last call
+	void Poll();
+
+	uint64_t GetWrittenFrameCount() const;
+	uint64_t GetDroppedFrameCount() const;
+
+private:
+	void EncoderLoop();
+	void WriteFrame(const ReadbackFrame& frame);
+
+private:
+	CaptureSettings Settings;
+	FrameReadback* Readback = nullptr;
+
+	std::vector<std::thread> Encoders;
+	std::atomic<bool> bRunning;
+
+	std::mutex QueueMutex;
+	std::condition_variable QueueCondition;
+	std::deque<ReadbackFrame> Queue;
+	bool bStopRequested = false;
+
+	std::atomic<uint64_t> WrittenFrames;
+	std::atomic<uint64_t> DroppedFrames;
+};
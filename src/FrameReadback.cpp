@@ -0,0 +1,279 @@
+#include "FrameReadback.h"
+
+#include <stdexcept>
+
+#include "Utilities.h"
+
+FrameReadback::FrameReadback()
+	: DroppedFrames(0)
+{
+
+}
+
+FrameReadback::~FrameReadback()
+{
+
+}
+
+void FrameReadback::Create(VkPhysicalDevice physicalDevice, VkDevice logicalDevice, VkCommandPool commandPool,
+	VkExtent2D resolution, VkFormat format, uint32_t slotCount, const VkAllocationCallbacks* allocator, MemoryBudget* memory)
+{
+	LogicalDevice = logicalDevice;
+	CommandPool = commandPool;
+	Allocator = allocator;
+	Memory = memory;
+	Resolution = resolution;
+	Format = format;
+
+	// rows are tightly packed
+	uint32_t texelSize = GetFormatTexelSize(Format);
+	if(texelSize == 0)
+	{
+		throw std::runtime_error("the swapchain format can't be read back!");
+	}
+	RowPitch = Resolution.width * texelSize;
+	FrameSize = static_cast<VkDeviceSize>(RowPitch) * Resolution.height;
+
+	// the cpu reads every byte, cached memory makes that a lot faster than the usual write combined memory
+	// (it may not be coherent, in that case Acquire invalidates the range)
+	MemoryProperties = VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT;
+	if(HasMemoryType(physicalDevice, UINT32_MAX, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_CACHED_BIT))
+	{
+		MemoryProperties = VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_CACHED_BIT;
+	}
+
+	Slots.resize(slotCount);
+
+	std::vector<VkCommandBuffer> commandBuffers(slotCount);
+	VkCommandBufferAllocateInfo allocateInfo = {};
+	allocateInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
+	allocateInfo.commandPool = CommandPool;
+	allocateInfo.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
+	allocateInfo.commandBufferCount = slotCount;
+	if(vkAllocateCommandBuffers(LogicalDevice, &allocateInfo, commandBuffers.data()) != VK_SUCCESS)
+	{
+		throw std::runtime_error("failed to allocate readback command buffers!");
+	}
+
+	// free slots have their fence signalled
+	VkFenceCreateInfo fenceCreateInfo = {};
+	fenceCreateInfo.sType = VK_STRUCTURE_TYPE_FENCE_CREATE_INFO;
+	fenceCreateInfo.flags = VK_FENCE_CREATE_SIGNALED_BIT;
+
+	for(uint32_t i = 0; i < slotCount; i++)
+	{
+		Slot& slot = Slots[i];
+		slot.CommandBuffer = commandBuffers[i];
+
+		CreateBufferAndAllocateMemory(physicalDevice, LogicalDevice, FrameSize, VK_BUFFER_USAGE_TRANSFER_DST_BIT,
+			MemoryProperties, &slot.Buffer, &slot.Memory, Allocator);
+		Memory->TrackBuffer(LogicalDevice, slot.Buffer, MemoryProperties);
+
+		// stays mapped for the whole lifetime, frames are handed out as pointers into it
+		void* data;
+		vkMapMemory(LogicalDevice, slot.Memory, 0, FrameSize, 0, &data);
+		slot.Mapped = static_cast<uint8_t*>(data);
+
+		if(vkCreateFence(LogicalDevice, &fenceCreateInfo, Allocator, &slot.Fence) != VK_SUCCESS)
+		{
+			throw std::runtime_error("failed to create a fence!");
+		}
+	}
+}
+
+void FrameReadback::Destroy()
+{
+	for(Slot& slot : Slots)
+	{
+		vkFreeCommandBuffers(LogicalDevice, CommandPool, 1, &slot.CommandBuffer);
+		vkDestroyFence(LogicalDevice, slot.Fence, Allocator);
+		vkUnmapMemory(LogicalDevice, slot.Memory);
+		if(slot.Buffer != VK_NULL_HANDLE)
+		{
+			Memory->TrackBufferFree(LogicalDevice, slot.Buffer, MemoryProperties);
+		}
+		vkDestroyBuffer(LogicalDevice, slot.Buffer, Allocator);
+		vkFreeMemory(LogicalDevice, slot.Memory, Allocator);
+	}
+	Slots.clear();
+}
+
+bool FrameReadback::IsEnabled() const
+{
+	return !Slots.empty();
+}
+
+VkCommandBuffer FrameReadback::RecordCopy(VkImage image, uint64_t frameNumber, VkFence* fence)
+{
+	uint32_t slotIndex = UINT32_MAX;
+	{
+		std::lock_guard<std::mutex> lock(Mutex);
+
+		for(uint32_t i = 0; i < Slots.size(); i++)
+		{
+			if(Slots[i].State == SLOT_FREE)
+			{
+				slotIndex = i;
+				break;
+			}
+		}
+
+		// nothing free: rather lose the oldest finished frame than wait for the consumer
+		// (or this one, if all of them are still in flight or acquired)
+		if(slotIndex == UINT32_MAX)
+		{
+			DroppedFrames++;
+
+			slotIndex = FindOldestFinishedSlot();
+			if(slotIndex == UINT32_MAX)
+			{
+				return VK_NULL_HANDLE;
+			}
+		}
+
+		Slots[slotIndex].State = SLOT_PENDING;
+		Slots[slotIndex].FrameNumber = frameNumber;
+		vkResetFences(LogicalDevice, 1, &Slots[slotIndex].Fence);
+	}
+
+	Slot& slot = Slots[slotIndex];
+
+	VkCommandBufferBeginInfo beginInfo = {};
+	beginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+	beginInfo.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
+
+	if(vkBeginCommandBuffer(slot.CommandBuffer, &beginInfo) != VK_SUCCESS)
+	{
+		throw std::runtime_error("failed to start recording a readback command buffer!");
+	}
+	{
+		VkImageMemoryBarrier imageBarrier = {};
+		imageBarrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
+		imageBarrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+		imageBarrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+		imageBarrier.image = image;
+		imageBarrier.subresourceRange.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+		imageBarrier.subresourceRange.baseMipLevel = 0;
+		imageBarrier.subresourceRange.levelCount = 1;
+		imageBarrier.subresourceRange.baseArrayLayer = 0;
+		imageBarrier.subresourceRange.layerCount = 1;
+
+		// wait for the render pass (and its resolve) to finish writing the image
+		imageBarrier.srcAccessMask = VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT;
+		imageBarrier.dstAccessMask = VK_ACCESS_TRANSFER_READ_BIT;
+		imageBarrier.oldLayout = VK_IMAGE_LAYOUT_PRESENT_SRC_KHR;
+		imageBarrier.newLayout = VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL;
+		vkCmdPipelineBarrier(slot.CommandBuffer, VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT, 0,
+			0, nullptr, 0, nullptr, 1, &imageBarrier);
+
+		VkBufferImageCopy copyRegion = {};
+		copyRegion.bufferOffset = 0;
+		copyRegion.bufferRowLength = 0;		// 0 -> tightly packed
+		copyRegion.bufferImageHeight = 0;
+		copyRegion.imageSubresource.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+		copyRegion.imageSubresource.mipLevel = 0;
+		copyRegion.imageSubresource.baseArrayLayer = 0;
+		copyRegion.imageSubresource.layerCount = 1;
+		copyRegion.imageOffset = {0, 0, 0};
+		copyRegion.imageExtent = {Resolution.width, Resolution.height, 1};
+		vkCmdCopyImageToBuffer(slot.CommandBuffer, image, VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL, slot.Buffer, 1, &copyRegion);
+
+		// back to presenting. the semaphore signalled after this submission makes present wait for it
+		imageBarrier.srcAccessMask = VK_ACCESS_TRANSFER_READ_BIT;
+		imageBarrier.dstAccessMask = 0;
+		imageBarrier.oldLayout = VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL;
+		imageBarrier.newLayout = VK_IMAGE_LAYOUT_PRESENT_SRC_KHR;
+
+		// make the copied data available to the host once the fence has signalled
+		VkBufferMemoryBarrier bufferBarrier = {};
+		bufferBarrier.sType = VK_STRUCTURE_TYPE_BUFFER_MEMORY_BARRIER;
+		bufferBarrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+		bufferBarrier.dstAccessMask = VK_ACCESS_HOST_READ_BIT;
+		bufferBarrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+		bufferBarrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+		bufferBarrier.buffer = slot.Buffer;
+		bufferBarrier.offset = 0;
+		bufferBarrier.size = VK_WHOLE_SIZE;
+
+		vkCmdPipelineBarrier(slot.CommandBuffer, VK_PIPELINE_STAGE_TRANSFER_BIT,
+			VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT | VK_PIPELINE_STAGE_HOST_BIT, 0,
+			0, nullptr, 1, &bufferBarrier, 1, &imageBarrier);
+	}
+	if(vkEndCommandBuffer(slot.CommandBuffer) != VK_SUCCESS)
+	{
+		throw std::runtime_error("failed to end recording a readback command buffer!");
+	}
+
+	*fence = slot.Fence;
+	return slot.CommandBuffer;
+}
+
+bool FrameReadback::Acquire(ReadbackFrame& frame)
+{
+	std::lock_guard<std::mutex> lock(Mutex);
+
+	uint32_t slotIndex = FindOldestFinishedSlot();
+	if(slotIndex == UINT32_MAX)
+	{
+		return false;
+	}
+
+	Slot& slot = Slots[slotIndex];
+	slot.State = SLOT_ACQUIRED;
+
+	// cached memory isn't necessarily coherent, so drop whatever the cpu cache still holds of the last frame
+	VkMappedMemoryRange range = {};
+	range.sType = VK_STRUCTURE_TYPE_MAPPED_MEMORY_RANGE;
+	range.memory = slot.Memory;
+	range.offset = 0;
+	range.size = VK_WHOLE_SIZE;
+	vkInvalidateMappedMemoryRanges(LogicalDevice, 1, &range);
+
+	frame.Data = slot.Mapped;
+	frame.Size = FrameSize;
+	frame.Width = Resolution.width;
+	frame.Height = Resolution.height;
+	frame.RowPitch = RowPitch;
+	frame.Format = Format;
+	frame.FrameNumber = slot.FrameNumber;
+	frame.Slot = slotIndex;
+
+	return true;
+}
+
+void FrameReadback::Release(const ReadbackFrame& frame)
+{
+	std::lock_guard<std::mutex> lock(Mutex);
+
+	if(frame.Slot >= Slots.size() || Slots[frame.Slot].State != SLOT_ACQUIRED)
+	{
+		throw std::runtime_error("released a readback frame that wasn't acquired!");
+	}
+
+	Slots[frame.Slot].State = SLOT_FREE;
+}
+
+uint64_t FrameReadback::GetDroppedFrameCount() const
+{
+	return DroppedFrames;
+}
+
+uint32_t FrameReadback::FindOldestFinishedSlot()
+{
+	uint32_t oldest = UINT32_MAX;
+	for(uint32_t i = 0; i < Slots.size(); i++)
+	{
+		const Slot& slot = Slots[i];
+		if(slot.State != SLOT_PENDING || (oldest != UINT32_MAX && slot.FrameNumber >= Slots[oldest].FrameNumber))
+		{
+			continue;
+		}
+
+		if(vkGetFenceStatus(LogicalDevice, slot.Fence) == VK_SUCCESS)
+		{
+			oldest = i;
+		}
+	}
+
+	return oldest;
+}
@@ -0,0 +1,102 @@
+#pragma once
+
+#define GLFW_INCLUDE_VULKAN
+#include <GLFW/glfw3.h>
+
+#include <atomic>
+#include <cstdint>
+#include <mutex>
+#include <vector>
+
+#include "MemoryBudget.h"
+
+// a rendered frame in host memory
+// Data points straight into the mapped readback buffer (no copy) and stays valid until the frame is released
+struct ReadbackFrame
+{
+	const uint8_t* Data = nullptr;
+	VkDeviceSize Size = 0;
+	uint32_t Width = 0;
+	uint32_t Height = 0;
+	uint32_t RowPitch = 0;				// bytes per row
+	VkFormat Format = VK_FORMAT_UNDEFINED;
+	uint64_t FrameNumber = 0;
+	uint32_t Slot = UINT32_MAX;
+};
+
+// copies rendered frames into a ring of persistently mapped, host cached buffers
+// the copy is recorded right behind the frame's draw commands and completes with the frame,
+// the cpu picks finished frames up whenever it gets to them. neither side ever waits for the other:
+// if the ring is full, the oldest finished frame nobody has acquired yet is overwritten
+class FrameReadback
+{
+public:
+	FrameReadback();
+	~FrameReadback();
+
+	// the command pool has to allow resetting individual command buffers
+	// the buffers are made with allocator and counted in memory's budget
+	// throws if format isn't one GetFormatTexelSize knows
+	void Create(VkPhysicalDevice physicalDevice, VkDevice logicalDevice, VkCommandPool commandPool,
+		VkExtent2D resolution, VkFormat format, uint32_t slotCount, const VkAllocationCallbacks* allocator, MemoryBudget* memory);
+
+	// the device has to be idle
+	void Destroy();
+
+	bool IsEnabled() const;
+
+	// - render thread
+	// record copying image (in PRESENT_SRC layout, returned in the same layout) into a free slot.
+	// submit the command buffer right after the frame's draw commands, with fence signalled once it has finished
+	// returns VK_NULL_HANDLE if every slot is in flight or held by the consumer (the frame is dropped)
+	VkCommandBuffer RecordCopy(VkImage image, uint64_t frameNumber, VkFence* fence);
+
+	// - any thread
+	// get the oldest finished frame. returns false if there is none
+	bool Acquire(ReadbackFrame& frame);
+
+	// hand the slot back, frame.Data must not be used afterwards
+	void Release(const ReadbackFrame& frame);
+
+	// frames that were overwritten before they were acquired or couldn't be copied at all
+	uint64_t GetDroppedFrameCount() const;
+
+private:
+	enum SlotState
+	{
+		SLOT_FREE,
+		SLOT_PENDING,		// copy submitted (and maybe finished), not acquired yet
+		SLOT_ACQUIRED
+	};
+
+	struct Slot
+	{
+		VkBuffer Buffer = VK_NULL_HANDLE;
+		VkDeviceMemory Memory = VK_NULL_HANDLE;
+		uint8_t* Mapped = nullptr;
+		VkCommandBuffer CommandBuffer = VK_NULL_HANDLE;
+		VkFence Fence = VK_NULL_HANDLE;
+		SlotState State = SLOT_FREE;
+		uint64_t FrameNumber = 0;
+	};
+
+	// oldest pending slot whose copy has finished, UINT32_MAX if there is none
+	uint32_t FindOldestFinishedSlot();
+
+private:
+	VkDevice LogicalDevice = VK_NULL_HANDLE;
+	VkCommandPool CommandPool = VK_NULL_HANDLE;
+	const VkAllocationCallbacks* Allocator = nullptr;
+	MemoryBudget* Memory = nullptr;
+	VkMemoryPropertyFlags MemoryProperties = 0;
+
+	VkExtent2D Resolution = {};
+	VkFormat Format = VK_FORMAT_UNDEFINED;
+	uint32_t RowPitch = 0;
+	VkDeviceSize FrameSize = 0;
+
+	std::mutex Mutex;		// guards the slot states
+	std::vector<Slot> Slots;
+
+	std::atomic<uint64_t> DroppedFrames;
+};
@@ -0,0 +1,317 @@
+#include "HostAllocator.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <new>
+
+static size_t AlignUp(size_t value, size_t alignment)
+{
+	return (value + alignment - 1) & ~(alignment - 1);
+}
+
+HostAllocator::HostAllocator()
+{
+	Callbacks.pUserData = this;
+	Callbacks.pfnAllocation = &HostAllocator::Allocate;
+	Callbacks.pfnReallocation = &HostAllocator::Reallocate;
+	Callbacks.pfnFree = &HostAllocator::Free;
+	Callbacks.pfnInternalAllocation = &HostAllocator::InternalAllocation;
+	Callbacks.pfnInternalFree = &HostAllocator::InternalFree;
+
+	Arena.reset(new uint8_t[ARENA_SIZE]);
+
+	for(uint32_t i = 0; i < POOL_COUNT; i++)
+	{
+		Pools[i].BlockSize = MIN_POOL_BLOCK_SIZE << i;
+	}
+}
+
+HostAllocator::~HostAllocator()
+{
+
+}
+
+const VkAllocationCallbacks* HostAllocator::GetCallbacks() const
+{
+	return &Callbacks;
+}
+
+void HostAllocator::BeginFrame()
+{
+	FrameThread.store(std::this_thread::get_id(), std::memory_order_relaxed);
+
+	ArenaFrameBytes.store(ArenaOffset, std::memory_order_relaxed);
+	ArenaOffset = 0;
+}
+
+HostAllocationStats HostAllocator::GetStats(VkSystemAllocationScope scope) const
+{
+	HostAllocationStats stats;
+	if(static_cast<uint32_t>(scope) >= SCOPE_COUNT)
+	{
+		return stats;
+	}
+
+	const ScopeCounters& counters = Counters[scope];
+	stats.AllocationCount = counters.AllocationCount.load(std::memory_order_relaxed);
+	stats.FreeCount = counters.FreeCount.load(std::memory_order_relaxed);
+	stats.LiveCount = counters.LiveCount.load(std::memory_order_relaxed);
+	stats.LiveBytes = counters.LiveBytes.load(std::memory_order_relaxed);
+	stats.PeakBytes = counters.PeakBytes.load(std::memory_order_relaxed);
+
+	return stats;
+}
+
+size_t HostAllocator::GetArenaFrameBytes() const
+{
+	return ArenaFrameBytes.load(std::memory_order_relaxed);
+}
+
+uint64_t HostAllocator::GetArenaOverflowCount() const
+{
+	return ArenaOverflowCount.load(std::memory_order_relaxed);
+}
+
+uint64_t HostAllocator::GetInternalAllocationBytes() const
+{
+	return InternalAllocationBytes.load(std::memory_order_relaxed);
+}
+
+void HostAllocator::PrintStats() const
+{
+	static const char* scopeNames[SCOPE_COUNT] = { "command", "object", "cache", "device", "instance" };
+
+	printf("vulkan host allocations:\n");
+	for(uint32_t i = 0; i < SCOPE_COUNT; i++)
+	{
+		HostAllocationStats stats = GetStats(static_cast<VkSystemAllocationScope>(i));
+		printf("  %-8s %10llu allocations, %10llu frees, %8llu live (%llu bytes, peak %llu)\n", scopeNames[i],
+			static_cast<unsigned long long>(stats.AllocationCount), static_cast<unsigned long long>(stats.FreeCount),
+			static_cast<unsigned long long>(stats.LiveCount), static_cast<unsigned long long>(stats.LiveBytes),
+			static_cast<unsigned long long>(stats.PeakBytes));
+	}
+	printf("  arena: %zu bytes last frame, %llu overflows. internal: %llu bytes\n", GetArenaFrameBytes(),
+		static_cast<unsigned long long>(GetArenaOverflowCount()),
+		static_cast<unsigned long long>(GetInternalAllocationBytes()));
+}
+
+VKAPI_ATTR void* VKAPI_CALL HostAllocator::Allocate(void* userData, size_t size, size_t alignment,
+	VkSystemAllocationScope scope)
+{
+	return static_cast<HostAllocator*>(userData)->AllocateMemory(size, alignment, scope);
+}
+
+VKAPI_ATTR void* VKAPI_CALL HostAllocator::Reallocate(void* userData, void* original, size_t size, size_t alignment,
+	VkSystemAllocationScope scope)
+{
+	HostAllocator* allocator = static_cast<HostAllocator*>(userData);
+
+	if(original == nullptr)
+	{
+		return allocator->AllocateMemory(size, alignment, scope);
+	}
+	if(size == 0)
+	{
+		allocator->FreeMemory(original);
+		return nullptr;
+	}
+
+	// the blocks are sized to their allocation, so always move. the original stays valid on failure
+	void* memory = allocator->AllocateMemory(size, alignment, scope);
+	if(memory == nullptr)
+	{
+		return nullptr;
+	}
+
+	memcpy(memory, original, std::min(size, GetHeader(original)->Size));
+	allocator->FreeMemory(original);
+
+	return memory;
+}
+
+VKAPI_ATTR void VKAPI_CALL HostAllocator::Free(void* userData, void* memory)
+{
+	static_cast<HostAllocator*>(userData)->FreeMemory(memory);
+}
+
+VKAPI_ATTR void VKAPI_CALL HostAllocator::InternalAllocation(void* userData, size_t size,
+	VkInternalAllocationType allocationType, VkSystemAllocationScope scope)
+{
+	static_cast<HostAllocator*>(userData)->InternalAllocationBytes.fetch_add(size, std::memory_order_relaxed);
+}
+
+VKAPI_ATTR void VKAPI_CALL HostAllocator::InternalFree(void* userData, size_t size,
+	VkInternalAllocationType allocationType, VkSystemAllocationScope scope)
+{
+	static_cast<HostAllocator*>(userData)->InternalAllocationBytes.fetch_sub(size, std::memory_order_relaxed);
+}
+
+void* HostAllocator::AllocateMemory(size_t size, size_t alignment, VkSystemAllocationScope scope)
+{
+	if(size == 0)
+	{
+		return nullptr;
+	}
+
+	// the header goes right in front of the memory, worst case padding included
+	alignment = std::max(alignment, alignof(std::max_align_t));
+	size_t blockSize = size + sizeof(AllocationHeader) + alignment - 1;
+
+	void* block = nullptr;
+	uint32_t source = ALLOCATION_SOURCE_HEAP;
+
+	if(scope == VK_SYSTEM_ALLOCATION_SCOPE_COMMAND
+		&& FrameThread.load(std::memory_order_relaxed) == std::this_thread::get_id())
+	{
+		block = AllocateFromArena(blockSize);
+		source = ALLOCATION_SOURCE_ARENA;
+	}
+	else if(scope == VK_SYSTEM_ALLOCATION_SCOPE_OBJECT && blockSize <= (MIN_POOL_BLOCK_SIZE << (POOL_COUNT - 1)))
+	{
+		uint32_t poolIndex = 0;
+		while((MIN_POOL_BLOCK_SIZE << poolIndex) < blockSize)
+		{
+			poolIndex++;
+		}
+
+		block = AllocateFromPool(poolIndex);
+		source = ALLOCATION_SOURCE_POOL + poolIndex;
+	}
+
+	// everything else, and what didn't fit into the arena
+	if(block == nullptr)
+	{
+		block = malloc(blockSize);
+		source = ALLOCATION_SOURCE_HEAP;
+		if(block == nullptr)
+		{
+			return nullptr;
+		}
+	}
+
+	uint8_t* memory = reinterpret_cast<uint8_t*>(
+		AlignUp(reinterpret_cast<size_t>(block) + sizeof(AllocationHeader), alignment));
+
+	AllocationHeader* header = GetHeader(memory);
+	header->Block = block;
+	header->Size = size;
+	header->Source = source;
+	header->Scope = static_cast<uint32_t>(scope);
+
+	CountAllocation(header->Scope, size);
+
+	return memory;
+}
+
+void HostAllocator::FreeMemory(void* memory)
+{
+	if(memory == nullptr)
+	{
+		return;
+	}
+
+	AllocationHeader* header = GetHeader(memory);
+	CountFree(header->Scope, header->Size);
+
+	if(header->Source == ALLOCATION_SOURCE_HEAP)
+	{
+		free(header->Block);
+	}
+	else if(header->Source >= ALLOCATION_SOURCE_POOL)
+	{
+		FreeToPool(header->Source - ALLOCATION_SOURCE_POOL, header->Block);
+	}
+	// arena memory is reclaimed with the next frame
+}
+
+void* HostAllocator::AllocateFromArena(size_t blockSize)
+{
+	if(ArenaOffset + blockSize > ARENA_SIZE)
+	{
+		ArenaOverflowCount.fetch_add(1, std::memory_order_relaxed);
+		return nullptr;
+	}
+
+	void* block = Arena.get() + ArenaOffset;
+	ArenaOffset = AlignUp(ArenaOffset + blockSize, alignof(std::max_align_t));
+
+	return block;
+}
+
+void* HostAllocator::AllocateFromPool(uint32_t poolIndex)
+{
+	Pool& pool = Pools[poolIndex];
+	std::lock_guard<std::mutex> lock(pool.Mutex);
+
+	if(pool.FreeList == nullptr)
+	{
+		// carve a new chunk into blocks (the padding for the alignment is part of the block size)
+		pool.Chunks.emplace_back(new (std::nothrow) uint8_t[POOL_CHUNK_SIZE]);
+		uint8_t* chunk = pool.Chunks.back().get();
+		if(chunk == nullptr)
+		{
+			pool.Chunks.pop_back();
+			return nullptr;
+		}
+
+		for(size_t offset = 0; offset + pool.BlockSize <= POOL_CHUNK_SIZE; offset += pool.BlockSize)
+		{
+			void* block = chunk + offset;
+			*static_cast<void**>(block) = pool.FreeList;
+			pool.FreeList = block;
+		}
+	}
+
+	void* block = pool.FreeList;
+	pool.FreeList = *static_cast<void**>(block);
+
+	return block;
+}
+
+void HostAllocator::FreeToPool(uint32_t poolIndex, void* block)
+{
+	Pool& pool = Pools[poolIndex];
+	std::lock_guard<std::mutex> lock(pool.Mutex);
+
+	*static_cast<void**>(block) = pool.FreeList;
+	pool.FreeList = block;
+}
+
+void HostAllocator::CountAllocation(uint32_t scope, size_t size)
+{
+	if(scope >= SCOPE_COUNT)
+	{
+		return;
+	}
+
+	ScopeCounters& counters = Counters[scope];
+	counters.AllocationCount.fetch_add(1, std::memory_order_relaxed);
+	counters.LiveCount.fetch_add(1, std::memory_order_relaxed);
+	uint64_t liveBytes = counters.LiveBytes.fetch_add(size, std::memory_order_relaxed) + size;
+
+	uint64_t peakBytes = counters.PeakBytes.load(std::memory_order_relaxed);
+	while(liveBytes > peakBytes
+		&& !counters.PeakBytes.compare_exchange_weak(peakBytes, liveBytes, std::memory_order_relaxed))
+	{
+	}
+}
+
+void HostAllocator::CountFree(uint32_t scope, size_t size)
+{
+	if(scope >= SCOPE_COUNT)
+	{
+		return;
+	}
+
+	ScopeCounters& counters = Counters[scope];
+	counters.FreeCount.fetch_add(1, std::memory_order_relaxed);
+	counters.LiveCount.fetch_sub(1, std::memory_order_relaxed);
+	counters.LiveBytes.fetch_sub(size, std::memory_order_relaxed);
+}
+
+HostAllocator::AllocationHeader* HostAllocator::GetHeader(void* memory)
+{
+	return reinterpret_cast<AllocationHeader*>(static_cast<uint8_t*>(memory) - sizeof(AllocationHeader));
+}
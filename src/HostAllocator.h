@@ -0,0 +1,126 @@
+#pragma once
+
+#define GLFW_INCLUDE_VULKAN
+#include <GLFW/glfw3.h>
+
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// host allocations of one VkSystemAllocationScope
+struct HostAllocationStats
+{
+	uint64_t AllocationCount = 0;		// total, reallocations count as one allocation
+	uint64_t FreeCount = 0;
+	uint64_t LiveCount = 0;
+	uint64_t LiveBytes = 0;
+	uint64_t PeakBytes = 0;
+};
+
+// VkAllocationCallbacks that take the driver's host allocations off the global heap and count them
+// - COMMAND scope: only live for the duration of one vulkan call. on the frame thread they come from
+//   a linear arena that is reset with every frame, frees are no-ops
+// - OBJECT scope: pooled, one free list per size class
+// - CACHE, DEVICE and INSTANCE scope: long lived and rare, they go to the heap and are only tracked
+// the driver may call the callbacks from any thread that calls into vulkan
+class HostAllocator
+{
+public:
+	HostAllocator();
+	~HostAllocator();
+
+	// pass to every vkCreate* / vkAllocate* and the matching vkDestroy* / vkFree*
+	const VkAllocationCallbacks* GetCallbacks() const;
+
+	// start a new frame on the calling thread. resets the arena, so no vulkan call may be running on this thread
+	void BeginFrame();
+
+	HostAllocationStats GetStats(VkSystemAllocationScope scope) const;
+	// arena bytes used by the last frame, and command allocations that didn't fit into it (and went to the heap)
+	size_t GetArenaFrameBytes() const;
+	uint64_t GetArenaOverflowCount() const;
+	// allocations the driver made itself and only reported to us
+	uint64_t GetInternalAllocationBytes() const;
+
+	void PrintStats() const;
+
+private:
+	// where an allocation came from, stored in front of it
+	enum AllocationSource : uint32_t
+	{
+		ALLOCATION_SOURCE_HEAP,
+		ALLOCATION_SOURCE_ARENA,
+		ALLOCATION_SOURCE_POOL			// + size class
+	};
+
+	struct AllocationHeader
+	{
+		void* Block;
+		size_t Size;
+		uint32_t Source;
+		uint32_t Scope;
+	};
+
+	// fixed size blocks, carved from larger chunks that are only released with the allocator
+	struct Pool
+	{
+		std::mutex Mutex;
+		size_t BlockSize = 0;
+		void* FreeList = nullptr;
+		std::vector<std::unique_ptr<uint8_t[]>> Chunks;
+	};
+
+	struct ScopeCounters
+	{
+		std::atomic<uint64_t> AllocationCount{0};
+		std::atomic<uint64_t> FreeCount{0};
+		std::atomic<uint64_t> LiveCount{0};
+		std::atomic<uint64_t> LiveBytes{0};
+		std::atomic<uint64_t> PeakBytes{0};
+	};
+
+	static VKAPI_ATTR void* VKAPI_CALL Allocate(void* userData, size_t size, size_t alignment,
+		VkSystemAllocationScope scope);
+	static VKAPI_ATTR void* VKAPI_CALL Reallocate(void* userData, void* original, size_t size, size_t alignment,
+		VkSystemAllocationScope scope);
+	static VKAPI_ATTR void VKAPI_CALL Free(void* userData, void* memory);
+	static VKAPI_ATTR void VKAPI_CALL InternalAllocation(void* userData, size_t size,
+		VkInternalAllocationType allocationType, VkSystemAllocationScope scope);
+	static VKAPI_ATTR void VKAPI_CALL InternalFree(void* userData, size_t size,
+		VkInternalAllocationType allocationType, VkSystemAllocationScope scope);
+
+	void* AllocateMemory(size_t size, size_t alignment, VkSystemAllocationScope scope);
+	void FreeMemory(void* memory);
+
+	void* AllocateFromArena(size_t blockSize);
+	void* AllocateFromPool(uint32_t poolIndex);
+	void FreeToPool(uint32_t poolIndex, void* block);
+
+	void CountAllocation(uint32_t scope, size_t size);
+	void CountFree(uint32_t scope, size_t size);
+
+	static AllocationHeader* GetHeader(void* memory);
+
+private:
+	static const uint32_t SCOPE_COUNT = 5;
+	static const uint32_t POOL_COUNT = 7;				// 64 bytes to 4 KiB blocks
+	static const size_t MIN_POOL_BLOCK_SIZE = 64;
+	static const size_t POOL_CHUNK_SIZE = 64 * 1024;
+	static const size_t ARENA_SIZE = 256 * 1024;
+
+	VkAllocationCallbacks Callbacks = {};
+
+	std::unique_ptr<uint8_t[]> Arena;
+	size_t ArenaOffset = 0;								// only touched by the frame thread
+	std::atomic<size_t> ArenaFrameBytes{0};
+	std::atomic<uint64_t> ArenaOverflowCount{0};
+	std::atomic<std::thread::id> FrameThread;
+
+	Pool Pools[POOL_COUNT];
+
+	ScopeCounters Counters[SCOPE_COUNT];
+	std::atomic<uint64_t> InternalAllocationBytes{0};
+};
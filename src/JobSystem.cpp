@@ -0,0 +1,402 @@
+#include "JobSystem.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <exception>
+
+// the job system and queue the current thread belongs to (if it is a worker)
+static thread_local const JobSystem* CurrentJobSystem = nullptr;
+static thread_local uint32_t CurrentWorkerIndex = 0;
+
+static uint64_t GetTimeNs()
+{
+	return std::chrono::duration_cast<std::chrono::nanoseconds>(
+		std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+JobCounter::JobCounter()
+	: Count(0)
+{
+
+}
+
+JobCounter::~JobCounter()
+{
+
+}
+
+bool JobCounter::IsDone() const
+{
+	return Count.load(std::memory_order_acquire) == 0;
+}
+
+uint32_t JobCounter::GetCount() const
+{
+	return Count.load(std::memory_order_acquire);
+}
+
+JobSystem::JobSystem()
+	: PendingJobs(0), bShutdown(false), FailedJobCount(0)
+{
+
+}
+
+JobSystem::~JobSystem()
+{
+	CleanUp();
+}
+
+void JobSystem::Init(uint32_t workerCount)
+{
+	if(!Workers.empty())
+	{
+		return;
+	}
+
+	if(workerCount == 0)
+	{
+		// the thread calling Init keeps running the main loop, so leave it a core
+		uint32_t hardwareThreads = std::thread::hardware_concurrency();
+		workerCount = std::max(hardwareThreads, 2u) - 1;
+	}
+
+	bShutdown = false;
+
+	Queues.clear();
+	for(uint32_t i = 0; i < workerCount + 1; i++)
+	{
+		Queues.push_back(std::make_unique<WorkQueue>());
+	}
+
+	for(uint32_t i = 0; i < workerCount; i++)
+	{
+		Workers.emplace_back(&JobSystem::WorkerLoop, this, i);
+	}
+}
+
+void JobSystem::CleanUp()
+{
+	if(Workers.empty())
+	{
+		return;
+	}
+
+	// let the workers finish whatever is still queued, then stop them
+	uint32_t sharedQueue = static_cast<uint32_t>(Workers.size());
+	Job job;
+	while(FindJob(sharedQueue, job))
+	{
+		Execute(job, sharedQueue);
+	}
+
+	{
+		std::lock_guard<std::mutex> lock(SleepMutex);
+		bShutdown = true;
+	}
+	WakeCondition.notify_all();
+
+	for(std::thread& worker : Workers)
+	{
+		worker.join();
+	}
+
+	Workers.clear();
+	Queues.clear();
+}
+
+uint32_t JobSystem::GetWorkerCount() const
+{
+	return static_cast<uint32_t>(Workers.size());
+}
+
+uint32_t JobSystem::GetFailedJobCount() const
+{
+	return FailedJobCount.load(std::memory_order_relaxed);
+}
+
+void JobSystem::Run(const char* name, std::function<void()> function, JobCounter* counter)
+{
+	if(counter)
+	{
+		counter->Count.fetch_add(1, std::memory_order_acq_rel);
+	}
+
+	Job job;
+	job.Name = name;
+	job.Function = std::move(function);
+	job.Counter = counter;
+
+	// without workers, there is nobody else to run the job. it runs on this thread, which is outside the job system
+	if(Workers.empty())
+	{
+		Execute(job, GetWorkerCount());
+		return;
+	}
+
+	Push(std::move(job));
+}
+
+void JobSystem::RunAfter(JobCounter& dependency, const char* name, std::function<void()> function, JobCounter* counter)
+{
+	if(counter)
+	{
+		counter->Count.fetch_add(1, std::memory_order_acq_rel);
+	}
+
+	Job job;
+	job.Name = name;
+	job.Function = std::move(function);
+	job.Counter = counter;
+
+	{
+		// the dependency might reach zero concurrently. the last job of the dependency takes the
+		// continuations under this lock, so either it sees this job or this job sees the zero count
+		std::lock_guard<std::mutex> lock(dependency.ContinuationMutex);
+		if(!dependency.IsDone())
+		{
+			dependency.Continuations.push_back(std::move(job));
+			return;
+		}
+	}
+
+	if(Workers.empty())
+	{
+		Execute(job, GetWorkerCount());
+		return;
+	}
+
+	Push(std::move(job));
+}
+
+void JobSystem::ParallelFor(const char* name, uint32_t count, uint32_t batchSize,
+	std::function<void(uint32_t begin, uint32_t end)> function, JobCounter* counter)
+{
+	if(count == 0)
+	{
+		return;
+	}
+
+	batchSize = std::max(batchSize, 1u);
+
+	// all batches share one copy of the function
+	auto sharedFunction = std::make_shared<std::function<void(uint32_t, uint32_t)>>(std::move(function));
+
+	for(uint32_t begin = 0; begin < count; begin += batchSize)
+	{
+		uint32_t end = std::min(begin + batchSize, count);
+		Run(name, [sharedFunction, begin, end]()
+		{
+			(*sharedFunction)(begin, end);
+		}, counter);
+	}
+}
+
+void JobSystem::Wait(JobCounter& counter)
+{
+	uint32_t queueIndex = GetCurrentQueueIndex();
+
+	while(!counter.IsDone())
+	{
+		// rather than blocking the thread, help with the queued work
+		Job job;
+		if(!Workers.empty() && FindJob(queueIndex, job))
+		{
+			Execute(job, queueIndex);
+		}
+		else
+		{
+			std::this_thread::yield();
+		}
+	}
+
+	// the last job might still hold the counter's lock, wait for it to let go before the counter can be destroyed
+	std::lock_guard<std::mutex> lock(counter.ContinuationMutex);
+}
+
+void JobSystem::SetProfileCallback(JobProfileCallback callback, void* userData)
+{
+	ProfileCallback = callback;
+	ProfileUserData = userData;
+}
+
+void JobSystem::WorkerLoop(uint32_t workerIndex)
+{
+	CurrentJobSystem = this;
+	CurrentWorkerIndex = workerIndex;
+
+	while(true)
+	{
+		Job job;
+		if(FindJob(workerIndex, job))
+		{
+			Execute(job, workerIndex);
+			continue;
+		}
+
+		// nothing to do, sleep until a job is pushed
+		std::unique_lock<std::mutex> lock(SleepMutex);
+		WakeCondition.wait(lock, [this]()
+		{
+			return PendingJobs.load(std::memory_order_acquire) > 0 || bShutdown;
+		});
+
+		if(bShutdown && PendingJobs.load(std::memory_order_acquire) == 0)
+		{
+			break;
+		}
+	}
+
+	CurrentJobSystem = nullptr;
+}
+
+void JobSystem::Push(Job&& job)
+{
+	WorkQueue& queue = *Queues[GetCurrentQueueIndex()];
+	{
+		std::lock_guard<std::mutex> lock(queue.Mutex);
+		queue.Jobs.push_back(std::move(job));
+	}
+
+	PendingJobs.fetch_add(1, std::memory_order_acq_rel);
+
+	// take the sleep lock, so a worker can't miss the wake up between checking for jobs and going to sleep
+	{
+		std::lock_guard<std::mutex> lock(SleepMutex);
+	}
+	WakeCondition.notify_one();
+}
+
+bool JobSystem::FindJob(uint32_t queueIndex, Job& job)
+{
+	const uint32_t queueCount = static_cast<uint32_t>(Queues.size());
+	const uint32_t sharedQueue = queueCount - 1;
+
+	// own queue first: newest job, its data is most likely still in the cache
+	// (the shared queue is first in, first out, as there is no owner)
+	{
+		WorkQueue& queue = *Queues[queueIndex];
+		std::lock_guard<std::mutex> lock(queue.Mutex);
+		if(!queue.Jobs.empty())
+		{
+			if(queueIndex == sharedQueue)
+			{
+				job = std::move(queue.Jobs.front());
+				queue.Jobs.pop_front();
+			}
+			else
+			{
+				job = std::move(queue.Jobs.back());
+				queue.Jobs.pop_back();
+			}
+			PendingJobs.fetch_sub(1, std::memory_order_acq_rel);
+			return true;
+		}
+	}
+
+	// then steal the oldest job of another queue, starting with the neighbour to spread the stealing
+	for(uint32_t i = 1; i < queueCount; i++)
+	{
+		WorkQueue& queue = *Queues[(queueIndex + i) % queueCount];
+		std::lock_guard<std::mutex> lock(queue.Mutex);
+		if(!queue.Jobs.empty())
+		{
+			job = std::move(queue.Jobs.front());
+			queue.Jobs.pop_front();
+			PendingJobs.fetch_sub(1, std::memory_order_acq_rel);
+			return true;
+		}
+	}
+
+	return false;
+}
+
+void JobSystem::Execute(Job& job, uint32_t workerIndex)
+{
+	JobTiming timing = {};
+	if(ProfileCallback)
+	{
+		timing.Name = job.Name;
+		timing.WorkerIndex = workerIndex;
+		timing.StartNs = GetTimeNs();
+	}
+
+	// a job that throws still counts down its counter, otherwise everybody waiting for it would wait forever
+	// (and on a worker, the exception would terminate the program)
+	try
+	{
+		job.Function();
+	}
+	catch(const std::exception &e)
+	{
+		printf("ERROR: job %s failed: %s\n", job.Name, e.what());
+		FailedJobCount.fetch_add(1, std::memory_order_relaxed);
+	}
+	catch(...)
+	{
+		printf("ERROR: job %s failed\n", job.Name);
+		FailedJobCount.fetch_add(1, std::memory_order_relaxed);
+	}
+
+	if(ProfileCallback)
+	{
+		timing.EndNs = GetTimeNs();
+		ProfileCallback(timing, ProfileUserData);
+	}
+
+	FinishJob(job.Counter);
+}
+
+void JobSystem::FinishJob(JobCounter* counter)
+{
+	if(!counter)
+	{
+		return;
+	}
+
+	// not the last job: just count down
+	uint32_t count = counter->Count.load(std::memory_order_acquire);
+	while(count > 1)
+	{
+		if(counter->Count.compare_exchange_weak(count, count - 1, std::memory_order_acq_rel))
+		{
+			return;
+		}
+	}
+
+	// (most likely) the last job of the counter: count down under the lock, so that RunAfter and Wait
+	// see the zero count and the continuations consistently. the counter must not be touched after this
+	std::vector<Job> continuations;
+	{
+		std::lock_guard<std::mutex> lock(counter->ContinuationMutex);
+		if(counter->Count.fetch_sub(1, std::memory_order_acq_rel) == 1)
+		{
+			continuations.swap(counter->Continuations);
+		}
+	}
+
+	// start everything that depended on the counter
+
+	for(Job& continuation : continuations)
+	{
+		if(Workers.empty())
+		{
+			Execute(continuation, GetWorkerCount());
+		}
+		else
+		{
+			Push(std::move(continuation));
+		}
+	}
+}
+
+uint32_t JobSystem::GetCurrentQueueIndex() const
+{
+	if(CurrentJobSystem == this)
+	{
+		return CurrentWorkerIndex;
+	}
+
+	// not a worker of this job system -> shared queue
+	return static_cast<uint32_t>(Queues.size()) - 1;
+}
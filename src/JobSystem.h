@@ -0,0 +1,134 @@
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// timing of a single finished job, handed to the profile callback
+struct JobTiming
+{
+	const char* Name;
+	// index of the worker thread, GetWorkerCount() for threads outside the job system. without workers every job
+	// runs inline on the thread that scheduled it, so the index is always GetWorkerCount(), i.e. 0, which is
+	// no worker's index then
+	uint32_t WorkerIndex;
+	uint64_t StartNs;			// steady clock time stamps
+	uint64_t EndNs;
+};
+
+typedef void (*JobProfileCallback)(const JobTiming& timing, void* userData);
+
+class JobCounter;
+
+struct Job
+{
+	const char* Name = "";
+	std::function<void()> Function;
+	JobCounter* Counter = nullptr;		// decremented once the job has finished
+};
+
+// counts the unfinished jobs that were scheduled with it
+// jobs can wait on a counter (JobSystem::Wait) or be started once it reaches zero (JobSystem::RunAfter)
+// a counter has to outlive all jobs that were scheduled with it, i.e. JobSystem::Wait for it before destroying it
+class JobCounter
+{
+public:
+	JobCounter();
+	~JobCounter();
+
+	JobCounter(const JobCounter&) = delete;
+	JobCounter& operator=(const JobCounter&) = delete;
+
+	bool IsDone() const;
+
+	uint32_t GetCount() const;
+
+private:
+	friend class JobSystem;
+
+	std::atomic<uint32_t> Count;
+
+	// jobs to schedule once the count reaches zero
+	std::mutex ContinuationMutex;
+	std::vector<Job> Continuations;
+};
+
+// work stealing job scheduler
+// every worker has its own queue: it takes the newest job from its own queue and steals the oldest
+// job from the other queues when it runs out of work. threads outside the job system push into a
+// separate shared queue and help executing jobs while they wait for a counter
+class JobSystem
+{
+public:
+	JobSystem();
+	~JobSystem();
+
+	// start the worker threads. 0 -> one worker per hardware thread, except for the calling one
+	void Init(uint32_t workerCount = 0);
+
+	// finish the queued jobs and join the worker threads
+	void CleanUp();
+
+	uint32_t GetWorkerCount() const;
+
+	// schedule a job. the counter is incremented immediately and decremented when the job has finished
+	// the name has to be a string literal (or outlive the job), it is only used for profiling
+	void Run(const char* name, std::function<void()> function, JobCounter* counter = nullptr);
+
+	// schedule a job that only starts once dependency has reached zero
+	void RunAfter(JobCounter& dependency, const char* name, std::function<void()> function, JobCounter* counter = nullptr);
+
+	// split [0, count) into batches of batchSize and run function(begin, end) for every batch
+	void ParallelFor(const char* name, uint32_t count, uint32_t batchSize,
+		std::function<void(uint32_t begin, uint32_t end)> function, JobCounter* counter = nullptr);
+
+	// block until the counter reaches zero, executing queued jobs in the meantime
+	void Wait(JobCounter& counter);
+
+	// jobs that threw. the exception is logged and the job counts as finished, so Wait doesn't hang.
+	// jobs whose failure matters should catch it themselves and hand the error over
+	uint32_t GetFailedJobCount() const;
+
+	// called from the executing thread after every job, therefore has to be thread safe
+	// set this before scheduling any jobs
+	void SetProfileCallback(JobProfileCallback callback, void* userData);
+
+private:
+	struct WorkQueue
+	{
+		std::mutex Mutex;
+		std::deque<Job> Jobs;
+	};
+
+	void WorkerLoop(uint32_t workerIndex);
+
+	void Push(Job&& job);
+	bool FindJob(uint32_t queueIndex, Job& job);
+	void Execute(Job& job, uint32_t workerIndex);
+	void FinishJob(JobCounter* counter);
+
+	uint32_t GetCurrentQueueIndex() const;
+
+private:
+	std::vector<std::thread> Workers;
+
+	// one queue per worker, plus a shared queue for all other threads at the end
+	std::vector<std::unique_ptr<WorkQueue>> Queues;
+
+	// idle workers sleep until new jobs are pushed
+	std::atomic<uint32_t> PendingJobs;
+	std::mutex SleepMutex;
+	std::condition_variable WakeCondition;
+	std::atomic<bool> bShutdown;
+
+	std::atomic<uint32_t> FailedJobCount;
+
+	JobProfileCallback ProfileCallback = nullptr;
+	void* ProfileUserData = nullptr;
+};
@@ -0,0 +1,86 @@
+#include "LinearArena.h"
+
+#include <algorithm>
+
+#include "FrameAllocationCheck.h"
+
+static size_t AlignOffset(size_t offset, size_t alignment)
+{
+	return (offset + alignment - 1) & ~(alignment - 1);
+}
+
+LinearArena::LinearArena(size_t capacity)
+	: Block(new uint8_t[capacity]), Capacity(capacity)
+{
+
+}
+
+LinearArena::~LinearArena()
+{
+
+}
+
+void* LinearArena::Allocate(size_t size, size_t alignment)
+{
+	// the block itself is only aligned for max_align_t, so align the address rather than the offset
+	size_t base = reinterpret_cast<size_t>(Block.get());
+	size_t offset = AlignOffset(base + Offset, alignment) - base;
+
+	if(offset + size <= Capacity)
+	{
+		Offset = offset + size;
+		Peak = std::max(Peak, Offset + OverflowBytes);
+
+		return Block.get() + offset;
+	}
+
+	// spill into a block of its own, the next Reset makes room for it.
+	// this only happens while warming up, so it may hit the heap even inside a frame
+	FrameAllocationAllowance allowance;
+
+	OverflowBlocks.emplace_back(new uint8_t[size + alignment]);
+	OverflowBytes += size + alignment;
+	OverflowCount++;
+	Peak = std::max(Peak, Offset + OverflowBytes);
+
+	size_t overflowBase = reinterpret_cast<size_t>(OverflowBlocks.back().get());
+	return reinterpret_cast<void*>(AlignOffset(overflowBase, alignment));
+}
+
+void LinearArena::Reset()
+{
+	if(!OverflowBlocks.empty())
+	{
+		FrameAllocationAllowance allowance;
+
+		OverflowBlocks.clear();
+		OverflowBytes = 0;
+
+		// leave some room, so a slowly growing usage doesn't reallocate every time
+		Capacity = std::max(Capacity, Peak + Peak / 2);
+		Block.reset(new uint8_t[Capacity]);
+	}
+
+	Offset = 0;
+	Peak = 0;
+}
+
+size_t LinearArena::GetUsed() const
+{
+	return Offset + OverflowBytes;
+}
+
+size_t LinearArena::GetCapacity() const
+{
+	return Capacity;
+}
+
+size_t LinearArena::GetPeak() const
+{
+	return Peak;
+}
+
+uint64_t LinearArena::GetOverflowCount() const
+{
+	return OverflowCount;
+}
@@ -0,0 +1,98 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+// bump allocator for data that only lives until the next Reset (e.g. for one frame)
+// nothing is freed individually. when the block runs out, the allocations spill into extra blocks and the next
+// Reset grows the block to the peak usage, so after warming up an arena never touches the heap again
+class LinearArena
+{
+public:
+	explicit LinearArena(size_t capacity = 64 * 1024);
+	~LinearArena();
+
+	LinearArena(const LinearArena&) = delete;
+	LinearArena& operator=(const LinearArena&) = delete;
+
+	// alignment has to be a power of two
+	void* Allocate(size_t size, size_t alignment);
+
+	// everything allocated so far becomes invalid
+	void Reset();
+
+	size_t GetUsed() const;
+	size_t GetCapacity() const;
+	// highest usage between two resets
+	size_t GetPeak() const;
+	// allocations that didn't fit into the block since it was last grown
+	uint64_t GetOverflowCount() const;
+
+private:
+	std::unique_ptr<uint8_t[]> Block;
+	size_t Capacity = 0;
+	size_t Offset = 0;
+
+	std::vector<std::unique_ptr<uint8_t[]>> OverflowBlocks;
+	size_t OverflowBytes = 0;
+	uint64_t OverflowCount = 0;
+
+	size_t Peak = 0;
+};
+
+// lets standard containers allocate from an arena, e.g. ArenaVector<VkImageView> views(ArenaAllocator<VkImageView>(arena))
+// deallocation is a no-op, so growing a container leaves its old storage behind until the arena is reset
+template<typename T>
+class ArenaAllocator
+{
+public:
+	typedef T value_type;
+
+	ArenaAllocator(LinearArena& arena)
+		: Arena(&arena)
+	{
+
+	}
+
+	template<typename U>
+	ArenaAllocator(const ArenaAllocator<U>& other)
+		: Arena(other.GetArena())
+	{
+
+	}
+
+	T* allocate(size_t count)
+	{
+		return static_cast<T*>(Arena->Allocate(count * sizeof(T), alignof(T)));
+	}
+
+	void deallocate(T* memory, size_t count)
+	{
+
+	}
+
+	LinearArena* GetArena() const
+	{
+		return Arena;
+	}
+
+	template<typename U>
+	bool operator==(const ArenaAllocator<U>& other) const
+	{
+		return Arena == other.GetArena();
+	}
+
+	template<typename U>
+	bool operator!=(const ArenaAllocator<U>& other) const
+	{
+		return Arena != other.GetArena();
+	}
+
+private:
+	LinearArena* Arena;
+};
+
+template<typename T>
+using ArenaVector = std::vector<T, ArenaAllocator<T>>;
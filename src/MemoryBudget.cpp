@@ -0,0 +1,175 @@
+#include "MemoryBudget.h"
+
+#include <algorithm>
+#include <stdexcept>
+
+#include "Utilities.h"
+
+// without the extension, leave some room for other applications and for what isn't tracked
+static const VkDeviceSize FALLBACK_BUDGET_PERCENT = 80;
+
+MemoryBudget::MemoryBudget()
+{
+	for(std::atomic<VkDeviceSize>& usage : TrackedUsage)
+	{
+		usage = 0;
+	}
+}
+
+MemoryBudget::~MemoryBudget()
+{
+
+}
+
+void MemoryBudget::Create(VkInstance instance, VkPhysicalDevice physicalDevice, bool useBudgetExtension)
+{
+	PhysicalDevice = physicalDevice;
+	vkGetPhysicalDeviceMemoryProperties(PhysicalDevice, &MemoryProperties);
+
+	DeviceLocalHeap = 0;
+	for(uint32_t i = 0; i < MemoryProperties.memoryTypeCount; i++)
+	{
+		if(MemoryProperties.memoryTypes[i].propertyFlags & VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT)
+		{
+			DeviceLocalHeap = MemoryProperties.memoryTypes[i].heapIndex;
+			break;
+		}
+	}
+
+	GetMemoryProperties2 = nullptr;
+	if(useBudgetExtension)
+	{
+		GetMemoryProperties2 = (PFN_vkGetPhysicalDeviceMemoryProperties2)
+			vkGetInstanceProcAddr(instance, "vkGetPhysicalDeviceMemoryProperties2");
+	}
+
+	Update();
+}
+
+void MemoryBudget::Update()
+{
+	if(GetMemoryProperties2 == nullptr)
+	{
+		return;
+	}
+
+	VkPhysicalDeviceMemoryBudgetPropertiesEXT budgetProperties = {};
+	budgetProperties.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_MEMORY_BUDGET_PROPERTIES_EXT;
+
+	VkPhysicalDeviceMemoryProperties2 memoryProperties = {};
+	memoryProperties.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_MEMORY_PROPERTIES_2;
+	memoryProperties.pNext = &budgetProperties;
+
+	GetMemoryProperties2(PhysicalDevice, &memoryProperties);
+
+	for(uint32_t i = 0; i < MemoryProperties.memoryHeapCount; i++)
+	{
+		DriverUsage[i] = budgetProperties.heapUsage[i];
+		DriverBudget[i] = budgetProperties.heapBudget[i];
+	}
+}
+
+bool MemoryBudget::UsesBudgetExtension() const
+{
+	return GetMemoryProperties2 != nullptr;
+}
+
+uint32_t MemoryBudget::GetHeapCount() const
+{
+	return MemoryProperties.memoryHeapCount;
+}
+
+uint32_t MemoryBudget::GetHeapIndex(uint32_t memoryTypeIndex) const
+{
+	if(memoryTypeIndex >= MemoryProperties.memoryTypeCount)
+	{
+		throw std::runtime_error("invalid memory type index!");
+	}
+
+	return MemoryProperties.memoryTypes[memoryTypeIndex].heapIndex;
+}
+
+uint32_t MemoryBudget::GetDeviceLocalHeap() const
+{
+	return DeviceLocalHeap;
+}
+
+HeapBudget MemoryBudget::GetHeapBudget(uint32_t heapIndex) const
+{
+	if(heapIndex >= MemoryProperties.memoryHeapCount)
+	{
+		throw std::runtime_error("invalid memory heap index!");
+	}
+
+	HeapBudget heap;
+	heap.Size = MemoryProperties.memoryHeaps[heapIndex].size;
+
+	if(UsesBudgetExtension())
+	{
+		heap.Usage = DriverUsage[heapIndex];
+		heap.Budget = DriverBudget[heapIndex];
+	}
+	else
+	{
+		heap.Usage = TrackedUsage[heapIndex].load(std::memory_order_relaxed);
+		heap.Budget = heap.Size / 100 * FALLBACK_BUDGET_PERCENT;
+	}
+
+	if(Limit > 0)
+	{
+		heap.Budget = std::min(heap.Budget, Limit);
+	}
+
+	return heap;
+}
+
+VkDeviceSize MemoryBudget::GetOverBudget(uint32_t heapIndex) const
+{
+	HeapBudget heap = GetHeapBudget(heapIndex);
+
+	return heap.Usage > heap.Budget ? heap.Usage - heap.Budget : 0;
+}
+
+void MemoryBudget::SetLimit(VkDeviceSize limit)
+{
+	Limit = limit;
+}
+
+VkDeviceSize MemoryBudget::GetLimit() const
+{
+	return Limit;
+}
+
+void MemoryBudget::TrackAllocation(uint32_t heapIndex, VkDeviceSize size)
+{
+	TrackedUsage[heapIndex].fetch_add(size, std::memory_order_relaxed);
+}
+
+void MemoryBudget::TrackFree(uint32_t heapIndex, VkDeviceSize size)
+{
+	TrackedUsage[heapIndex].fetch_sub(size, std::memory_order_relaxed);
+}
+
+void MemoryBudget::TrackBuffer(VkDevice logicalDevice, VkBuffer buffer, VkMemoryPropertyFlags properties)
+{
+	VkDeviceSize size;
+	uint32_t heapIndex = GetBufferHeap(logicalDevice, buffer, properties, &size);
+	TrackAllocation(heapIndex, size);
+}
+
+void MemoryBudget::TrackBufferFree(VkDevice logicalDevice, VkBuffer buffer, VkMemoryPropertyFlags properties)
+{
+	VkDeviceSize size;
+	uint32_t heapIndex = GetBufferHeap(logicalDevice, buffer, properties, &size);
+	TrackFree(heapIndex, size);
+}
+
+uint32_t MemoryBudget::GetBufferHeap(VkDevice logicalDevice, VkBuffer buffer, VkMemoryPropertyFlags properties,
+	VkDeviceSize* size) const
+{
+	VkMemoryRequirements memRequirements;
+	vkGetBufferMemoryRequirements(logicalDevice, buffer, &memRequirements);
+	*size = memRequirements.size;
+
+	return GetHeapIndex(FindMemoryTypeIndex(PhysicalDevice, memRequirements.memoryTypeBits, properties));
+}
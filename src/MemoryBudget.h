@@ -0,0 +1,71 @@
+#pragma once
+
+#define GLFW_INCLUDE_VULKAN
+#include <GLFW/glfw3.h>
+
+#include <atomic>
+#include <cstdint>
+
+// usage and budget of one memory heap
+struct HeapBudget
+{
+	VkDeviceSize Size = 0;			// of the heap
+	VkDeviceSize Usage = 0;			// by this process (or only the tracked allocations, without VK_EXT_memory_budget)
+	VkDeviceSize Budget = 0;		// how much this process should use at most
+};
+
+// device memory accounting per heap
+// with VK_EXT_memory_budget, usage and budget come from the driver and include every allocation of the process.
+// without it, only the allocations reported through TrackAllocation / TrackFree count and the budget is
+// a fraction of the heap size. either way, the budget can be lowered further with SetLimit
+class MemoryBudget
+{
+public:
+	MemoryBudget();
+	~MemoryBudget();
+
+	// the extension has to be enabled on the device (and the instance has to be 1.1) to use it
+	void Create(VkInstance instance, VkPhysicalDevice physicalDevice, bool useBudgetExtension);
+
+	// query the driver for the current usage. call once per frame, it isn't free
+	void Update();
+
+	bool UsesBudgetExtension() const;
+
+	uint32_t GetHeapCount() const;
+	uint32_t GetHeapIndex(uint32_t memoryTypeIndex) const;
+	// heap of the first device local memory type, i.e. where the buffers are put
+	uint32_t GetDeviceLocalHeap() const;
+
+	HeapBudget GetHeapBudget(uint32_t heapIndex) const;
+	// by how much the heap's usage exceeds its budget (0 if it doesn't)
+	VkDeviceSize GetOverBudget(uint32_t heapIndex) const;
+
+	// upper bound for the budget of every heap, 0 to only use the driver's budget
+	void SetLimit(VkDeviceSize limit);
+	VkDeviceSize GetLimit() const;
+
+	// (can be called from any thread)
+	void TrackAllocation(uint32_t heapIndex, VkDeviceSize size);
+	void TrackFree(uint32_t heapIndex, VkDeviceSize size);
+	// the memory of a buffer made with CreateBufferAndAllocateMemory, its heap is looked up the way it was allocated
+	void TrackBuffer(VkDevice logicalDevice, VkBuffer buffer, VkMemoryPropertyFlags properties);
+	void TrackBufferFree(VkDevice logicalDevice, VkBuffer buffer, VkMemoryPropertyFlags properties);
+
+private:
+	uint32_t GetBufferHeap(VkDevice logicalDevice, VkBuffer buffer, VkMemoryPropertyFlags properties, VkDeviceSize* size) const;
+
+private:
+	VkPhysicalDevice PhysicalDevice = VK_NULL_HANDLE;
+	PFN_vkGetPhysicalDeviceMemoryProperties2 GetMemoryProperties2 = nullptr;	// only with the extension
+
+	VkPhysicalDeviceMemoryProperties MemoryProperties = {};
+	uint32_t DeviceLocalHeap = 0;
+
+	// driver values from the last Update
+	VkDeviceSize DriverUsage[VK_MAX_MEMORY_HEAPS] = {};
+	VkDeviceSize DriverBudget[VK_MAX_MEMORY_HEAPS] = {};
+
+	std::atomic<VkDeviceSize> TrackedUsage[VK_MAX_MEMORY_HEAPS];
+	VkDeviceSize Limit = 0;
+};
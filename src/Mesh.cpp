@@ -6,16 +6,64 @@ Mesh::Mesh()
 }
 
 Mesh::Mesh(const VkPhysicalDevice& newPhysicalDevice, const VkDevice& newDevice, VkQueue transferQueue,
-         VkCommandPool transferCommandPool,  std::vector<Vertex>* vertices, std::vector<uint32_t>* indices)
+         VkCommandPool transferCommandPool,  std::vector<Vertex>* vertices, std::vector<uint32_t>* indices,
+         const VkAllocationCallbacks* allocator)
 {
     VertexCount = vertices->size();
     IndexCount = indices->size();
     PhysicalDevice = newPhysicalDevice;
     LogicalDevice = newDevice;
+    Allocator = allocator;
     CreateVertexBuffer(transferQueue, transferCommandPool, vertices);
     CreateIndexBuffer(transferQueue, transferCommandPool, indices);
 }
 
+Mesh::Mesh(const VkPhysicalDevice& newPhysicalDevice, const VkDevice& newDevice, std::vector<Vertex>* vertices,
+         std::vector<uint32_t>* indices, VkBuffer* stagingBuffer, VkDeviceMemory* stagingBufferMemory,
+         const VkAllocationCallbacks* allocator)
+{
+    VertexCount = vertices->size();
+    IndexCount = indices->size();
+    PhysicalDevice = newPhysicalDevice;
+    LogicalDevice = newDevice;
+    Allocator = allocator;
+
+    VkDeviceSize vertexBufferSize = sizeof(Vertex) * vertices->size();
+    VkDeviceSize indexBufferSize = sizeof(uint32_t) * indices->size();
+
+    // one staging buffer for both, indices follow the vertices
+    *stagingBuffer = VK_NULL_HANDLE;
+    *stagingBufferMemory = VK_NULL_HANDLE;
+    try
+    {
+        CreateBufferAndAllocateMemory(PhysicalDevice, LogicalDevice, vertexBufferSize + indexBufferSize, VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
+            VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
+            stagingBuffer, stagingBufferMemory, Allocator);
+
+        void* data;
+        vkMapMemory(LogicalDevice, *stagingBufferMemory, 0, vertexBufferSize + indexBufferSize, 0, &data);
+        memcpy(data, vertices->data(), (size_t)(vertexBufferSize));
+        memcpy(static_cast<char*>(data) + vertexBufferSize, indices->data(), (size_t)(indexBufferSize));
+        vkUnmapMemory(LogicalDevice, *stagingBufferMemory);
+
+        CreateBufferAndAllocateMemory(PhysicalDevice, LogicalDevice, vertexBufferSize, VK_BUFFER_USAGE_TRANSFER_DST_BIT | VK_BUFFER_USAGE_VERTEX_BUFFER_BIT,
+            VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, &VertexBuffer, &VertexBufferMemory, Allocator);
+        CreateBufferAndAllocateMemory(PhysicalDevice, LogicalDevice, indexBufferSize, VK_BUFFER_USAGE_TRANSFER_DST_BIT | VK_BUFFER_USAGE_INDEX_BUFFER_BIT,
+            VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, &IndexBuffer, &IndexBufferMemory, Allocator);
+    }
+    catch(const std::runtime_error&)
+    {
+        // the mesh never exists, so nobody else could destroy what was created up to here
+        // (destroying VK_NULL_HANDLE does nothing)
+        DestroyBuffers();
+        vkDestroyBuffer(LogicalDevice, *stagingBuffer, Allocator);
+        vkFreeMemory(LogicalDevice, *stagingBufferMemory, Allocator);
+        *stagingBuffer = VK_NULL_HANDLE;
+        *stagingBufferMemory = VK_NULL_HANDLE;
+        throw;
+    }
+}
+
 Mesh::~Mesh()
 {
 
@@ -41,13 +89,71 @@ VkBuffer Mesh::GetIndexBuffer() const
     return IndexBuffer;
 }
 
+bool Mesh::IsValid() const
+{
+    return VertexBuffer != VK_NULL_HANDLE;
+}
+
+VkDeviceSize Mesh::GetMemorySize() const
+{
+    if(!IsValid())
+    {
+        return 0;
+    }
+
+    VkMemoryRequirements vertexRequirements;
+    vkGetBufferMemoryRequirements(LogicalDevice, VertexBuffer, &vertexRequirements);
+    VkMemoryRequirements indexRequirements;
+    vkGetBufferMemoryRequirements(LogicalDevice, IndexBuffer, &indexRequirements);
+
+    return vertexRequirements.size + indexRequirements.size;
+}
+
+void Mesh::RecordUpload(VkCommandBuffer commandBuffer, VkBuffer stagingBuffer) const
+{
+    VkDeviceSize vertexBufferSize = sizeof(Vertex) * VertexCount;
+    VkDeviceSize indexBufferSize = sizeof(uint32_t) * IndexCount;
+
+    VkBufferCopy vertexCopyRegion = {};
+    vertexCopyRegion.srcOffset = 0;
+    vertexCopyRegion.dstOffset = 0;
+    vertexCopyRegion.size = vertexBufferSize;
+    vkCmdCopyBuffer(commandBuffer, stagingBuffer, VertexBuffer, 1, &vertexCopyRegion);
+
+    VkBufferCopy indexCopyRegion = {};
+    indexCopyRegion.srcOffset = vertexBufferSize;
+    indexCopyRegion.dstOffset = 0;
+    indexCopyRegion.size = indexBufferSize;
+    vkCmdCopyBuffer(commandBuffer, stagingBuffer, IndexBuffer, 1, &indexCopyRegion);
+
+    // the draws reading these buffers are submitted later on the same queue,
+    // the barrier makes the copied data visible to them
+    VkBufferMemoryBarrier barriers[2] = {};
+    for(uint32_t i = 0; i < 2; i++)
+    {
+        barriers[i].sType = VK_STRUCTURE_TYPE_BUFFER_MEMORY_BARRIER;
+        barriers[i].srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+        barriers[i].srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+        barriers[i].dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+        barriers[i].offset = 0;
+        barriers[i].size = VK_WHOLE_SIZE;
+    }
+    barriers[0].dstAccessMask = VK_ACCESS_VERTEX_ATTRIBUTE_READ_BIT;
+    barriers[0].buffer = VertexBuffer;
+    barriers[1].dstAccessMask = VK_ACCESS_INDEX_READ_BIT;
+    barriers[1].buffer = IndexBuffer;
+
+    vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_VERTEX_INPUT_BIT, 0,
+        0, nullptr, 2, barriers, 0, nullptr);
+}
+
 void Mesh::DestroyBuffers()
 {
-    vkDestroyBuffer(LogicalDevice, VertexBuffer, nullptr);
-    vkFreeMemory(LogicalDevice, VertexBufferMemory, nullptr);
+    vkDestroyBuffer(LogicalDevice, VertexBuffer, Allocator);
+    vkFreeMemory(LogicalDevice, VertexBufferMemory, Allocator);
 
-    vkDestroyBuffer(LogicalDevice, IndexBuffer, nullptr);
-    vkFreeMemory(LogicalDevice, IndexBufferMemory, nullptr);
+    vkDestroyBuffer(LogicalDevice, IndexBuffer, Allocator);
+    vkFreeMemory(LogicalDevice, IndexBufferMemory, Allocator);
 }
 
 void Mesh::CreateVertexBuffer(VkQueue transferQueue, VkCommandPool transferCommandPool, std::vector<Vertex>* vertices)
@@ -66,7 +172,7 @@ void Mesh::CreateVertexBuffer(VkQueue transferQueue, VkCommandPool transferComma
     // create staging buffer and allocate memory to it
     CreateBufferAndAllocateMemory(PhysicalDevice, LogicalDevice, bufferSize, VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
         VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
-        &stagingBuffer, &stagingBufferMemory);
+        &stagingBuffer, &stagingBufferMemory, Allocator);
 
     // Map Memory To Staging Buffer
 
@@ -88,15 +194,15 @@ void Mesh::CreateVertexBuffer(VkQueue transferQueue, VkCommandPool transferComma
     // this is the actual vertex buffer
     // buffer memory is DEVICE_LOCAL, i.e. the GPU is accessing this only, not the CPU
     CreateBufferAndAllocateMemory(PhysicalDevice, LogicalDevice, bufferSize, VK_BUFFER_USAGE_TRANSFER_DST_BIT | VK_BUFFER_USAGE_VERTEX_BUFFER_BIT,
-        VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, &VertexBuffer, &VertexBufferMemory);
+        VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, &VertexBuffer, &VertexBufferMemory, Allocator);
 
     // the buffer is transferred via the transfer "queue". as per vulkan definition, the graphics queue family has a transfer family
     // meaning we don't have to find one extra queue family
     CopyBuffer(LogicalDevice, transferQueue, transferCommandPool, stagingBuffer, VertexBuffer, bufferSize);
 
     // destroy staging buffer and free memory
-    vkDestroyBuffer(LogicalDevice, stagingBuffer, nullptr);
-    vkFreeMemory(LogicalDevice, stagingBufferMemory, nullptr);
+    vkDestroyBuffer(LogicalDevice, stagingBuffer, Allocator);
+    vkFreeMemory(LogicalDevice, stagingBufferMemory, Allocator);
 }
 
  void Mesh::CreateIndexBuffer(VkQueue transferQueue, VkCommandPool transferCommandPool, std::vector<uint32_t>* indices)
@@ -111,7 +217,7 @@ void Mesh::CreateVertexBuffer(VkQueue transferQueue, VkCommandPool transferComma
     // create staging buffer and allocate memory to it
     CreateBufferAndAllocateMemory(PhysicalDevice, LogicalDevice, bufferSize, VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
         VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
-        &stagingBuffer, &stagingBufferMemory);
+        &stagingBuffer, &stagingBufferMemory, Allocator);
 
     void* data;
     vkMapMemory(LogicalDevice, stagingBufferMemory, 0, bufferSize, 0, &data);
@@ -119,11 +225,11 @@ void Mesh::CreateVertexBuffer(VkQueue transferQueue, VkCommandPool transferComma
     vkUnmapMemory(LogicalDevice, stagingBufferMemory);
 
     CreateBufferAndAllocateMemory(PhysicalDevice, LogicalDevice, bufferSize, VK_BUFFER_USAGE_TRANSFER_DST_BIT | VK_BUFFER_USAGE_INDEX_BUFFER_BIT,
-        VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, &IndexBuffer, &IndexBufferMemory);
+        VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, &IndexBuffer, &IndexBufferMemory, Allocator);
 
     CopyBuffer(LogicalDevice, transferQueue, transferCommandPool, stagingBuffer, IndexBuffer, bufferSize);
 
     // destroy staging buffer and free memory
-    vkDestroyBuffer(LogicalDevice, stagingBuffer, nullptr);
-    vkFreeMemory(LogicalDevice, stagingBufferMemory, nullptr);
+    vkDestroyBuffer(LogicalDevice, stagingBuffer, Allocator);
+    vkFreeMemory(LogicalDevice, stagingBufferMemory, Allocator);
  }
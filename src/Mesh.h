@@ -8,12 +8,34 @@
 
 #include "Utilities.h"
 
+// index into the renderer's mesh list
+typedef uint32_t MeshHandle;
+const MeshHandle INVALID_MESH_HANDLE = UINT32_MAX;
+
+enum MeshState
+{
+    MESH_STATE_LOADING,     // being loaded or uploaded in the background
+    MESH_STATE_READY,       // uploaded and part of the draw list
+    MESH_STATE_FAILED,
+    MESH_STATE_REMOVED,     // its buffers are destroyed once the gpu is done with them
+    MESH_STATE_EVICTED      // buffers destroyed to stay within the memory budget, streamed in again when it's drawn
+};
+
 class Mesh
 {
 public:
     Mesh();
+    // the buffers are created and destroyed with allocator (the staging buffer as well)
     Mesh(const VkPhysicalDevice& newPhysicalDevice, const VkDevice& newDevice, VkQueue transferQueue,
-         VkCommandPool transferCommandPool, std::vector<Vertex>* vertices, std::vector<uint32_t>* indices);
+         VkCommandPool transferCommandPool, std::vector<Vertex>* vertices, std::vector<uint32_t>* indices,
+         const VkAllocationCallbacks* allocator = nullptr);
+
+    // create the buffers without uploading: vertices and indices are written to a new host visible staging buffer
+    // the copy is recorded with RecordUpload and the staging buffer has to stay alive until it has executed
+    // (doesn't use a queue or command pool, so this can run on any thread)
+    Mesh(const VkPhysicalDevice& newPhysicalDevice, const VkDevice& newDevice, std::vector<Vertex>* vertices,
+         std::vector<uint32_t>* indices, VkBuffer* stagingBuffer, VkDeviceMemory* stagingBufferMemory,
+         const VkAllocationCallbacks* allocator = nullptr);
 
     ~Mesh();
 
@@ -25,6 +47,15 @@ public:
 
     VkBuffer GetIndexBuffer() const;
 
+    // false for default constructed meshes (i.e. empty slots in the mesh list)
+    bool IsValid() const;
+
+    // device memory of the vertex and index buffer
+    VkDeviceSize GetMemorySize() const;
+
+    // copy the staging buffer into the vertex and index buffer and make them visible to the vertex input stage
+    void RecordUpload(VkCommandBuffer commandBuffer, VkBuffer stagingBuffer) const;
+
     void DestroyBuffers();
 
 private:
@@ -33,13 +64,14 @@ private:
 
 private:
     uint32_t VertexCount = 0;
-    VkBuffer VertexBuffer;                  // the layout of the buffer, i.e. header, only information
-    VkDeviceMemory VertexBufferMemory;      // actual memory
+    VkBuffer VertexBuffer = VK_NULL_HANDLE;                 // the layout of the buffer, i.e. header, only information
+    VkDeviceMemory VertexBufferMemory = VK_NULL_HANDLE;     // actual memory
 
     uint32_t IndexCount = 0;
-    VkBuffer IndexBuffer;
-    VkDeviceMemory IndexBufferMemory;
+    VkBuffer IndexBuffer = VK_NULL_HANDLE;
+    VkDeviceMemory IndexBufferMemory = VK_NULL_HANDLE;
 
     VkPhysicalDevice PhysicalDevice;
     VkDevice LogicalDevice;
+    const VkAllocationCallbacks* Allocator = nullptr;
 };
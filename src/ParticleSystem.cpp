@@ -0,0 +1,426 @@
+#include "ParticleSystem.h"
+
+#include <algorithm>
+#include <array>
+#include <cstddef>
+#include <cstring>
+#include <stdexcept>
+
+#include "Utilities.h"
+
+// must match the local size of the particle compute shaders
+static const uint32_t PARTICLE_GROUP_SIZE = 64;
+
+// longest time step simulated at once, e.g. after the window was dragged
+static const float MAX_PARTICLE_TIME_STEP = 0.1f;
+
+struct ParticleDrawConstants
+{
+	float Size;
+	uint32_t MaxParticles;
+};
+
+ParticleSystem::ParticleSystem()
+{
+
+}
+
+ParticleSystem::~ParticleSystem()
+{
+
+}
+
+void ParticleSystem::Create(ComputeSystem& compute, ShaderCompiler& shaders, VkPhysicalDevice physicalDevice, VkDevice logicalDevice,
+	VkQueue queue, VkCommandPool commandPool, VkRenderPass renderPass, const VkPipelineRenderingCreateInfo* renderingInfo,
+	VkSampleCountFlagBits samples, VkExtent2D extent, const std::vector<VkBuffer>& uniformBuffers,
+	const ParticleSettings& settings, const VkAllocationCallbacks* allocator)
+{
+	if(settings.MaxParticles == 0 || settings.MaxEmitPerFrame == 0)
+	{
+		throw std::runtime_error("particle system needs room for particles!");
+	}
+
+	Compute = &compute;
+	LogicalDevice = logicalDevice;
+	Allocator = allocator;
+	Settings = settings;
+
+	// -- Buffers
+	// particles are read as vertex shader data by the draw, the counters double as indirect arguments
+	ParticleBuffer = compute.CreateStorageBuffer(2 * static_cast<VkDeviceSize>(settings.MaxParticles) * 3 * sizeof(glm::vec4));
+	CounterBuffer = compute.CreateStorageBuffer(sizeof(ParticleCounters), false, false, VK_BUFFER_USAGE_INDIRECT_BUFFER_BIT);
+	ParameterBuffer = compute.CreateStorageBuffer(sizeof(ParticleParameters), true, true);
+
+	ClearCounters(queue, commandPool);
+
+	// -- Compute passes (in order: simulate and compact, emit, flip)
+	std::vector<StorageBufferHandle> buffers = { ParticleBuffer, CounterBuffer, ParameterBuffer };
+
+	ComputePipelineHandle simulate = compute.CreateComputePipeline(
+		shaders.Load("particle_simulate.comp", "particle_simulate.spv"), buffers);
+	ComputePipelineHandle emit = compute.CreateComputePipeline(
+		shaders.Load("particle_emit.comp", "particle_emit.spv"), buffers);
+	ComputePipelineHandle finish = compute.CreateComputePipeline(
+		shaders.Load("particle_finish.comp", "particle_finish.spv"), buffers);
+
+	// the number of simulate groups depends on the alive count of the last frame, which only the gpu knows
+	compute.AddIndirectDispatch(COMPUTE_STAGE_BEFORE_RENDER_PASS, simulate, CounterBuffer, offsetof(ParticleCounters, SimulateArgs));
+	compute.AddDispatch(COMPUTE_STAGE_BEFORE_RENDER_PASS, emit,
+		(settings.MaxEmitPerFrame + PARTICLE_GROUP_SIZE - 1) / PARTICLE_GROUP_SIZE);
+	compute.AddDispatch(COMPUTE_STAGE_BEFORE_RENDER_PASS, finish, 1);
+
+	// -- Drawing
+	CreateDescriptorSets(uniformBuffers);
+	CreateGraphicsPipeline(shaders, renderPass, renderingInfo, samples, extent);
+
+	// nothing is emitted before the first update
+	for(uint32_t i = 0; i < static_cast<uint32_t>(uniformBuffers.size()); i++)
+	{
+		memset(compute.GetStorageBufferMapped(ParameterBuffer, i), 0, sizeof(ParticleParameters));
+	}
+	bFirstUpdate = true;
+}
+
+void ParticleSystem::Destroy()
+{
+	if(!IsEnabled())
+	{
+		return;
+	}
+
+	vkDestroyPipeline(LogicalDevice, GraphicsPipeline, Allocator);
+	vkDestroyPipelineLayout(LogicalDevice, PipelineLayout, Allocator);
+	vkDestroyDescriptorPool(LogicalDevice, DescriptorPool, Allocator);
+	vkDestroyDescriptorSetLayout(LogicalDevice, DescriptorSetLayout, Allocator);
+
+	GraphicsPipeline = VK_NULL_HANDLE;
+	Compute = nullptr;
+}
+
+bool ParticleSystem::IsEnabled() const
+{
+	return Compute != nullptr;
+}
+
+void ParticleSystem::SetSettings(const ParticleSettings& settings)
+{
+	uint32_t maxParticles = Settings.MaxParticles;
+	uint32_t maxEmitPerFrame = Settings.MaxEmitPerFrame;
+
+	Settings = settings;
+	Settings.MaxParticles = maxParticles;
+	Settings.MaxEmitPerFrame = maxEmitPerFrame;
+}
+
+const ParticleSettings& ParticleSystem::GetSettings() const
+{
+	return Settings;
+}
+
+void ParticleSystem::Update(uint32_t imageIndex)
+{
+	std::chrono::steady_clock::time_point now = std::chrono::steady_clock::now();
+	float deltaTime = bFirstUpdate ? 0.0f : std::chrono::duration<float>(now - LastUpdate).count();
+	deltaTime = std::min(deltaTime, MAX_PARTICLE_TIME_STEP);
+	LastUpdate = now;
+	bFirstUpdate = false;
+
+	// keep the fraction, so low rates still emit over several frames
+	float emit = Settings.EmitRate * deltaTime + EmitRemainder;
+	uint32_t emitCount = std::min(static_cast<uint32_t>(emit), Settings.MaxEmitPerFrame);
+	EmitRemainder = emit - static_cast<float>(static_cast<uint32_t>(emit));
+
+	ParticleParameters parameters;
+	parameters.EmitterPosition = glm::vec4(Settings.EmitterPosition, Settings.EmitterRadius);
+	parameters.EmitterVelocity = glm::vec4(Settings.EmitterVelocity, Settings.VelocitySpread);
+	parameters.Gravity = glm::vec4(Settings.Gravity, deltaTime);
+	parameters.Colour = Settings.Colour;
+	parameters.EmitCount = emitCount;
+	parameters.Seed = Seed++;
+	parameters.MaxParticles = Settings.MaxParticles;
+	parameters.Lifetime = Settings.Lifetime;
+
+	// the image's previous frame has finished, so its buffer is free
+	memcpy(Compute->GetStorageBufferMapped(ParameterBuffer, imageIndex), &parameters, sizeof(ParticleParameters));
+}
+
+void ParticleSystem::RecordDraw(VkCommandBuffer commandBuffer, uint32_t imageIndex) const
+{
+	if(!IsEnabled())
+	{
+		return;
+	}
+
+	vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, GraphicsPipeline);
+	vkCmdBindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, PipelineLayout,
+		0, 1, &DescriptorSets[imageIndex], 0, nullptr);
+
+	ParticleDrawConstants constants;
+	constants.Size = Settings.Size;
+	constants.MaxParticles = Settings.MaxParticles;
+	vkCmdPushConstants(commandBuffer, PipelineLayout, VK_SHADER_STAGE_VERTEX_BIT, 0, sizeof(ParticleDrawConstants), &constants);
+
+	// one instance per alive particle, the instance count was written by the finish pass
+	vkCmdDrawIndirect(commandBuffer, Compute->GetStorageBuffer(CounterBuffer),
+		offsetof(ParticleCounters, DrawArgs), 1, sizeof(VkDrawIndirectCommand));
+}
+
+void ParticleSystem::CreateDescriptorSets(const std::vector<VkBuffer>& uniformBuffers)
+{
+	uint32_t imageCount = static_cast<uint32_t>(uniformBuffers.size());
+
+	// view projection uniform, particles and counters
+	std::array<VkDescriptorSetLayoutBinding, 3> bindings = {};
+	bindings[0].binding = 0;
+	bindings[0].descriptorType = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER;
+	bindings[0].descriptorCount = 1;
+	bindings[0].stageFlags = VK_SHADER_STAGE_VERTEX_BIT;
+	for(uint32_t i = 1; i < bindings.size(); i++)
+	{
+		bindings[i].binding = i;
+		bindings[i].descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+		bindings[i].descriptorCount = 1;
+		bindings[i].stageFlags = VK_SHADER_STAGE_VERTEX_BIT;
+	}
+
+	VkDescriptorSetLayoutCreateInfo layoutCreateInfo = {};
+	layoutCreateInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO;
+	layoutCreateInfo.bindingCount = static_cast<uint32_t>(bindings.size());
+	layoutCreateInfo.pBindings = bindings.data();
+
+	if(vkCreateDescriptorSetLayout(LogicalDevice, &layoutCreateInfo, Allocator, &DescriptorSetLayout) != VK_SUCCESS)
+	{
+		throw std::runtime_error("failed to create the particle descriptor set layout!");
+	}
+
+	std::array<VkDescriptorPoolSize, 2> poolSizes = {};
+	poolSizes[0].type = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER;
+	poolSizes[0].descriptorCount = imageCount;
+	poolSizes[1].type = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+	poolSizes[1].descriptorCount = 2 * imageCount;
+
+	VkDescriptorPoolCreateInfo poolCreateInfo = {};
+	poolCreateInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO;
+	poolCreateInfo.maxSets = imageCount;
+	poolCreateInfo.poolSizeCount = static_cast<uint32_t>(poolSizes.size());
+	poolCreateInfo.pPoolSizes = poolSizes.data();
+
+	if(vkCreateDescriptorPool(LogicalDevice, &poolCreateInfo, Allocator, &DescriptorPool) != VK_SUCCESS)
+	{
+		throw std::runtime_error("failed to create the particle descriptor pool!");
+	}
+
+	std::vector<VkDescriptorSetLayout> setLayouts(imageCount, DescriptorSetLayout);
+	DescriptorSets.resize(imageCount);
+
+	VkDescriptorSetAllocateInfo allocateInfo = {};
+	allocateInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO;
+	allocateInfo.descriptorPool = DescriptorPool;
+	allocateInfo.descriptorSetCount = imageCount;
+	allocateInfo.pSetLayouts = setLayouts.data();
+
+	if(vkAllocateDescriptorSets(LogicalDevice, &allocateInfo, DescriptorSets.data()) != VK_SUCCESS)
+	{
+		throw std::runtime_error("failed to allocate the particle descriptor sets!");
+	}
+
+	for(uint32_t i = 0; i < imageCount; i++)
+	{
+		std::array<VkDescriptorBufferInfo, 3> bufferInfos = {};
+		bufferInfos[0].buffer = uniformBuffers[i];
+		bufferInfos[0].range = VK_WHOLE_SIZE;
+		bufferInfos[1].buffer = Compute->GetStorageBuffer(ParticleBuffer);
+		bufferInfos[1].range = VK_WHOLE_SIZE;
+		bufferInfos[2].buffer = Compute->GetStorageBuffer(CounterBuffer);
+		bufferInfos[2].range = VK_WHOLE_SIZE;
+
+		std::array<VkWriteDescriptorSet, 3> writes = {};
+		for(uint32_t binding = 0; binding < writes.size(); binding++)
+		{
+			writes[binding].sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+			writes[binding].dstSet = DescriptorSets[i];
+			writes[binding].dstBinding = binding;
+			writes[binding].descriptorType = bindings[binding].descriptorType;
+			writes[binding].descriptorCount = 1;
+			writes[binding].pBufferInfo = &bufferInfos[binding];
+		}
+
+		vkUpdateDescriptorSets(LogicalDevice, static_cast<uint32_t>(writes.size()), writes.data(), 0, nullptr);
+	}
+}
+
+void ParticleSystem::CreateGraphicsPipeline(ShaderCompiler& shaders, VkRenderPass renderPass, const VkPipelineRenderingCreateInfo* renderingInfo,
+	VkSampleCountFlagBits samples, VkExtent2D extent)
+{
+	ShaderCode vertexShaderCode = shaders.Load("particle.vert", "particle_vert.spv");
+	ShaderCode fragmentShaderCode = shaders.Load("particle.frag", "particle_frag.spv");
+
+	VkShaderModule shaderModules[2];
+	const ShaderCode* shaderCodes[2] = { &vertexShaderCode, &fragmentShaderCode };
+	for(uint32_t i = 0; i < 2; i++)
+	{
+		VkShaderModuleCreateInfo moduleCreateInfo = {};
+		moduleCreateInfo.sType = VK_STRUCTURE_TYPE_SHADER_MODULE_CREATE_INFO;
+		moduleCreateInfo.codeSize = shaderCodes[i]->GetSize();
+		moduleCreateInfo.pCode = shaderCodes[i]->GetCode();
+
+		if(vkCreateShaderModule(LogicalDevice, &moduleCreateInfo, Allocator, &shaderModules[i]) != VK_SUCCESS)
+		{
+			throw std::runtime_error("failed to create shader module!");
+		}
+	}
+
+	VkPipelineShaderStageCreateInfo shaderStages[2] = {};
+	shaderStages[0].sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
+	shaderStages[0].stage = VK_SHADER_STAGE_VERTEX_BIT;
+	shaderStages[0].module = shaderModules[0];
+	shaderStages[0].pName = "main";
+	shaderStages[1].sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
+	shaderStages[1].stage = VK_SHADER_STAGE_FRAGMENT_BIT;
+	shaderStages[1].module = shaderModules[1];
+	shaderStages[1].pName = "main";
+
+	// no vertex input, the vertex shader builds the quads from the particle buffer
+	VkPipelineVertexInputStateCreateInfo vertexInputCreateInfo = {};
+	vertexInputCreateInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_VERTEX_INPUT_STATE_CREATE_INFO;
+
+	VkPipelineInputAssemblyStateCreateInfo inputAssemblyCreateInfo = {};
+	inputAssemblyCreateInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_INPUT_ASSEMBLY_STATE_CREATE_INFO;
+	inputAssemblyCreateInfo.topology = VK_PRIMITIVE_TOPOLOGY_TRIANGLE_LIST;
+	inputAssemblyCreateInfo.primitiveRestartEnable = VK_FALSE;
+
+	VkViewport viewport = {};
+	viewport.width = (float)extent.width;
+	viewport.height = (float)extent.height;
+	viewport.minDepth = 0;
+	viewport.maxDepth = 1;
+
+	VkRect2D scissor = {};
+	scissor.offset = {0, 0};
+	scissor.extent = extent;
+
+	VkPipelineViewportStateCreateInfo viewportCreateInfo = {};
+	viewportCreateInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_VIEWPORT_STATE_CREATE_INFO;
+	viewportCreateInfo.viewportCount = 1;
+	viewportCreateInfo.pViewports = &viewport;
+	viewportCreateInfo.scissorCount = 1;
+	viewportCreateInfo.pScissors = &scissor;
+
+	// quads always face the camera, so there is nothing to cull
+	VkPipelineRasterizationStateCreateInfo rasterizerCreateInfo = {};
+	rasterizerCreateInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_RASTERIZATION_STATE_CREATE_INFO;
+	rasterizerCreateInfo.polygonMode = VK_POLYGON_MODE_FILL;
+	rasterizerCreateInfo.lineWidth = 1.0f;
+	rasterizerCreateInfo.cullMode = VK_CULL_MODE_NONE;
+	rasterizerCreateInfo.frontFace = VK_FRONT_FACE_COUNTER_CLOCKWISE;
+
+	VkPipelineMultisampleStateCreateInfo multisampleCreateInfo = {};
+	multisampleCreateInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_MULTISAMPLE_STATE_CREATE_INFO;
+	multisampleCreateInfo.rasterizationSamples = samples;
+
+	// additive: particles don't have to be sorted
+	VkPipelineColorBlendAttachmentState colourBlendState = {};
+	colourBlendState.colorWriteMask = VK_COLOR_COMPONENT_R_BIT | VK_COLOR_COMPONENT_G_BIT
+		| VK_COLOR_COMPONENT_B_BIT | VK_COLOR_COMPONENT_A_BIT;
+	colourBlendState.blendEnable = VK_TRUE;
+	colourBlendState.srcColorBlendFactor = VK_BLEND_FACTOR_SRC_ALPHA;
+	colourBlendState.dstColorBlendFactor = VK_BLEND_FACTOR_ONE;
+	colourBlendState.colorBlendOp = VK_BLEND_OP_ADD;
+	colourBlendState.srcAlphaBlendFactor = VK_BLEND_FACTOR_ZERO;
+	colourBlendState.dstAlphaBlendFactor = VK_BLEND_FACTOR_ONE;
+	colourBlendState.alphaBlendOp = VK_BLEND_OP_ADD;
+
+	VkPipelineColorBlendStateCreateInfo colourBlendCreateInfo = {};
+	colourBlendCreateInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_COLOR_BLEND_STATE_CREATE_INFO;
+	colourBlendCreateInfo.logicOpEnable = VK_FALSE;
+	colourBlendCreateInfo.attachmentCount = 1;
+	colourBlendCreateInfo.pAttachments = &colourBlendState;
+
+	// hidden behind meshes, but don't hide each other
+	VkPipelineDepthStencilStateCreateInfo depthStencilCreateInfo = {};
+	depthStencilCreateInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_DEPTH_STENCIL_STATE_CREATE_INFO;
+	depthStencilCreateInfo.depthTestEnable = VK_TRUE;
+	depthStencilCreateInfo.depthWriteEnable = VK_FALSE;
+	depthStencilCreateInfo.depthCompareOp = VK_COMPARE_OP_LESS_OR_EQUAL;
+
+	VkPushConstantRange pushConstantRange = {};
+	pushConstantRange.stageFlags = VK_SHADER_STAGE_VERTEX_BIT;
+	pushConstantRange.offset = 0;
+	pushConstantRange.size = sizeof(ParticleDrawConstants);
+
+	VkPipelineLayoutCreateInfo pipelineLayoutCreateInfo = {};
+	pipelineLayoutCreateInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
+	pipelineLayoutCreateInfo.setLayoutCount = 1;
+	pipelineLayoutCreateInfo.pSetLayouts = &DescriptorSetLayout;
+	pipelineLayoutCreateInfo.pushConstantRangeCount = 1;
+	pipelineLayoutCreateInfo.pPushConstantRanges = &pushConstantRange;
+
+	if(vkCreatePipelineLayout(LogicalDevice, &pipelineLayoutCreateInfo, Allocator, &PipelineLayout) != VK_SUCCESS)
+	{
+		throw std::runtime_error("failed to create the particle pipeline layout!");
+	}
+
+	VkGraphicsPipelineCreateInfo pipelineCreateInfo = {};
+	pipelineCreateInfo.sType = VK_STRUCTURE_TYPE_GRAPHICS_PIPELINE_CREATE_INFO;
+	pipelineCreateInfo.pNext = renderingInfo;
+	pipelineCreateInfo.stageCount = 2;
+	pipelineCreateInfo.pStages = shaderStages;
+	pipelineCreateInfo.pVertexInputState = &vertexInputCreateInfo;
+	pipelineCreateInfo.pInputAssemblyState = &inputAssemblyCreateInfo;
+	pipelineCreateInfo.pViewportState = &viewportCreateInfo;
+	pipelineCreateInfo.pRasterizationState = &rasterizerCreateInfo;
+	pipelineCreateInfo.pMultisampleState = &multisampleCreateInfo;
+	pipelineCreateInfo.pColorBlendState = &colourBlendCreateInfo;
+	pipelineCreateInfo.pDepthStencilState = &depthStencilCreateInfo;
+	pipelineCreateInfo.layout = PipelineLayout;
+	pipelineCreateInfo.renderPass = renderPass;
+	pipelineCreateInfo.subpass = 0;
+	pipelineCreateInfo.basePipelineHandle = VK_NULL_HANDLE;
+	pipelineCreateInfo.basePipelineIndex = -1;
+
+	VkResult result = vkCreateGraphicsPipelines(LogicalDevice, VK_NULL_HANDLE, 1, &pipelineCreateInfo, Allocator, &GraphicsPipeline);
+
+	vkDestroyShaderModule(LogicalDevice, shaderModules[1], Allocator);
+	vkDestroyShaderModule(LogicalDevice, shaderModules[0], Allocator);
+
+	if(result != VK_SUCCESS)
+	{
+		throw std::runtime_error("failed to create the particle pipeline!");
+	}
+}
+
+void ParticleSystem::ClearCounters(VkQueue queue, VkCommandPool commandPool)
+{
+	// the counters have to start at zero (no particles, no groups, no instances)
+	VkCommandBuffer commandBuffer;
+
+	VkCommandBufferAllocateInfo allocateInfo = {};
+	allocateInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
+	allocateInfo.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
+	allocateInfo.commandPool = commandPool;
+	allocateInfo.commandBufferCount = 1;
+
+	if(vkAllocateCommandBuffers(LogicalDevice, &allocateInfo, &commandBuffer) != VK_SUCCESS)
+	{
+		throw std::runtime_error("failed to allocate a command buffer!");
+	}
+
+	VkCommandBufferBeginInfo beginInfo = {};
+	beginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+	beginInfo.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
+
+	vkBeginCommandBuffer(commandBuffer, &beginInfo);
+	vkCmdFillBuffer(commandBuffer, Compute->GetStorageBuffer(CounterBuffer), 0, VK_WHOLE_SIZE, 0);
+	vkEndCommandBuffer(commandBuffer);
+
+	VkSubmitInfo submitInfo = {};
+	submitInfo.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
+	submitInfo.commandBufferCount = 1;
+	submitInfo.pCommandBuffers = &commandBuffer;
+
+	// only happens once, at creation
+	vkQueueSubmit(queue, 1, &submitInfo, VK_NULL_HANDLE);
+	vkQueueWaitIdle(queue);
+
+	vkFreeCommandBuffers(LogicalDevice, commandPool, 1, &commandBuffer);
+}
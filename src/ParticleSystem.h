@@ -0,0 +1,120 @@
+#pragma once
+
+#define GLFW_INCLUDE_VULKAN
+#include <GLFW/glfw3.h>
+
+#include <chrono>
+#include <cstdint>
+#include <vector>
+
+#include <glm/glm.hpp>
+
+#include "ComputeSystem.h"
+#include "ShaderCompiler.h"
+
+struct ParticleSettings
+{
+	uint32_t MaxParticles = 256 * 1024;
+	uint32_t MaxEmitPerFrame = 8192;		// size of the emit dispatch
+	float EmitRate = 50000.0f;				// particles per second
+	float Lifetime = 4.0f;					// seconds, each particle lives between half and all of it
+
+	glm::vec3 EmitterPosition = glm::vec3(0.0f, 0.0f, 0.0f);
+	float EmitterRadius = 0.05f;
+	glm::vec3 EmitterVelocity = glm::vec3(0.0f, 1.5f, 0.0f);
+	float VelocitySpread = 0.5f;
+	glm::vec3 Gravity = glm::vec3(0.0f, -1.0f, 0.0f);
+
+	glm::vec4 Colour = glm::vec4(1.0f, 0.6f, 0.2f, 1.0f);
+	float Size = 0.01f;
+};
+
+// particles that live entirely on the gpu: emission, integration and compaction of the dead ones
+// run as compute dispatches before the render pass, and all particles are drawn with a single
+// instanced indirect draw whose instance count is written by the gpu.
+// the cpu only writes a few parameters per frame, no matter how many particles are alive
+class ParticleSystem
+{
+public:
+	ParticleSystem();
+	~ParticleSystem();
+
+	// creates the buffers and dispatches in compute and its own graphics pipeline for the render pass
+	// renderingInfo: attachment formats with dynamic rendering (renderPass is null then), nullptr otherwise
+	// uniformBuffers: per swapchain image view data of the renderer (premultiplied view projection and view matrix)
+	// the pipeline and its descriptors are made with allocator
+	void Create(ComputeSystem& compute, ShaderCompiler& shaders, VkPhysicalDevice physicalDevice, VkDevice logicalDevice,
+		VkQueue queue, VkCommandPool commandPool, VkRenderPass renderPass, const VkPipelineRenderingCreateInfo* renderingInfo,
+		VkSampleCountFlagBits samples, VkExtent2D extent, const std::vector<VkBuffer>& uniformBuffers,
+		const ParticleSettings& settings, const VkAllocationCallbacks* allocator);
+
+	// the device has to be idle. the buffers belong to the compute system and are destroyed with it
+	void Destroy();
+
+	bool IsEnabled() const;
+
+	// emitter settings for the following frames (MaxParticles and MaxEmitPerFrame can't be changed)
+	void SetSettings(const ParticleSettings& settings);
+	const ParticleSettings& GetSettings() const;
+
+	// write this frame's parameters (time step, number of particles to emit)
+	void Update(uint32_t imageIndex);
+
+	// draw all alive particles (inside the render pass)
+	void RecordDraw(VkCommandBuffer commandBuffer, uint32_t imageIndex) const;
+
+private:
+	// matches the parameter buffer of the particle shaders
+	struct ParticleParameters
+	{
+		glm::vec4 EmitterPosition;		// w: radius
+		glm::vec4 EmitterVelocity;		// w: spread
+		glm::vec4 Gravity;				// w: delta time
+		glm::vec4 Colour;
+		uint32_t EmitCount;
+		uint32_t Seed;
+		uint32_t MaxParticles;
+		float Lifetime;
+	};
+
+	// matches the counter buffer of the particle shaders
+	struct ParticleCounters
+	{
+		uint32_t AliveCount[2];
+		uint32_t Current;
+		uint32_t Pad;
+		VkDispatchIndirectCommand SimulateArgs;
+		uint32_t Pad2;
+		VkDrawIndirectCommand DrawArgs;
+	};
+
+	void CreateGraphicsPipeline(ShaderCompiler& shaders, VkRenderPass renderPass, const VkPipelineRenderingCreateInfo* renderingInfo,
+		VkSampleCountFlagBits samples, VkExtent2D extent);
+	void CreateDescriptorSets(const std::vector<VkBuffer>& uniformBuffers);
+	void ClearCounters(VkQueue queue, VkCommandPool commandPool);
+
+private:
+	ComputeSystem* Compute = nullptr;
+	VkDevice LogicalDevice = VK_NULL_HANDLE;
+	const VkAllocationCallbacks* Allocator = nullptr;
+
+	ParticleSettings Settings;
+
+	// - Compute
+	StorageBufferHandle ParticleBuffer = INVALID_COMPUTE_HANDLE;
+	StorageBufferHandle CounterBuffer = INVALID_COMPUTE_HANDLE;
+	StorageBufferHandle ParameterBuffer = INVALID_COMPUTE_HANDLE;		// per image, host visible
+
+	// - Drawing
+	VkDescriptorSetLayout DescriptorSetLayout = VK_NULL_HANDLE;
+	VkDescriptorPool DescriptorPool = VK_NULL_HANDLE;
+	std::vector<VkDescriptorSet> DescriptorSets;
+	VkPipelineLayout PipelineLayout = VK_NULL_HANDLE;
+	VkPipeline GraphicsPipeline = VK_NULL_HANDLE;
+
+	// - Timing
+	std::chrono::steady_clock::time_point LastUpdate;
+	bool bFirstUpdate = true;
+	float EmitRemainder = 0.0f;			// fraction of a particle left over from the last frame
+	uint32_t Seed = 0;
+};
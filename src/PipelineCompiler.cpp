@@ -0,0 +1,205 @@
+#include "PipelineCompiler.h"
+
+#include <chrono>
+#include <cstdio>
+#include <stdexcept>
+
+PipelineCompiler::PipelineCompiler()
+	: ResultCount(0), CompiledCount(0)
+{
+
+}
+
+PipelineCompiler::~PipelineCompiler()
+{
+
+}
+
+void PipelineCompiler::Create(VkDevice device, const VkAllocationCallbacks* allocator, JobSystem* jobs,
+	BuildFunction build, DestroyFunction destroy)
+{
+	Device = device;
+	Allocator = allocator;
+	Jobs = jobs;
+	BuildPipeline = build;
+	DestroyPipeline = destroy;
+
+	// starts out empty, it fills up with every pipeline created against it
+	VkPipelineCacheCreateInfo cacheCreateInfo = {};
+	cacheCreateInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_CACHE_CREATE_INFO;
+
+	VkResult result = vkCreatePipelineCache(Device, &cacheCreateInfo, Allocator, &PipelineCache);
+	if(result != VK_SUCCESS)
+	{
+		throw std::runtime_error("failed to create a pipeline cache!");
+	}
+}
+
+void PipelineCompiler::Destroy()
+{
+	if(Jobs == nullptr)
+	{
+		return;
+	}
+
+	Jobs->Wait(CompileJobs);
+
+	for(CompiledPipeline& compiled : Results)
+	{
+		if(compiled.Pipeline != VK_NULL_HANDLE)
+		{
+			DestroyPipeline(compiled.Pipeline);
+		}
+	}
+	Results.clear();
+	ResultCount = 0;
+	Requested.clear();
+	PendingCount = 0;
+	DerivingCounts.clear();
+
+	vkDestroyPipelineCache(Device, PipelineCache, Allocator);
+	PipelineCache = VK_NULL_HANDLE;
+
+	Jobs = nullptr;
+}
+
+VkPipelineCache PipelineCompiler::GetPipelineCache() const
+{
+	return PipelineCache;
+}
+
+void PipelineCompiler::Request(const PipelineStateDesc& desc, VkPipeline basePipeline)
+{
+	if(!Requested.insert(desc).second)
+	{
+		return;
+	}
+	PendingCount++;
+	if(basePipeline != VK_NULL_HANDLE)
+	{
+		DerivingCounts[basePipeline]++;
+	}
+
+	Jobs->Run("CompilePipeline", [this, desc, basePipeline]()
+	{
+		Build(desc, basePipeline);
+	}, &CompileJobs);
+}
+
+VkPipeline PipelineCompiler::Compile(const PipelineStateDesc& desc, VkPipeline basePipeline)
+{
+	return BuildTimed(desc, basePipeline);
+}
+
+bool PipelineCompiler::Poll(std::vector<CompiledPipeline>& pipelines)
+{
+	if(ResultCount.load(std::memory_order_acquire) == 0)
+	{
+		return false;
+	}
+
+	{
+		std::lock_guard<std::mutex> lock(ResultMutex);
+		pipelines.swap(Results);
+		Results.clear();
+		ResultCount = 0;
+	}
+
+	PendingCount -= static_cast<uint32_t>(pipelines.size());
+
+	// their jobs are done, so the bases aren't used anymore
+	for(const CompiledPipeline& compiled : pipelines)
+	{
+		if(compiled.BasePipeline == VK_NULL_HANDLE)
+		{
+			continue;
+		}
+
+		std::unordered_map<VkPipeline, uint32_t>::iterator it = DerivingCounts.find(compiled.BasePipeline);
+		if(it != DerivingCounts.end() && --it->second == 0)
+		{
+			DerivingCounts.erase(it);
+		}
+	}
+
+	return !pipelines.empty();
+}
+
+uint32_t PipelineCompiler::GetPendingCount() const
+{
+	return PendingCount;
+}
+
+bool PipelineCompiler::IsDeriving(VkPipeline basePipeline) const
+{
+	return DerivingCounts.find(basePipeline) != DerivingCounts.end();
+}
+
+uint32_t PipelineCompiler::GetCompiledCount() const
+{
+	return CompiledCount;
+}
+
+PipelineCompileStats PipelineCompiler::GetStats() const
+{
+	std::lock_guard<std::mutex> lock(StatsMutex);
+
+	return Stats;
+}
+
+void PipelineCompiler::PrintStats() const
+{
+	PipelineCompileStats stats = GetStats();
+
+	printf("graphics pipelines:\n");
+	printf("  base:    %4u, %8.1f ms total, %6.1f ms average\n", stats.BaseCount, stats.BaseTime_ms,
+		stats.BaseCount > 0 ? stats.BaseTime_ms / stats.BaseCount : 0.0);
+	printf("  derived: %4u, %8.1f ms total, %6.1f ms average\n", stats.DerivedCount, stats.DerivedTime_ms,
+		stats.DerivedCount > 0 ? stats.DerivedTime_ms / stats.DerivedCount : 0.0);
+}
+
+VkPipeline PipelineCompiler::BuildTimed(const PipelineStateDesc& desc, VkPipeline basePipeline)
+{
+	std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+	VkPipeline pipeline = BuildPipeline(desc, basePipeline);
+	double duration_ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+
+	CompiledCount++;
+	{
+		std::lock_guard<std::mutex> lock(StatsMutex);
+		if(basePipeline != VK_NULL_HANDLE)
+		{
+			Stats.DerivedCount++;
+			Stats.DerivedTime_ms += duration_ms;
+		}
+		else
+		{
+			Stats.BaseCount++;
+			Stats.BaseTime_ms += duration_ms;
+		}
+	}
+
+	return pipeline;
+}
+
+void PipelineCompiler::Build(const PipelineStateDesc& desc, VkPipeline basePipeline)
+{
+	CompiledPipeline compiled = {};
+	compiled.Desc = desc;
+	compiled.BasePipeline = basePipeline;
+
+	try
+	{
+		compiled.Pipeline = BuildTimed(desc, basePipeline);
+	}
+	catch(const std::runtime_error &e)
+	{
+		// the draws keep using the fallback
+		printf("ERROR: pipeline of permutation 0x%x failed to build: %s\n", desc.Permutation, e.what());
+		compiled.Pipeline = VK_NULL_HANDLE;
+	}
+
+	std::lock_guard<std::mutex> lock(ResultMutex);
+	Results.push_back(compiled);
+	ResultCount = static_cast<uint32_t>(Results.size());
+}
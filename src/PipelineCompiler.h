@@ -0,0 +1,108 @@
+#pragma once
+
+#define GLFW_INCLUDE_VULKAN
+#include <GLFW/glfw3.h>
+
+#include <atomic>
+#include <cstdint>
+#include <functional>
+#include <mutex>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+#include "JobSystem.h"
+#include "PipelineState.h"
+
+// pipeline built on a worker
+struct CompiledPipeline
+{
+	PipelineStateDesc Desc;
+	VkPipeline Pipeline;			// VK_NULL_HANDLE if building it failed
+	VkPipeline BasePipeline;		// the one it was derived from, VK_NULL_HANDLE if none
+};
+
+// creation times, separately for base pipelines and the variants derived from them
+struct PipelineCompileStats
+{
+	uint32_t BaseCount = 0;
+	double BaseTime_ms = 0.0;
+	uint32_t DerivedCount = 0;
+	double DerivedTime_ms = 0.0;
+};
+
+// builds pipelines on the worker threads, every requested pipeline in its own job, so several of them
+// compile in parallel and the thread that draws never waits for one. it polls the finished pipelines once
+// per frame and draws with a fallback pipeline until then.
+// all pipelines are created against one VkPipelineCache, which the driver keeps thread safe
+class PipelineCompiler
+{
+public:
+	// basePipeline: VK_NULL_HANDLE, or the pipeline to derive the new one from
+	typedef std::function<VkPipeline(const PipelineStateDesc&, VkPipeline basePipeline)> BuildFunction;
+	typedef std::function<void(VkPipeline)> DestroyFunction;
+
+	PipelineCompiler();
+	~PipelineCompiler();
+
+	// build is called on the workers and has to be thread safe, it should create its pipeline with
+	// GetPipelineCache. destroy gets rid of finished pipelines nobody took
+	void Create(VkDevice device, const VkAllocationCallbacks* allocator, JobSystem* jobs,
+		BuildFunction build, DestroyFunction destroy);
+
+	// waits for the pipelines still compiling
+	void Destroy();
+
+	VkPipelineCache GetPipelineCache() const;
+
+	// - thread that draws
+	// start building the pipeline, unless it has been requested before (even if that failed)
+	// the base pipeline has to stay alive until the job has finished, see IsDeriving
+	void Request(const PipelineStateDesc& desc, VkPipeline basePipeline = VK_NULL_HANDLE);
+
+	// build it right here, e.g. the fallback pipeline. doesn't count as requested
+	VkPipeline Compile(const PipelineStateDesc& desc, VkPipeline basePipeline = VK_NULL_HANDLE);
+
+	// hand over the pipelines that finished since the last call, returns false if there are none
+	bool Poll(std::vector<CompiledPipeline>& pipelines);
+
+	// requested pipelines that haven't been picked up by Poll yet
+	uint32_t GetPendingCount() const;
+
+	// whether pipelines derived from the base are still being built (or haven't been picked up by Poll yet)
+	bool IsDeriving(VkPipeline basePipeline) const;
+
+	// - any thread
+	uint32_t GetCompiledCount() const;
+	PipelineCompileStats GetStats() const;
+	void PrintStats() const;
+
+private:
+	// build and time it. throws like the build function
+	VkPipeline BuildTimed(const PipelineStateDesc& desc, VkPipeline basePipeline);
+	void Build(const PipelineStateDesc& desc, VkPipeline basePipeline);
+
+private:
+	VkDevice Device = VK_NULL_HANDLE;
+	const VkAllocationCallbacks* Allocator = nullptr;
+	JobSystem* Jobs = nullptr;
+	BuildFunction BuildPipeline;
+	DestroyFunction DestroyPipeline;
+
+	VkPipelineCache PipelineCache = VK_NULL_HANDLE;
+
+	std::unordered_set<PipelineStateDesc, PipelineStateDescHash> Requested;		// only touched by the thread that draws
+	uint32_t PendingCount = 0;
+	std::unordered_map<VkPipeline, uint32_t> DerivingCounts;							// by base, only touched by the thread that draws
+	JobCounter CompileJobs;
+
+	// finished by the workers, waiting for Poll
+	std::mutex ResultMutex;
+	std::vector<CompiledPipeline> Results;
+	std::atomic<uint32_t> ResultCount;		// lets Poll skip the lock when nothing finished
+
+	std::atomic<uint32_t> CompiledCount;
+
+	mutable std::mutex StatsMutex;
+	PipelineCompileStats Stats;
+};
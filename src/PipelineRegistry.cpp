@@ -0,0 +1,144 @@
+#include "PipelineRegistry.h"
+
+#include <cstdio>
+#include <stdexcept>
+
+PipelineRegistry::PipelineRegistry()
+{
+
+}
+
+PipelineRegistry::~PipelineRegistry()
+{
+
+}
+
+void PipelineRegistry::Create(VkDevice device, const VkAllocationCallbacks* allocator)
+{
+	Device = device;
+	Allocator = allocator;
+}
+
+void PipelineRegistry::Destroy()
+{
+	for(auto& pipeline : Pipelines)
+	{
+		vkDestroyPipeline(Device, pipeline.second, Allocator);
+	}
+	Pipelines.clear();
+
+	std::lock_guard<std::mutex> lock(LayoutMutex);
+	for(auto& layout : Layouts)
+	{
+		vkDestroyPipelineLayout(Device, layout.second, Allocator);
+	}
+	Layouts.clear();
+}
+
+VkPipelineLayout PipelineRegistry::GetLayout(const PipelineLayoutDesc& desc)
+{
+	if(desc.SetLayoutCount > MAX_PIPELINE_SET_LAYOUTS || desc.PushConstantRangeCount > MAX_PIPELINE_PUSH_CONSTANT_RANGES)
+	{
+		throw std::runtime_error("too many descriptor set layouts or push constant ranges for a pipeline layout!");
+	}
+
+	std::lock_guard<std::mutex> lock(LayoutMutex);
+
+	LayoutLookups++;
+	auto found = Layouts.find(desc);
+	if(found != Layouts.end())
+	{
+		LayoutHits++;
+		return found->second;
+	}
+
+	VkPipelineLayoutCreateInfo pipelineLayoutCreateInfo = {};
+	pipelineLayoutCreateInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
+	pipelineLayoutCreateInfo.setLayoutCount = desc.SetLayoutCount;
+	pipelineLayoutCreateInfo.pSetLayouts = desc.SetLayouts.data();
+	pipelineLayoutCreateInfo.pushConstantRangeCount = desc.PushConstantRangeCount;
+	pipelineLayoutCreateInfo.pPushConstantRanges = desc.PushConstantRangeCount > 0 ? desc.PushConstantRanges.data() : nullptr;
+
+	VkPipelineLayout layout;
+	VkResult result = vkCreatePipelineLayout(Device, &pipelineLayoutCreateInfo, Allocator, &layout);
+	if(result != VK_SUCCESS)
+	{
+		throw std::runtime_error("failed to create pipeline layout!");
+	}
+	Layouts[desc] = layout;
+
+	return layout;
+}
+
+VkPipeline PipelineRegistry::Find(const PipelineStateDesc& desc)
+{
+	PipelineLookups++;
+	auto found = Pipelines.find(desc);
+	if(found == Pipelines.end())
+	{
+		return VK_NULL_HANDLE;
+	}
+
+	PipelineHits++;
+	return found->second;
+}
+
+VkPipeline PipelineRegistry::FindWithLayout(VkPipelineLayout layout) const
+{
+	for(const auto& registered : Pipelines)
+	{
+		if(registered.first.Layout == layout && registered.second != VK_NULL_HANDLE)
+		{
+			return registered.second;
+		}
+	}
+
+	return VK_NULL_HANDLE;
+}
+
+VkPipeline PipelineRegistry::Insert(const PipelineStateDesc& desc, VkPipeline pipeline)
+{
+	VkPipeline& registered = Pipelines[desc];
+	VkPipeline replaced = registered;
+	registered = pipeline;
+
+	return replaced;
+}
+
+std::vector<PipelineStateDesc> PipelineRegistry::GetDescs() const
+{
+	std::vector<PipelineStateDesc> descs;
+	descs.reserve(Pipelines.size());
+	for(const auto& pipeline : Pipelines)
+	{
+		descs.push_back(pipeline.first);
+	}
+
+	return descs;
+}
+
+PipelineRegistryStats PipelineRegistry::GetStats() const
+{
+	PipelineRegistryStats stats;
+	stats.PipelineCount = static_cast<uint32_t>(Pipelines.size());
+	stats.PipelineLookups = PipelineLookups;
+	stats.PipelineHits = PipelineHits;
+
+	std::lock_guard<std::mutex> lock(LayoutMutex);
+	stats.LayoutCount = static_cast<uint32_t>(Layouts.size());
+	stats.LayoutLookups = LayoutLookups;
+	stats.LayoutHits = LayoutHits;
+
+	return stats;
+}
+
+void PipelineRegistry::PrintStats() const
+{
+	PipelineRegistryStats stats = GetStats();
+
+	printf("pipeline registry:\n");
+	printf("  pipelines: %4u unique, %8llu lookups, %8llu shared\n", stats.PipelineCount,
+		static_cast<unsigned long long>(stats.PipelineLookups), static_cast<unsigned long long>(stats.PipelineHits));
+	printf("  layouts:   %4u unique, %8llu lookups, %8llu shared\n", stats.LayoutCount,
+		static_cast<unsigned long long>(stats.LayoutLookups), static_cast<unsigned long long>(stats.LayoutHits));
+}
@@ -0,0 +1,69 @@
+#pragma once
+
+#define GLFW_INCLUDE_VULKAN
+#include <GLFW/glfw3.h>
+
+#include <cstdint>
+#include <mutex>
+#include <unordered_map>
+#include <vector>
+
+#include "PipelineState.h"
+
+// how well the registry deduplicates
+struct PipelineRegistryStats
+{
+	uint32_t PipelineCount = 0;
+	uint32_t LayoutCount = 0;
+	uint64_t PipelineLookups = 0;
+	uint64_t PipelineHits = 0;		// lookups that found an existing pipeline
+	uint64_t LayoutLookups = 0;
+	uint64_t LayoutHits = 0;
+};
+
+// owns the graphics pipelines and pipeline layouts, one per unique description:
+// whoever asks for an identical state gets the same object instead of a new one
+class PipelineRegistry
+{
+public:
+	PipelineRegistry();
+	~PipelineRegistry();
+
+	void Create(VkDevice device, const VkAllocationCallbacks* allocator);
+
+	// destroys all pipelines and layouts
+	void Destroy();
+
+	// - any thread
+	// layout with this signature, created the first time it's asked for
+	VkPipelineLayout GetLayout(const PipelineLayoutDesc& desc);
+
+	// - thread that draws
+	// VK_NULL_HANDLE if there is no pipeline for the description yet
+	VkPipeline Find(const PipelineStateDesc& desc);
+	// any pipeline created with the layout, VK_NULL_HANDLE if there is none. not counted as a lookup
+	VkPipeline FindWithLayout(VkPipelineLayout layout) const;
+
+	// register the pipeline for the description, returns the one it replaces (or VK_NULL_HANDLE)
+	// the registry destroys registered pipelines, the replaced one is the caller's
+	VkPipeline Insert(const PipelineStateDesc& desc, VkPipeline pipeline);
+
+	std::vector<PipelineStateDesc> GetDescs() const;
+
+	PipelineRegistryStats GetStats() const;
+	void PrintStats() const;
+
+private:
+	VkDevice Device = VK_NULL_HANDLE;
+	const VkAllocationCallbacks* Allocator = nullptr;
+
+	std::unordered_map<PipelineStateDesc, VkPipeline, PipelineStateDescHash> Pipelines;
+	uint64_t PipelineLookups = 0;
+	uint64_t PipelineHits = 0;
+
+	// layouts are rarely asked for, a lock keeps them usable from everywhere
+	mutable std::mutex LayoutMutex;
+	std::unordered_map<PipelineLayoutDesc, VkPipelineLayout, PipelineLayoutDescHash> Layouts;
+	uint64_t LayoutLookups = 0;
+	uint64_t LayoutHits = 0;
+};
@@ -0,0 +1,146 @@
+#pragma once
+
+#define GLFW_INCLUDE_VULKAN
+#include <GLFW/glfw3.h>
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+
+#include "PipelineVariant.h"
+#include "ShaderPermutation.h"
+
+// 64 bit fnv-1a, fed one value at a time
+inline uint64_t HashPipelineValue(uint64_t hash, uint64_t value)
+{
+	for(uint32_t i = 0; i < 8; i++)
+	{
+		hash ^= (value >> (i * 8)) & 0xFF;
+		hash *= 0x100000001B3ull;
+	}
+
+	return hash;
+}
+
+const uint64_t PIPELINE_HASH_SEED = 0xCBF29CE484222325ull;
+
+// everything a graphics pipeline of the mesh shaders is built from, except for what is the same for all of
+// them (vertex format, render pass / attachment formats, sample count). identical descriptions always share
+// one pipeline
+struct PipelineStateDesc
+{
+	ShaderPermutationKey Permutation = DefaultShaderPermutation::Key;
+	PipelineVariant Variant;
+	VkPipelineLayout Layout = VK_NULL_HANDLE;		// VK_NULL_HANDLE: the renderer's mesh layout
+
+	bool operator==(const PipelineStateDesc& other) const
+	{
+		return Permutation == other.Permutation
+			&& Variant.Blend == other.Variant.Blend
+			&& Variant.Cull == other.Variant.Cull
+			&& Variant.Topology == other.Variant.Topology
+			&& Layout == other.Layout;
+	}
+
+	bool operator!=(const PipelineStateDesc& other) const
+	{
+		return !(*this == other);
+	}
+
+	// the variants are derived from this one
+	PipelineStateDesc GetBase() const
+	{
+		PipelineStateDesc base = *this;
+		base.Variant = PipelineVariant();
+
+		return base;
+	}
+
+	bool IsBase() const
+	{
+		return *this == GetBase();
+	}
+
+	// known features and states only
+	bool IsValid() const
+	{
+		return (Permutation & ~SHADER_FEATURE_ALL) == 0
+			&& Variant.Blend < PIPELINE_BLEND_COUNT
+			&& Variant.Cull < PIPELINE_CULL_COUNT
+			&& Variant.Topology < PIPELINE_TOPOLOGY_COUNT;
+	}
+};
+
+struct PipelineStateDescHash
+{
+	size_t operator()(const PipelineStateDesc& desc) const
+	{
+		uint64_t hash = PIPELINE_HASH_SEED;
+		hash = HashPipelineValue(hash, desc.Permutation);
+		hash = HashPipelineValue(hash, desc.Variant.Blend | (desc.Variant.Cull << 8) | (desc.Variant.Topology << 16));
+		hash = HashPipelineValue(hash, (uint64_t)desc.Layout);
+
+		return static_cast<size_t>(hash);
+	}
+};
+
+const uint32_t MAX_PIPELINE_SET_LAYOUTS = 4;
+const uint32_t MAX_PIPELINE_PUSH_CONSTANT_RANGES = 2;
+
+// signature of a pipeline layout: its descriptor set layouts and push constant ranges
+struct PipelineLayoutDesc
+{
+	uint32_t SetLayoutCount = 0;
+	std::array<VkDescriptorSetLayout, MAX_PIPELINE_SET_LAYOUTS> SetLayouts = {};
+	uint32_t PushConstantRangeCount = 0;
+	std::array<VkPushConstantRange, MAX_PIPELINE_PUSH_CONSTANT_RANGES> PushConstantRanges = {};
+
+	// only the used entries count
+	bool operator==(const PipelineLayoutDesc& other) const
+	{
+		if(SetLayoutCount != other.SetLayoutCount || PushConstantRangeCount != other.PushConstantRangeCount)
+		{
+			return false;
+		}
+		for(uint32_t i = 0; i < SetLayoutCount; i++)
+		{
+			if(SetLayouts[i] != other.SetLayouts[i])
+			{
+				return false;
+			}
+		}
+		for(uint32_t i = 0; i < PushConstantRangeCount; i++)
+		{
+			const VkPushConstantRange& a = PushConstantRanges[i];
+			const VkPushConstantRange& b = other.PushConstantRanges[i];
+			if(a.stageFlags != b.stageFlags || a.offset != b.offset || a.size != b.size)
+			{
+				return false;
+			}
+		}
+
+		return true;
+	}
+};
+
+struct PipelineLayoutDescHash
+{
+	size_t operator()(const PipelineLayoutDesc& desc) const
+	{
+		uint64_t hash = PIPELINE_HASH_SEED;
+		for(uint32_t i = 0; i < desc.SetLayoutCount; i++)
+		{
+			hash = HashPipelineValue(hash, (uint64_t)desc.SetLayouts[i]);
+		}
+		for(uint32_t i = 0; i < desc.PushConstantRangeCount; i++)
+		{
+			const VkPushConstantRange& range = desc.PushConstantRanges[i];
+			hash = HashPipelineValue(hash, range.stageFlags);
+			hash = HashPipelineValue(hash, (static_cast<uint64_t>(range.offset) << 32) | range.size);
+		}
+		// tells the counts apart, e.g. one set vs. the same set and a push constant range
+		hash = HashPipelineValue(hash, (static_cast<uint64_t>(desc.SetLayoutCount) << 32) | desc.PushConstantRangeCount);
+
+		return static_cast<size_t>(hash);
+	}
+};
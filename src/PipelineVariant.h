@@ -0,0 +1,40 @@
+#pragma once
+
+#define GLFW_INCLUDE_VULKAN
+#include <GLFW/glfw3.h>
+
+#include <cstdint>
+
+// fixed function state that can differ between pipelines of the same shader permutation
+// the first value of each is the state the mesh pipeline always had
+enum PipelineBlendMode : uint8_t
+{
+	PIPELINE_BLEND_OPAQUE = 0,
+	PIPELINE_BLEND_ALPHA,			// src alpha * new + (1 - src alpha) * old
+	PIPELINE_BLEND_ADDITIVE,		// src alpha * new + old
+	PIPELINE_BLEND_COUNT
+};
+
+enum PipelineCullMode : uint8_t
+{
+	PIPELINE_CULL_BACK = 0,
+	PIPELINE_CULL_FRONT,
+	PIPELINE_CULL_NONE,
+	PIPELINE_CULL_COUNT
+};
+
+enum PipelineTopology : uint8_t
+{
+	PIPELINE_TOPOLOGY_TRIANGLE_LIST = 0,
+	PIPELINE_TOPOLOGY_TRIANGLE_STRIP,
+	PIPELINE_TOPOLOGY_LINE_LIST,
+	PIPELINE_TOPOLOGY_COUNT
+};
+
+// all defaults is the base variant of a permutation, the others are created as its derivatives
+struct PipelineVariant
+{
+	PipelineBlendMode Blend = PIPELINE_BLEND_OPAQUE;
+	PipelineCullMode Cull = PIPELINE_CULL_BACK;
+	PipelineTopology Topology = PIPELINE_TOPOLOGY_TRIANGLE_LIST;
+};
@@ -0,0 +1,102 @@
+#include "RenderThread.h"
+
+#include <cstdio>
+#include <stdexcept>
+
+#include "FixedTimestep.h"
+#include "VulkanRenderer.h"
+
+RenderThread::RenderThread()
+	: bRunning(false), bStopRequested(false)
+{
+
+}
+
+RenderThread::~RenderThread()
+{
+	Stop();
+}
+
+void RenderThread::Start(VulkanRenderer* renderer)
+{
+	if(Thread.joinable())
+	{
+		return;
+	}
+
+	Renderer = renderer;
+	bStopRequested = false;
+	bRunning = true;
+
+	Thread = std::thread(&RenderThread::Loop, this);
+}
+
+void RenderThread::Stop()
+{
+	if(!Thread.joinable())
+	{
+		return;
+	}
+
+	bStopRequested = true;
+	Thread.join();
+
+	bRunning = false;
+}
+
+bool RenderThread::IsRunning() const
+{
+	return bRunning;
+}
+
+FrameSnapshot& RenderThread::BeginSnapshot()
+{
+	FrameSnapshot& snapshot = Snapshots.GetWriteBuffer();
+	snapshot.Transforms.clear();
+	snapshot.bSetDrawList = false;
+	snapshot.DrawList.clear();
+
+	return snapshot;
+}
+
+void RenderThread::PublishSnapshot()
+{
+	Snapshots.Publish();
+}
+
+void RenderThread::Loop()
+{
+	try
+	{
+		while(!bStopRequested)
+		{
+			// apply the latest simulation state, if there is a new one.
+			// otherwise keep drawing the last one
+			if(Snapshots.Consume())
+			{
+				const FrameSnapshot& snapshot = Snapshots.GetReadBuffer();
+
+				SceneGraph& scene = Renderer->GetScene();
+				for(const NodeTransform& transform : snapshot.Transforms)
+				{
+					scene.SetLocalTransform(transform.Node,
+						InterpolateTransform(transform.PreviousLocalTransform, transform.LocalTransform, snapshot.Alpha));
+				}
+
+				if(snapshot.bSetDrawList)
+				{
+					Renderer->SetDrawList(snapshot.DrawList);
+				}
+			}
+
+			Renderer->Draw();
+		}
+	}
+	// anything escaping the thread would terminate the program, the main thread sees IsRunning go false instead
+	catch(const std::exception &e)
+	{
+		printf("ERROR: %s\n", e.what());
+	}
+
+	bRunning = false;
+}
@@ -0,0 +1,69 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <thread>
+#include <vector>
+
+#include <glm/glm.hpp>
+
+#include "SceneGraph.h"
+#include "TripleBuffer.h"
+
+class VulkanRenderer;
+
+// local transform of a scene node, as set by the last two simulation steps
+// the render thread interpolates between them with the snapshot's alpha
+struct NodeTransform
+{
+	SceneNode Node;
+	glm::mat4 PreviousLocalTransform;
+	glm::mat4 LocalTransform;
+};
+
+// everything the render thread needs from one completed simulation frame
+// snapshots are not deltas (the render thread may skip some), they always hold the full state
+struct FrameSnapshot
+{
+	uint64_t FrameIndex = 0;
+	float Alpha = 1.0f;						// position of the render time between the previous and the current step
+	std::vector<NodeTransform> Transforms;
+	bool bSetDrawList = false;				// replace the renderer's draw list (otherwise it keeps its own,
+	std::vector<uint32_t> DrawList;			// which includes all loaded meshes): handles of the meshes to draw
+};
+
+// runs VulkanRenderer::Draw on its own thread, so that waiting for fences or presentation
+// never stalls the simulation. the simulation publishes snapshots through a lock free triple buffer
+// and the render thread always draws the latest one
+class RenderThread
+{
+public:
+	RenderThread();
+	~RenderThread();
+
+	// the renderer has to be initialised. from here on, only the render thread may use it until Stop
+	void Start(VulkanRenderer* renderer);
+
+	// finish the current frame and join the render thread
+	void Stop();
+
+	// false once the render thread stopped, e.g. because drawing failed
+	bool IsRunning() const;
+
+	// - simulation thread
+	// snapshot to fill for the next publish (cleared, but keeps its memory)
+	FrameSnapshot& BeginSnapshot();
+	void PublishSnapshot();
+
+private:
+	void Loop();
+
+private:
+	VulkanRenderer* Renderer = nullptr;
+
+	std::thread Thread;
+	std::atomic<bool> bRunning;
+	std::atomic<bool> bStopRequested;
+
+	TripleBuffer<FrameSnapshot> Snapshots;
+};
@@ -0,0 +1,382 @@
+#include "SceneGraph.h"
+#include "FrameAllocationCheck.h"
+#include "JobSystem.h"
+
+#include <algorithm>
+#include <numeric>
+#include <stdexcept>
+
+#if defined(__SSE__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 1)
+#include <xmmintrin.h>
+#define SCENE_GRAPH_USE_SSE
+#endif
+
+// batch size when splitting a run of dirty nodes into jobs. runs shorter than two batches aren't worth the scheduling
+static const uint32_t PARALLEL_BATCH_SIZE = 2048;
+
+// worldMatrices[i] = worldMatrices[parentSlots[i]] * localMatrices[i] for all i in [begin, end)
+// the parents have to be outside of the range, which is given as long as the range only holds a single depth
+static void MultiplyWorldBatch(glm::mat4* worldMatrices, const glm::mat4* localMatrices, const uint32_t* parentSlots,
+	uint32_t begin, uint32_t end)
+{
+#ifdef SCENE_GRAPH_USE_SSE
+	for(uint32_t i = begin; i < end; i++)
+	{
+		// glm matrices are column major: every column of the result is a linear combination
+		// of the parent's columns, weighted by the entries of the matching local column
+		const float* parent = &worldMatrices[parentSlots[i]][0][0];
+		const float* local = &localMatrices[i][0][0];
+		float* world = &worldMatrices[i][0][0];
+
+		__m128 parentColumn0 = _mm_loadu_ps(parent);
+		__m128 parentColumn1 = _mm_loadu_ps(parent + 4);
+		__m128 parentColumn2 = _mm_loadu_ps(parent + 8);
+		__m128 parentColumn3 = _mm_loadu_ps(parent + 12);
+
+		for(uint32_t column = 0; column < 4; column++)
+		{
+			const float* localColumn = local + column * 4;
+
+			__m128 result = _mm_mul_ps(parentColumn0, _mm_set1_ps(localColumn[0]));
+			result = _mm_add_ps(result, _mm_mul_ps(parentColumn1, _mm_set1_ps(localColumn[1])));
+			result = _mm_add_ps(result, _mm_mul_ps(parentColumn2, _mm_set1_ps(localColumn[2])));
+			result = _mm_add_ps(result, _mm_mul_ps(parentColumn3, _mm_set1_ps(localColumn[3])));
+
+			_mm_storeu_ps(world + column * 4, result);
+		}
+	}
+#else
+	for(uint32_t i = begin; i < end; i++)
+	{
+		worldMatrices[i] = worldMatrices[parentSlots[i]] * localMatrices[i];
+	}
+#endif
+}
+
+SceneGraph::SceneGraph()
+{
+
+}
+
+SceneGraph::~SceneGraph()
+{
+
+}
+
+SceneNode SceneGraph::CreateNode(SceneNode parent, const glm::mat4& localTransform)
+{
+	uint32_t parentSlot = INVALID_SCENE_NODE;
+	uint32_t depth = 0;
+
+	if(parent != INVALID_SCENE_NODE)
+	{
+		CheckNode(parent);
+		parentSlot = Slots[parent];
+		depth = Depths[parentSlot] + 1;
+	}
+
+	// reuse handles of destroyed nodes first, so the object buffer stays compact
+	SceneNode node;
+	if(!FreeHandles.empty())
+	{
+		node = FreeHandles.back();
+		FreeHandles.pop_back();
+	}
+	else
+	{
+		node = static_cast<SceneNode>(Slots.size());
+		Slots.push_back(INVALID_SCENE_NODE);
+	}
+
+	// appending keeps parents in front of their children,
+	// but the depth order has to be restored if the new node is less deep than the last one
+	if(!Depths.empty() && depth < Depths.back())
+	{
+		bNeedsSort = true;
+	}
+
+	Slots[node] = static_cast<uint32_t>(Handles.size());
+
+	ParentSlots.push_back(parentSlot);
+	Depths.push_back(depth);
+	Handles.push_back(node);
+	LocalMatrices.push_back(localTransform);
+	WorldMatrices.push_back(localTransform);
+	DirtyFlags.push_back(1);
+	ChangedGenerations.push_back(0);
+
+	return node;
+}
+
+void SceneGraph::DestroyNode(SceneNode node)
+{
+	DestroyNodes(&node, 1);
+}
+
+void SceneGraph::DestroyNodes(const SceneNode* nodes, uint32_t count)
+{
+	if(count == 0)
+	{
+		return;
+	}
+
+	std::vector<uint8_t>& removed = RemovedFlags;
+	removed.assign(Handles.size(), 0);
+
+	uint32_t firstSlot = static_cast<uint32_t>(Handles.size());
+	for(uint32_t i = 0; i < count; i++)
+	{
+		CheckNode(nodes[i]);
+		removed[Slots[nodes[i]]] = 1;
+		firstSlot = std::min(firstSlot, Slots[nodes[i]]);
+	}
+
+	// mark the subtrees for removal. since parents come before their children,
+	// a single pass starting at the first node is enough to find all descendants
+	for(uint32_t slot = firstSlot + 1; slot < Handles.size(); slot++)
+	{
+		if(ParentSlots[slot] != INVALID_SCENE_NODE && removed[ParentSlots[slot]])
+		{
+			removed[slot] = 1;
+		}
+	}
+
+	// compact all arrays in place, keeping the order (and therefore the depth sorting) intact
+	std::vector<uint32_t>& newSlots = NewSlots;
+	newSlots.assign(Handles.size(), INVALID_SCENE_NODE);
+	uint32_t writeSlot = firstSlot;
+	for(uint32_t slot = 0; slot < firstSlot; slot++)
+	{
+		newSlots[slot] = slot;
+	}
+
+	for(uint32_t slot = firstSlot; slot < Handles.size(); slot++)
+	{
+		if(removed[slot])
+		{
+			Slots[Handles[slot]] = INVALID_SCENE_NODE;
+			FreeHandles.push_back(Handles[slot]);
+			continue;
+		}
+
+		newSlots[slot] = writeSlot;
+		uint32_t parentSlot = ParentSlots[slot];
+
+		ParentSlots[writeSlot] = parentSlot != INVALID_SCENE_NODE ? newSlots[parentSlot] : INVALID_SCENE_NODE;
+		Depths[writeSlot] = Depths[slot];
+		Handles[writeSlot] = Handles[slot];
+		LocalMatrices[writeSlot] = LocalMatrices[slot];
+		WorldMatrices[writeSlot] = WorldMatrices[slot];
+		DirtyFlags[writeSlot] = DirtyFlags[slot];
+		ChangedGenerations[writeSlot] = ChangedGenerations[slot];
+		Slots[Handles[writeSlot]] = writeSlot;
+
+		writeSlot++;
+	}
+
+	ParentSlots.resize(writeSlot);
+	Depths.resize(writeSlot);
+	Handles.resize(writeSlot);
+	LocalMatrices.resize(writeSlot);
+	WorldMatrices.resize(writeSlot);
+	DirtyFlags.resize(writeSlot);
+	ChangedGenerations.resize(writeSlot);
+}
+
+void SceneGraph::SetLocalTransform(SceneNode node, const glm::mat4& localTransform)
+{
+	CheckNode(node);
+
+	uint32_t slot = Slots[node];
+	LocalMatrices[slot] = localTransform;
+	DirtyFlags[slot] = 1;
+}
+
+const glm::mat4& SceneGraph::GetLocalTransform(SceneNode node) const
+{
+	CheckNode(node);
+
+	return LocalMatrices[Slots[node]];
+}
+
+const glm::mat4& SceneGraph::GetWorldTransform(SceneNode node) const
+{
+	CheckNode(node);
+
+	return WorldMatrices[Slots[node]];
+}
+
+SceneNode SceneGraph::GetParent(SceneNode node) const
+{
+	CheckNode(node);
+
+	uint32_t parentSlot = ParentSlots[Slots[node]];
+	return parentSlot != INVALID_SCENE_NODE ? Handles[parentSlot] : INVALID_SCENE_NODE;
+}
+
+uint32_t SceneGraph::GetNodeCount() const
+{
+	return static_cast<uint32_t>(Handles.size());
+}
+
+uint32_t SceneGraph::GetHandleCount() const
+{
+	return static_cast<uint32_t>(Slots.size());
+}
+
+uint64_t SceneGraph::UpdateWorldTransforms(JobSystem* jobs)
+{
+	if(bNeedsSort)
+	{
+		// only after nodes were created or destroyed
+		FrameAllocationAllowance allowance;
+		SortByDepth();
+	}
+
+	Generation++;
+
+	const uint32_t nodeCount = static_cast<uint32_t>(Handles.size());
+
+	// children of dirty nodes have to be recomputed as well.
+	// parents come before their children, so one pass propagates dirtiness down the whole tree
+	for(uint32_t slot = 0; slot < nodeCount; slot++)
+	{
+		if(ParentSlots[slot] != INVALID_SCENE_NODE && DirtyFlags[ParentSlots[slot]])
+		{
+			DirtyFlags[slot] = 1;
+		}
+	}
+
+	// recompute runs of dirty nodes of the same depth in one batch.
+	// nodes within such a run never depend on each other, only on the (already updated) level above
+	uint32_t slot = 0;
+	while(slot < nodeCount)
+	{
+		if(!DirtyFlags[slot])
+		{
+			slot++;
+			continue;
+		}
+
+		uint32_t runEnd = slot + 1;
+		while(runEnd < nodeCount && DirtyFlags[runEnd] && Depths[runEnd] == Depths[slot])
+		{
+			runEnd++;
+		}
+
+		if(Depths[slot] == 0)
+		{
+			// root nodes: world transform is the local transform
+			std::copy(LocalMatrices.begin() + slot, LocalMatrices.begin() + runEnd, WorldMatrices.begin() + slot);
+		}
+		else if(jobs && runEnd - slot >= 2 * PARALLEL_BATCH_SIZE)
+		{
+			// all nodes of the run only read the level above, so the run can be split freely
+			// the job system allocates the batches
+			FrameAllocationAllowance allowance;
+			uint32_t runBegin = slot;
+			JobCounter counter;
+			jobs->ParallelFor("SceneGraph::UpdateWorldTransforms", runEnd - runBegin, PARALLEL_BATCH_SIZE,
+				[this, runBegin](uint32_t begin, uint32_t end)
+			{
+				MultiplyWorldBatch(WorldMatrices.data(), LocalMatrices.data(), ParentSlots.data(),
+					runBegin + begin, runBegin + end);
+			}, &counter);
+			jobs->Wait(counter);
+		}
+		else
+		{
+			MultiplyWorldBatch(WorldMatrices.data(), LocalMatrices.data(), ParentSlots.data(), slot, runEnd);
+		}
+
+		std::fill(ChangedGenerations.begin() + slot, ChangedGenerations.begin() + runEnd, Generation);
+
+		slot = runEnd;
+	}
+
+	// dirty flags can only be cleared once all children have seen them
+	std::fill(DirtyFlags.begin(), DirtyFlags.end(), 0);
+
+	return Generation;
+}
+
+uint32_t SceneGraph::WriteClipTransforms(const glm::mat4& viewProjection, glm::mat4* objectBuffer, uint64_t& writtenGeneration) const
+{
+	uint32_t writtenCount = 0;
+
+	// every node has changed at least once (in the update that added it), so 0 selects all of them
+	for(uint32_t slot = 0; slot < Handles.size(); slot++)
+	{
+		if(ChangedGenerations[slot] > writtenGeneration)
+		{
+			objectBuffer[Handles[slot]] = viewProjection * WorldMatrices[slot];
+			writtenCount++;
+		}
+	}
+
+	writtenGeneration = Generation;
+
+	return writtenCount;
+}
+
+void SceneGraph::SortByDepth()
+{
+	const uint32_t nodeCount = static_cast<uint32_t>(Handles.size());
+
+	// stable sort keeps the relative order of siblings (and therefore of the object buffer writes)
+	std::vector<uint32_t> order(nodeCount);
+	std::iota(order.begin(), order.end(), 0);
+	std::stable_sort(order.begin(), order.end(), [this](uint32_t a, uint32_t b)
+	{
+		return Depths[a] < Depths[b];
+	});
+
+	// old slot -> new slot, to remap the parents
+	std::vector<uint32_t> newSlots(nodeCount);
+	for(uint32_t i = 0; i < nodeCount; i++)
+	{
+		newSlots[order[i]] = i;
+	}
+
+	std::vector<uint32_t> parentSlots(nodeCount);
+	std::vector<uint32_t> depths(nodeCount);
+	std::vector<SceneNode> handles(nodeCount);
+	std::vector<glm::mat4> localMatrices(nodeCount);
+	std::vector<glm::mat4> worldMatrices(nodeCount);
+	std::vector<uint8_t> dirtyFlags(nodeCount);
+	std::vector<uint64_t> changedGenerations(nodeCount);
+
+	for(uint32_t i = 0; i < nodeCount; i++)
+	{
+		uint32_t oldSlot = order[i];
+		uint32_t parentSlot = ParentSlots[oldSlot];
+
+		parentSlots[i] = parentSlot != INVALID_SCENE_NODE ? newSlots[parentSlot] : INVALID_SCENE_NODE;
+		depths[i] = Depths[oldSlot];
+		handles[i] = Handles[oldSlot];
+		localMatrices[i] = LocalMatrices[oldSlot];
+		worldMatrices[i] = WorldMatrices[oldSlot];
+		dirtyFlags[i] = DirtyFlags[oldSlot];
+		changedGenerations[i] = ChangedGenerations[oldSlot];
+
+		Slots[handles[i]] = i;
+	}
+
+	ParentSlots.swap(parentSlots);
+	Depths.swap(depths);
+	Handles.swap(handles);
+	LocalMatrices.swap(localMatrices);
+	WorldMatrices.swap(worldMatrices);
+	DirtyFlags.swap(dirtyFlags);
+	ChangedGenerations.swap(changedGenerations);
+
+	bNeedsSort = false;
+}
+
+void SceneGraph::CheckNode(SceneNode node) const
+{
+	if(node >= Slots.size() || Slots[node] == INVALID_SCENE_NODE)
+	{
+		throw std::runtime_error("invalid scene node!");
+	}
+}
@@ -0,0 +1,82 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+#include <glm/glm.hpp>
+
+class JobSystem;
+
+// handle to a node of the scene graph
+// handles stay valid while the nodes are re-sorted internally and double as
+// the index of the node's world matrix in the GPU object buffer
+typedef uint32_t SceneNode;
+const SceneNode INVALID_SCENE_NODE = UINT32_MAX;
+
+class SceneGraph
+{
+public:
+	SceneGraph();
+	~SceneGraph();
+
+	// create a node below parent (or a root node, if no parent is given)
+	SceneNode CreateNode(SceneNode parent = INVALID_SCENE_NODE, const glm::mat4& localTransform = glm::mat4(1.0f));
+
+	// destroy the node and its whole subtree
+	void DestroyNode(SceneNode node);
+
+	// destroy all the nodes and their subtrees at once: a single pass over the graph,
+	// instead of one for every node
+	void DestroyNodes(const SceneNode* nodes, uint32_t count);
+
+	void SetLocalTransform(SceneNode node, const glm::mat4& localTransform);
+
+	const glm::mat4& GetLocalTransform(SceneNode node) const;
+
+	// world transform as of the last UpdateWorldTransforms call
+	const glm::mat4& GetWorldTransform(SceneNode node) const;
+
+	SceneNode GetParent(SceneNode node) const;
+
+	uint32_t GetNodeCount() const;
+
+	// upper bound of all handles handed out, i.e. the number of matrices an object buffer needs to hold
+	uint32_t GetHandleCount() const;
+
+	// recompute the world matrices of all dirty subtrees
+	// if a job system is given, large levels of the tree are split across its workers
+	// returns the generation of the update, which is used to track what has been written to which buffer
+	uint64_t UpdateWorldTransforms(JobSystem* jobs = nullptr);
+
+	// write viewProjection * world of all nodes that changed since writtenGeneration straight into the (mapped)
+	// object buffer, indexed by node handle, so the vertex shader needs a single matrix per vertex.
+	// writtenGeneration is updated to the current generation. when viewProjection changed, pass a
+	// writtenGeneration of 0 to rewrite all of them. returns the number of matrices written
+	uint32_t WriteClipTransforms(const glm::mat4& viewProjection, glm::mat4* objectBuffer, uint64_t& writtenGeneration) const;
+
+private:
+	void SortByDepth();
+	void CheckNode(SceneNode node) const;
+
+private:
+	// node data as structure of arrays, sorted by depth (parents always come before their children)
+	// all arrays are indexed by slot
+	std::vector<uint32_t> ParentSlots;			// slot of the parent, INVALID_SCENE_NODE for root nodes
+	std::vector<uint32_t> Depths;				// 0 for root nodes
+	std::vector<SceneNode> Handles;				// handle of the node in this slot
+	std::vector<glm::mat4> LocalMatrices;
+	std::vector<glm::mat4> WorldMatrices;
+	std::vector<uint8_t> DirtyFlags;			// local transform changed since last update
+	std::vector<uint64_t> ChangedGenerations;	// generation in which the world matrix last changed
+
+	// handle -> slot (INVALID_SCENE_NODE for free handles)
+	std::vector<uint32_t> Slots;
+	std::vector<SceneNode> FreeHandles;
+
+	// scratch space of DestroyNodes, indexed by slot. kept, so destroying nodes doesn't allocate every time
+	std::vector<uint8_t> RemovedFlags;
+	std::vector<uint32_t> NewSlots;
+
+	uint64_t Generation = 0;
+	bool bNeedsSort = false;
+};
@@ -0,0 +1,440 @@
+#include "ShaderCompiler.h"
+
+#include <cstring>
+#include <fstream>
+#include <sstream>
+#include <stdexcept>
+#include <thread>
+
+#ifndef _WIN32
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+#ifdef HAS_SHADERC
+#include <shaderc/shaderc.h>
+
+// the compile options, they go into the cache key as well
+static const uint32_t SHADER_TARGET_ENV_VERSION = shaderc_env_version_vulkan_1_0;
+static const shaderc_optimization_level SHADER_OPTIMIZATION_LEVEL = shaderc_optimization_level_performance;
+#endif
+
+// identifies the shaderc (and glslang) build, set by CMake from the library it links
+#ifndef SHADERC_BUILD_ID
+#define SHADERC_BUILD_ID "unknown"
+#endif
+
+// bump to invalidate all cache files, e.g. when the compile options change
+static const uint64_t SHADER_CACHE_VERSION = 1;
+
+// deep enough for any sane include chain, stops include cycles
+static const uint32_t MAX_INCLUDE_DEPTH = 16;
+
+// 64 bit FNV-1a
+static uint64_t HashBytes(const void* data, size_t size, uint64_t hash = 14695981039346656037ull)
+{
+	const uint8_t* bytes = static_cast<const uint8_t*>(data);
+	for(size_t i = 0; i < size; i++)
+	{
+		hash ^= bytes[i];
+		hash *= 1099511628211ull;
+	}
+
+	return hash;
+}
+
+static uint64_t HashString(const std::string& string, uint64_t hash)
+{
+	// include the length, so that "ab" + "c" and "a" + "bc" differ
+	uint64_t length = string.size();
+	hash = HashBytes(&length, sizeof(length), hash);
+
+	return HashBytes(string.data(), string.size(), hash);
+}
+
+static bool ReadTextFile(const fs::path& path, std::string& text)
+{
+	std::ifstream file(path, std::ios::binary);
+	if(!file.is_open())
+	{
+		return false;
+	}
+
+	std::stringstream stream;
+	stream << file.rdbuf();
+	text = stream.str();
+
+	return true;
+}
+
+// - ShaderCode
+
+ShaderCode::ShaderCode()
+{
+
+}
+
+ShaderCode::~ShaderCode()
+{
+	Release();
+}
+
+ShaderCode::ShaderCode(ShaderCode&& other)
+{
+	*this = std::move(other);
+}
+
+ShaderCode& ShaderCode::operator=(ShaderCode&& other)
+{
+	if(this != &other)
+	{
+		Release();
+
+		Mapping = other.Mapping;
+		MappingSize = other.MappingSize;
+		Words = std::move(other.Words);
+
+		other.Mapping = nullptr;
+		other.MappingSize = 0;
+	}
+
+	return *this;
+}
+
+ShaderCode ShaderCode::MapFile(const fs::path& path)
+{
+	ShaderCode code;
+
+#ifndef _WIN32
+	int descriptor = open(path.c_str(), O_RDONLY);
+	if(descriptor < 0)
+	{
+		throw std::runtime_error("failed to open file at " + path.string());
+	}
+
+	struct stat fileStat;
+	if(fstat(descriptor, &fileStat) == 0 && fileStat.st_size > 0)
+	{
+		void* mapping = mmap(nullptr, static_cast<size_t>(fileStat.st_size), PROT_READ, MAP_PRIVATE, descriptor, 0);
+		if(mapping != MAP_FAILED)
+		{
+			code.Mapping = mapping;
+			code.MappingSize = static_cast<size_t>(fileStat.st_size);
+		}
+	}
+	close(descriptor);
+
+	if(code.Mapping != nullptr)
+	{
+		return code;
+	}
+#endif
+
+	// no mapping: read it like ReadShaderFile does
+	std::ifstream file(path, std::ios::binary | std::ios::ate);
+	if(!file.is_open())
+	{
+		throw std::runtime_error("failed to open file at " + path.string());
+	}
+
+	size_t fileSize = static_cast<size_t>(file.tellg());
+	code.Words.resize((fileSize + sizeof(uint32_t) - 1) / sizeof(uint32_t));
+	code.MappingSize = fileSize;
+
+	file.seekg(0);
+	file.read(reinterpret_cast<char*>(code.Words.data()), fileSize);
+
+	return code;
+}
+
+ShaderCode ShaderCode::FromBytes(const char* bytes, size_t size)
+{
+	ShaderCode code;
+	code.Words.resize((size + sizeof(uint32_t) - 1) / sizeof(uint32_t));
+	memcpy(code.Words.data(), bytes, size);
+	code.MappingSize = size;
+
+	return code;
+}
+
+const uint32_t* ShaderCode::GetCode() const
+{
+	return Mapping != nullptr ? static_cast<const uint32_t*>(Mapping) : Words.data();
+}
+
+size_t ShaderCode::GetSize() const
+{
+	return MappingSize;
+}
+
+void ShaderCode::Release()
+{
+#ifndef _WIN32
+	if(Mapping != nullptr)
+	{
+		munmap(Mapping, MappingSize);
+	}
+#endif
+	Mapping = nullptr;
+	MappingSize = 0;
+	Words.clear();
+}
+
+// - ShaderCompiler
+
+#ifdef HAS_SHADERC
+// included files are looked up relative to the source directory
+struct ShaderInclude
+{
+	std::string Name;
+	std::string Content;
+	shaderc_include_result Result;
+};
+
+static shaderc_include_result* ResolveInclude(void* userData, const char* requestedSource, int type,
+	const char* requestingSource, size_t includeDepth)
+{
+	const ShaderCompiler* compiler = static_cast<const ShaderCompiler*>(userData);
+
+	ShaderInclude* include = new ShaderInclude();
+	include->Name = requestedSource;
+	if(!ReadTextFile(compiler->GetSourceDirectory() / include->Name, include->Content))
+	{
+		// an empty name tells shaderc the include failed, the content is the error message
+		include->Name.clear();
+		include->Content = std::string("failed to open include ") + requestedSource;
+	}
+
+	include->Result.source_name = include->Name.c_str();
+	include->Result.source_name_length = include->Name.size();
+	include->Result.content = include->Content.c_str();
+	include->Result.content_length = include->Content.size();
+	include->Result.user_data = include;
+
+	return &include->Result;
+}
+
+static void ReleaseInclude(void* userData, shaderc_include_result* result)
+{
+	delete static_cast<ShaderInclude*>(result->user_data);
+}
+#endif
+
+ShaderCompiler::ShaderCompiler()
+	: CompiledCount(0), CacheHitCount(0)
+{
+
+}
+
+ShaderCompiler::~ShaderCompiler()
+{
+	CleanUp();
+}
+
+void ShaderCompiler::Init(const fs::path& sourceDirectory, const fs::path& cacheDirectory)
+{
+	SourceDirectory = sourceDirectory;
+	CacheDirectory = cacheDirectory;
+
+#ifdef HAS_SHADERC
+	Compiler = shaderc_compiler_initialize();
+	if(Compiler == nullptr)
+	{
+		throw std::runtime_error("failed to initialise the shader compiler!");
+	}
+
+	// the spir-v version doesn't change with every compiler update, the library's build id does
+	unsigned int version = 0;
+	unsigned int revision = 0;
+	shaderc_get_spv_version(&version, &revision);
+	CompilerId = HashString(SHADERC_BUILD_ID, HashBytes(&version, sizeof(version)));
+	CompilerId = HashBytes(&revision, sizeof(revision), CompilerId);
+	CompilerId = HashBytes(&SHADER_TARGET_ENV_VERSION, sizeof(SHADER_TARGET_ENV_VERSION), CompilerId);
+	CompilerId = HashBytes(&SHADER_OPTIMIZATION_LEVEL, sizeof(SHADER_OPTIMIZATION_LEVEL), CompilerId);
+
+	std::error_code error;
+	fs::create_directories(CacheDirectory, error);
+#endif
+}
+
+void ShaderCompiler::CleanUp()
+{
+#ifdef HAS_SHADERC
+	if(Compiler != nullptr)
+	{
+		shaderc_compiler_release(static_cast<shaderc_compiler_t>(Compiler));
+	}
+#endif
+	Compiler = nullptr;
+}
+
+ShaderCode ShaderCompiler::Load(const std::string& sourceName, const std::string& precompiledName,
+	const std::vector<std::string>& defines)
+{
+	if(!CanCompile())
+	{
+		return ShaderCode::MapFile(SourceDirectory / precompiledName);
+	}
+
+	// everything that can change the output goes into the key
+	uint64_t hash = HashBytes(&SHADER_CACHE_VERSION, sizeof(SHADER_CACHE_VERSION));
+	hash = HashBytes(&CompilerId, sizeof(CompilerId), hash);
+	hash = HashString(sourceName, hash);
+	for(const std::string& define : defines)
+	{
+		hash = HashString(define, hash);
+	}
+	hash = HashSource(SourceDirectory / sourceName, hash, 0);
+
+	char hashString[17];
+	snprintf(hashString, sizeof(hashString), "%016llx", static_cast<unsigned long long>(hash));
+	fs::path cachePath = CacheDirectory / (sourceName + "." + hashString + ".spv");
+
+	std::error_code error;
+	if(fs::exists(cachePath, error))
+	{
+		CacheHitCount++;
+		return ShaderCode::MapFile(cachePath);
+	}
+
+	std::string source;
+	if(!ReadTextFile(SourceDirectory / sourceName, source))
+	{
+		throw std::runtime_error("failed to open shader source " + sourceName);
+	}
+
+	std::vector<char> spirv = Compile(sourceName, source, defines);
+	CompiledCount++;
+
+	// write to a temporary file first and rename it, so that other threads or processes
+	// never map a half written file
+	std::ostringstream temporaryName;
+	temporaryName << cachePath.string() << "." << std::this_thread::get_id() << ".tmp";
+	fs::path temporaryPath = temporaryName.str();
+	bool bWritten = false;
+	{
+		std::ofstream file(temporaryPath, std::ios::binary | std::ios::trunc);
+		file.write(spirv.data(), spirv.size());
+		file.close();
+		bWritten = file.good();
+	}
+	// a short write (e.g. a full disk) must not end up in the cache, the next run would map it
+	if(bWritten)
+	{
+		fs::rename(temporaryPath, cachePath, error);
+	}
+	if(!bWritten || error)
+	{
+		// the cache is only an optimisation
+		fs::remove(temporaryPath, error);
+	}
+
+	return ShaderCode::FromBytes(spirv.data(), spirv.size());
+}
+
+bool ShaderCompiler::CanCompile() const
+{
+	return Compiler != nullptr;
+}
+
+const fs::path& ShaderCompiler::GetSourceDirectory() const
+{
+	return SourceDirectory;
+}
+
+uint32_t ShaderCompiler::GetCompiledCount() const
+{
+	return CompiledCount;
+}
+
+uint32_t ShaderCompiler::GetCacheHitCount() const
+{
+	return CacheHitCount;
+}
+
+uint64_t ShaderCompiler::HashSource(const fs::path& file, uint64_t hash, uint32_t depth) const
+{
+	std::string source;
+	if(depth > MAX_INCLUDE_DEPTH || !ReadTextFile(file, source))
+	{
+		// the compiler reports the error
+		return hash;
+	}
+
+	hash = HashString(source, hash);
+
+	// #include "name" lines (the only form the shaders use)
+	std::istringstream lines(source);
+	std::string line;
+	while(std::getline(lines, line))
+	{
+		size_t directive = line.find("#include");
+		if(directive == std::string::npos)
+		{
+			continue;
+		}
+
+		size_t begin = line.find('"', directive);
+		size_t end = begin == std::string::npos ? std::string::npos : line.find('"', begin + 1);
+		if(end != std::string::npos)
+		{
+			hash = HashSource(SourceDirectory / line.substr(begin + 1, end - begin - 1), hash, depth + 1);
+		}
+	}
+
+	return hash;
+}
+
+std::vector<char> ShaderCompiler::Compile(const std::string& sourceName, const std::string& source,
+	const std::vector<std::string>& defines) const
+{
+#ifdef HAS_SHADERC
+	shaderc_shader_kind kind = shaderc_glsl_infer_from_source;
+	std::string extension = fs::path(sourceName).extension().string();
+	if(extension == ".vert")
+	{
+		kind = shaderc_vertex_shader;
+	}
+	else if(extension == ".frag")
+	{
+		kind = shaderc_fragment_shader;
+	}
+	else if(extension == ".comp")
+	{
+		kind = shaderc_compute_shader;
+	}
+
+	shaderc_compile_options_t options = shaderc_compile_options_initialize();
+	shaderc_compile_options_set_target_env(options, shaderc_target_env_vulkan, SHADER_TARGET_ENV_VERSION);
+	shaderc_compile_options_set_optimization_level(options, SHADER_OPTIMIZATION_LEVEL);
+	shaderc_compile_options_set_include_callbacks(options, ResolveInclude, ReleaseInclude, const_cast<ShaderCompiler*>(this));
+	for(const std::string& define : defines)
+	{
+		size_t equals = define.find('=');
+		std::string name = define.substr(0, equals);
+		std::string value = equals == std::string::npos ? "" : define.substr(equals + 1);
+		shaderc_compile_options_add_macro_definition(options, name.c_str(), name.size(), value.c_str(), value.size());
+	}
+
+	shaderc_compilation_result_t result = shaderc_compile_into_spv(static_cast<shaderc_compiler_t>(Compiler),
+		source.c_str(), source.size(), kind, sourceName.c_str(), "main", options);
+	shaderc_compile_options_release(options);
+
+	if(shaderc_result_get_compilation_status(result) != shaderc_compilation_status_success)
+	{
+		std::string message = shaderc_result_get_error_message(result);
+		shaderc_result_release(result);
+		throw std::runtime_error("failed to compile " + sourceName + ": " + message);
+	}
+
+	const char* bytes = shaderc_result_get_bytes(result);
+	std::vector<char> spirv(bytes, bytes + shaderc_result_get_length(result));
+	shaderc_result_release(result);
+
+	return spirv;
+#else
+	throw std::runtime_error("built without runtime shader compiler!");
+#endif
+}
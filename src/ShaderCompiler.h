@@ -0,0 +1,87 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <filesystem>
+#include <string>
+#include <vector>
+
+namespace fs = std::filesystem;
+
+// spir-v of one shader, either memory mapped from the cache or held in memory
+// (move only, a mapping is released with the object)
+class ShaderCode
+{
+public:
+	ShaderCode();
+	~ShaderCode();
+
+	ShaderCode(ShaderCode&& other);
+	ShaderCode& operator=(ShaderCode&& other);
+	ShaderCode(const ShaderCode&) = delete;
+	ShaderCode& operator=(const ShaderCode&) = delete;
+
+	// map the file (read only), falls back to reading it where mapping isn't available
+	static ShaderCode MapFile(const fs::path& path);
+	static ShaderCode FromBytes(const char* bytes, size_t size);
+
+	// what VkShaderModuleCreateInfo wants: code pointer and size in bytes
+	const uint32_t* GetCode() const;
+	size_t GetSize() const;
+
+private:
+	void Release();
+
+private:
+	void* Mapping = nullptr;
+	size_t MappingSize = 0;
+	std::vector<uint32_t> Words;		// when not mapped
+};
+
+// compiles glsl to spir-v at runtime (with shaderc, if the build found it) and keeps the results in an
+// on disk cache. cache files are named after a hash of the source, everything it includes, the defines and
+// the compiler version, so only sources that changed are compiled again. without shaderc, the precompiled
+// .spv files next to the sources are loaded instead (see shaders/compile_shaders.sh)
+// Load can be called from any thread
+class ShaderCompiler
+{
+public:
+	ShaderCompiler();
+	~ShaderCompiler();
+
+	// sourceDirectory: the glsl sources. cacheDirectory is created if it doesn't exist
+	void Init(const fs::path& sourceDirectory, const fs::path& cacheDirectory);
+	void CleanUp();
+
+	// sourceName: file in the source directory, the stage is taken from its extension (.vert, .frag, .comp)
+	// precompiledName: .spv file in the source directory to use without runtime compiler
+	// defines: "NAME" or "NAME=VALUE"
+	ShaderCode Load(const std::string& sourceName, const std::string& precompiledName,
+		const std::vector<std::string>& defines = {});
+
+	// whether shaders are compiled at runtime
+	bool CanCompile() const;
+
+	const fs::path& GetSourceDirectory() const;
+
+	// number of Load calls that had to compile / were served from the cache
+	uint32_t GetCompiledCount() const;
+	uint32_t GetCacheHitCount() const;
+
+private:
+	// hash of the source and, recursively, of the files it includes
+	uint64_t HashSource(const fs::path& file, uint64_t hash, uint32_t depth) const;
+	std::vector<char> Compile(const std::string& sourceName, const std::string& source,
+		const std::vector<std::string>& defines) const;
+
+private:
+	fs::path SourceDirectory;
+	fs::path CacheDirectory;
+
+	void* Compiler = nullptr;			// shaderc_compiler_t, which is thread safe
+	uint64_t CompilerId = 0;			// hash of the compiler build and the compile options
+
+	std::atomic<uint32_t> CompiledCount;
+	std::atomic<uint32_t> CacheHitCount;
+};
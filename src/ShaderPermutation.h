@@ -0,0 +1,89 @@
+#pragma once
+
+#define GLFW_INCLUDE_VULKAN
+#include <GLFW/glfw3.h>
+
+#include <array>
+#include <cstdint>
+
+// features of the mesh shaders (shader.vert / shader.frag) that can be switched per pipeline
+// every feature is a boolean specialization constant with the feature's bit index as constant_id,
+// so the driver compiles the branches of disabled features out of each pipeline
+enum ShaderFeature : uint32_t
+{
+	SHADER_FEATURE_VERTEX_COLOUR = 1 << 0,		// colour from the vertices (plain white otherwise)
+	SHADER_FEATURE_FOG = 1 << 1,				// fade into the clear colour with the view distance
+	SHADER_FEATURE_GREYSCALE = 1 << 2			// desaturate the output
+};
+
+const uint32_t SHADER_FEATURE_COUNT = 3;
+const uint32_t SHADER_FEATURE_ALL = (1u << SHADER_FEATURE_COUNT) - 1;
+
+// set of shader features, i.e. one permutation of the shaders
+typedef uint32_t ShaderPermutationKey;
+
+// permutation known at compile time, e.g.
+//		ShaderPermutation<SHADER_FEATURE_VERTEX_COLOUR | SHADER_FEATURE_FOG>::Key
+// unknown features are rejected by the compiler instead of showing up as a broken pipeline
+template<uint32_t Features>
+struct ShaderPermutation
+{
+	static_assert((Features & ~SHADER_FEATURE_ALL) == 0, "unknown shader feature");
+
+	static constexpr ShaderPermutationKey Key = Features;
+
+	template<uint32_t Feature>
+	static constexpr bool Has()
+	{
+		return (Features & Feature) != 0;
+	}
+
+	template<uint32_t Feature>
+	using With = ShaderPermutation<Features | Feature>;
+
+	template<uint32_t Feature>
+	using Without = ShaderPermutation<Features & ~Feature>;
+};
+
+// what the mesh shaders did before there were permutations
+typedef ShaderPermutation<SHADER_FEATURE_VERTEX_COLOUR> DefaultShaderPermutation;
+
+// specialization constant values of a permutation, one VkBool32 per feature
+constexpr std::array<VkBool32, SHADER_FEATURE_COUNT> GetShaderFeatureValues(ShaderPermutationKey permutation)
+{
+	std::array<VkBool32, SHADER_FEATURE_COUNT> values = {};
+	for(uint32_t i = 0; i < SHADER_FEATURE_COUNT; i++)
+	{
+		values[i] = (permutation & (1u << i)) ? VK_TRUE : VK_FALSE;
+	}
+
+	return values;
+}
+
+// VkSpecializationInfo for a permutation, to be passed to all shader stages of a pipeline
+// (the info points into this object, so it can't be copied)
+struct ShaderSpecialization
+{
+	explicit ShaderSpecialization(ShaderPermutationKey permutation)
+		: Values(GetShaderFeatureValues(permutation))
+	{
+		for(uint32_t i = 0; i < SHADER_FEATURE_COUNT; i++)
+		{
+			MapEntries[i].constantID = i;
+			MapEntries[i].offset = i * sizeof(VkBool32);
+			MapEntries[i].size = sizeof(VkBool32);
+		}
+
+		Info.mapEntryCount = SHADER_FEATURE_COUNT;
+		Info.pMapEntries = MapEntries.data();
+		Info.dataSize = sizeof(Values);
+		Info.pData = Values.data();
+	}
+
+	ShaderSpecialization(const ShaderSpecialization&) = delete;
+	ShaderSpecialization& operator=(const ShaderSpecialization&) = delete;
+
+	std::array<VkBool32, SHADER_FEATURE_COUNT> Values;
+	std::array<VkSpecializationMapEntry, SHADER_FEATURE_COUNT> MapEntries;
+	VkSpecializationInfo Info;
+};
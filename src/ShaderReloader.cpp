@@ -0,0 +1,181 @@
+#include "ShaderReloader.h"
+
+#include <cstdio>
+#include <stdexcept>
+
+ShaderReloader::ShaderReloader()
+{
+
+}
+
+ShaderReloader::~ShaderReloader()
+{
+	Stop();
+}
+
+void ShaderReloader::Start(JobSystem* jobs, const fs::path& directory, BuildFunction build, DestroyFunction destroy,
+	double checkInterval_s)
+{
+	if(bRunning)
+	{
+		return;
+	}
+
+	Jobs = jobs;
+	Directory = directory;
+	Build = build;
+	Destroy = destroy;
+	CheckInterval = std::chrono::duration<double>(checkInterval_s);
+
+	// the current state is the baseline, only changes after this trigger a rebuild
+	Timestamps.clear();
+	ScanForChanges();
+
+	LastCheck = std::chrono::steady_clock::now();
+	bRunning = true;
+}
+
+void ShaderReloader::Stop()
+{
+	if(!bRunning)
+	{
+		return;
+	}
+
+	Jobs->Wait(CheckJob);
+	bCheckInFlight = false;
+
+	for(ReloadedPipeline& reloaded : Results)
+	{
+		Destroy(reloaded.Pipeline);
+	}
+	Results.clear();
+	bResultsReady = false;
+
+	bRunning = false;
+}
+
+bool ShaderReloader::IsRunning() const
+{
+	return bRunning;
+}
+
+bool ShaderReloader::Poll(const std::function<std::vector<PipelineStateDesc>()>& getDescs,
+	std::vector<ReloadedPipeline>& pipelines)
+{
+	if(!bRunning)
+	{
+		return false;
+	}
+
+	if(bCheckInFlight)
+	{
+		// never block the frame on the rebuild
+		if(!CheckJob.IsDone())
+		{
+			return false;
+		}
+		bCheckInFlight = false;
+
+		if(!bResultsReady)
+		{
+			return false;
+		}
+
+		pipelines.swap(Results);
+		Results.clear();
+		bResultsReady = false;
+		ReloadCount++;
+
+		return true;
+	}
+
+	std::chrono::steady_clock::time_point now = std::chrono::steady_clock::now();
+	if(now - LastCheck < CheckInterval)
+	{
+		return false;
+	}
+	LastCheck = now;
+
+	// even scanning the directory happens on the worker
+	std::vector<PipelineStateDesc> descs = getDescs();
+	bCheckInFlight = true;
+	Jobs->Run("ShaderReload", [this, descs]()
+	{
+		if(ScanForChanges())
+		{
+			Rebuild(descs);
+		}
+	}, &CheckJob);
+
+	return false;
+}
+
+uint32_t ShaderReloader::GetReloadCount() const
+{
+	return ReloadCount;
+}
+
+bool ShaderReloader::ScanForChanges()
+{
+	bool bChanged = false;
+	std::map<fs::path, fs::file_time_type> timestamps;
+
+	// only the files directly in the directory (the sources and precompiled spir-v), not the cache below it
+	std::error_code error;
+	for(const fs::directory_entry& entry : fs::directory_iterator(Directory, error))
+	{
+		if(!entry.is_regular_file(error))
+		{
+			continue;
+		}
+
+		fs::file_time_type timestamp = entry.last_write_time(error);
+		if(error)
+		{
+			continue;
+		}
+		timestamps[entry.path()] = timestamp;
+
+		auto previous = Timestamps.find(entry.path());
+		if(previous == Timestamps.end() || previous->second != timestamp)
+		{
+			bChanged = true;
+		}
+	}
+
+	// deleted files don't need a rebuild (the pipelines would fail anyway), but have to be forgotten
+	Timestamps.swap(timestamps);
+
+	return bChanged;
+}
+
+void ShaderReloader::Rebuild(const std::vector<PipelineStateDesc>& descs)
+{
+	std::vector<ReloadedPipeline> pipelines;
+
+	try
+	{
+		for(const PipelineStateDesc& desc : descs)
+		{
+			ReloadedPipeline reloaded;
+			reloaded.Desc = desc;
+			reloaded.Pipeline = Build(desc);
+			pipelines.push_back(reloaded);
+		}
+	}
+	catch(const std::runtime_error &e)
+	{
+		// e.g. a compile error: keep rendering with the old pipelines until the next change
+		printf("ERROR: shader reload failed: %s\n", e.what());
+
+		for(ReloadedPipeline& reloaded : pipelines)
+		{
+			Destroy(reloaded.Pipeline);
+		}
+		return;
+	}
+
+	Results = std::move(pipelines);
+	bResultsReady = true;
+}
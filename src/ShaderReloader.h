@@ -0,0 +1,75 @@
+#pragma once
+
+#define GLFW_INCLUDE_VULKAN
+#include <GLFW/glfw3.h>
+
+#include <chrono>
+#include <filesystem>
+#include <functional>
+#include <map>
+#include <vector>
+
+#include "JobSystem.h"
+#include "PipelineState.h"
+
+namespace fs = std::filesystem;
+
+// pipeline rebuilt from changed shaders, to replace the current one with the same description
+struct ReloadedPipeline
+{
+	PipelineStateDesc Desc;
+	VkPipeline Pipeline;
+};
+
+// watches the shader directory and rebuilds the pipelines on a worker thread when a file in it changes
+// the thread that draws polls it once per frame and swaps in the new pipelines when they are ready,
+// so the old ones keep rendering while the shaders are compiled
+class ShaderReloader
+{
+public:
+	typedef std::function<VkPipeline(const PipelineStateDesc&)> BuildFunction;
+	typedef std::function<void(VkPipeline)> DestroyFunction;
+
+	ShaderReloader();
+	~ShaderReloader();
+
+	// build is called on a worker and has to be thread safe. destroy gets rid of rebuilt pipelines nobody took
+	void Start(JobSystem* jobs, const fs::path& directory, BuildFunction build, DestroyFunction destroy,
+		double checkInterval_s = 0.5);
+
+	// waits for a running rebuild
+	void Stop();
+
+	bool IsRunning() const;
+
+	// start a check when it's due. returns true once a rebuild has finished, with the new pipelines
+	// getDescs is called when a check starts, for the pipelines to rebuild
+	bool Poll(const std::function<std::vector<PipelineStateDesc>()>& getDescs,
+		std::vector<ReloadedPipeline>& pipelines);
+
+	uint32_t GetReloadCount() const;
+
+private:
+	// compare the modification times against the last scan. runs on the worker
+	bool ScanForChanges();
+	void Rebuild(const std::vector<PipelineStateDesc>& descs);
+
+private:
+	JobSystem* Jobs = nullptr;
+	fs::path Directory;
+	BuildFunction Build;
+	DestroyFunction Destroy;
+	std::chrono::duration<double> CheckInterval{0.5};
+
+	std::chrono::steady_clock::time_point LastCheck;
+	bool bRunning = false;
+	bool bCheckInFlight = false;
+	JobCounter CheckJob;
+
+	// only touched by the check job while it's in flight, and by the polling thread otherwise
+	std::map<fs::path, fs::file_time_type> Timestamps;
+	std::vector<ReloadedPipeline> Results;
+	bool bResultsReady = false;
+
+	uint32_t ReloadCount = 0;
+};
@@ -0,0 +1,150 @@
+#include "StartupProfiler.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+
+static double ToMilliseconds(StartupProfiler::Clock::duration duration)
+{
+	return std::chrono::duration<double, std::milli>(duration).count();
+}
+
+void StartupProfiler::Start()
+{
+	std::lock_guard<std::mutex> lock(Mutex);
+
+	Stages.clear();
+	Jobs.clear();
+	bFinished = false;
+	MainThread = std::this_thread::get_id();
+	StartTime = Clock::now();
+}
+
+void StartupProfiler::Record(const char* stage, Clock::time_point begin, Clock::time_point end)
+{
+	std::lock_guard<std::mutex> lock(Mutex);
+
+	StartupStage startupStage = {};
+	startupStage.Name = stage;
+	startupStage.Begin_ms = ToMilliseconds(begin - StartTime);
+	startupStage.Duration_ms = ToMilliseconds(end - begin);
+	startupStage.bMainThread = std::this_thread::get_id() == MainThread;
+
+	Stages.push_back(startupStage);
+}
+
+void StartupProfiler::RecordJob(const char* name, Clock::time_point begin, Clock::time_point end)
+{
+	std::lock_guard<std::mutex> lock(Mutex);
+
+	if(bFinished || begin < StartTime)
+	{
+		return;
+	}
+
+	// a handful of distinct names, a linear search is fine
+	double duration_ms = ToMilliseconds(end - begin);
+	for(StartupJobStats& job : Jobs)
+	{
+		if(strcmp(job.Name, name) == 0)
+		{
+			job.Count++;
+			job.Total_ms += duration_ms;
+			job.Longest_ms = std::max(job.Longest_ms, duration_ms);
+			return;
+		}
+	}
+
+	StartupJobStats job = {};
+	job.Name = name;
+	job.Count = 1;
+	job.Total_ms = duration_ms;
+	job.Longest_ms = duration_ms;
+	Jobs.push_back(job);
+}
+
+void StartupProfiler::Finish()
+{
+	std::lock_guard<std::mutex> lock(Mutex);
+
+	if(bFinished)
+	{
+		return;
+	}
+
+	FinishTime = Clock::now();
+	bFinished = true;
+}
+
+bool StartupProfiler::IsFinished() const
+{
+	std::lock_guard<std::mutex> lock(Mutex);
+
+	return bFinished;
+}
+
+double StartupProfiler::GetElapsed_ms() const
+{
+	std::lock_guard<std::mutex> lock(Mutex);
+
+	return ToMilliseconds((bFinished ? FinishTime : Clock::now()) - StartTime);
+}
+
+std::vector<StartupStage> StartupProfiler::GetStages() const
+{
+	std::vector<StartupStage> stages;
+	{
+		std::lock_guard<std::mutex> lock(Mutex);
+		stages = Stages;
+	}
+
+	// stages are recorded when they end, nested and parallel ones finish out of order
+	std::stable_sort(stages.begin(), stages.end(), [](const StartupStage& a, const StartupStage& b)
+	{
+		return a.Begin_ms < b.Begin_ms;
+	});
+
+	return stages;
+}
+
+std::vector<StartupJobStats> StartupProfiler::GetJobs() const
+{
+	std::vector<StartupJobStats> jobs;
+	{
+		std::lock_guard<std::mutex> lock(Mutex);
+		jobs = Jobs;
+	}
+
+	std::sort(jobs.begin(), jobs.end(), [](const StartupJobStats& a, const StartupJobStats& b)
+	{
+		return a.Total_ms > b.Total_ms;
+	});
+
+	return jobs;
+}
+
+void StartupProfiler::Print() const
+{
+	std::vector<StartupStage> stages = GetStages();
+
+	printf("startup: %.1f ms%s\n", GetElapsed_ms(), IsFinished() ? " to the first frame" : " so far");
+	for(const StartupStage& stage : stages)
+	{
+		printf("  %8.1f ms  %8.1f ms  %c %s\n", stage.Begin_ms, stage.Duration_ms,
+			stage.bMainThread ? ' ' : '*', stage.Name);
+	}
+	printf("  (start, duration; * ran on a worker thread)\n");
+
+	std::vector<StartupJobStats> jobs = GetJobs();
+	if(jobs.empty())
+	{
+		return;
+	}
+
+	printf("startup jobs:\n");
+	for(const StartupJobStats& job : jobs)
+	{
+		printf("  %8.1f ms  %5u x  %8.1f ms longest  %s\n", job.Total_ms, job.Count, job.Longest_ms, job.Name);
+	}
+	printf("  (total, count, longest)\n");
+}
@@ -0,0 +1,76 @@
+#pragma once
+
+#include <chrono>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// one timed step of the renderer's start up
+struct StartupStage
+{
+	const char* Name;				// string literal
+	double Begin_ms;				// relative to StartupProfiler::Start
+	double Duration_ms;
+	bool bMainThread;				// false for the stages that ran on a worker, in parallel to the main thread
+};
+
+// all jobs of one name that ran during the start up
+struct StartupJobStats
+{
+	const char* Name;				// string literal, the job's name
+	uint32_t Count;
+	double Total_ms;
+	double Longest_ms;
+};
+
+// records how long every step from the start of the initialisation up to the first presented frame takes,
+// so slow start ups can be broken down instead of guessed at. stages may be recorded from any thread
+class StartupProfiler
+{
+public:
+	typedef std::chrono::steady_clock Clock;
+
+	// start the clock, forgets all stages recorded so far. the calling thread is the main thread
+	void Start();
+
+	// run the function as a stage. nothing is recorded if it throws
+	template<typename Function>
+	void Time(const char* stage, Function&& function)
+	{
+		Clock::time_point begin = Clock::now();
+		function();
+		Record(stage, begin, Clock::now());
+	}
+
+	void Record(const char* stage, Clock::time_point begin, Clock::time_point end);
+
+	// a job of the job system finished (see JobSystem::SetProfileCallback). only jobs that ran between
+	// Start and Finish are counted
+	void RecordJob(const char* name, Clock::time_point begin, Clock::time_point end);
+
+	// the first frame has been presented, stops the clock
+	void Finish();
+	bool IsFinished() const;
+
+	// time from Start until Finish (or until now, if not finished yet)
+	double GetElapsed_ms() const;
+
+	// in the order they were started
+	std::vector<StartupStage> GetStages() const;
+
+	// by total time, longest first
+	std::vector<StartupJobStats> GetJobs() const;
+
+	// breakdown of all stages, parallel ones are marked, followed by the jobs
+	void Print() const;
+
+private:
+	mutable std::mutex Mutex;
+	std::vector<StartupStage> Stages;
+	std::vector<StartupJobStats> Jobs;
+
+	Clock::time_point StartTime;
+	Clock::time_point FinishTime;
+	bool bFinished = false;
+	std::thread::id MainThread;
+};
@@ -0,0 +1,61 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+
+// lock free triple buffer for exactly one writer and one reader thread
+// the writer always has a buffer to write to and the reader always gets the latest published buffer,
+// neither of them ever waits for the other. buffers the reader didn't pick up in time are overwritten
+template<typename T>
+class TripleBuffer
+{
+public:
+	// - writer thread
+	// buffer to fill for the next publish (still holds the data of an older publish)
+	T& GetWriteBuffer()
+	{
+		return Buffers[BackIndex];
+	}
+
+	// hand the write buffer over to the reader
+	void Publish()
+	{
+		// the buffer in the middle becomes the new write buffer,
+		// the release makes the written data visible to the reader that picks it up
+		uint8_t previous = Middle.exchange(static_cast<uint8_t>(BackIndex | FRESH_BIT), std::memory_order_acq_rel);
+		BackIndex = previous & INDEX_MASK;
+	}
+
+	// - reader thread
+	// pick up the latest published buffer. returns false if nothing new has been published since the last call
+	bool Consume()
+	{
+		if(!(Middle.load(std::memory_order_relaxed) & FRESH_BIT))
+		{
+			return false;
+		}
+
+		uint8_t previous = Middle.exchange(FrontIndex, std::memory_order_acq_rel);
+		FrontIndex = previous & INDEX_MASK;
+
+		return true;
+	}
+
+	// latest buffer picked up by Consume
+	const T& GetReadBuffer() const
+	{
+		return Buffers[FrontIndex];
+	}
+
+private:
+	static const uint8_t INDEX_MASK = 0x3;
+	static const uint8_t FRESH_BIT = 0x4;		// middle buffer has been published, but not consumed yet
+
+	T Buffers[3];
+
+	// the writer owns BackIndex, the reader owns FrontIndex and the remaining buffer sits in the middle
+	// keep them on separate cache lines, so the two threads don't fight over them
+	alignas(64) std::atomic<uint8_t> Middle{1};
+	alignas(64) uint8_t BackIndex = 0;
+	alignas(64) uint8_t FrontIndex = 2;
+};
@@ -4,6 +4,8 @@
 #include <fstream>
 #include <cstring>
 #include <filesystem>
+#include <stdexcept>
+#include <vector>
 
 #define GLFW_INCLUDE_VULKAN
 #include <GLFW/glfw3.h>
@@ -12,6 +14,9 @@
 namespace fs = std::filesystem;
 
 const uint32_t MAX_FRAME_DRAWS = 2;
+const uint32_t MAX_OBJECTS = 65536;		// max scene nodes that can be uploaded to the object buffer
+const uint32_t MIN_INSTANCE_CAPACITY = 4;		// room to grow of a mesh's range in the instance buffer
+const uint32_t MIN_DRAW_COMMAND_CAPACITY = 64;	// meshes the draw command buffers hold at first
 
 const std::vector<const char*> DeviceExtensions = {
 	VK_KHR_SWAPCHAIN_EXTENSION_NAME
@@ -25,6 +30,21 @@ struct Vertex
 	glm::vec3 Colour;
 };
 
+// per instance data of a mesh draw (vertex binding 1, instance rate)
+struct MeshInstance
+{
+	uint32_t Node;				// scene node, i.e. the index of the instance's matrix in the object buffer
+	uint8_t Colour[4];			// rgba tint, unorm
+};
+
+static void PackInstanceColour(const glm::vec4& colour, uint8_t* packed)
+{
+	for(uint32_t i = 0; i < 4; i++)
+	{
+		packed[i] = static_cast<uint8_t>(glm::clamp(colour[i], 0.0f, 1.0f) * 255.0f + 0.5f);
+	}
+}
+
 //indices of the locations of queue families (if they exist at all)
 struct QueueFamilyIndicies
 {
@@ -95,7 +115,7 @@ static std::string GetPathLeaf(const fs::path& path)
 	return *it;
 }
 
-static fs::path GetShaderPath()
+static fs::path FindShaderPath()
 {
 	// get shader path
 	fs::path shaderPath = fs::current_path();
@@ -117,6 +137,14 @@ static fs::path GetShaderPath()
 	return shaderPath;
 }
 
+static fs::path GetShaderPath()
+{
+	// only walk up the directory tree once
+	static const fs::path shaderPath = FindShaderPath();
+
+	return shaderPath;
+}
+
 static uint32_t FindMemoryTypeIndex(VkPhysicalDevice physicalDevice, uint32_t allowedTypes, VkMemoryPropertyFlags propertyFlags)
 {
 	// get properties of _physical_ device memory
@@ -135,11 +163,58 @@ static uint32_t FindMemoryTypeIndex(VkPhysicalDevice physicalDevice, uint32_t al
         }
     }
 
-    return 0;
+    throw std::runtime_error("failed to find a suitable memory type!");
+}
+
+// FindMemoryTypeIndex throws if there is no such type, use this to check for optional properties first
+static bool HasMemoryType(VkPhysicalDevice physicalDevice, uint32_t allowedTypes, VkMemoryPropertyFlags propertyFlags)
+{
+    VkPhysicalDeviceMemoryProperties memProps;
+    vkGetPhysicalDeviceMemoryProperties(physicalDevice, &memProps);
+
+    for(uint32_t i = 0; i < memProps.memoryTypeCount; i++)
+    {
+        if((allowedTypes & (1 << i))
+            && (memProps.memoryTypes[i].propertyFlags & propertyFlags) == propertyFlags)
+        {
+            return true;
+        }
+    }
+
+    return false;
 }
 
+// bytes per texel of the uncompressed colour formats a swapchain can have, 0 for any other format
+static uint32_t GetFormatTexelSize(VkFormat format)
+{
+	switch(format)
+	{
+	case VK_FORMAT_R5G6B5_UNORM_PACK16:
+	case VK_FORMAT_B5G6R5_UNORM_PACK16:
+	case VK_FORMAT_A1R5G5B5_UNORM_PACK16:
+		return 2;
+	case VK_FORMAT_R8G8B8A8_UNORM:
+	case VK_FORMAT_R8G8B8A8_SRGB:
+	case VK_FORMAT_B8G8R8A8_UNORM:
+	case VK_FORMAT_B8G8R8A8_SRGB:
+	case VK_FORMAT_A8B8G8R8_UNORM_PACK32:
+	case VK_FORMAT_A8B8G8R8_SRGB_PACK32:
+	case VK_FORMAT_A2R10G10B10_UNORM_PACK32:
+	case VK_FORMAT_A2B10G10R10_UNORM_PACK32:
+	case VK_FORMAT_B10G11R11_UFLOAT_PACK32:
+		return 4;
+	case VK_FORMAT_R16G16B16A16_UNORM:
+	case VK_FORMAT_R16G16B16A16_SFLOAT:
+		return 8;
+	default:
+		return 0;
+	}
+}
+
+// destroy the buffer and free its memory with the same allocator
 static void CreateBufferAndAllocateMemory(VkPhysicalDevice physicalDevice, VkDevice logicalDevice, VkDeviceSize bufferSize,
-	VkBufferUsageFlags bufferUsageFlags, VkMemoryPropertyFlags bufferProperties, VkBuffer* buffer, VkDeviceMemory* bufferMemory)
+	VkBufferUsageFlags bufferUsageFlags, VkMemoryPropertyFlags bufferProperties, VkBuffer* buffer, VkDeviceMemory* bufferMemory,
+	const VkAllocationCallbacks* allocator = nullptr)
 {
 	// the VkBuffer is just a description of the buffer contents, not the actual memory itself!
     // therefore, no memory is created/allocated here
@@ -149,7 +224,7 @@ static void CreateBufferAndAllocateMemory(VkPhysicalDevice physicalDevice, VkDev
     createInfo.usage = bufferUsageFlags;
     createInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
 
-    VkResult result = vkCreateBuffer(logicalDevice, &createInfo, nullptr, buffer);
+    VkResult result = vkCreateBuffer(logicalDevice, &createInfo, allocator, buffer);
 
     if(result != VK_SUCCESS)
     {
@@ -169,13 +244,26 @@ static void CreateBufferAndAllocateMemory(VkPhysicalDevice physicalDevice, VkDev
     // HOST_COHERENT_BIT:   allows placement of data straight into buffer after mapping
     //                          (otherwise would need flushes and memory invalidating)
 	// DEVICE_VISIBLE_BIT:	only GPU can interact with memory, has to be copied over from other buffer from CPU
-    memAllocInfo.memoryTypeIndex = FindMemoryTypeIndex(physicalDevice, memRequirements.memoryTypeBits,
-        bufferProperties);
+    // without memory the buffer is of no use, it doesn't outlive a failure
+    try
+    {
+        memAllocInfo.memoryTypeIndex = FindMemoryTypeIndex(physicalDevice, memRequirements.memoryTypeBits,
+            bufferProperties);
+    }
+    catch(const std::runtime_error&)
+    {
+        vkDestroyBuffer(logicalDevice, *buffer, allocator);
+        *buffer = VK_NULL_HANDLE;
+        throw;
+    }
 
     // allocate memory _on_ VkDeviceMemory
-    result = vkAllocateMemory(logicalDevice, &memAllocInfo, nullptr, bufferMemory);
+    result = vkAllocateMemory(logicalDevice, &memAllocInfo, allocator, bufferMemory);
     if(result != VK_SUCCESS)
     {
+        vkDestroyBuffer(logicalDevice, *buffer, allocator);
+        *buffer = VK_NULL_HANDLE;
+        *bufferMemory = VK_NULL_HANDLE;
         throw std::runtime_error("failed to allocate vertex buffer memory!");
     }
 
@@ -5,9 +5,22 @@
 #include <limits>
 #include <algorithm>
 #include <array>
+#include <cstdio>
+#include <string>
 
 #include <glm/gtc/matrix_transform.hpp>
 
+// profile callback of the job system: the jobs that ran up to the first frame go into the startup report
+// (both use the steady clock)
+static void RecordStartupJob(const JobTiming& timing, void* userData)
+{
+	typedef StartupProfiler::Clock Clock;
+	Clock::time_point begin(std::chrono::duration_cast<Clock::duration>(std::chrono::nanoseconds(timing.StartNs)));
+	Clock::time_point end(std::chrono::duration_cast<Clock::duration>(std::chrono::nanoseconds(timing.EndNs)));
+
+	static_cast<StartupProfiler*>(userData)->RecordJob(timing.Name, begin, end);
+}
+
 VulkanRenderer::VulkanRenderer()
 {
 
@@ -18,93 +31,206 @@ VulkanRenderer::~VulkanRenderer()
 
 }
 
-int32_t VulkanRenderer::Init(GLFWwindow* newWindow)
+int32_t VulkanRenderer::Init(GLFWwindow* newWindow, uint32_t msaaSamples, uint32_t readbackFrames, bool dynamicRendering)
 {
 	Window = newWindow;
+	ReadbackFrameCount = readbackFrames;
+
+	// everything up to the first presented frame is timed
+	Startup.Start();
+
+	// the jobs that run in parallel to the main thread, they have to be waited for whatever happens
+	JobCounter shaderJobs;
+	JobCounter pipelineJobs;
+	std::string pipelineError;
 
 	try
 	{
-		CreateInstance();
+		// start the worker threads first, so that all of the setup can make use of them
+		if(bStartupReport)
+		{
+			Jobs.SetProfileCallback(RecordStartupJob, &Startup);
+		}
+		Startup.Time("job system", [&]{ Jobs.Init(); });
+
+		// compiles the shaders at runtime (if built with shaderc), unchanged ones come from the cache
+		Startup.Time("shader compiler", [&]{ Shaders.Init(GetShaderPath(), GetShaderPath() / "cache"); });
+
+		// the shaders don't need a device: compile (or at least read) them while the device is set up,
+		// the first pipeline takes them over. if that fails, errors show up again when the pipeline loads them
+		Jobs.Run("LoadShaders", [this]()
+		{
+			try
+			{
+				Startup.Time("load shaders", [&]
+				{
+					StartupVertexShader = Shaders.Load("shader.vert", "vert.spv");
+					StartupFragmentShader = Shaders.Load("shader.frag", "frag.spv");
+				});
+			}
+			catch(const std::runtime_error&)
+			{
+			}
+		}, &shaderJobs);
+
+		Startup.Time("instance", [&]{ CreateInstance(); });
 
 		//enable validation layer output
-		SetupDebugMessenger();
+		Startup.Time("debug messenger", [&]{ SetupDebugMessenger(); });
 
 		//surface is not create for any particular device, but for an instance
 		//thus create the surface first and make sure the device supports it
-		CreateSurface();		
-		GetPhysicalDevice();
-		CreateLogicalDevice();
-		CreateSwapChain();
-		CreateRenderPass();
-		CreateDescriptorSetLayout();
-		CreateGraphicsPipeline();
-		CreateFramebuffers();
-		CreateCommandPool();
-
-		// setup model, view and projection matrix
-		ModelViewProjectMatrix.Projection = glm::perspective(glm::radians(45.0f),
+		Startup.Time("surface", [&]{ CreateSurface(); });
+		Startup.Time("physical device", [&]
+		{
+			GetPhysicalDevice();
+			MsaaSamples = GetMaxUsableSampleCount(msaaSamples);
+			DepthFormat = GetDepthFormat();
+			bDynamicRendering = dynamicRendering && CheckDynamicRenderingSupport(MainDevice.PhysicalDevice);
+			bMemoryBudgetExtension = CheckMemoryBudgetSupport(MainDevice.PhysicalDevice);
+			bDescriptorUpdateTemplates = CheckDescriptorUpdateTemplateSupport(MainDevice.PhysicalDevice);
+		});
+		Startup.Time("logical device", [&]
+		{
+			CreateLogicalDevice();
+			Memory.Create(Instance, MainDevice.PhysicalDevice, bMemoryBudgetExtension);
+
+			VkDevice device = MainDevice.LogicalDevice;
+			const VkAllocationCallbacks* allocator = Allocator;
+			GraphicsPipelines.Create(device, allocator);
+			DescriptorLayouts.Create(device, allocator);
+			Pipelines.Create(device, allocator, &Jobs,
+				[this](const PipelineStateDesc& desc, VkPipeline basePipeline)
+				{
+					return CreateGraphicsPipeline(desc, basePipeline);
+				},
+				[device, allocator](VkPipeline pipeline)
+				{
+					vkDestroyPipeline(device, pipeline, allocator);
+				});
+		});
+		// the render pass and the pipeline only need the format and the resolution,
+		// not the swapchain itself: it's created while the pipeline is compiled
+		Startup.Time("swapchain settings", [&]{ ChooseSwapChainSettings(); });
+		// with dynamic rendering there are no render pass and framebuffer objects,
+		// the pipelines only need to know the attachment formats
+		if(!bDynamicRendering)
+		{
+			Startup.Time("render pass", [&]{ CreateRenderPass(); });
+		}
+		else
+		{
+			// filled once here, pipelines may be created on worker threads later (shader reload)
+			PipelineRenderingInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_RENDERING_CREATE_INFO;
+			PipelineRenderingInfo.colorAttachmentCount = 1;
+			PipelineRenderingInfo.pColorAttachmentFormats = &SwapchainImageFormat;
+			PipelineRenderingInfo.depthAttachmentFormat = DepthFormat;
+			PipelineRenderingInfo.stencilAttachmentFormat = VK_FORMAT_UNDEFINED;
+		}
+		Startup.Time("layouts", [&]
+		{
+			CreateDescriptorSetLayout();
+			CreatePipelineLayout();
+		});
+
+		// the pipeline is the slowest part of the setup and nothing but the command recording depends on it.
+		// nothing else touches GraphicsPipelines until it's waited for below.
+		// it's the fallback for all other permutations, so it's always built up front
+		Jobs.RunAfter(shaderJobs, "CreateGraphicsPipeline", [this, &pipelineError]()
+		{
+			try
+			{
+				Startup.Time("graphics pipeline", [&]
+				{
+					PipelineStateDesc desc = ResolvePipelineState(PipelineStateDesc());
+					GraphicsPipelines.Insert(desc, Pipelines.Compile(desc));
+				});
+			}
+			catch(const std::runtime_error &e)
+			{
+				pipelineError = e.what();
+			}
+		}, &pipelineJobs);
+
+		Startup.Time("swapchain", [&]{ CreateSwapChain(); });
+		Startup.Time("attachments", [&]
+		{
+			CreateAttachmentImages();
+			if(!bDynamicRendering)
+			{
+				CreateFramebuffers();
+			}
+		});
+		Startup.Time("command pool", [&]{ CreateCommandPool(); });
+
+		Startup.Time("compute", [&]
+		{
+			Compute.Create(MainDevice.PhysicalDevice, MainDevice.LogicalDevice,
+				static_cast<uint32_t>(SwapchainImages.size()), Allocator, &Memory);
+		});
+
+		if(ReadbackFrameCount > 0)
+		{
+			Startup.Time("readback", [&]
+			{
+				Readback.Create(MainDevice.PhysicalDevice, MainDevice.LogicalDevice, GraphicsCommandPool,
+					SwapchainResolution, SwapchainImageFormat, ReadbackFrameCount, Allocator, &Memory);
+			});
+		}
+
+		// setup view and projection matrix
+		glm::mat4 projection = glm::perspective(glm::radians(45.0f),
 			(float)(SwapchainResolution.width / SwapchainResolution.height), 0.1f, 100.f);
-		ModelViewProjectMatrix.View = glm::lookAt(glm::vec3(3.0f, 1.0f, 2.0f), glm::vec3(0.0f, 0.0f, 0.0f),
+		glm::mat4 view = glm::lookAt(glm::vec3(3.0f, 1.0f, 2.0f), glm::vec3(0.0f, 0.0f, 0.0f),
 			glm::vec3(0.0, 1.0f, 0.0f));
-		ModelViewProjectMatrix.Model = glm::mat4(1.0f);
 
 		// invert the y axis for glm to work correctly
-		ModelViewProjectMatrix.Projection[1][1] *= -1;
-
-		// create a mesh
-		// vertex data
-		std::vector<Vertex> firstMeshVertices = {
-			{{-0.1, -0.4, 0.0},		{1.0f, 0.0f, 0.0f}},
-			{{-0.1, 0.4, 0.0},		{0.0f, 1.0f, 0.0f}},
-			{{-0.9, 0.4, 0.0},		{0.0f, 0.0f, 1.0f}},
-			{{-0.9, -0.4, 0.0},		{1.0f, 1.0f, 0.0f}}
-		};
-
-		// index data
-		std::vector<uint32_t> meshIndices = {
-			0, 1, 2,
-			2, 3, 0
-		};
-		Mesh firstMesh = Mesh(MainDevice.PhysicalDevice, MainDevice.LogicalDevice, GraphicsQueue,
-			GraphicsCommandPool, &firstMeshVertices, &meshIndices);
-
-		/*
-		std::vector<Vertex> secondMeshVertices = {
-			{{0.9, -0.4, 0.0},		{0.0f, 0.0f, 1.0f}},
-			{{0.9, 0.4, 0.0},		{0.0f, 1.0f, 0.0f}},
-			{{0.1, 0.4, 0.0},		{1.0f, 0.0f, 0.0f}},
-			{{0.1, -0.4, 0.0},		{1.0f, 1.0f, 0.0f}}
-		};*/
-
-		std::vector<Vertex> secondMeshVertices = {
-			{{0.3, -0.4, 0.0},		{1.0f, 1.0f, 0.0f}},
-			{{0.05, 0.1, 0.0},		{1.0f, 0.0f, 1.0f}},
-			{{0.5, 0.4, 0.0},		{0.0f, 1.0f, 0.0f}},
-			{{0.95, 0.1, 0.0},		{0.0f, 1.0f, 1.0f}},
-			{{0.7, -0.4, 0.0},		{0.0f, 0.0f, 1.0f}}
-		};
-		std::vector<uint32_t> secondMeshIndices = {
-			2, 1, 0,
-			4, 2, 0,
-			4, 3, 2
-		};
+		projection[1][1] *= -1;
+		SetView(view, projection);
 
-		Mesh secondMesh = Mesh(MainDevice.PhysicalDevice, MainDevice.LogicalDevice, GraphicsQueue,
-			GraphicsCommandPool, &secondMeshVertices, &secondMeshIndices);
+		// fog fades into the clear colour
+		SetFog(glm::vec3(0.6f, 0.65f, 0.4f), 2.0f, 6.0f);
+		InitTime = std::chrono::steady_clock::now();
 
-		MeshList.push_back(firstMesh);
-		MeshList.push_back(secondMesh);
+		Startup.Time("meshes", [&]{ CreateMeshes(); });
 
-		CreateCommandBuffers();
-		CreateUniformBuffers();
-		CreateDescriptorPool();
-		CreateDescriptorSets();
-		RecordCommands();
-		CreateSynchronizationObjects();
+		Startup.Time("command buffers", [&]{ CreateCommandBuffers(); });
+		Startup.Time("buffers", [&]
+		{
+			CreateUniformBuffers();
+			CreateObjectBuffers();
+			CreateInstanceBuffers();
+		});
+		Startup.Time("descriptor sets", [&]
+		{
+			CreateDescriptorPool();
+			CreateDescriptorSets();
+		});
+		Startup.Time("synchronisation", [&]{ CreateSynchronizationObjects(); });
+
+		// everything left needs the pipeline
+		Startup.Time("wait for pipeline", [&]{ Jobs.Wait(pipelineJobs); });
+		if(!pipelineError.empty())
+		{
+			throw std::runtime_error(pipelineError);
+		}
+		Startup.Time("record commands", [&]
+		{
+			LayoutInstances();
+			RecordCommands();
+		});
 	}
 	catch (const std::runtime_error &e)
 	{
+		// the jobs still use the renderer
+		Jobs.Wait(shaderJobs);
+		Jobs.Wait(pipelineJobs);
+
 		printf("ERROR: %s\n", e.what());
+		if(bStartupReport)
+		{
+			Startup.Print();
+		}
 		return EXIT_FAILURE;
 	}
 	
@@ -112,911 +238,2500 @@ int32_t VulkanRenderer::Init(GLFWwindow* newWindow)
 	return 0;
 }
 
+bool VulkanRenderer::UsesDynamicRendering() const
+{
+	return bDynamicRendering;
+}
+
 void VulkanRenderer::UpdateModel(const glm::mat4& modelMatrix)
 {
-	ModelViewProjectMatrix.Model = modelMatrix;
+	Scene.SetLocalTransform(SceneRoot, modelMatrix);
 }
 
-void VulkanRenderer::Draw()
+void VulkanRenderer::SetView(const glm::mat4& view, const glm::mat4& projection)
 {
-	// 1. Get next available image to draw to and set something to signal
-	//		when we're finished with the image (-> semaphore)
-	// 2. Submit command buffer to queue for execution,
-	//		making sure it waits for the image to be signalled as available before drawing
-	//		and signals when it has finished rendering
-	// 3. Present image to screen when it has signalled finished recording
+	ViewUniforms.View = view;
+	ViewUniforms.ViewProjection = projection * view;
 
-	// waiting for, but not closing fence!
-	vkWaitForFences(MainDevice.LogicalDevice, 1, &DrawFences[CurrentFrame], VK_TRUE, std::numeric_limits<uint64_t>::max());
+	// every image's view uniforms and object matrices are out of date now
+	ViewGeneration++;
+}
 
-	// actually close fence
-	vkResetFences(MainDevice.LogicalDevice, 1, &DrawFences[CurrentFrame]);
+void VulkanRenderer::SetFog(const glm::vec3& colour, float start, float end)
+{
+	// written with every frame anyway
+	FrameUniforms.FogColour = glm::vec4(colour, 1.0f);
+	FrameUniforms.FogStart = start;
+	FrameUniforms.FogEnd = end;
+}
 
-	// - Get next image (index)
-	uint32_t imageIndex = 0;
-	// signal ImageAvailable, when done
-	vkAcquireNextImageKHR(MainDevice.LogicalDevice, Swapchain, std::numeric_limits<uint64_t>::max(), ImagesAvailable[CurrentFrame], VK_NULL_HANDLE, &imageIndex);
+SceneGraph& VulkanRenderer::GetScene()
+{
+	return Scene;
+}
 
-	// update the uniform buffer memory
-	UpdateUniformBuffer(imageIndex);
+SceneNode VulkanRenderer::GetMeshNode(size_t meshIndex) const
+{
+	return MeshNodes[meshIndex];
+}
 
-	// - Submit cmd buffer to render (this is the actual drawing! but not presented to screen yet)
-	VkSubmitInfo submitInfo = {};
-	submitInfo.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
-	submitInfo.waitSemaphoreCount = 1;
-	submitInfo.pWaitSemaphores = &ImagesAvailable[CurrentFrame];
-	// the pipeline will continue execution until the fragment shader, before it waits for the ImageAvailable
-	// (rather than waiting at this point immediately
-	// --> stages to check semaphores at
-	VkPipelineStageFlags waitStages[] = {
-		VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT
-	};
-	submitInfo.pWaitDstStageMask = waitStages;
-	//don't submit all cmd buffers at once, since we want to use one per draw call (-> triple buffering)
-	submitInfo.commandBufferCount = 1;
-	submitInfo.pCommandBuffers = &CommandBuffers[imageIndex];
-	// number of semaphores to signale when cmd buffer finished
-	submitInfo.signalSemaphoreCount = 1;
-	submitInfo.pSignalSemaphores = &RendersFinished[CurrentFrame];
+SceneNode VulkanRenderer::GetSceneRoot() const
+{
+	return SceneRoot;
+}
 
-	// fence -> when it has finished drawing, signal(/open) the fence
-	VkResult result = vkQueueSubmit(GraphicsQueue, 1, &submitInfo, DrawFences[CurrentFrame]);
-	if(result != VK_SUCCESS)
+size_t VulkanRenderer::GetMeshCount() const
+{
+	return MeshList.size();
+}
+
+void VulkanRenderer::SetDrawList(const std::vector<uint32_t>& drawList)
+{
+	if(drawList == DrawList)
 	{
-		throw std::runtime_error("failed to submit cmd buffer to queue!");
+		return;
 	}
 
-	// - Present rendered image to screen
-	VkPresentInfoKHR presentInfo = {};
-	presentInfo.sType = VK_STRUCTURE_TYPE_PRESENT_INFO_KHR;
-	presentInfo.waitSemaphoreCount = 1;
-	presentInfo.pWaitSemaphores = &RendersFinished[CurrentFrame];
-	// number of swapchains to present to
-	presentInfo.swapchainCount = 1;
-	presentInfo.pSwapchains = &Swapchain;
-	presentInfo.pImageIndices = &imageIndex;
-
-	result = vkQueuePresentKHR(GraphicsQueue, &presentInfo);
-	if(result != VK_SUCCESS)
+	// evicted meshes are valid as well, they're streamed in again. only removed ones lose their node
+	for(uint32_t meshIndex : drawList)
 	{
-		throw std::runtime_error("failed to present image!");
+		if(meshIndex >= MeshNodes.size() || MeshNodes[meshIndex] == INVALID_SCENE_NODE)
+		{
+			throw std::runtime_error("draw list contains an invalid mesh index!");
+		}
 	}
 
-	// get next frame (not image!)
-	CurrentFrame = (CurrentFrame + 1) % MAX_FRAME_DRAWS;
+	// the command buffers are re-recorded lazily, when their image is drawn to next
+	DrawList = drawList;
+	DrawListVersion++;
 }
 
-void VulkanRenderer::CleanUp()
+void VulkanRenderer::SetMeshPermutation(MeshHandle mesh, ShaderPermutationKey permutation)
 {
-	// wait until no actions are being run on device before destroying
-	vkDeviceWaitIdle(MainDevice.LogicalDevice);
-
-	vkDestroyDescriptorPool(MainDevice.LogicalDevice, DescriptorPool, nullptr);
-	for(size_t i = 0; i < MeshList.size(); i++)
+	if(permutation & ~SHADER_FEATURE_ALL)
 	{
-		MeshList[i].DestroyBuffers();
+		throw std::runtime_error("unknown shader feature!");
 	}
 
-	for(uint32_t i = 0; i < MAX_FRAME_DRAWS; i++)
-	{
-		vkDestroyFence(MainDevice.LogicalDevice, DrawFences[i], nullptr);
-		vkDestroySemaphore(MainDevice.LogicalDevice, RendersFinished[i], nullptr);
-		vkDestroySemaphore(MainDevice.LogicalDevice, ImagesAvailable[i], nullptr);
-	}
-	vkDestroyCommandPool(MainDevice.LogicalDevice, GraphicsCommandPool, nullptr);
-	for(auto fb : SwapchainFramebuffers)
-	{
-		vkDestroyFramebuffer(MainDevice.LogicalDevice, fb, nullptr);
-	}
-	vkDestroyDescriptorSetLayout(MainDevice.LogicalDevice, DescriptorSetLayout, nullptr);
-	for(size_t i = 0; i < UniformBuffer.size(); i++)
-	{
-		vkDestroyBuffer(MainDevice.LogicalDevice, UniformBuffer[i], nullptr);
-		vkFreeMemory(MainDevice.LogicalDevice, UniformBufferMemory[i], nullptr);
-	}
-	vkDestroyPipeline(MainDevice.LogicalDevice, GraphicsPipeline, nullptr);
-	vkDestroyPipelineLayout(MainDevice.LogicalDevice, PipelineLayout, nullptr);
-	vkDestroyRenderPass(MainDevice.LogicalDevice, RenderPass, nullptr);
-	for(SwapchainImage image : SwapchainImages)
-	{
-		vkDestroyImageView(MainDevice.LogicalDevice, image.ImageView, nullptr);
-	}
-	vkDestroySwapchainKHR(MainDevice.LogicalDevice, Swapchain, nullptr);
-	vkDestroySurfaceKHR(Instance, Surface, nullptr);
-	vkDestroyDevice(MainDevice.LogicalDevice, nullptr);
-	if(bEnableValidationLayers)
+	PipelineStateDesc desc = GetMeshPipelineState(mesh);
+	desc.Permutation = permutation;
+	SetMeshPipelineState(mesh, desc);
+}
+
+void VulkanRenderer::SetMeshVariant(MeshHandle mesh, const PipelineVariant& variant)
+{
+	PipelineStateDesc desc = GetMeshPipelineState(mesh);
+	desc.Variant = variant;
+	if(!desc.IsValid())
 	{
-		DestroyDebugUtilsMessenger(Instance, DebugMessenger, nullptr);
+		throw std::runtime_error("unknown pipeline variant!");
 	}
-	vkDestroyInstance(Instance, nullptr);
+
+	SetMeshPipelineState(mesh, desc);
 }
 
-void VulkanRenderer::CreateInstance()
+void VulkanRenderer::SetMeshPipelineState(MeshHandle mesh, const PipelineStateDesc& desc)
 {
-	//enable validation layers
-	if(bEnableValidationLayers && ! CheckValidationLayerSupport())
+	if(mesh >= MeshPipelineStates.size())
 	{
-		throw std::runtime_error("validation layers requested, but not available");
+		MeshPipelineStates.resize(mesh + 1, ResolvePipelineState(PipelineStateDesc()));
 	}
-	else if (bEnableValidationLayers)
+	if(MeshPipelineStates[mesh] == desc)
 	{
-		std::cout << "Validation layers are enabled!" << std::endl;
+		return;
 	}
+	MeshPipelineStates[mesh] = desc;
 
-	//information about the application itself
-	//most data here doesn't affect the program and is for developer convenience
-	VkApplicationInfo appInfo = {};
-	appInfo.sType = VK_STRUCTURE_TYPE_APPLICATION_INFO;
-	appInfo.pApplicationName = "Vulkan Tutorial App";
-	appInfo.applicationVersion = VK_MAKE_VERSION(0, 1, 0);
-	appInfo.engineVersion = VK_MAKE_VERSION(0, 1, 0);
-	appInfo.pEngineName = "No Engine";
-	//the previous info is just for the developer
-	//the apiInfo relates to the Vulkan API Version though, this can affect the program!
-	appInfo.apiVersion = VK_API_VERSION_1_0;
-
-	//creation information for a VkInstance
-	VkInstanceCreateInfo createInfo = {};
-	createInfo.sType = VK_STRUCTURE_TYPE_INSTANCE_CREATE_INFO;
-	createInfo.pApplicationInfo = &appInfo;
+	// start building it now rather than while recording
+	GetGraphicsPipeline(desc);
 
-	//create list to hold instance extensions
-	std::vector<const char*> instanceExtensions = GetRequiredExtensions();
+	DrawListVersion++;
+}
 
-	//check instance extensions are supported
-	if (!CheckInstanceExtensionSupport(&instanceExtensions))
+void VulkanRenderer::PrecompilePipelines(const std::vector<PipelineStateDesc>& descs)
+{
+	for(const PipelineStateDesc& desc : descs)
 	{
-		throw std::runtime_error("VkInstance does not support required extensions!");
+		if(!desc.IsValid())
+		{
+			throw std::runtime_error("unknown shader feature or pipeline variant!");
+		}
+
+		GetGraphicsPipeline(ResolvePipelineState(desc));
 	}
+}
 
-	createInfo.enabledExtensionCount = static_cast<uint32_t>(instanceExtensions.size());
-	createInfo.ppEnabledExtensionNames = instanceExtensions.data();
+LinearArena& VulkanRenderer::GetFrameArena()
+{
+	return FrameArenas[CurrentFrame];
+}
 
-	//if no validation layers:
-	createInfo.enabledLayerCount = 0;
-	createInfo.ppEnabledLayerNames = nullptr;
-	createInfo.pNext = nullptr;
+JobSystem& VulkanRenderer::GetJobSystem()
+{
+	return Jobs;
+}
 
-	//enable validation layers for the actual instance creation
-	//	(i.e. this is separate from the rest of the validation layer cheks with the DebugMessenger)
-	VkDebugUtilsMessengerCreateInfoEXT debugCreateInfo{};
-	if(bEnableValidationLayers)
+MeshHandle VulkanRenderer::LoadMeshAsync(MeshLoadFunction loader)
+{
+	MeshHandle handle;
 	{
-		createInfo.enabledLayerCount = static_cast<uint32_t>(validationLayers.size());
-		createInfo.ppEnabledLayerNames = validationLayers.data();
+		std::lock_guard<std::mutex> lock(MeshUploadMutex);
+		handle = static_cast<MeshHandle>(MeshStates.size());
+		MeshStates.push_back(MESH_STATE_LOADING);
 
-		VulkanRenderer::PopulateDebugMessengerCreateInfo(debugCreateInfo);
-		createInfo.pNext = (VkDebugUtilsMessengerCreateInfoEXT*)&debugCreateInfo;
+		// kept to stream the mesh in again after it has been evicted
+		MeshLoaders.resize(handle + 1);
+		MeshLoaders[handle] = loader;
 	}
 
-	//create the actual VkInstance
-	VkResult result = vkCreateInstance(&createInfo, nullptr, &Instance);
-	if (result != VK_SUCCESS)
-	{
-		throw std::runtime_error("Failed to create a Vulkan instance!");
-	}
+	StreamMesh(handle, loader, false);
+
+	return handle;
 }
 
-void VulkanRenderer::CreateLogicalDevice()
+void VulkanRenderer::StreamMesh(MeshHandle handle, MeshLoadFunction loader, bool restream)
 {
-	//get the queue family indices for the chosen physical device
-	QueueFamilyIndicies indices = GetQueueFamilies(MainDevice.PhysicalDevice);
+	Jobs.Run("LoadMesh", [this, handle, loader, restream]()
+	{
+		MeshUpload upload;
+		upload.Handle = handle;
+		upload.bRestream = restream;
 
-	std::vector<VkDeviceQueueCreateInfo> queueCreateInfos;
-	//use a set for this to avoid accessing the same index twice
-	std::set<int32_t> queueFamilyIndices = { indices.GraphicsFamily, indices.PresentationFamily};
+		try
+		{
+			// decode
+			std::vector<Vertex> vertices;
+			std::vector<uint32_t> indices;
+			loader(vertices, indices);
+			if(vertices.empty() || indices.empty())
+			{
+				throw std::runtime_error("loaded mesh has no vertices or indices!");
+			}
 
-	for (int32_t queueFamilyIndex : queueFamilyIndices)
-	{
-		//queues the logical device needs to create
-		VkDeviceQueueCreateInfo queueCreateInfo = {};
-		queueCreateInfo.sType = VK_STRUCTURE_TYPE_DEVICE_QUEUE_CREATE_INFO;
-		queueCreateInfo.queueFamilyIndex = queueFamilyIndex;
-		queueCreateInfo.queueCount = 1;
-		float priority = 1.0f;
-		queueCreateInfo.pQueuePriorities = &priority;		//1 is highest priority
+			// create the buffers and stage the data. this only needs the device, which is thread safe.
+			// if it fails, the mesh has already destroyed whatever it created
+			upload.UploadedMesh = Mesh(MainDevice.PhysicalDevice, MainDevice.LogicalDevice, &vertices, &indices,
+				&upload.StagingBuffer, &upload.StagingBufferMemory, Allocator);
+		}
+		catch(const std::runtime_error &e)
+		{
+			printf("ERROR: %s\n", e.what());
 
-		queueCreateInfos.push_back(queueCreateInfo);
+			// an evicted mesh still has its node and is still in the draw list: it stays evicted,
+			// so the next residency pass tries again
+			std::lock_guard<std::mutex> lock(MeshUploadMutex);
+			MeshStates[handle] = restream ? MESH_STATE_EVICTED : MESH_STATE_FAILED;
+			return;
+		}
+
+		// the queue and command pool belong to the render thread, it records and submits the copy
+		std::lock_guard<std::mutex> lock(MeshUploadMutex);
+		StagedMeshUploads.push_back(upload);
+	}, &MeshLoadJobs);
+}
+
+MeshHandle VulkanRenderer::AddMesh(std::vector<Vertex>* vertices, std::vector<uint32_t>* indices)
+{
+	if(vertices->empty() || indices->empty())
+	{
+		throw std::runtime_error("mesh has no vertices or indices!");
 	}
 
-	//physical device features that the logical device will be using (e.g. geometry shader)
-	VkPhysicalDeviceFeatures features = {};
+	// staging doesn't touch the queue, so it doesn't have to wait for the frames in flight
+	MeshUpload upload;
+	upload.UploadedMesh = Mesh(MainDevice.PhysicalDevice, MainDevice.LogicalDevice, vertices, indices,
+		&upload.StagingBuffer, &upload.StagingBufferMemory, Allocator);
 
-	//information to create logical device (sometimes only called "device")
-	VkDeviceCreateInfo deviceCreateInfo = {};
-	deviceCreateInfo.sType = VK_STRUCTURE_TYPE_DEVICE_CREATE_INFO;
-	deviceCreateInfo.queueCreateInfoCount = static_cast<uint32_t>(queueCreateInfos.size());
-	deviceCreateInfo.pQueueCreateInfos = queueCreateInfos.data();
+	std::lock_guard<std::mutex> lock(MeshUploadMutex);
+	upload.Handle = static_cast<MeshHandle>(MeshStates.size());
+	MeshStates.push_back(MESH_STATE_LOADING);
+	StagedMeshUploads.push_back(upload);
 
-	//note that there is a difference between VkInstance Extensions and Vk(Logical)Device Extensions!
-	deviceCreateInfo.enabledExtensionCount = static_cast<uint32_t>(DeviceExtensions.size());
-	deviceCreateInfo.ppEnabledExtensionNames = DeviceExtensions.data();
-	deviceCreateInfo.pEnabledFeatures = &features;
+	return upload.Handle;
+}
 
-	//create logical device for the given physical device
-	//this implicitly also creates the queues which we can then fetch later with vkGetDeviceQueue
-	VkResult result = vkCreateDevice(MainDevice.PhysicalDevice, &deviceCreateInfo, nullptr, &MainDevice.LogicalDevice);
-	if (result != VK_SUCCESS)
+void VulkanRenderer::RemoveMesh(MeshHandle mesh)
+{
+	std::lock_guard<std::mutex> lock(MeshUploadMutex);
+	if(mesh >= MeshStates.size() || MeshStates[mesh] == MESH_STATE_REMOVED)
 	{
-		throw std::runtime_error("Failed to create a logical device!");
+		throw std::runtime_error("can't remove a mesh that doesn't exist!");
 	}
 
-	//VkCreateDevice also implicitly created the queue(s)
-	//we still need to get a handle for these
-	vkGetDeviceQueue(MainDevice.LogicalDevice, indices.GraphicsFamily, 0, &GraphicsQueue);
-	vkGetDeviceQueue(MainDevice.LogicalDevice, indices.PresentationFamily, 0, &PresentationQueue);
+	PendingMeshRemovals.push_back(mesh);
 }
 
-void VulkanRenderer::CreateSurface()
+MeshState VulkanRenderer::GetMeshState(MeshHandle mesh)
 {
-	//create surface:
-	//	glfw is creating a surface create info struct,
-	//	then runs the create surface function and returns result
-	VkResult result = glfwCreateWindowSurface(Instance, Window, nullptr, &Surface);
-
-	if (result != VK_SUCCESS)
+	std::lock_guard<std::mutex> lock(MeshUploadMutex);
+	if(mesh >= MeshStates.size())
 	{
-		throw std::runtime_error("Failed to create a surface!");
+		throw std::runtime_error("invalid mesh handle!");
 	}
+
+	return MeshStates[mesh];
 }
 
-void VulkanRenderer::CreateSwapChain()
+SceneNode VulkanRenderer::AddMeshInstance(MeshHandle mesh, const glm::mat4& transform, const glm::vec4& colour)
 {
-	// get swapchain details so we can pick best settings
-	SwapChainDetails swapChainDetails = GetSwapChainDetails(MainDevice.PhysicalDevice);
+	{
+		std::lock_guard<std::mutex> lock(MeshUploadMutex);
+		// until the mesh is ready it has no node of its own, and its instances couldn't be cleaned up if the load fails
+		if(mesh >= MeshStates.size() || (MeshStates[mesh] != MESH_STATE_READY && MeshStates[mesh] != MESH_STATE_EVICTED))
+		{
+			throw std::runtime_error("can't add an instance to a mesh that isn't ready!");
+		}
+	}
 
-	// find optimal values
-	VkSurfaceFormatKHR format = ChooseBestSurfaceFormat(swapChainDetails.SurfaceFormats);
-	VkPresentModeKHR mode = ChooseBestPresentationMode(swapChainDetails.PresentationModes);
-	VkExtent2D resolution = ChooseSwapChainExtent(swapChainDetails.SurfaceCapabilities);
+	SceneNode node = Scene.CreateNode(SceneRoot, transform);
+	AddInstance(mesh, node, colour);
 
-	// get num images in swap chain. get 1 more than min to allow triple buffering
-	uint32_t imageCount = swapChainDetails.SurfaceCapabilities.minImageCount + 1;
+	return node;
+}
 
-	if(swapChainDetails.SurfaceCapabilities.maxImageCount > 0
-		&& swapChainDetails.SurfaceCapabilities.maxImageCount < imageCount)
+void VulkanRenderer::SetMeshInstanceColour(SceneNode instance, const glm::vec4& colour)
+{
+	if(instance >= InstanceLocations.size() || InstanceLocations[instance].Index == UINT32_MAX)
 	{
-		imageCount = swapChainDetails.SurfaceCapabilities.maxImageCount;
+		throw std::runtime_error("scene node is not a mesh instance!");
 	}
 
-	//create swapchain
-	VkSwapchainCreateInfoKHR createInfo = {};
-	createInfo.sType = VK_STRUCTURE_TYPE_SWAPCHAIN_CREATE_INFO_KHR;
-	createInfo.surface = Surface;
-	createInfo.imageFormat = format.format;
-	createInfo.imageColorSpace = format.colorSpace;
-	createInfo.presentMode = mode;
-	createInfo.imageExtent = resolution;
-	createInfo.minImageCount = imageCount;
-	//number of layers for each image in chain
-	createInfo.imageArrayLayers = 1;
-	createInfo.imageUsage = VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT;
-	createInfo.preTransform = swapChainDetails.SurfaceCapabilities.currentTransform;
-	createInfo.compositeAlpha = VK_COMPOSITE_ALPHA_OPAQUE_BIT_KHR;
-	//whether to clip parts of image not in view (e.g. behind other window, off screen, ...)
-	createInfo.clipped = VK_TRUE;
+	const InstanceLocation& location = InstanceLocations[instance];
+	PackInstanceColour(colour, MeshInstances[location.Mesh][location.Index].Colour);
 
-	// get queue family indices
-	QueueFamilyIndicies indices = GetQueueFamilies(MainDevice.PhysicalDevice);
+	MarkInstancesChanged(location.Mesh);
+}
 
-	// if graphics and presentation families are different, then swapchain must
-	// images be shared between families
-	if(indices.GraphicsFamily != indices.PresentationFamily)
+void VulkanRenderer::RemoveMeshInstance(SceneNode instance)
+{
+	if(instance >= InstanceLocations.size() || InstanceLocations[instance].Index == UINT32_MAX)
 	{
-		//queues to share between
-		uint32_t queueFamilyIndices[] = {
-			(uint32_t) indices.GraphicsFamily,
-			(uint32_t) indices.PresentationFamily
-		};
-
-		createInfo.imageSharingMode = VK_SHARING_MODE_CONCURRENT;
-		createInfo.queueFamilyIndexCount = 2;
-		createInfo.pQueueFamilyIndices = queueFamilyIndices;
+		throw std::runtime_error("scene node is not a mesh instance!");
 	}
-	else
+
+	InstanceLocation location = InstanceLocations[instance];
+	if(MeshNodes.size() > location.Mesh && MeshNodes[location.Mesh] == instance)
 	{
-		createInfo.imageSharingMode = VK_SHARING_MODE_EXCLUSIVE;
-		//the next two don't have to be specified for this case,
-		//just doing it for clariy
-		createInfo.queueFamilyIndexCount = 0;
-		createInfo.pQueueFamilyIndices = nullptr;
+		throw std::runtime_error("the mesh's own node can only be removed with the mesh!");
 	}
 
-	// we could take over work/responsibilities from an older swap chain,
-	// useful e.g. when resizing the window, which means
-	// to destory the old swapchain and creatign a new one
-	createInfo.oldSwapchain = VK_NULL_HANDLE;
+	// the last instance takes the place of the removed one, the order within a mesh doesn't matter
+	std::vector<MeshInstance>& instances = MeshInstances[location.Mesh];
+	instances[location.Index] = instances.back();
+	InstanceLocations[instances[location.Index].Node].Index = location.Index;
+	instances.pop_back();
 
-	VkResult result = vkCreateSwapchainKHR(MainDevice.LogicalDevice, &createInfo, nullptr, &Swapchain);
-	if(result != VK_SUCCESS)
-	{
-		throw std::runtime_error("failed to create a swapchain!");
-	}
+	InstanceLocations[instance].Index = UINT32_MAX;
+	Scene.DestroyNode(instance);
 
-	//store for later reference
-	SwapchainImageFormat = format.format;
-	SwapchainResolution = resolution;
+	// the range keeps its capacity, only the instances and the count are written again
+	MarkInstancesChanged(location.Mesh);
+}
 
-	// get swapchain images
-	uint32_t swapchainImageCount;
-	vkGetSwapchainImagesKHR(MainDevice.LogicalDevice, Swapchain, &swapchainImageCount, nullptr);
+uint32_t VulkanRenderer::GetMeshInstanceCount(MeshHandle mesh) const
+{
+	return mesh < MeshInstances.size() ? static_cast<uint32_t>(MeshInstances[mesh].size()) : 0;
+}
 
-	std::vector<VkImage> images(swapchainImageCount);
-	vkGetSwapchainImagesKHR(MainDevice.LogicalDevice, Swapchain, &swapchainImageCount, images.data());
+bool VulkanRenderer::AcquireReadbackFrame(ReadbackFrame& frame)
+{
+	return Readback.IsEnabled() && Readback.Acquire(frame);
+}
 
-	for(VkImage image : images)
+void VulkanRenderer::SetMeshPriority(MeshHandle mesh, uint32_t priority)
+{
+	if(mesh >= MeshResidencies.size())
 	{
-		//store image handle (note that VkImage is just uint64_t, i.e. an index and we can just copy the value
-		SwapchainImage scImage = {};
-		scImage.Image = image;
-		scImage.ImageView = CreateImageView(image, SwapchainImageFormat, VK_IMAGE_ASPECT_COLOR_BIT);
-
-		SwapchainImages.push_back(scImage);
+		MeshResidencies.resize(mesh + 1);
 	}
+	MeshResidencies[mesh].Priority = priority;
 }
 
-void VulkanRenderer::CreateRenderPass()
+void VulkanRenderer::SetMemoryBudget(VkDeviceSize limit)
 {
-	// colour attachment of render pass
-	VkAttachmentDescription colourAttachment = {};
-	colourAttachment.format = SwapchainImageFormat;
-	// same as creating in the rasterizer mutlisampling
-	colourAttachment.samples = VK_SAMPLE_COUNT_1_BIT;
-	// what to do with the attachment before rendering
-	colourAttachment.loadOp = VK_ATTACHMENT_LOAD_OP_CLEAR;
-	// what to do with the attachment after rendering
-	colourAttachment.storeOp = VK_ATTACHMENT_STORE_OP_STORE;
-	colourAttachment.stencilLoadOp =  VK_ATTACHMENT_LOAD_OP_DONT_CARE;
-	colourAttachment.stencilStoreOp =  VK_ATTACHMENT_STORE_OP_DONT_CARE;
-
-	// framebuffer data will be stored as an image, but images can be given different data layouts
-	// to give optimal use for certain operations
-
-	// layout before render pass starts (the expected one, not the one to change to
-	//										--> conversion happens in subpass)
-	colourAttachment.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
-	// layout after render pass (the one to change to)
-	colourAttachment.finalLayout = VK_IMAGE_LAYOUT_PRESENT_SRC_KHR;
+	Memory.SetLimit(limit);
+	bReportedOverBudget = false;
+}
 
-	// attachment reference uses an attachment index
-	// that refers to index in the attachment list passed to renderPassCreateInfo
-	// (can be reused for other passes)
-	VkAttachmentReference colourAttachmentRef = {};
-	// index in the list
-	colourAttachmentRef.attachment = 0;
-	// the layout the colourAttachment.initialLayout is converted to
-	colourAttachmentRef.layout = VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL;
+const MemoryBudget& VulkanRenderer::GetMemoryBudget() const
+{
+	return Memory;
+}
 
-	// information about particular subpass the renderpass is using
-	VkSubpassDescription subpass = {};
-	// you can choose ray tracing here
-	subpass.pipelineBindPoint = VK_PIPELINE_BIND_POINT_GRAPHICS;
-	subpass.colorAttachmentCount = 1;
-	subpass.pColorAttachments = &colourAttachmentRef;
+const HostAllocator& VulkanRenderer::GetHostAllocator() const
+{
+	return HostMemory;
+}
 
-	// need to determine when layout transitions occurr using subpass dependencies
-	std::array<VkSubpassDependency, 2> subpassDependencies;
+const PipelineCompiler& VulkanRenderer::GetPipelineCompiler() const
+{
+	return Pipelines;
+}
 
-	// conversion from VK_IMAGE_LAYOUT_UNDEFINED to VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL
-	//			--- transition must happen after
-	subpassDependencies[0].srcSubpass = VK_SUBPASS_EXTERNAL;	//SUBPASS_EXTERNAL: special value meaning outside of render pass
-	// what stage in the pipeline has to happen before this can take place
-	subpassDependencies[0].srcStageMask = VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT;
-	subpassDependencies[0].srcAccessMask = VK_ACCESS_MEMORY_READ_BIT;
+const PipelineRegistry& VulkanRenderer::GetPipelineRegistry() const
+{
+	return GraphicsPipelines;
+}
 
-	//			--- transition must happen before
-	subpassDependencies[0].dstSubpass = 0;	//id of subpass
-	subpassDependencies[0].dstStageMask = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT;
-	subpassDependencies[0].dstAccessMask = VK_ACCESS_MEMORY_READ_BIT | VK_ACCESS_MEMORY_WRITE_BIT;
-	subpassDependencies[0].dependencyFlags = 0;
+void VulkanRenderer::EnableStartupReport()
+{
+	bStartupReport = true;
+}
 
-	subpassDependencies[1].srcSubpass = 0;
-	subpassDependencies[1].srcStageMask = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT;
-	subpassDependencies[1].srcAccessMask = VK_ACCESS_MEMORY_READ_BIT | VK_ACCESS_MEMORY_WRITE_BIT;
+const StartupProfiler& VulkanRenderer::GetStartupProfile() const
+{
+	return Startup;
+}
 
-	subpassDependencies[1].dstSubpass = VK_SUBPASS_EXTERNAL;
-	subpassDependencies[1].dstStageMask = VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT;
-	subpassDependencies[1].dstAccessMask = VK_ACCESS_MEMORY_READ_BIT;
-	subpassDependencies[1].dependencyFlags = 0;
+void VulkanRenderer::ReleaseReadbackFrame(const ReadbackFrame& frame)
+{
+	Readback.Release(frame);
+}
 
-	VkRenderPassCreateInfo renderPassCreateInfo = {};
-	renderPassCreateInfo.sType = VK_STRUCTURE_TYPE_RENDER_PASS_CREATE_INFO;
-	renderPassCreateInfo.attachmentCount = 1;
-	renderPassCreateInfo.pAttachments = &colourAttachment;
-	renderPassCreateInfo.subpassCount = 1;
-	renderPassCreateInfo.pSubpasses = &subpass;
-	renderPassCreateInfo.dependencyCount = static_cast<uint32_t>(subpassDependencies.size());
-	renderPassCreateInfo.pDependencies = subpassDependencies.data();
+void VulkanRenderer::StartCapture(const CaptureSettings& settings)
+{
+	Capture.Start(settings, &Readback);
+}
 
-	VkResult result = vkCreateRenderPass(MainDevice.LogicalDevice, &renderPassCreateInfo, nullptr, &RenderPass);
-	if(result != VK_SUCCESS)
-	{
-		throw std::runtime_error("failed to create a render pass!");
-	}
+void VulkanRenderer::StopCapture()
+{
+	Capture.Stop();
 }
 
-void VulkanRenderer::CreateDescriptorSetLayout()
+ComputeSystem& VulkanRenderer::GetCompute()
 {
-	// ModelViewProjection matrix Binding Info
-	VkDescriptorSetLayoutBinding mvpLayoutBinding = {};
-	// the binding used in the shader ( -> layout(binding = 0)... )
-	mvpLayoutBinding.binding = 0;
-	// type of the descriptor (data), like Uniform Buffer, Storage Buffer, Sampler, Input Attachment
-	mvpLayoutBinding.descriptorType = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER;
-	// we bind only 1 descriptor (which contains three matrices)
-	mvpLayoutBinding.descriptorCount = 1;
-	// shader stage to bind to
-	mvpLayoutBinding.stageFlags = VK_SHADER_STAGE_VERTEX_BIT;
-	// for texture samplers: the sampler becomes immutable (image view does not!) by specifying in layout
-	mvpLayoutBinding.pImmutableSamplers = nullptr;
+	return Compute;
+}
 
-	// Create Descriptor Set Layout with given bindings
-	VkDescriptorSetLayoutCreateInfo layoutCreateInfo = {};
-	layoutCreateInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO;
-	layoutCreateInfo.bindingCount = 1;
-	layoutCreateInfo.pBindings = &mvpLayoutBinding;
+void VulkanRenderer::EnableShaderHotReload()
+{
+	VkDevice device = MainDevice.LogicalDevice;
+	const VkAllocationCallbacks* allocator = Allocator;
+	ShaderReload.Start(&Jobs, Shaders.GetSourceDirectory(),
+		[this](const PipelineStateDesc& desc)
+		{
+			// every pipeline on its own, the bases are replaced in the same go
+			return CreateGraphicsPipeline(desc, VK_NULL_HANDLE);
+		},
+		[device, allocator](VkPipeline pipeline)
+		{
+			vkDestroyPipeline(device, pipeline, allocator);
+		});
+}
 
-	// Create Descriptor Set Layout
-	VkResult result = vkCreateDescriptorSetLayout(MainDevice.LogicalDevice, &layoutCreateInfo, nullptr, &DescriptorSetLayout);
-	if(result != VK_SUCCESS)
+void VulkanRenderer::SwapReloadedPipelines()
+{
+	if(!ShaderReload.IsRunning())
 	{
-		throw std::runtime_error("failed to create a descriptor set layout!");
+		return;
 	}
-}
 
-void VulkanRenderer::CreateGraphicsPipeline()
-{
-	auto vertexShaderCode = ReadShaderFile(GetShaderPath() / fs::path("vert.spv"));
-	auto fragmentShaderCode = ReadShaderFile(GetShaderPath() / fs::path("frag.spv"));
+	// a development feature, it starts jobs and hands over vectors
+	FrameAllocationAllowance allowance;
 
-	// build shader modules to link to graphics CreateGraphicsPipeline
-	// we don't need these after creating the pipeline, they can be destroyed at the end of this function
-	VkShaderModule vertexShaderModule = CreateShaderModule(vertexShaderCode);
-	VkShaderModule fragmentShaderModule = CreateShaderModule(fragmentShaderCode);
+	std::vector<ReloadedPipeline> reloaded;
+	bool bReloaded = ShaderReload.Poll([this]()
+	{
+		return GraphicsPipelines.GetDescs();
+	}, reloaded);
 
-	// -- Shader stage creation information
-	// vertex stage creation info
-	VkPipelineShaderStageCreateInfo vertexShaderCreateInfo = {};
+	if(!bReloaded)
 	{
-		vertexShaderCreateInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
-		vertexShaderCreateInfo.stage = VK_SHADER_STAGE_VERTEX_BIT;
-		vertexShaderCreateInfo.module = vertexShaderModule;
-		// function name for the function run first in the shader
-		// in OpenGL / glsl, the default is main, so keep with that
-		vertexShaderCreateInfo.pName = "main";
+		return;
 	}
 
-	// fragment stage  creation info
-	VkPipelineShaderStageCreateInfo fragmentShaderCreateInfo = {};
+	// frames in flight still use the old pipelines, so they are retired with this frame. variants still
+	// compiling may derive from them, those are retired once the variants are picked up
+	for(const ReloadedPipeline& pipeline : reloaded)
 	{
-		fragmentShaderCreateInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
-		fragmentShaderCreateInfo.stage = VK_SHADER_STAGE_FRAGMENT_BIT;
-		fragmentShaderCreateInfo.module = fragmentShaderModule;
-		fragmentShaderCreateInfo.pName = "main";
+		RetireReplacedPipeline(GraphicsPipelines.Insert(pipeline.Desc, pipeline.Pipeline));
 	}
 
-	// put shader stage creation infos into array
-	// graphics pipeline creation info requires array of shader stage creates
-	VkPipelineShaderStageCreateInfo shaderStages[] = {
-		vertexShaderCreateInfo, fragmentShaderCreateInfo
-	};
+	// the command buffers bind the pipelines, re-record them
+	DrawListVersion++;
 
-	// -- Vertex input
+	printf("reloaded shaders: %zu pipeline(s) rebuilt\n", reloaded.size());
+}
 
-	// how the data for single vertex (pos, colour, texCoords, ...) is as a whole
-	VkVertexInputBindingDescription bindingDescr = {};
-	bindingDescr.binding = 0;									// can bind multiple streams of data, this defines which one
-	bindingDescr.stride = sizeof(Vertex);						// size of single vertex object (i.e. all attributes!)
-	bindingDescr.inputRate = VK_VERTEX_INPUT_RATE_VERTEX;		// how to move between data after each vertex
-																// e.g. instancing can be done by send always using first vertex
-																// of each instance, then second vertex of each index and so forth
-																// (VK_VERTEX_INPUT_RATE_INSTANCE)
+void VulkanRenderer::ProcessCompiledPipelines()
+{
+	// nothing is allocated unless a pipeline finished
+	FrameAllocationAllowance allowance;
 
-	// definition of the individual attributes (i.e. pos is an attribute, colour is one, ...)
-	// within the vertex: size and position in struct
-	std::array<VkVertexInputAttributeDescription, 2> attributeDescriptions;
+	std::vector<CompiledPipeline> compiled;
+	if(!Pipelines.Poll(compiled))
+	{
+		return;
+	}
 
-	// position attribute
-	attributeDescriptions[0].binding = 0; 							// binding can be set in the shader as well,
-																	// but needs to match binding description binding
-																	// in the shader, layout(binding = 0, location = 0), but binding = 0 is default
-	attributeDescriptions[0].location = 0;
-	attributeDescriptions[0].format = VK_FORMAT_R32G32B32_SFLOAT;
-	attributeDescriptions[0].offset = offsetof(Vertex, Position);	// the stride to start reading in the struct
+	// the old bases nothing derives from anymore
+	for(size_t i = 0; i < RetiredBasePipelines.size();)
+	{
+		if(Pipelines.IsDeriving(RetiredBasePipelines[i]))
+		{
+			i++;
+			continue;
+		}
 
-	// colour attribute
-	attributeDescriptions[1].binding = 0;
-	attributeDescriptions[1].location = 1;
-	attributeDescriptions[1].format = VK_FORMAT_R32G32B32_SFLOAT;
-	attributeDescriptions[1].offset = offsetof(Vertex, Colour);
+		RetirePipeline(RetiredBasePipelines[i]);
+		RetiredBasePipelines[i] = RetiredBasePipelines.back();
+		RetiredBasePipelines.pop_back();
+	}
 
-	VkPipelineVertexInputStateCreateInfo vertInputCreateInfo = {};
+	bool bChanged = false;
+	for(const CompiledPipeline& pipeline : compiled)
 	{
-		vertInputCreateInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_VERTEX_INPUT_STATE_CREATE_INFO;
-		// list of vertex binding descriptions (data spacing / stride)
-		vertInputCreateInfo.vertexBindingDescriptionCount = 1;
-		vertInputCreateInfo.pVertexBindingDescriptions = &bindingDescr;
-		// list of vertex attribute descriptions (data format and where to bind to / from)
-		vertInputCreateInfo.vertexAttributeDescriptionCount = static_cast<uint32_t>(attributeDescriptions.size());
-		vertInputCreateInfo.pVertexAttributeDescriptions = attributeDescriptions.data();
+		// failed ones stay on the fallback. one that was built twice (e.g. by the shader reload meanwhile)
+		// replaces the other
+		if(pipeline.Pipeline != VK_NULL_HANDLE)
+		{
+			RetireReplacedPipeline(GraphicsPipelines.Insert(pipeline.Desc, pipeline.Pipeline));
+			bChanged = true;
+		}
 	}
 
-	// -- Input assembly
-	VkPipelineInputAssemblyStateCreateInfo inputAssemblyCreateInfo = {};
+	// the meshes drawn with the fallback switch to their own pipeline
+	if(bChanged)
 	{
-		inputAssemblyCreateInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_INPUT_ASSEMBLY_STATE_CREATE_INFO;
-		inputAssemblyCreateInfo.topology = VK_PRIMITIVE_TOPOLOGY_TRIANGLE_LIST;
-		// restart primitive is used for strips (rather than lists), to start a new strip at some point
-		inputAssemblyCreateInfo.primitiveRestartEnable = VK_FALSE;
+		DrawListVersion++;
 	}
+}
 
-	// -- Viewport and scissor
-	//	create a viewport info struct
-	VkViewport viewport = {};
+void VulkanRenderer::RetireReplacedPipeline(VkPipeline pipeline)
+{
+	if(pipeline == VK_NULL_HANDLE)
 	{
-		viewport.x = 0.0f;
-		viewport.y = 0.0f;
-		viewport.width = (float)SwapchainResolution.width;
-		viewport.height = (float)SwapchainResolution.height;
-		// framebuffer depth
-		viewport.minDepth = 0;
-		viewport.maxDepth = 1;
+		return;
 	}
 
-	// create a scissor info struct
-	VkRect2D scissor = {};
-	scissor.offset = {0, 0};
-	scissor.extent = SwapchainResolution;
-
-	VkPipelineViewportStateCreateInfo vpStateCreateInfo = {};
+	// variants still compiling may derive from it, it's retired once they are picked up
+	if(Pipelines.IsDeriving(pipeline))
 	{
-		vpStateCreateInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_VIEWPORT_STATE_CREATE_INFO;
-		vpStateCreateInfo.viewportCount = 1;
-		vpStateCreateInfo.pViewports = &viewport;
-		vpStateCreateInfo.scissorCount = 1;
-		vpStateCreateInfo.pScissors = &scissor;
+		RetiredBasePipelines.push_back(pipeline);
+	}
+	else
+	{
+		RetirePipeline(pipeline);
 	}
+}
 
-	// -- Dynamic states (not used here. if used, e.g. for resizing window, you still have to recreate the swapchain with new size!
+void VulkanRenderer::RetirePipeline(VkPipeline pipeline)
+{
+	VkDevice device = MainDevice.LogicalDevice;
+	const VkAllocationCallbacks* allocator = Allocator;
+	FrameDeletions.Push(SubmittedFrames, [device, allocator, pipeline]()
 	{
-		// dynamic states to enable
-		std::vector<VkDynamicState> dynamicStateEnables;
-		// dynamic vp - resize in command buffer with vkCmdSetViewport(cmdBuffer, viewportIndex, numViewports, array of viewports)
-		// 		e.g. vkCmdSetViewport(cmdBuffer, 0, 1, &viewport);
-		dynamicStateEnables.push_back(VK_DYNAMIC_STATE_VIEWPORT);
-		// same as vp: vkCmdSetScissor
-		dynamicStateEnables.push_back(VK_DYNAMIC_STATE_SCISSOR);
+		vkDestroyPipeline(device, pipeline, allocator);
+	});
+}
 
-		// dynamic state creation info
-		VkPipelineDynamicStateCreateInfo dynamicStateCreateInfo = {};
-		dynamicStateCreateInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_DYNAMIC_STATE_CREATE_INFO;
-		dynamicStateCreateInfo.dynamicStateCount = static_cast<uint32_t>(dynamicStateEnables.size());
-		dynamicStateCreateInfo.pDynamicStates = dynamicStateEnables.data();
+int32_t VulkanRenderer::EnableParticles(const ParticleSettings& settings)
+{
+	try
+	{
+		Particles.Create(Compute, Shaders, MainDevice.PhysicalDevice, MainDevice.LogicalDevice, GraphicsQueue, GraphicsCommandPool,
+			RenderPass, bDynamicRendering ? &PipelineRenderingInfo : nullptr, MsaaSamples, SwapchainResolution, ViewUniformBuffer, settings, Allocator);
+	}
+	catch (const std::runtime_error &e)
+	{
+		printf("ERROR: %s\n", e.what());
+		return EXIT_FAILURE;
 	}
 
-	// - Rasterizer
-	VkPipelineRasterizationStateCreateInfo rasterizerCreateInfo = {};
+	return 0;
+}
+
+ParticleSystem& VulkanRenderer::GetParticles()
+{
+	return Particles;
+}
+
+const FrameCapture& VulkanRenderer::GetFrameCapture() const
+{
+	return Capture;
+}
+
+const FrameReadback& VulkanRenderer::GetFrameReadback() const
+{
+	return Readback;
+}
+
+void VulkanRenderer::Draw()
+{
+	// 1. Get next available image to draw to and set something to signal
+	//		when we're finished with the image (-> semaphore)
+	// 2. Submit command buffer to queue for execution,
+	//		making sure it waits for the image to be signalled as available before drawing
+	//		and signals when it has finished rendering
+	// 3. Present image to screen when it has signalled finished recording
+
+	// in steady state, a frame doesn't touch the heap (only checked with FRAME_ALLOCATION_CHECK)
+	FrameAllocationScope allocationScope;
+
+	// command scope allocations of the last frame's vulkan calls are all freed by now
+	HostMemory.BeginFrame();
+
+	// waiting for, but not closing fence!
+	vkWaitForFences(MainDevice.LogicalDevice, 1, &DrawFences[CurrentFrame], VK_TRUE, std::numeric_limits<uint64_t>::max());
+
+	// whatever the frame allocated from its arena when it was drawn last is done with
+	FrameArenas[CurrentFrame].Reset();
+
+	// every frame submitted MAX_FRAME_DRAWS frames ago (and before) has finished now,
+	// so the resources they were the last ones to use can be destroyed
+	if(SubmittedFrames >= MAX_FRAME_DRAWS)
 	{
-		rasterizerCreateInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_RASTERIZATION_STATE_CREATE_INFO;
-		// whether to clip past far plane (TRUE, default) or clip into farplane (FALSE)
-		rasterizerCreateInfo.depthClampEnable = VK_FALSE;
-		// whether to discard data and skip rasterizer (never creates fragments)
-		rasterizerCreateInfo.rasterizerDiscardEnable = VK_FALSE;
-		rasterizerCreateInfo.polygonMode = VK_POLYGON_MODE_FILL;
-		rasterizerCreateInfo.lineWidth = 1.0f;		//values != 1 need extension
-		rasterizerCreateInfo.cullMode = VK_CULL_MODE_BACK_BIT;
-		rasterizerCreateInfo.frontFace = VK_FRONT_FACE_COUNTER_CLOCKWISE;
-		rasterizerCreateInfo.depthBiasEnable = VK_FALSE;
+		FrameDeletions.Flush(SubmittedFrames - MAX_FRAME_DRAWS + 1);
 	}
 
-	// -- Multisampling (disabled for now)
-	VkPipelineMultisampleStateCreateInfo multisampleCreateInfo = {};
+	// hand finished readback frames to the capture encoders (their queue allocates)
 	{
-		multisampleCreateInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_MULTISAMPLE_STATE_CREATE_INFO;
-		multisampleCreateInfo.sampleShadingEnable = VK_FALSE;
-		// number of samples to use per fragment (not necessary when disabled)
-		multisampleCreateInfo.rasterizationSamples = VK_SAMPLE_COUNT_1_BIT;
+		FrameAllocationAllowance allowance;
+		Capture.Poll();
 	}
 
-	// -- Blending
-	// blend attachment state
-	VkPipelineColorBlendAttachmentState colourBlendState = {};
+	// pipelines rebuilt from changed shaders replace the old ones before recording,
+	// newly built ones replace the fallback
+	SwapReloadedPipelines();
+	ProcessCompiledPipelines();
+
+	// meshes that finished uploading join the draw list before it is recorded, removed ones leave it
+	ProcessMeshUploads();
+	ProcessMeshRemovals();
+	UpdateMeshResidency();
+
+	// instances outgrew their range, before the command buffer is checked for re-recording
+	if(bInstanceRangeOverflowed)
 	{
-		// channels on which to blend
-		colourBlendState.colorWriteMask = VK_COLOR_COMPONENT_R_BIT | VK_COLOR_COMPONENT_G_BIT
-			| VK_COLOR_COMPONENT_B_BIT | VK_COLOR_COMPONENT_A_BIT;
-		colourBlendState.blendEnable = VK_TRUE;
+		LayoutInstances();
+	}
 
-		// blending uses equation: (srcColorBlendFactor * new colour) colorBlendOp (dstColorBlendFactor * old colour)
-		colourBlendState.srcColorBlendFactor = VK_BLEND_FACTOR_SRC_ALPHA;
-		colourBlendState.dstAlphaBlendFactor = VK_BLEND_FACTOR_ONE_MINUS_SRC_ALPHA;
-		colourBlendState.colorBlendOp = VK_BLEND_OP_ADD;
+	// - Get next image (index)
+	uint32_t imageIndex = 0;
+	// signal ImageAvailable, when done
+	vkAcquireNextImageKHR(MainDevice.LogicalDevice, Swapchain, std::numeric_limits<uint64_t>::max(), ImagesAvailable[CurrentFrame], VK_NULL_HANDLE, &imageIndex);
 
-		//summarised: VK_BLEND_FACTOR_SRC_ALPHA * new colour + (VK_BLEND_FACTOR_ONE_MINUS_SRC_ALPHA * old colour)
-		//				(new colour alpha * new colour) + ((1 - new colour alpha) * old colour)
+	// images aren't necessarily acquired round robin, so the image's command buffer
+	// may still be in use by another frame. wait for that one before touching it
+	if(ImagesInFlight[imageIndex] != VK_NULL_HANDLE && ImagesInFlight[imageIndex] != DrawFences[CurrentFrame])
+	{
+		vkWaitForFences(MainDevice.LogicalDevice, 1, &ImagesInFlight[imageIndex], VK_TRUE, std::numeric_limits<uint64_t>::max());
+	}
+	ImagesInFlight[imageIndex] = DrawFences[CurrentFrame];
 
-		colourBlendState.srcAlphaBlendFactor = VK_BLEND_FACTOR_ONE;
-		colourBlendState.dstAlphaBlendFactor = VK_BLEND_FACTOR_ZERO;
-		colourBlendState.alphaBlendOp = VK_BLEND_OP_ADD;
+	// actually close fence
+	vkResetFences(MainDevice.LogicalDevice, 1, &DrawFences[CurrentFrame]);
 
-		//summarised: (1 * new alpha) + (0 * old alpha) = new alpha
+	// re-record the command buffer, if the draw list or the compute dispatches changed since it was recorded last
+	if(CommandBufferVersions[imageIndex] != DrawListVersion + Compute.GetVersion())
+	{
+		RecordCommandBuffer(imageIndex);
 	}
 
-	VkPipelineColorBlendStateCreateInfo colourBlendCreateInfo = {};
+	// update the uniform buffer memory
+	UpdateUniformBuffer(imageIndex);
+	UpdateInstanceBuffer(imageIndex);
+	if(Particles.IsEnabled())
 	{
-		colourBlendCreateInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_COLOR_BLEND_STATE_CREATE_INFO;
-		// alternative to calculations is to use logical oerpations
-		colourBlendCreateInfo.logicOpEnable = VK_FALSE;
-		colourBlendCreateInfo.attachmentCount = 1;
-		colourBlendCreateInfo.pAttachments = &colourBlendState;
+		Particles.Update(imageIndex);
 	}
 
-	// -- Pipeline layout
-	VkPipelineLayoutCreateInfo pipelineLayoutCreateInfo = {};
+	// - Submit cmd buffer to render (this is the actual drawing! but not presented to screen yet)
+	VkSubmitInfo submitInfo = {};
+	submitInfo.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
+	submitInfo.waitSemaphoreCount = 1;
+	submitInfo.pWaitSemaphores = &ImagesAvailable[CurrentFrame];
+	// the pipeline will continue execution until the fragment shader, before it waits for the ImageAvailable
+	// (rather than waiting at this point immediately
+	// --> stages to check semaphores at
+	VkPipelineStageFlags waitStages[] = {
+		VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT
+	};
+	submitInfo.pWaitDstStageMask = waitStages;
+	//don't submit all cmd buffers at once, since we want to use one per draw call (-> triple buffering)
+	submitInfo.commandBufferCount = 1;
+	submitInfo.pCommandBuffers = &CommandBuffers[imageIndex];
+	// number of semaphores to signale when cmd buffer finished
+	submitInfo.signalSemaphoreCount = 1;
+	submitInfo.pSignalSemaphores = &RendersFinished[CurrentFrame];
+
+	// copy the frame back to host memory right behind the draw commands
+	// it is submitted separately, so that it gets a fence of its own the cpu can check (the readback slot's)
+	VkCommandBuffer readbackCommandBuffer = VK_NULL_HANDLE;
+	VkFence readbackFence = VK_NULL_HANDLE;
+	if(Readback.IsEnabled())
+	{
+		readbackCommandBuffer = Readback.RecordCopy(SwapchainImages[imageIndex].Image, SubmittedFrames, &readbackFence);
+	}
+	if(readbackCommandBuffer != VK_NULL_HANDLE)
 	{
-		pipelineLayoutCreateInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
-		pipelineLayoutCreateInfo.setLayoutCount = 1;
-		pipelineLayoutCreateInfo.pSetLayouts = &DescriptorSetLayout;
-		pipelineLayoutCreateInfo.pushConstantRangeCount = 0;
-		pipelineLayoutCreateInfo.pPushConstantRanges = nullptr;
+		// presenting has to wait for the copy instead
+		submitInfo.signalSemaphoreCount = 0;
+		submitInfo.pSignalSemaphores = nullptr;
 	}
 
-	// create pipeline layout
-	VkResult result = vkCreatePipelineLayout(MainDevice.LogicalDevice, &pipelineLayoutCreateInfo, nullptr, &PipelineLayout);
+	// fence -> when it has finished drawing, signal(/open) the fence
+	VkResult result = vkQueueSubmit(GraphicsQueue, 1, &submitInfo, DrawFences[CurrentFrame]);
 	if(result != VK_SUCCESS)
 	{
-		throw std::runtime_error("failed to create pipeline layout!");
+		throw std::runtime_error("failed to submit cmd buffer to queue!");
 	}
 
-	// -- Depth stencil testing
-	//TODO: setup depth stencil testing
-
-	// -- Graphics pipeline creation
-	VkGraphicsPipelineCreateInfo pipelineCreateInfo = {};
+	if(readbackCommandBuffer != VK_NULL_HANDLE)
 	{
-		pipelineCreateInfo.sType = VK_STRUCTURE_TYPE_GRAPHICS_PIPELINE_CREATE_INFO;
-		pipelineCreateInfo.stageCount = 2;	//number of shader stages
-		pipelineCreateInfo.pStages = shaderStages;
-		pipelineCreateInfo.pVertexInputState = &vertInputCreateInfo;
-		pipelineCreateInfo.pInputAssemblyState = &inputAssemblyCreateInfo;
-		pipelineCreateInfo.pViewportState = &vpStateCreateInfo;
-		pipelineCreateInfo.pDynamicState = nullptr;
-		pipelineCreateInfo.pRasterizationState = &rasterizerCreateInfo;
-		pipelineCreateInfo.pMultisampleState = &multisampleCreateInfo;
-		pipelineCreateInfo.pColorBlendState = &colourBlendCreateInfo;
-		pipelineCreateInfo.pDepthStencilState = nullptr;
-		pipelineCreateInfo.layout = PipelineLayout;
-		pipelineCreateInfo.renderPass = RenderPass;
-		pipelineCreateInfo.subpass = 0;		//index of subpass of render pass to use with pipeline
+		// same queue, so it runs after the draw commands (the barriers in it take care of the rest)
+		VkSubmitInfo readbackSubmitInfo = {};
+		readbackSubmitInfo.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
+		readbackSubmitInfo.commandBufferCount = 1;
+		readbackSubmitInfo.pCommandBuffers = &readbackCommandBuffer;
+		readbackSubmitInfo.signalSemaphoreCount = 1;
+		readbackSubmitInfo.pSignalSemaphores = &RendersFinished[CurrentFrame];
 
-		// pipeline derivatives
-		// for shared settings usage
-		pipelineCreateInfo.basePipelineHandle = VK_NULL_HANDLE;		//existing pipeline to derive from
-		pipelineCreateInfo.basePipelineIndex = -1;					//or index of pipeline being created to derive from
+		result = vkQueueSubmit(GraphicsQueue, 1, &readbackSubmitInfo, readbackFence);
+		if(result != VK_SUCCESS)
+		{
+			throw std::runtime_error("failed to submit readback cmd buffer to queue!");
+		}
 	}
 
-	result = vkCreateGraphicsPipelines(MainDevice.LogicalDevice, VK_NULL_HANDLE, 1, &pipelineCreateInfo, nullptr, &GraphicsPipeline);
+	// - Present rendered image to screen
+	VkPresentInfoKHR presentInfo = {};
+	presentInfo.sType = VK_STRUCTURE_TYPE_PRESENT_INFO_KHR;
+	presentInfo.waitSemaphoreCount = 1;
+	presentInfo.pWaitSemaphores = &RendersFinished[CurrentFrame];
+	// number of swapchains to present to
+	presentInfo.swapchainCount = 1;
+	presentInfo.pSwapchains = &Swapchain;
+	presentInfo.pImageIndices = &imageIndex;
+
+	result = vkQueuePresentKHR(GraphicsQueue, &presentInfo);
 	if(result != VK_SUCCESS)
 	{
-		throw std::runtime_error("failed to create graphics pipeline!");
+		throw std::runtime_error("failed to present image!");
+	}
+
+	// time to first frame ends with its present
+	if(SubmittedFrames == 0)
+	{
+		Startup.Finish();
+		if(bStartupReport)
+		{
+			FrameAllocationAllowance allowance;
+			Startup.Print();
+		}
+	}
+
+	// get next frame (not image!)
+	CurrentFrame = (CurrentFrame + 1) % MAX_FRAME_DRAWS;
+	SubmittedFrames++;
+}
+
+void VulkanRenderer::CleanUp()
+{
+	// no more uploads may be staged while we clean up
+	Jobs.Wait(MeshLoadJobs);
+	// nor pipelines be rebuilt
+	ShaderReload.Stop();
+	Pipelines.Destroy();
+
+	// wait until no actions are being run on device before destroying
+	vkDeviceWaitIdle(MainDevice.LogicalDevice);
+
+	DestroyDrawCommandBuffers();
+	// the compile jobs are done
+	for(VkPipeline pipeline : RetiredBasePipelines)
+	{
+		RetirePipeline(pipeline);
+	}
+	RetiredBasePipelines.clear();
+	FrameDeletions.FlushAll();
+	// the encoders give their readback slots back when they're done
+	Capture.Stop();
+	Readback.Destroy();
+	Particles.Destroy();
+	Compute.Destroy();
+
+	for(MeshUpload& upload : StagedMeshUploads)
+	{
+		DestroyMeshUpload(upload);
+		upload.UploadedMesh.DestroyBuffers();
+	}
+	for(MeshUpload& upload : SubmittedMeshUploads)
+	{
+		DestroyMeshUpload(upload);
+		upload.UploadedMesh.DestroyBuffers();
+	}
+
+	for(DescriptorUpdateTemplate& descriptorTemplate : DescriptorTemplates)
+	{
+		descriptorTemplate.Destroy();
+	}
+	Descriptors.Destroy();
+	for(size_t i = 0; i < MeshList.size(); i++)
+	{
+		if(MeshList[i].IsValid())
+		{
+			MeshList[i].DestroyBuffers();
+		}
+	}
+
+	for(uint32_t i = 0; i < MAX_FRAME_DRAWS; i++)
+	{
+		vkDestroyFence(MainDevice.LogicalDevice, DrawFences[i], Allocator);
+		vkDestroySemaphore(MainDevice.LogicalDevice, RendersFinished[i], Allocator);
+		vkDestroySemaphore(MainDevice.LogicalDevice, ImagesAvailable[i], Allocator);
+	}
+	vkDestroyCommandPool(MainDevice.LogicalDevice, GraphicsCommandPool, Allocator);
+	for(auto fb : SwapchainFramebuffers)
+	{
+		vkDestroyFramebuffer(MainDevice.LogicalDevice, fb, Allocator);
+	}
+	vkDestroyImageView(MainDevice.LogicalDevice, DepthImageView, Allocator);
+	vkDestroyImage(MainDevice.LogicalDevice, DepthImage, Allocator);
+	vkFreeMemory(MainDevice.LogicalDevice, DepthImageMemory, Allocator);
+	if(ColourImage != VK_NULL_HANDLE)
+	{
+		vkDestroyImageView(MainDevice.LogicalDevice, ColourImageView, Allocator);
+		vkDestroyImage(MainDevice.LogicalDevice, ColourImage, Allocator);
+		vkFreeMemory(MainDevice.LogicalDevice, ColourImageMemory, Allocator);
+	}
+	DescriptorLayouts.Destroy();
+	for(size_t i = 0; i < FrameUniformBuffer.size(); i++)
+	{
+		vkUnmapMemory(MainDevice.LogicalDevice, FrameUniformBufferMemory[i]);
+		vkDestroyBuffer(MainDevice.LogicalDevice, FrameUniformBuffer[i], Allocator);
+		vkFreeMemory(MainDevice.LogicalDevice, FrameUniformBufferMemory[i], Allocator);
+	}
+	for(size_t i = 0; i < ViewUniformBuffer.size(); i++)
+	{
+		vkUnmapMemory(MainDevice.LogicalDevice, ViewUniformBufferMemory[i]);
+		vkDestroyBuffer(MainDevice.LogicalDevice, ViewUniformBuffer[i], Allocator);
+		vkFreeMemory(MainDevice.LogicalDevice, ViewUniformBufferMemory[i], Allocator);
+	}
+	for(size_t i = 0; i < InstanceBuffer.size(); i++)
+	{
+		vkUnmapMemory(MainDevice.LogicalDevice, InstanceBufferMemory[i]);
+		vkDestroyBuffer(MainDevice.LogicalDevice, InstanceBuffer[i], Allocator);
+		vkFreeMemory(MainDevice.LogicalDevice, InstanceBufferMemory[i], Allocator);
+	}
+	for(size_t i = 0; i < ObjectBuffer.size(); i++)
+	{
+		vkUnmapMemory(MainDevice.LogicalDevice, ObjectBufferMemory[i]);
+		vkDestroyBuffer(MainDevice.LogicalDevice, ObjectBuffer[i], Allocator);
+		vkFreeMemory(MainDevice.LogicalDevice, ObjectBufferMemory[i], Allocator);
+	}
+	GraphicsPipelines.Destroy();
+	vkDestroyRenderPass(MainDevice.LogicalDevice, RenderPass, Allocator);
+	for(SwapchainImage image : SwapchainImages)
+	{
+		vkDestroyImageView(MainDevice.LogicalDevice, image.ImageView, Allocator);
+	}
+	vkDestroySwapchainKHR(MainDevice.LogicalDevice, Swapchain, Allocator);
+	vkDestroySurfaceKHR(Instance, Surface, Allocator);
+	vkDestroyDevice(MainDevice.LogicalDevice, Allocator);
+	if(bEnableValidationLayers)
+	{
+		DestroyDebugUtilsMessenger(Instance, DebugMessenger, Allocator);
+	}
+	vkDestroyInstance(Instance, Allocator);
+
+	Shaders.CleanUp();
+	Jobs.CleanUp();
+}
+
+void VulkanRenderer::CreateInstance()
+{
+	//enable validation layers
+	if(bEnableValidationLayers && ! CheckValidationLayerSupport())
+	{
+		throw std::runtime_error("validation layers requested, but not available");
+	}
+	else if (bEnableValidationLayers)
+	{
+		std::cout << "Validation layers are enabled!" << std::endl;
+	}
+
+	//information about the application itself
+	//most data here doesn't affect the program and is for developer convenience
+	VkApplicationInfo appInfo = {};
+	appInfo.sType = VK_STRUCTURE_TYPE_APPLICATION_INFO;
+	appInfo.pApplicationName = "Vulkan Tutorial App";
+	appInfo.applicationVersion = VK_MAKE_VERSION(0, 1, 0);
+	appInfo.engineVersion = VK_MAKE_VERSION(0, 1, 0);
+	appInfo.pEngineName = "No Engine";
+	//the previous info is just for the developer
+	//the apiInfo relates to the Vulkan API Version though, this can affect the program!
+	//ask for what the loader has, up to 1.3 (for dynamic rendering), 1.0 loaders reject anything above 1.0
+	auto enumerateInstanceVersion = (PFN_vkEnumerateInstanceVersion) vkGetInstanceProcAddr(nullptr, "vkEnumerateInstanceVersion");
+	InstanceApiVersion = VK_API_VERSION_1_0;
+	if(enumerateInstanceVersion != nullptr)
+	{
+		enumerateInstanceVersion(&InstanceApiVersion);
 	}
+	appInfo.apiVersion = VK_MAKE_API_VERSION(0, 1, std::min(VK_API_VERSION_MINOR(InstanceApiVersion), 3u), 0);
+
+	//creation information for a VkInstance
+	VkInstanceCreateInfo createInfo = {};
+	createInfo.sType = VK_STRUCTURE_TYPE_INSTANCE_CREATE_INFO;
+	createInfo.pApplicationInfo = &appInfo;
+
+	//create list to hold instance extensions
+	std::vector<const char*> instanceExtensions = GetRequiredExtensions();
+
+	//check instance extensions are supported
+	if (!CheckInstanceExtensionSupport(&instanceExtensions))
+	{
+		throw std::runtime_error("VkInstance does not support required extensions!");
+	}
+
+	createInfo.enabledExtensionCount = static_cast<uint32_t>(instanceExtensions.size());
+	createInfo.ppEnabledExtensionNames = instanceExtensions.data();
+
+	//if no validation layers:
+	createInfo.enabledLayerCount = 0;
+	createInfo.ppEnabledLayerNames = nullptr;
+	createInfo.pNext = nullptr;
+
+	//enable validation layers for the actual instance creation
+	//	(i.e. this is separate from the rest of the validation layer cheks with the DebugMessenger)
+	VkDebugUtilsMessengerCreateInfoEXT debugCreateInfo{};
+	if(bEnableValidationLayers)
+	{
+		createInfo.enabledLayerCount = static_cast<uint32_t>(validationLayers.size());
+		createInfo.ppEnabledLayerNames = validationLayers.data();
+
+		VulkanRenderer::PopulateDebugMessengerCreateInfo(debugCreateInfo);
+		createInfo.pNext = (VkDebugUtilsMessengerCreateInfoEXT*)&debugCreateInfo;
+	}
+
+	//create the actual VkInstance
+	VkResult result = vkCreateInstance(&createInfo, Allocator, &Instance);
+	if (result != VK_SUCCESS)
+	{
+		throw std::runtime_error("Failed to create a Vulkan instance!");
+	}
+}
+
+void VulkanRenderer::CreateLogicalDevice()
+{
+	//get the queue family indices for the chosen physical device
+	QueueFamilyIndicies indices = GetQueueFamilies(MainDevice.PhysicalDevice);
+
+	std::vector<VkDeviceQueueCreateInfo> queueCreateInfos;
+	//use a set for this to avoid accessing the same index twice
+	std::set<int32_t> queueFamilyIndices = { indices.GraphicsFamily, indices.PresentationFamily};
+
+	for (int32_t queueFamilyIndex : queueFamilyIndices)
+	{
+		//queues the logical device needs to create
+		VkDeviceQueueCreateInfo queueCreateInfo = {};
+		queueCreateInfo.sType = VK_STRUCTURE_TYPE_DEVICE_QUEUE_CREATE_INFO;
+		queueCreateInfo.queueFamilyIndex = queueFamilyIndex;
+		queueCreateInfo.queueCount = 1;
+		float priority = 1.0f;
+		queueCreateInfo.pQueuePriorities = &priority;		//1 is highest priority
+
+		queueCreateInfos.push_back(queueCreateInfo);
+	}
+
+	//physical device features that the logical device will be using (e.g. geometry shader)
+	VkPhysicalDeviceFeatures features = {};
+
+	//information to create logical device (sometimes only called "device")
+	VkDeviceCreateInfo deviceCreateInfo = {};
+	deviceCreateInfo.sType = VK_STRUCTURE_TYPE_DEVICE_CREATE_INFO;
+	deviceCreateInfo.queueCreateInfoCount = static_cast<uint32_t>(queueCreateInfos.size());
+	deviceCreateInfo.pQueueCreateInfos = queueCreateInfos.data();
+
+	//note that there is a difference between VkInstance Extensions and Vk(Logical)Device Extensions!
+	std::vector<const char*> extensions = DeviceExtensions;
+	if(bMemoryBudgetExtension)
+	{
+		extensions.push_back(VK_EXT_MEMORY_BUDGET_EXTENSION_NAME);
+	}
+	if(bDynamicRenderingExtension)
+	{
+		extensions.push_back(VK_KHR_DYNAMIC_RENDERING_EXTENSION_NAME);
+	}
+	deviceCreateInfo.enabledExtensionCount = static_cast<uint32_t>(extensions.size());
+	deviceCreateInfo.ppEnabledExtensionNames = extensions.data();
+	deviceCreateInfo.pEnabledFeatures = &features;
+
+	//features beyond vulkan 1.0 are switched on through the pNext chain
+	VkPhysicalDeviceDynamicRenderingFeatures dynamicRenderingFeatures = {};
+	dynamicRenderingFeatures.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_DYNAMIC_RENDERING_FEATURES;
+	dynamicRenderingFeatures.dynamicRendering = VK_TRUE;
+	if(bDynamicRendering)
+	{
+		deviceCreateInfo.pNext = &dynamicRenderingFeatures;
+	}
+
+	//create logical device for the given physical device
+	//this implicitly also creates the queues which we can then fetch later with vkGetDeviceQueue
+	VkResult result = vkCreateDevice(MainDevice.PhysicalDevice, &deviceCreateInfo, Allocator, &MainDevice.LogicalDevice);
+	if (result != VK_SUCCESS)
+	{
+		throw std::runtime_error("Failed to create a logical device!");
+	}
+
+	//VkCreateDevice also implicitly created the queue(s)
+	//we still need to get a handle for these
+	vkGetDeviceQueue(MainDevice.LogicalDevice, indices.GraphicsFamily, 0, &GraphicsQueue);
+	vkGetDeviceQueue(MainDevice.LogicalDevice, indices.PresentationFamily, 0, &PresentationQueue);
+
+	if(bDynamicRendering)
+	{
+		//the extension only exposes the KHR names, 1.3 devices have the core ones
+		CmdBeginRendering = (PFN_vkCmdBeginRenderingKHR) vkGetDeviceProcAddr(MainDevice.LogicalDevice,
+			bDynamicRenderingExtension ? "vkCmdBeginRenderingKHR" : "vkCmdBeginRendering");
+		CmdEndRendering = (PFN_vkCmdEndRenderingKHR) vkGetDeviceProcAddr(MainDevice.LogicalDevice,
+			bDynamicRenderingExtension ? "vkCmdEndRenderingKHR" : "vkCmdEndRendering");
+		if(CmdBeginRendering == nullptr || CmdEndRendering == nullptr)
+		{
+			throw std::runtime_error("failed to load the dynamic rendering functions!");
+		}
+	}
+}
+
+void VulkanRenderer::CreateSurface()
+{
+	//create surface:
+	//	glfw is creating a surface create info struct,
+	//	then runs the create surface function and returns result
+	VkResult result = glfwCreateWindowSurface(Instance, Window, Allocator, &Surface);
+
+	if (result != VK_SUCCESS)
+	{
+		throw std::runtime_error("Failed to create a surface!");
+	}
+}
+
+void VulkanRenderer::ChooseSwapChainSettings()
+{
+	// get swapchain details so we can pick best settings
+	SwapChainDetails swapChainDetails = GetSwapChainDetails(MainDevice.PhysicalDevice);
+
+	// find optimal values
+	SwapchainSettings.SurfaceFormat = ChooseBestSurfaceFormat(swapChainDetails.SurfaceFormats);
+	SwapchainSettings.PresentMode = ChooseBestPresentationMode(swapChainDetails.PresentationModes);
+	SwapchainSettings.SurfaceCapabilities = swapChainDetails.SurfaceCapabilities;
+
+	// get num images in swap chain. get 1 more than min to allow triple buffering
+	SwapchainSettings.ImageCount = swapChainDetails.SurfaceCapabilities.minImageCount + 1;
+
+	if(swapChainDetails.SurfaceCapabilities.maxImageCount > 0
+		&& swapChainDetails.SurfaceCapabilities.maxImageCount < SwapchainSettings.ImageCount)
+	{
+		SwapchainSettings.ImageCount = swapChainDetails.SurfaceCapabilities.maxImageCount;
+	}
+
+	//store for later reference
+	SwapchainImageFormat = SwapchainSettings.SurfaceFormat.format;
+	SwapchainResolution = ChooseSwapChainExtent(swapChainDetails.SurfaceCapabilities);
+}
+
+void VulkanRenderer::CreateSwapChain()
+{
+	const VkSurfaceFormatKHR& format = SwapchainSettings.SurfaceFormat;
+
+	//create swapchain
+	VkSwapchainCreateInfoKHR createInfo = {};
+	createInfo.sType = VK_STRUCTURE_TYPE_SWAPCHAIN_CREATE_INFO_KHR;
+	createInfo.surface = Surface;
+	createInfo.imageFormat = format.format;
+	createInfo.imageColorSpace = format.colorSpace;
+	createInfo.presentMode = SwapchainSettings.PresentMode;
+	createInfo.imageExtent = SwapchainResolution;
+	createInfo.minImageCount = SwapchainSettings.ImageCount;
+	//number of layers for each image in chain
+	createInfo.imageArrayLayers = 1;
+	createInfo.imageUsage = VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT;
+	// readback copies out of the swapchain images
+	if(ReadbackFrameCount > 0)
+	{
+		if(!(SwapchainSettings.SurfaceCapabilities.supportedUsageFlags & VK_IMAGE_USAGE_TRANSFER_SRC_BIT))
+		{
+			throw std::runtime_error("swapchain images can't be copied from, frame readback is not supported!");
+		}
+		createInfo.imageUsage |= VK_IMAGE_USAGE_TRANSFER_SRC_BIT;
+	}
+	createInfo.preTransform = SwapchainSettings.SurfaceCapabilities.currentTransform;
+	createInfo.compositeAlpha = VK_COMPOSITE_ALPHA_OPAQUE_BIT_KHR;
+	//whether to clip parts of image not in view (e.g. behind other window, off screen, ...)
+	createInfo.clipped = VK_TRUE;
+
+	// get queue family indices
+	QueueFamilyIndicies indices = GetQueueFamilies(MainDevice.PhysicalDevice);
+
+	// if graphics and presentation families are different, then swapchain must
+	// images be shared between families
+	if(indices.GraphicsFamily != indices.PresentationFamily)
+	{
+		//queues to share between
+		uint32_t queueFamilyIndices[] = {
+			(uint32_t) indices.GraphicsFamily,
+			(uint32_t) indices.PresentationFamily
+		};
+
+		createInfo.imageSharingMode = VK_SHARING_MODE_CONCURRENT;
+		createInfo.queueFamilyIndexCount = 2;
+		createInfo.pQueueFamilyIndices = queueFamilyIndices;
+	}
+	else
+	{
+		createInfo.imageSharingMode = VK_SHARING_MODE_EXCLUSIVE;
+		//the next two don't have to be specified for this case,
+		//just doing it for clariy
+		createInfo.queueFamilyIndexCount = 0;
+		createInfo.pQueueFamilyIndices = nullptr;
+	}
+
+	// we could take over work/responsibilities from an older swap chain,
+	// useful e.g. when resizing the window, which means
+	// to destory the old swapchain and creatign a new one
+	createInfo.oldSwapchain = VK_NULL_HANDLE;
+
+	VkResult result = vkCreateSwapchainKHR(MainDevice.LogicalDevice, &createInfo, Allocator, &Swapchain);
+	if(result != VK_SUCCESS)
+	{
+		throw std::runtime_error("failed to create a swapchain!");
+	}
+
+	// get swapchain images
+	uint32_t swapchainImageCount;
+	vkGetSwapchainImagesKHR(MainDevice.LogicalDevice, Swapchain, &swapchainImageCount, nullptr);
+
+	ArenaVector<VkImage> images(swapchainImageCount, ArenaAllocator<VkImage>(GetFrameArena()));
+	vkGetSwapchainImagesKHR(MainDevice.LogicalDevice, Swapchain, &swapchainImageCount, images.data());
+
+	for(VkImage image : images)
+	{
+		//store image handle (note that VkImage is just uint64_t, i.e. an index and we can just copy the value
+		SwapchainImage scImage = {};
+		scImage.Image = image;
+		scImage.ImageView = CreateImageView(image, SwapchainImageFormat, VK_IMAGE_ASPECT_COLOR_BIT);
+
+		SwapchainImages.push_back(scImage);
+	}
+}
+
+void VulkanRenderer::CreateRenderPass()
+{
+	const bool bMultisampled = MsaaSamples != VK_SAMPLE_COUNT_1_BIT;
+
+	// colour attachment of render pass
+	VkAttachmentDescription colourAttachment = {};
+	colourAttachment.format = SwapchainImageFormat;
+	// same as creating in the rasterizer mutlisampling
+	colourAttachment.samples = MsaaSamples;
+	// what to do with the attachment before rendering
+	colourAttachment.loadOp = VK_ATTACHMENT_LOAD_OP_CLEAR;
+	// what to do with the attachment after rendering
+	// the multisampled image is resolved at the end of the subpass, its samples are never needed afterwards
+	colourAttachment.storeOp = bMultisampled ? VK_ATTACHMENT_STORE_OP_DONT_CARE : VK_ATTACHMENT_STORE_OP_STORE;
+	colourAttachment.stencilLoadOp =  VK_ATTACHMENT_LOAD_OP_DONT_CARE;
+	colourAttachment.stencilStoreOp =  VK_ATTACHMENT_STORE_OP_DONT_CARE;
+
+	// framebuffer data will be stored as an image, but images can be given different data layouts
+	// to give optimal use for certain operations
+
+	// layout before render pass starts (the expected one, not the one to change to
+	//										--> conversion happens in subpass)
+	colourAttachment.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+	// layout after render pass (the one to change to)
+	colourAttachment.finalLayout = bMultisampled ? VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL : VK_IMAGE_LAYOUT_PRESENT_SRC_KHR;
+
+	// depth is only needed during the subpass as well
+	VkAttachmentDescription depthAttachment = {};
+	depthAttachment.format = DepthFormat;
+	depthAttachment.samples = MsaaSamples;
+	depthAttachment.loadOp = VK_ATTACHMENT_LOAD_OP_CLEAR;
+	depthAttachment.storeOp = VK_ATTACHMENT_STORE_OP_DONT_CARE;
+	depthAttachment.stencilLoadOp = VK_ATTACHMENT_LOAD_OP_DONT_CARE;
+	depthAttachment.stencilStoreOp = VK_ATTACHMENT_STORE_OP_DONT_CARE;
+	depthAttachment.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+	depthAttachment.finalLayout = VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL;
+
+	// swapchain image the multisampled colour is resolved into (only with msaa)
+	VkAttachmentDescription resolveAttachment = {};
+	resolveAttachment.format = SwapchainImageFormat;
+	resolveAttachment.samples = VK_SAMPLE_COUNT_1_BIT;
+	resolveAttachment.loadOp = VK_ATTACHMENT_LOAD_OP_DONT_CARE;		// every pixel is overwritten by the resolve
+	resolveAttachment.storeOp = VK_ATTACHMENT_STORE_OP_STORE;
+	resolveAttachment.stencilLoadOp = VK_ATTACHMENT_LOAD_OP_DONT_CARE;
+	resolveAttachment.stencilStoreOp = VK_ATTACHMENT_STORE_OP_DONT_CARE;
+	resolveAttachment.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+	resolveAttachment.finalLayout = VK_IMAGE_LAYOUT_PRESENT_SRC_KHR;
+
+	std::array<VkAttachmentDescription, 3> attachments = { colourAttachment, depthAttachment, resolveAttachment };
+
+	// attachment reference uses an attachment index
+	// that refers to index in the attachment list passed to renderPassCreateInfo
+	// (can be reused for other passes)
+	VkAttachmentReference colourAttachmentRef = {};
+	// index in the list
+	colourAttachmentRef.attachment = 0;
+	// the layout the colourAttachment.initialLayout is converted to
+	colourAttachmentRef.layout = VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL;
+
+	VkAttachmentReference depthAttachmentRef = {};
+	depthAttachmentRef.attachment = 1;
+	depthAttachmentRef.layout = VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL;
+
+	VkAttachmentReference resolveAttachmentRef = {};
+	resolveAttachmentRef.attachment = 2;
+	resolveAttachmentRef.layout = VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL;
+
+	// information about particular subpass the renderpass is using
+	VkSubpassDescription subpass = {};
+	// you can choose ray tracing here
+	subpass.pipelineBindPoint = VK_PIPELINE_BIND_POINT_GRAPHICS;
+	subpass.colorAttachmentCount = 1;
+	subpass.pColorAttachments = &colourAttachmentRef;
+	subpass.pDepthStencilAttachment = &depthAttachmentRef;
+	// resolve the samples into the swapchain image at the end of the subpass
+	subpass.pResolveAttachments = bMultisampled ? &resolveAttachmentRef : nullptr;
+
+	// need to determine when layout transitions occurr using subpass dependencies
+	std::array<VkSubpassDependency, 2> subpassDependencies;
+
+	// conversion from VK_IMAGE_LAYOUT_UNDEFINED to VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL
+	//			--- transition must happen after
+	subpassDependencies[0].srcSubpass = VK_SUBPASS_EXTERNAL;	//SUBPASS_EXTERNAL: special value meaning outside of render pass
+	// what stage in the pipeline has to happen before this can take place
+	// the colour and depth images are shared by all frames in flight, so the previous frame has to be done with them
+	subpassDependencies[0].srcStageMask = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT | VK_PIPELINE_STAGE_LATE_FRAGMENT_TESTS_BIT;
+	subpassDependencies[0].srcAccessMask = VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT | VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT;
+
+	//			--- transition must happen before
+	subpassDependencies[0].dstSubpass = 0;	//id of subpass
+	subpassDependencies[0].dstStageMask = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT | VK_PIPELINE_STAGE_EARLY_FRAGMENT_TESTS_BIT;
+	subpassDependencies[0].dstAccessMask = VK_ACCESS_COLOR_ATTACHMENT_READ_BIT | VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT
+		| VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_READ_BIT | VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT;
+	subpassDependencies[0].dependencyFlags = 0;
+
+	subpassDependencies[1].srcSubpass = 0;
+	subpassDependencies[1].srcStageMask = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT;
+	subpassDependencies[1].srcAccessMask = VK_ACCESS_MEMORY_READ_BIT | VK_ACCESS_MEMORY_WRITE_BIT;
+
+	subpassDependencies[1].dstSubpass = VK_SUBPASS_EXTERNAL;
+	subpassDependencies[1].dstStageMask = VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT;
+	subpassDependencies[1].dstAccessMask = VK_ACCESS_MEMORY_READ_BIT;
+	subpassDependencies[1].dependencyFlags = 0;
+
+	VkRenderPassCreateInfo renderPassCreateInfo = {};
+	renderPassCreateInfo.sType = VK_STRUCTURE_TYPE_RENDER_PASS_CREATE_INFO;
+	// without msaa there is nothing to resolve, so leave out the last attachment
+	renderPassCreateInfo.attachmentCount = bMultisampled ? 3 : 2;
+	renderPassCreateInfo.pAttachments = attachments.data();
+	renderPassCreateInfo.subpassCount = 1;
+	renderPassCreateInfo.pSubpasses = &subpass;
+	renderPassCreateInfo.dependencyCount = static_cast<uint32_t>(subpassDependencies.size());
+	renderPassCreateInfo.pDependencies = subpassDependencies.data();
+
+	VkResult result = vkCreateRenderPass(MainDevice.LogicalDevice, &renderPassCreateInfo, Allocator, &RenderPass);
+	if(result != VK_SUCCESS)
+	{
+		throw std::runtime_error("failed to create a render pass!");
+	}
+}
+
+void VulkanRenderer::CreateDescriptorSetLayout()
+{
+	// Frame data Binding Info (set 0)
+	VkDescriptorSetLayoutBinding frameLayoutBinding = {};
+	// the binding used in the shader ( -> layout(set = 0, binding = 0)... )
+	frameLayoutBinding.binding = 0;
+	// type of the descriptor (data), like Uniform Buffer, Storage Buffer, Sampler, Input Attachment
+	frameLayoutBinding.descriptorType = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER;
+	// we bind only 1 descriptor (which contains all of the frame data)
+	frameLayoutBinding.descriptorCount = 1;
+	// shader stages to bind to, the fog parameters are used by the fragment shader
+	frameLayoutBinding.stageFlags = VK_SHADER_STAGE_VERTEX_BIT | VK_SHADER_STAGE_FRAGMENT_BIT;
+	// for texture samplers: the sampler becomes immutable (image view does not!) by specifying in layout
+	frameLayoutBinding.pImmutableSamplers = nullptr;
+
+	// View data Binding Info (set 1): the premultiplied view projection matrix
+	VkDescriptorSetLayoutBinding viewLayoutBinding = frameLayoutBinding;
+	viewLayoutBinding.stageFlags = VK_SHADER_STAGE_VERTEX_BIT;
+
+	// Object buffer Binding Info (set 2)
+	// storage buffer, so it can hold the model view projection matrices of all scene nodes
+	// (the shader picks the matrix of the current object via the instance index)
+	VkDescriptorSetLayoutBinding objectLayoutBinding = viewLayoutBinding;
+	objectLayoutBinding.descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+
+	// Create Descriptor Set Layouts with given bindings (or get the ones that already have them)
+	DescriptorSetLayouts[UNIFORM_SET_FRAME] = DescriptorLayouts.Get(&frameLayoutBinding, 1);
+	DescriptorSetLayouts[UNIFORM_SET_VIEW] = DescriptorLayouts.Get(&viewLayoutBinding, 1);
+	DescriptorSetLayouts[UNIFORM_SET_OBJECT] = DescriptorLayouts.Get(&objectLayoutBinding, 1);
+}
+
+void VulkanRenderer::CreatePipelineLayout()
+{
+	// -- Pipeline layout
+	// shared by all permutations of the pipeline, the registry creates one per signature
+	PipelineLayoutDesc layoutDesc;
+	layoutDesc.SetLayoutCount = UNIFORM_SET_COUNT;
+	for(uint32_t set = 0; set < UNIFORM_SET_COUNT; set++)
+	{
+		layoutDesc.SetLayouts[set] = DescriptorSetLayouts[set];
+	}
+	layoutDesc.PushConstantRangeCount = 0;
+
+	PipelineLayout = GraphicsPipelines.GetLayout(layoutDesc);
+}
+
+VkPipeline VulkanRenderer::GetGraphicsPipeline(const PipelineStateDesc& desc)
+{
+	VkPipeline pipeline = GraphicsPipelines.Find(desc);
+	if(pipeline != VK_NULL_HANDLE)
+	{
+		return pipeline;
+	}
+
+	// never block the frame on a compile: build it on a worker (once) and draw with the fallback meanwhile
+	FrameAllocationAllowance allowance;
+
+	// variants are derived from their base, which has to be built first.
+	// the variant is requested once the base is in and the commands are recorded again
+	PipelineStateDesc baseDesc = desc.GetBase();
+	if(baseDesc != desc)
+	{
+		VkPipeline base = GraphicsPipelines.Find(baseDesc);
+		if(base != VK_NULL_HANDLE)
+		{
+			Pipelines.Request(desc, base);
+			return base;
+		}
+	}
+
+	Pipelines.Request(baseDesc);
+
+	// the fallback has to match the layout the draw binds its descriptor sets with: the default state,
+	// or any other pipeline with that layout. without one the draw is skipped until the pipeline is in
+	PipelineStateDesc fallbackDesc;
+	fallbackDesc.Layout = desc.Layout;
+	VkPipeline fallback = GraphicsPipelines.Find(ResolvePipelineState(fallbackDesc));
+	if(fallback == VK_NULL_HANDLE)
+	{
+		fallback = GraphicsPipelines.FindWithLayout(desc.Layout);
+	}
+
+	return fallback;
+}
+
+PipelineStateDesc VulkanRenderer::ResolvePipelineState(const PipelineStateDesc& desc) const
+{
+	PipelineStateDesc resolved = desc;
+	if(resolved.Layout == VK_NULL_HANDLE)
+	{
+		resolved.Layout = PipelineLayout;
+	}
+
+	return resolved;
+}
+
+PipelineStateDesc VulkanRenderer::GetMeshPipelineState(MeshHandle mesh) const
+{
+	return mesh < MeshPipelineStates.size() ? MeshPipelineStates[mesh] : ResolvePipelineState(PipelineStateDesc());
+}
+
+VkPipeline VulkanRenderer::CreateGraphicsPipeline(const PipelineStateDesc& desc, VkPipeline basePipeline)
+{
+	const ShaderPermutationKey permutation = desc.Permutation;
+	const PipelineVariant& variant = desc.Variant;
+
+	// Init builds the first pipeline on its own, with what its LoadShaders job loaded. later ones load the
+	// shaders again: the sources may have been reloaded since, unchanged ones come from the cache
+	ShaderCode vertexShaderCode;
+	ShaderCode fragmentShaderCode;
+	if(StartupVertexShader.GetSize() > 0 && StartupFragmentShader.GetSize() > 0)
+	{
+		vertexShaderCode = std::move(StartupVertexShader);
+		fragmentShaderCode = std::move(StartupFragmentShader);
+	}
+	else
+	{
+		vertexShaderCode = Shaders.Load("shader.vert", "vert.spv");
+		fragmentShaderCode = Shaders.Load("shader.frag", "frag.spv");
+	}
+
+	// build shader modules to link to graphics CreateGraphicsPipeline
+	// we don't need these after creating the pipeline, they can be destroyed at the end of this function
+	VkShaderModule vertexShaderModule = CreateShaderModule(vertexShaderCode);
+	VkShaderModule fragmentShaderModule = VK_NULL_HANDLE;
+	try
+	{
+		fragmentShaderModule = CreateShaderModule(fragmentShaderCode);
+	}
+	catch(const std::runtime_error&)
+	{
+		vkDestroyShaderModule(MainDevice.LogicalDevice, vertexShaderModule, Allocator);
+		throw;
+	}
+
+	// the permutation's features become specialization constants, the same for both stages
+	ShaderSpecialization specialization(permutation);
+
+	// -- Shader stage creation information
+	// vertex stage creation info
+	VkPipelineShaderStageCreateInfo vertexShaderCreateInfo = {};
+	{
+		vertexShaderCreateInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
+		vertexShaderCreateInfo.stage = VK_SHADER_STAGE_VERTEX_BIT;
+		vertexShaderCreateInfo.module = vertexShaderModule;
+		// function name for the function run first in the shader
+		// in OpenGL / glsl, the default is main, so keep with that
+		vertexShaderCreateInfo.pName = "main";
+		vertexShaderCreateInfo.pSpecializationInfo = &specialization.Info;
+	}
+
+	// fragment stage  creation info
+	VkPipelineShaderStageCreateInfo fragmentShaderCreateInfo = {};
+	{
+		fragmentShaderCreateInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
+		fragmentShaderCreateInfo.stage = VK_SHADER_STAGE_FRAGMENT_BIT;
+		fragmentShaderCreateInfo.module = fragmentShaderModule;
+		fragmentShaderCreateInfo.pName = "main";
+		fragmentShaderCreateInfo.pSpecializationInfo = &specialization.Info;
+	}
+
+	// put shader stage creation infos into array
+	// graphics pipeline creation info requires array of shader stage creates
+	VkPipelineShaderStageCreateInfo shaderStages[] = {
+		vertexShaderCreateInfo, fragmentShaderCreateInfo
+	};
+
+	// -- Vertex input
+
+	// how the data for single vertex (pos, colour, texCoords, ...) is as a whole
+	VkVertexInputBindingDescription bindingDescr = {};
+	bindingDescr.binding = 0;									// can bind multiple streams of data, this defines which one
+	bindingDescr.stride = sizeof(Vertex);						// size of single vertex object (i.e. all attributes!)
+	bindingDescr.inputRate = VK_VERTEX_INPUT_RATE_VERTEX;		// how to move between data after each vertex
+																// e.g. instancing can be done by send always using first vertex
+																// of each instance, then second vertex of each index and so forth
+																// (VK_VERTEX_INPUT_RATE_INSTANCE)
+
+	// definition of the individual attributes (i.e. pos is an attribute, colour is one, ...)
+	// within the vertex: size and position in struct
+	std::array<VkVertexInputAttributeDescription, 4> attributeDescriptions;
+
+	// position attribute
+	attributeDescriptions[0].binding = 0; 							// binding can be set in the shader as well,
+																	// but needs to match binding description binding
+																	// in the shader, layout(binding = 0, location = 0), but binding = 0 is default
+	attributeDescriptions[0].location = 0;
+	attributeDescriptions[0].format = VK_FORMAT_R32G32B32_SFLOAT;
+	attributeDescriptions[0].offset = offsetof(Vertex, Position);	// the stride to start reading in the struct
+
+	// colour attribute
+	attributeDescriptions[1].binding = 0;
+	attributeDescriptions[1].location = 1;
+	attributeDescriptions[1].format = VK_FORMAT_R32G32B32_SFLOAT;
+	attributeDescriptions[1].offset = offsetof(Vertex, Colour);
+
+	// the instances: advance once per instance instead of once per vertex
+	VkVertexInputBindingDescription instanceBindingDescr = {};
+	instanceBindingDescr.binding = 1;
+	instanceBindingDescr.stride = sizeof(MeshInstance);
+	instanceBindingDescr.inputRate = VK_VERTEX_INPUT_RATE_INSTANCE;
+
+	std::array<VkVertexInputBindingDescription, 2> bindingDescriptions = {
+		bindingDescr, instanceBindingDescr
+	};
+
+	// scene node attribute
+	attributeDescriptions[2].binding = 1;
+	attributeDescriptions[2].location = 2;
+	attributeDescriptions[2].format = VK_FORMAT_R32_UINT;
+	attributeDescriptions[2].offset = offsetof(MeshInstance, Node);
+
+	// tint attribute, unpacked to a vec4
+	attributeDescriptions[3].binding = 1;
+	attributeDescriptions[3].location = 3;
+	attributeDescriptions[3].format = VK_FORMAT_R8G8B8A8_UNORM;
+	attributeDescriptions[3].offset = offsetof(MeshInstance, Colour);
+
+	VkPipelineVertexInputStateCreateInfo vertInputCreateInfo = {};
+	{
+		vertInputCreateInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_VERTEX_INPUT_STATE_CREATE_INFO;
+		// list of vertex binding descriptions (data spacing / stride)
+		vertInputCreateInfo.vertexBindingDescriptionCount = static_cast<uint32_t>(bindingDescriptions.size());
+		vertInputCreateInfo.pVertexBindingDescriptions = bindingDescriptions.data();
+		// list of vertex attribute descriptions (data format and where to bind to / from)
+		vertInputCreateInfo.vertexAttributeDescriptionCount = static_cast<uint32_t>(attributeDescriptions.size());
+		vertInputCreateInfo.pVertexAttributeDescriptions = attributeDescriptions.data();
+	}
+
+	// -- Input assembly
+	VkPipelineInputAssemblyStateCreateInfo inputAssemblyCreateInfo = {};
+	{
+		inputAssemblyCreateInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_INPUT_ASSEMBLY_STATE_CREATE_INFO;
+		switch(variant.Topology)
+		{
+		case PIPELINE_TOPOLOGY_TRIANGLE_STRIP:
+			inputAssemblyCreateInfo.topology = VK_PRIMITIVE_TOPOLOGY_TRIANGLE_STRIP;
+			break;
+		case PIPELINE_TOPOLOGY_LINE_LIST:
+			inputAssemblyCreateInfo.topology = VK_PRIMITIVE_TOPOLOGY_LINE_LIST;
+			break;
+		default:
+			inputAssemblyCreateInfo.topology = VK_PRIMITIVE_TOPOLOGY_TRIANGLE_LIST;
+			break;
+		}
+		// restart primitive is used for strips (rather than lists), to start a new strip at some point
+		inputAssemblyCreateInfo.primitiveRestartEnable = VK_FALSE;
+	}
+
+	// -- Viewport and scissor
+	//	create a viewport info struct
+	VkViewport viewport = {};
+	{
+		viewport.x = 0.0f;
+		viewport.y = 0.0f;
+		viewport.width = (float)SwapchainResolution.width;
+		viewport.height = (float)SwapchainResolution.height;
+		// framebuffer depth
+		viewport.minDepth = 0;
+		viewport.maxDepth = 1;
+	}
+
+	// create a scissor info struct
+	VkRect2D scissor = {};
+	scissor.offset = {0, 0};
+	scissor.extent = SwapchainResolution;
+
+	VkPipelineViewportStateCreateInfo vpStateCreateInfo = {};
+	{
+		vpStateCreateInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_VIEWPORT_STATE_CREATE_INFO;
+		vpStateCreateInfo.viewportCount = 1;
+		vpStateCreateInfo.pViewports = &viewport;
+		vpStateCreateInfo.scissorCount = 1;
+		vpStateCreateInfo.pScissors = &scissor;
+	}
+
+	// -- Dynamic states (not used here. if used, e.g. for resizing window, you still have to recreate the swapchain with new size!
+	{
+		// dynamic states to enable
+		std::vector<VkDynamicState> dynamicStateEnables;
+		// dynamic vp - resize in command buffer with vkCmdSetViewport(cmdBuffer, viewportIndex, numViewports, array of viewports)
+		// 		e.g. vkCmdSetViewport(cmdBuffer, 0, 1, &viewport);
+		dynamicStateEnables.push_back(VK_DYNAMIC_STATE_VIEWPORT);
+		// same as vp: vkCmdSetScissor
+		dynamicStateEnables.push_back(VK_DYNAMIC_STATE_SCISSOR);
+
+		// dynamic state creation info
+		VkPipelineDynamicStateCreateInfo dynamicStateCreateInfo = {};
+		dynamicStateCreateInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_DYNAMIC_STATE_CREATE_INFO;
+		dynamicStateCreateInfo.dynamicStateCount = static_cast<uint32_t>(dynamicStateEnables.size());
+		dynamicStateCreateInfo.pDynamicStates = dynamicStateEnables.data();
+	}
+
+	// - Rasterizer
+	VkPipelineRasterizationStateCreateInfo rasterizerCreateInfo = {};
+	{
+		rasterizerCreateInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_RASTERIZATION_STATE_CREATE_INFO;
+		// whether to clip past far plane (TRUE, default) or clip into farplane (FALSE)
+		rasterizerCreateInfo.depthClampEnable = VK_FALSE;
+		// whether to discard data and skip rasterizer (never creates fragments)
+		rasterizerCreateInfo.rasterizerDiscardEnable = VK_FALSE;
+		rasterizerCreateInfo.polygonMode = VK_POLYGON_MODE_FILL;
+		rasterizerCreateInfo.lineWidth = 1.0f;		//values != 1 need extension
+		switch(variant.Cull)
+		{
+		case PIPELINE_CULL_FRONT:
+			rasterizerCreateInfo.cullMode = VK_CULL_MODE_FRONT_BIT;
+			break;
+		case PIPELINE_CULL_NONE:
+			rasterizerCreateInfo.cullMode = VK_CULL_MODE_NONE;
+			break;
+		default:
+			rasterizerCreateInfo.cullMode = VK_CULL_MODE_BACK_BIT;
+			break;
+		}
+		rasterizerCreateInfo.frontFace = VK_FRONT_FACE_COUNTER_CLOCKWISE;
+		rasterizerCreateInfo.depthBiasEnable = VK_FALSE;
+	}
+
+	// -- Multisampling
+	VkPipelineMultisampleStateCreateInfo multisampleCreateInfo = {};
+	{
+		multisampleCreateInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_MULTISAMPLE_STATE_CREATE_INFO;
+		// only the edges are multisampled, the fragment shader still runs once per pixel
+		multisampleCreateInfo.sampleShadingEnable = VK_FALSE;
+		// number of samples to use per fragment, has to match the render pass attachments
+		multisampleCreateInfo.rasterizationSamples = MsaaSamples;
+	}
+
+	// -- Blending
+	// blend attachment state
+	VkPipelineColorBlendAttachmentState colourBlendState = {};
+	{
+		// channels on which to blend
+		colourBlendState.colorWriteMask = VK_COLOR_COMPONENT_R_BIT | VK_COLOR_COMPONENT_G_BIT
+			| VK_COLOR_COMPONENT_B_BIT | VK_COLOR_COMPONENT_A_BIT;
+		colourBlendState.blendEnable = VK_TRUE;
+
+		// blending uses equation: (srcColorBlendFactor * new colour) colorBlendOp (dstColorBlendFactor * old colour)
+		colourBlendState.srcColorBlendFactor = VK_BLEND_FACTOR_SRC_ALPHA;
+		colourBlendState.dstAlphaBlendFactor = VK_BLEND_FACTOR_ONE_MINUS_SRC_ALPHA;
+		colourBlendState.colorBlendOp = VK_BLEND_OP_ADD;
+
+		//summarised: VK_BLEND_FACTOR_SRC_ALPHA * new colour + (VK_BLEND_FACTOR_ONE_MINUS_SRC_ALPHA * old colour)
+		//				(new colour alpha * new colour) + ((1 - new colour alpha) * old colour)
+
+		colourBlendState.srcAlphaBlendFactor = VK_BLEND_FACTOR_ONE;
+		colourBlendState.dstAlphaBlendFactor = VK_BLEND_FACTOR_ZERO;
+		colourBlendState.alphaBlendOp = VK_BLEND_OP_ADD;
+
+		//summarised: (1 * new alpha) + (0 * old alpha) = new alpha
+
+		// the opaque base leaves the old colour out (dstColorBlendFactor stays VK_BLEND_FACTOR_ZERO)
+		switch(variant.Blend)
+		{
+		case PIPELINE_BLEND_ALPHA:
+			colourBlendState.dstColorBlendFactor = VK_BLEND_FACTOR_ONE_MINUS_SRC_ALPHA;
+			break;
+		case PIPELINE_BLEND_ADDITIVE:
+			colourBlendState.dstColorBlendFactor = VK_BLEND_FACTOR_ONE;
+			break;
+		default:
+			break;
+		}
+	}
+
+	VkPipelineColorBlendStateCreateInfo colourBlendCreateInfo = {};
+	{
+		colourBlendCreateInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_COLOR_BLEND_STATE_CREATE_INFO;
+		// alternative to calculations is to use logical oerpations
+		colourBlendCreateInfo.logicOpEnable = VK_FALSE;
+		colourBlendCreateInfo.attachmentCount = 1;
+		colourBlendCreateInfo.pAttachments = &colourBlendState;
+	}
+
+	// -- Depth stencil testing
+	VkPipelineDepthStencilStateCreateInfo depthStencilCreateInfo = {};
+	{
+		depthStencilCreateInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_DEPTH_STENCIL_STATE_CREATE_INFO;
+		depthStencilCreateInfo.depthTestEnable = VK_TRUE;
+		depthStencilCreateInfo.depthWriteEnable = VK_TRUE;
+		// less or equal, so that coplanar meshes are still drawn in draw list order
+		depthStencilCreateInfo.depthCompareOp = VK_COMPARE_OP_LESS_OR_EQUAL;
+		depthStencilCreateInfo.depthBoundsTestEnable = VK_FALSE;
+		depthStencilCreateInfo.stencilTestEnable = VK_FALSE;
+	}
+
+	// -- Graphics pipeline creation
+	VkGraphicsPipelineCreateInfo pipelineCreateInfo = {};
+	{
+		pipelineCreateInfo.sType = VK_STRUCTURE_TYPE_GRAPHICS_PIPELINE_CREATE_INFO;
+		pipelineCreateInfo.stageCount = 2;	//number of shader stages
+		pipelineCreateInfo.pStages = shaderStages;
+		pipelineCreateInfo.pVertexInputState = &vertInputCreateInfo;
+		pipelineCreateInfo.pInputAssemblyState = &inputAssemblyCreateInfo;
+		pipelineCreateInfo.pViewportState = &vpStateCreateInfo;
+		pipelineCreateInfo.pDynamicState = nullptr;
+		pipelineCreateInfo.pRasterizationState = &rasterizerCreateInfo;
+		pipelineCreateInfo.pMultisampleState = &multisampleCreateInfo;
+		pipelineCreateInfo.pColorBlendState = &colourBlendCreateInfo;
+		pipelineCreateInfo.pDepthStencilState = &depthStencilCreateInfo;
+		pipelineCreateInfo.layout = desc.Layout;
+		pipelineCreateInfo.renderPass = RenderPass;
+		pipelineCreateInfo.subpass = 0;		//index of subpass of render pass to use with pipeline
+
+		// without a render pass, the attachment formats are given directly
+		if(bDynamicRendering)
+		{
+			pipelineCreateInfo.pNext = &PipelineRenderingInfo;
+		}
+
+		// pipeline derivatives
+		// for shared settings usage: the variants only differ from their base in a few states,
+		// so the driver can reuse what it compiled for the base
+		if(desc.IsBase())
+		{
+			pipelineCreateInfo.flags = VK_PIPELINE_CREATE_ALLOW_DERIVATIVES_BIT;
+		}
+		else if(basePipeline != VK_NULL_HANDLE)
+		{
+			pipelineCreateInfo.flags = VK_PIPELINE_CREATE_DERIVATIVE_BIT;
+		}
+		pipelineCreateInfo.basePipelineHandle = basePipeline;		//existing pipeline to derive from
+		pipelineCreateInfo.basePipelineIndex = -1;					//or index of pipeline being created to derive from
+	}
+
+	VkPipeline pipeline;
+	VkResult result = vkCreateGraphicsPipelines(MainDevice.LogicalDevice, Pipelines.GetPipelineCache(), 1,
+		&pipelineCreateInfo, Allocator, &pipeline);
+
+	// destroy shader modules, as they are no longer needed after pipeline creation (whether it worked or not:
+	// hot reloaded shaders fail to build every so often)
+	vkDestroyShaderModule(MainDevice.LogicalDevice, fragmentShaderModule, Allocator);
+	vkDestroyShaderModule(MainDevice.LogicalDevice, vertexShaderModule, Allocator);
+
+	if(result != VK_SUCCESS)
+	{
+		throw std::runtime_error("failed to create graphics pipeline!");
+	}
+
+	return pipeline;
+}
+
+void VulkanRenderer::CreateAttachmentImages()
+{
+	// TRANSIENT: the contents only live during the render pass (load op clear, store op don't care),
+	// so tilers can keep them in tile memory and don't have to back them with real memory
+	if(MsaaSamples != VK_SAMPLE_COUNT_1_BIT)
+	{
+		ColourImage = CreateTransientImage(SwapchainImageFormat,
+			VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT | VK_IMAGE_USAGE_TRANSIENT_ATTACHMENT_BIT, &ColourImageMemory);
+		ColourImageView = CreateImageView(ColourImage, SwapchainImageFormat, VK_IMAGE_ASPECT_COLOR_BIT);
+	}
+
+	DepthImage = CreateTransientImage(DepthFormat,
+		VK_IMAGE_USAGE_DEPTH_STENCIL_ATTACHMENT_BIT | VK_IMAGE_USAGE_TRANSIENT_ATTACHMENT_BIT, &DepthImageMemory);
+	DepthImageView = CreateImageView(DepthImage, DepthFormat, VK_IMAGE_ASPECT_DEPTH_BIT);
+}
+
+void VulkanRenderer::CreateFramebuffers()
+{
+	SwapchainFramebuffers.resize(SwapchainImages.size());
+
+	// create a framebuffer for each swapchain image
+	for(size_t i = 0; i < SwapchainFramebuffers.size(); i++)
+	{
+		// with msaa, the swapchain image is the resolve target
+		ArenaVector<VkImageView> attachments{ArenaAllocator<VkImageView>(GetFrameArena())};
+		if(MsaaSamples != VK_SAMPLE_COUNT_1_BIT)
+		{
+			attachments = { ColourImageView, DepthImageView, SwapchainImages[i].ImageView };
+		}
+		else
+		{
+			attachments = { SwapchainImages[i].ImageView, DepthImageView };
+		}
+
+		VkFramebufferCreateInfo createInfo = {};
+		createInfo.sType = VK_STRUCTURE_TYPE_FRAMEBUFFER_CREATE_INFO;
+		createInfo.renderPass = RenderPass;
+		// attachments are 1:1 with the render pass attachments
+		createInfo.attachmentCount = static_cast<uint32_t>(attachments.size());
+		createInfo.pAttachments = attachments.data();
+		createInfo.width = SwapchainResolution.width;
+		createInfo.height = SwapchainResolution.height;
+		createInfo.layers = 1;
+
+		VkResult result = vkCreateFramebuffer(MainDevice.LogicalDevice, &createInfo, Allocator, &SwapchainFramebuffers[i]);
+		if(result != VK_SUCCESS)
+		{
+			throw std::runtime_error("failed to create a framebuffer!");
+		}
+	}
+}
+
+void VulkanRenderer::CreateMeshes()
+{
+	// create a mesh
+	// vertex data
+	std::vector<Vertex> firstMeshVertices = {
+		{{-0.1, -0.4, 0.0},		{1.0f, 0.0f, 0.0f}},
+		{{-0.1, 0.4, 0.0},		{0.0f, 1.0f, 0.0f}},
+		{{-0.9, 0.4, 0.0},		{0.0f, 0.0f, 1.0f}},
+		{{-0.9, -0.4, 0.0},		{1.0f, 1.0f, 0.0f}}
+	};
+
+	// index data
+	std::vector<uint32_t> meshIndices = {
+		0, 1, 2,
+		2, 3, 0
+	};
+	Mesh firstMesh = Mesh(MainDevice.PhysicalDevice, MainDevice.LogicalDevice, GraphicsQueue,
+		GraphicsCommandPool, &firstMeshVertices, &meshIndices, Allocator);
+
+	/*
+	std::vector<Vertex> secondMeshVertices = {
+		{{0.9, -0.4, 0.0},		{0.0f, 0.0f, 1.0f}},
+		{{0.9, 0.4, 0.0},		{0.0f, 1.0f, 0.0f}},
+		{{0.1, 0.4, 0.0},		{1.0f, 0.0f, 0.0f}},
+		{{0.1, -0.4, 0.0},		{1.0f, 1.0f, 0.0f}}
+	};*/
+
+	std::vector<Vertex> secondMeshVertices = {
+		{{0.3, -0.4, 0.0},		{1.0f, 1.0f, 0.0f}},
+		{{0.05, 0.1, 0.0},		{1.0f, 0.0f, 1.0f}},
+		{{0.5, 0.4, 0.0},		{0.0f, 1.0f, 0.0f}},
+		{{0.95, 0.1, 0.0},		{0.0f, 1.0f, 1.0f}},
+		{{0.7, -0.4, 0.0},		{0.0f, 0.0f, 1.0f}}
+	};
+	std::vector<uint32_t> secondMeshIndices = {
+		2, 1, 0,
+		4, 2, 0,
+		4, 3, 2
+	};
+
+	MeshList.push_back(firstMesh);
+
+	// every mesh gets its own node below the scene root
+	SceneRoot = Scene.CreateNode();
+	for(size_t i = 0; i < MeshList.size(); i++)
+	{
+		MeshNodes.push_back(Scene.CreateNode(SceneRoot));
+		AddInstance(static_cast<MeshHandle>(i), MeshNodes.back(), glm::vec4(1.0f));
+		DrawList.push_back(static_cast<uint32_t>(i));
+		MeshStates.push_back(MESH_STATE_READY);
+		TrackMeshMemory(static_cast<MeshHandle>(i));
+	}
+
+	// the second mesh is streamed in, it shows up once its upload has finished
+	LoadMeshAsync([secondMeshVertices, secondMeshIndices](std::vector<Vertex>& vertices, std::vector<uint32_t>& indices)
+	{
+		vertices = secondMeshVertices;
+		indices = secondMeshIndices;
+	});
+}
+
+void VulkanRenderer::CreateCommandPool()
+{
+	// get indices of queue families from device
+	QueueFamilyIndicies queueFamilyIndices = GetQueueFamilies(MainDevice.PhysicalDevice);
+
+	VkCommandPoolCreateInfo createInfo = {};
+	createInfo.sType = VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO;
+	createInfo.queueFamilyIndex = queueFamilyIndices.GraphicsFamily; 	//queue family type that buffers from this command pool will used
+	// command buffers are re-recorded one by one, whenever the draw list changes
+	createInfo.flags = VK_COMMAND_POOL_CREATE_RESET_COMMAND_BUFFER_BIT;
+
+	// create a GRAPHICS QUEUE FAMILY command pool
+	VkResult result = vkCreateCommandPool(MainDevice.LogicalDevice, &createInfo, Allocator, &GraphicsCommandPool);
+	if(result != VK_SUCCESS)
+	{
+		throw std::runtime_error("failed to create a command pool!");
+	}
+}
+
+void VulkanRenderer::CreateCommandBuffers()
+{
+	// resize command buffer count to have onef or each frame buffer
+	CommandBuffers.resize(SwapchainImages.size());
+	CommandBufferVersions.resize(SwapchainImages.size(), 0);
+
+	// the command buffers exist in the command pool already, therefore allocate rather than create
+	VkCommandBufferAllocateInfo allocateInfo = {};
+	allocateInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
+	allocateInfo.commandPool = GraphicsCommandPool;
+	// Primary: directly called by queue. 	Secondary: can't be called by queue, but by other command buffer (i.e. by a primary)
+	//											-> called by "vkCmdExecuteCommands" from Primary cmd buffer
+	allocateInfo.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
+	// don't allocate cmd buffers in loop, as they all have the same setup. allocate all of them at once
+	allocateInfo.commandBufferCount = static_cast<uint32_t>(CommandBuffers.size());
+
+	// allocate command buffers and place handles in array of buffers
+	// since this is allocated rather than created, no destroy is needed
+	VkResult result = vkAllocateCommandBuffers(MainDevice.LogicalDevice, &allocateInfo, CommandBuffers.data());
+	if(result != VK_SUCCESS)
+	{
+		throw std::runtime_error("failed to allocate command buffers!");
+	}
+}
+
+void VulkanRenderer::CreateSynchronizationObjects()
+{
+	ImagesAvailable.resize(MAX_FRAME_DRAWS);
+	RendersFinished.resize(MAX_FRAME_DRAWS);
+	DrawFences.resize(MAX_FRAME_DRAWS);
+	ImagesInFlight.resize(SwapchainImages.size(), VK_NULL_HANDLE);
+
+	// semaphore creation information
+	VkSemaphoreCreateInfo semaphoreCreateInfo = {};
+	semaphoreCreateInfo.sType = VK_STRUCTURE_TYPE_SEMAPHORE_CREATE_INFO;
+
+	VkFenceCreateInfo fenceCreateInfo = {};
+	fenceCreateInfo.sType = VK_STRUCTURE_TYPE_FENCE_CREATE_INFO;
+	// fence should be open before rendering (otherwise we block draw, since it waits for open)
+	fenceCreateInfo.flags = VK_FENCE_CREATE_SIGNALED_BIT;
+
+	for(uint32_t i = 0; i < MAX_FRAME_DRAWS; i++)
+	{
+		if(vkCreateSemaphore(MainDevice.LogicalDevice, &semaphoreCreateInfo, Allocator, &ImagesAvailable[i]) != VK_SUCCESS
+			|| vkCreateSemaphore(MainDevice.LogicalDevice, &semaphoreCreateInfo, Allocator, &RendersFinished[i]) != VK_SUCCESS)
+		{
+			throw std::runtime_error("failed to create a semaphore!");
+		}
+
+		if(vkCreateFence(MainDevice.LogicalDevice, &fenceCreateInfo, Allocator, &DrawFences[i]) != VK_SUCCESS)
+		{
+			throw std::runtime_error("failed to create a fence!");
+		}
+	}
+}
+
+void VulkanRenderer::CreateUniformBuffers()
+{
+	// one frame and one view uniform buffer for each image (and by extension, command buffer)
+	FrameUniformBuffer.resize(SwapchainImages.size());
+	FrameUniformBufferMemory.resize(SwapchainImages.size());
+	FrameUniformBufferMapped.resize(SwapchainImages.size());
+	ViewUniformBuffer.resize(SwapchainImages.size());
+	ViewUniformBufferMemory.resize(SwapchainImages.size());
+	ViewUniformBufferMapped.resize(SwapchainImages.size());
+	// nothing has been written yet
+	ViewUniformBufferGenerations.resize(SwapchainImages.size(), 0);
+
+	// Create uniform buffers, mapped like the object buffers so updates are plain writes
+	for(size_t i = 0; i < SwapchainImages.size(); i++)
+	{
+		CreateBufferAndAllocateMemory(MainDevice.PhysicalDevice, MainDevice.LogicalDevice, sizeof(FrameData),
+			VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
+			&FrameUniformBuffer[i], &FrameUniformBufferMemory[i], Allocator);
+		CreateBufferAndAllocateMemory(MainDevice.PhysicalDevice, MainDevice.LogicalDevice, sizeof(ViewData),
+			VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
+			&ViewUniformBuffer[i], &ViewUniformBufferMemory[i], Allocator);
+
+		void* data = nullptr;
+		vkMapMemory(MainDevice.LogicalDevice, FrameUniformBufferMemory[i], 0, sizeof(FrameData), 0, &data);
+		FrameUniformBufferMapped[i] = static_cast<FrameData*>(data);
+		vkMapMemory(MainDevice.LogicalDevice, ViewUniformBufferMemory[i], 0, sizeof(ViewData), 0, &data);
+		ViewUniformBufferMapped[i] = static_cast<ViewData*>(data);
+	}
+}
+
+void VulkanRenderer::CreateObjectBuffers()
+{
+	// model view projection matrices of all possible scene nodes
+	VkDeviceSize bufferSize = sizeof(glm::mat4) * MAX_OBJECTS;
+
+	// one object buffer for each image, just like the uniform buffers
+	ObjectBuffer.resize(SwapchainImages.size());
+	ObjectBufferMemory.resize(SwapchainImages.size());
+	ObjectBufferMapped.resize(SwapchainImages.size());
+	// nothing has been written yet
+	ObjectBufferGenerations.resize(SwapchainImages.size(), 0);
+
+	for(size_t i = 0; i < ObjectBuffer.size(); i++)
+	{
+		CreateBufferAndAllocateMemory(MainDevice.PhysicalDevice, MainDevice.LogicalDevice, bufferSize,
+			VK_BUFFER_USAGE_STORAGE_BUFFER_BIT, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
+			&ObjectBuffer[i], &ObjectBufferMemory[i], Allocator);
+
+		// keep the memory mapped for the lifetime of the buffer, so that only changed matrices
+		// have to be written each frame (instead of mapping and copying everything)
+		void* data = nullptr;
+		vkMapMemory(MainDevice.LogicalDevice, ObjectBufferMemory[i], 0, bufferSize, 0, &data);
+		ObjectBufferMapped[i] = static_cast<glm::mat4*>(data);
+	}
+}
+
+void VulkanRenderer::CreateDescriptorPool()
+{
+	// type of descriptors + how many DESCRIPTORS (not Descr Sets!) per set -> combined with the number of sets
+	// makes the pool size. the pools are chained: when one runs out, a bigger one is added, so per material or
+	// per object sets don't need to be known up front
+	std::vector<DescriptorPoolRatio> ratios = {
+		{ VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER, 1.0f },
+		{ VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, 1.0f }
+	};
+
+	// the first pool fits the sets of all swapchain images
+	Descriptors.Create(MainDevice.LogicalDevice, Allocator,
+		static_cast<uint32_t>(SwapchainImages.size()) * UNIFORM_SET_COUNT, ratios);
+}
+
+void VulkanRenderer::CreateDescriptorSets()
+{
+	// one descriptor set of every frequency for every image
+	DescriptorSets.resize(SwapchainImages.size());
+	for(size_t i = 0; i < DescriptorSets.size(); i++)
+	{
+		for(uint32_t set = 0; set < UNIFORM_SET_COUNT; set++)
+		{
+			DescriptorSets[i][set] = Descriptors.Allocate(DescriptorSetLayouts[set]);
+		}
+	}
+
+	// the descriptor sets don't hold any information used by the shader themselves.
+	// the actual data will be stored in uniform buffers, which the descripor sets then use.
+	// -> update all of descriptor set buffer bindings. the templates write their binding
+	// straight from a VkDescriptorBufferInfo
+	std::array<VkDescriptorType, UNIFORM_SET_COUNT> types = {
+		VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER, VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER
+	};
+	for(uint32_t set = 0; set < UNIFORM_SET_COUNT; set++)
+	{
+		std::vector<DescriptorUpdateTemplate::Entry> entries = {
+			{ 0, types[set], 1, 0 }
+		};
+		DescriptorTemplates[set].Create(MainDevice.LogicalDevice, Allocator, DescriptorSetLayouts[set], entries,
+			bDescriptorUpdateTemplates);
+	}
+
+	for(size_t i = 0; i < DescriptorSets.size(); i++)
+	{
+		// the buffer to get data from, offset in data (e.g. if we only wanted to bind second half of data)
+		std::array<VkDescriptorBufferInfo, UNIFORM_SET_COUNT> bufferInfos = {};
+		bufferInfos[UNIFORM_SET_FRAME].buffer = FrameUniformBuffer[i];
+		bufferInfos[UNIFORM_SET_FRAME].range = sizeof(FrameData);
+		bufferInfos[UNIFORM_SET_VIEW].buffer = ViewUniformBuffer[i];
+		bufferInfos[UNIFORM_SET_VIEW].range = sizeof(ViewData);
+		// object buffer, the whole buffer is bound
+		bufferInfos[UNIFORM_SET_OBJECT].buffer = ObjectBuffer[i];
+		bufferInfos[UNIFORM_SET_OBJECT].range = sizeof(glm::mat4) * MAX_OBJECTS;
+
+		for(uint32_t set = 0; set < UNIFORM_SET_COUNT; set++)
+		{
+			DescriptorTemplates[set].Update(DescriptorSets[i][set], &bufferInfos[set]);
+		}
+	}
+}
+
+void VulkanRenderer::UpdateUniformBuffer(const uint32_t& imageIndex)
+{
+	// set 0: every frame
+	FrameUniforms.Time_s = std::chrono::duration<float>(std::chrono::steady_clock::now() - InitTime).count();
+	FrameUniforms.FrameIndex = static_cast<uint32_t>(SubmittedFrames);
+	*FrameUniformBufferMapped[imageIndex] = FrameUniforms;
+
+	// set 1: only when the camera moved since this image was drawn last. all object matrices have the
+	// old view projection baked in then, so they're rewritten as well
+	if(ViewUniformBufferGenerations[imageIndex] != ViewGeneration)
+	{
+		*ViewUniformBufferMapped[imageIndex] = ViewUniforms;
+		ViewUniformBufferGenerations[imageIndex] = ViewGeneration;
+		ObjectBufferGenerations[imageIndex] = 0;
+	}
+
+	// only recompute the subtrees that changed since the last frame
+	Scene.UpdateWorldTransforms(&Jobs);
+
+	if(Scene.GetHandleCount() > MAX_OBJECTS)
+	{
+		throw std::runtime_error("too many scene nodes for the object buffer!");
+	}
+
+	// set 2: the buffer of this image may be several updates behind, the generation tracks what it is missing
+	Scene.WriteClipTransforms(ViewUniforms.ViewProjection, ObjectBufferMapped[imageIndex],
+		ObjectBufferGenerations[imageIndex]);
+}
+
+void VulkanRenderer::CreateInstanceBuffers()
+{
+	// every instance is a scene node, so there can't be more instances than object matrices
+	VkDeviceSize bufferSize = sizeof(MeshInstance) * MAX_OBJECTS;
+
+	// one instance buffer for each image, just like the object buffers
+	InstanceBuffer.resize(SwapchainImages.size());
+	InstanceBufferMemory.resize(SwapchainImages.size());
+	InstanceBufferMapped.resize(SwapchainImages.size());
+	// nothing has been written yet
+	InstanceBufferGenerations.resize(SwapchainImages.size(), 0);
+
+	for(size_t i = 0; i < InstanceBuffer.size(); i++)
+	{
+		CreateBufferAndAllocateMemory(MainDevice.PhysicalDevice, MainDevice.LogicalDevice, bufferSize,
+			VK_BUFFER_USAGE_VERTEX_BUFFER_BIT, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
+			&InstanceBuffer[i], &InstanceBufferMemory[i], Allocator);
+
+		void* data = nullptr;
+		vkMapMemory(MainDevice.LogicalDevice, InstanceBufferMemory[i], 0, bufferSize, 0, &data);
+		InstanceBufferMapped[i] = static_cast<MeshInstance*>(data);
+	}
+}
+
+void VulkanRenderer::CreateDrawCommandBuffers(uint32_t capacity)
+{
+	DestroyDrawCommandBuffers();
+
+	VkDeviceSize bufferSize = sizeof(VkDrawIndexedIndirectCommand) * capacity;
+
+	// one draw command buffer for each image, just like the instance buffers
+	DrawCommandBuffer.resize(SwapchainImages.size());
+	DrawCommandBufferMemory.resize(SwapchainImages.size());
+	DrawCommandBufferMapped.resize(SwapchainImages.size());
+
+	for(size_t i = 0; i < DrawCommandBuffer.size(); i++)
+	{
+		CreateBufferAndAllocateMemory(MainDevice.PhysicalDevice, MainDevice.LogicalDevice, bufferSize,
+			VK_BUFFER_USAGE_INDIRECT_BUFFER_BIT, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
+			&DrawCommandBuffer[i], &DrawCommandBufferMemory[i], Allocator);
+
+		void* data = nullptr;
+		vkMapMemory(MainDevice.LogicalDevice, DrawCommandBufferMemory[i], 0, bufferSize, 0, &data);
+		DrawCommandBufferMapped[i] = static_cast<VkDrawIndexedIndirectCommand*>(data);
+	}
+	DrawCommandCapacity = capacity;
+}
+
+void VulkanRenderer::DestroyDrawCommandBuffers()
+{
+	// frames in flight may still draw from them
+	VkDevice device = MainDevice.LogicalDevice;
+	const VkAllocationCallbacks* allocator = Allocator;
+	for(size_t i = 0; i < DrawCommandBuffer.size(); i++)
+	{
+		VkBuffer buffer = DrawCommandBuffer[i];
+		VkDeviceMemory memory = DrawCommandBufferMemory[i];
+		FrameDeletions.Push(SubmittedFrames, [device, allocator, buffer, memory]()
+		{
+			vkUnmapMemory(device, memory);
+			vkDestroyBuffer(device, buffer, allocator);
+			vkFreeMemory(device, memory, allocator);
+		});
+	}
+	DrawCommandBuffer.clear();
+	DrawCommandBufferMemory.clear();
+	DrawCommandBufferMapped.clear();
+	DrawCommandCapacity = 0;
+}
+
+void VulkanRenderer::AddInstance(MeshHandle mesh, SceneNode node, const glm::vec4& colour)
+{
+	if(mesh >= MeshInstances.size())
+	{
+		MeshInstances.resize(mesh + 1);
+		MeshInstanceGenerations.resize(mesh + 1, 0);
+	}
+	if(node >= InstanceLocations.size())
+	{
+		InstanceLocations.resize(node + 1, { INVALID_MESH_HANDLE, UINT32_MAX });
+	}
+
+	MeshInstance instance = {};
+	instance.Node = node;
+	PackInstanceColour(colour, instance.Colour);
+
+	InstanceLocations[node] = { mesh, static_cast<uint32_t>(MeshInstances[mesh].size()) };
+	MeshInstances[mesh].push_back(instance);
+
+	MarkInstancesChanged(mesh);
+	if(mesh >= MeshInstanceRanges.size() || MeshInstances[mesh].size() > MeshInstanceRanges[mesh].Capacity)
+	{
+		bInstanceRangeOverflowed = true;
+	}
+}
+
+void VulkanRenderer::MarkInstancesChanged(MeshHandle mesh)
+{
+	MeshInstanceGenerations[mesh] = ++InstanceGeneration;
+}
+
+void VulkanRenderer::LayoutInstances()
+{
+	// the ranges grow with the mesh list
+	FrameAllocationAllowance allowance;
+
+	// a range that overflows doubles, so adding instances one by one only moves the ranges every so often.
+	// the others keep their capacity, removed meshes give theirs back
+	MeshInstanceRanges.resize(MeshInstances.size(), { 0, 0 });
+	uint32_t instanceCount = 0;
+	uint32_t capacity = 0;
+	for(size_t mesh = 0; mesh < MeshInstances.size(); mesh++)
+	{
+		uint32_t count = static_cast<uint32_t>(MeshInstances[mesh].size());
+		uint32_t& meshCapacity = MeshInstanceRanges[mesh].Capacity;
+		if(count == 0)
+		{
+			meshCapacity = 0;
+		}
+		else if(count > meshCapacity)
+		{
+			meshCapacity = std::max({ count, 2 * meshCapacity, MIN_INSTANCE_CAPACITY });
+		}
+		instanceCount += count;
+		capacity += meshCapacity;
+	}
+
+	// every instance is a scene node, so they always fit without room to grow
+	bool bCompact = capacity > MAX_OBJECTS;
+	if(instanceCount > MAX_OBJECTS)
+	{
+		throw std::runtime_error("too many mesh instances for the instance buffer!");
+	}
+
+	// the instances of a mesh are one contiguous range, so they can be drawn with a single call
+	uint32_t firstInstance = 0;
+	for(size_t mesh = 0; mesh < MeshInstances.size(); mesh++)
+	{
+		InstanceRange& range = MeshInstanceRanges[mesh];
+		if(bCompact)
+		{
+			range.Capacity = static_cast<uint32_t>(MeshInstances[mesh].size());
+		}
+		range.First = firstInstance;
+		firstInstance += range.Capacity;
+	}
+
+	// one draw command per mesh handle
+	if(MeshInstances.size() > DrawCommandCapacity)
+	{
+		CreateDrawCommandBuffers(std::max(2 * static_cast<uint32_t>(MeshInstances.size()), MIN_DRAW_COMMAND_CAPACITY));
+	}
+
+	// the ranges moved: all buffers are rewritten, and the draws bind the instances at new offsets
+	std::fill(InstanceBufferGenerations.begin(), InstanceBufferGenerations.end(), 0);
+	DrawListVersion++;
+	bInstanceRangeOverflowed = false;
+}
+
+void VulkanRenderer::UpdateInstanceBuffer(uint32_t imageIndex)
+{
+	uint64_t& writtenGeneration = InstanceBufferGenerations[imageIndex];
+	if(writtenGeneration == InstanceGeneration)
+	{
+		return;
+	}
+
+	// only the ranges of the meshes whose instances changed since this buffer was written last.
+	// the count is part of the draw command, so it changes without re-recording the command buffer
+	for(size_t mesh = 0; mesh < MeshInstances.size(); mesh++)
+	{
+		if(MeshInstanceGenerations[mesh] > writtenGeneration)
+		{
+			std::copy(MeshInstances[mesh].begin(), MeshInstances[mesh].end(),
+				InstanceBufferMapped[imageIndex] + MeshInstanceRanges[mesh].First);
+
+			// the instance buffer is bound at the range, so the first instance stays 0
+			// (drawIndirectFirstInstance isn't needed)
+			VkDrawIndexedIndirectCommand& command = DrawCommandBufferMapped[imageIndex][mesh];
+			command.indexCount = mesh < MeshList.size() ? static_cast<uint32_t>(MeshList[mesh].GetIndexCount()) : 0;
+			command.instanceCount = static_cast<uint32_t>(MeshInstances[mesh].size());
+			command.firstIndex = 0;
+			command.vertexOffset = 0;
+			command.firstInstance = 0;
+		}
+	}
+
+	writtenGeneration = InstanceGeneration;
+}
+
+void VulkanRenderer::ProcessMeshUploads()
+{
+	// hand over the uploads that have finished
+	for(size_t i = 0; i < SubmittedMeshUploads.size();)
+	{
+		MeshUpload& upload = SubmittedMeshUploads[i];
+		if(vkGetFenceStatus(MainDevice.LogicalDevice, upload.Fence) != VK_SUCCESS)
+		{
+			i++;
+			continue;
+		}
+
+		// the scene graph and the lists grow
+		FrameAllocationAllowance allowance;
+
+		if(upload.Handle >= MeshList.size())
+		{
+			MeshList.resize(upload.Handle + 1);
+			MeshNodes.resize(upload.Handle + 1, INVALID_SCENE_NODE);
+		}
+		MeshList[upload.Handle] = upload.UploadedMesh;
+		TrackMeshMemory(upload.Handle);
+
+		// an evicted mesh still has its node and is still in the draw list, it's only skipped while recording
+		if(!upload.bRestream)
+		{
+			MeshNodes[upload.Handle] = Scene.CreateNode(SceneRoot);
+			AddInstance(upload.Handle, MeshNodes[upload.Handle], glm::vec4(1.0f));
+			DrawList.push_back(upload.Handle);
+		}
+		else
+		{
+			// the draw command has the index count of the mesh
+			MarkInstancesChanged(upload.Handle);
+		}
+		DrawListVersion++;
+
+		{
+			std::lock_guard<std::mutex> lock(MeshUploadMutex);
+			MeshStates[upload.Handle] = MESH_STATE_READY;
+		}
+
+		DestroyMeshUpload(upload);
+		SubmittedMeshUploads.erase(SubmittedMeshUploads.begin() + i);
+	}
+
+	// submit the newly staged uploads
+	std::vector<MeshUpload> stagedUploads;
+	{
+		std::lock_guard<std::mutex> lock(MeshUploadMutex);
+		stagedUploads.swap(StagedMeshUploads);
+	}
+
+	for(MeshUpload& upload : stagedUploads)
+	{
+		FrameAllocationAllowance allowance;
+
+		VkCommandBufferAllocateInfo allocInfo = {};
+		allocInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
+		allocInfo.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
+		allocInfo.commandPool = GraphicsCommandPool;
+		allocInfo.commandBufferCount = 1;
+
+		if(vkAllocateCommandBuffers(MainDevice.LogicalDevice, &allocInfo, &upload.CommandBuffer) != VK_SUCCESS)
+		{
+			throw std::runtime_error("failed to allocate a mesh upload command buffer!");
+		}
+
+		VkCommandBufferBeginInfo beginInfo = {};
+		beginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+		beginInfo.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
+
+		vkBeginCommandBuffer(upload.CommandBuffer, &beginInfo);
+		upload.UploadedMesh.RecordUpload(upload.CommandBuffer, upload.StagingBuffer);
+		vkEndCommandBuffer(upload.CommandBuffer);
+
+		VkFenceCreateInfo fenceCreateInfo = {};
+		fenceCreateInfo.sType = VK_STRUCTURE_TYPE_FENCE_CREATE_INFO;
+		if(vkCreateFence(MainDevice.LogicalDevice, &fenceCreateInfo, Allocator, &upload.Fence) != VK_SUCCESS)
+		{
+			throw std::runtime_error("failed to create a fence!");
+		}
+
+		// don't wait for it here, the next frames check the fence instead
+		VkSubmitInfo submitInfo = {};
+		submitInfo.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
+		submitInfo.commandBufferCount = 1;
+		submitInfo.pCommandBuffers = &upload.CommandBuffer;
+
+		if(vkQueueSubmit(GraphicsQueue, 1, &submitInfo, upload.Fence) != VK_SUCCESS)
+		{
+			throw std::runtime_error("failed to submit a mesh upload!");
+		}
+
+		SubmittedMeshUploads.push_back(upload);
+	}
+}
+
+void VulkanRenderer::ProcessMeshRemovals()
+{
+	std::lock_guard<std::mutex> lock(MeshUploadMutex);
+
+	for(size_t i = 0; i < PendingMeshRemovals.size();)
+	{
+		MeshHandle handle = PendingMeshRemovals[i];
+
+		// wait for meshes that are still loading, so their upload can finish cleanly
+		if(MeshStates[handle] == MESH_STATE_LOADING)
+		{
+			i++;
+			continue;
+		}
+
+		// already removed (RemoveMesh was called twice before we got here)
+		if(MeshStates[handle] == MESH_STATE_REMOVED)
+		{
+			PendingMeshRemovals.erase(PendingMeshRemovals.begin() + i);
+			continue;
+		}
 
-	// destroy shader modules, as they are no longer needed after pipeline creation
-	vkDestroyShaderModule(MainDevice.LogicalDevice, fragmentShaderModule, nullptr);
-	vkDestroyShaderModule(MainDevice.LogicalDevice, vertexShaderModule, nullptr);
-}
+		// queueing the deletion allocates
+		FrameAllocationAllowance allowance;
 
-void VulkanRenderer::CreateFramebuffers()
-{
-	SwapchainFramebuffers.resize(SwapchainImages.size());
+		// everything the mesh still owns goes, whatever state it's in (a mesh that failed to load never got a node)
+		if(handle < MeshNodes.size() && MeshNodes[handle] != INVALID_SCENE_NODE)
+		{
+			DrawList.erase(std::remove(DrawList.begin(), DrawList.end(), handle), DrawList.end());
+			DrawListVersion++;
 
-	// create a framebuffer for each swapchain image
-	for(size_t i = 0; i < SwapchainFramebuffers.size(); i++)
-	{
-		std::array<VkImageView, 1> attachments = {
-			SwapchainImages[i].ImageView
-		};
+			// its own node is one of its instances. they're destroyed together, every single destroy would
+			// go over the whole scene graph
+			if(handle < MeshInstances.size())
+			{
+				std::vector<SceneNode> instanceNodes;
+				instanceNodes.reserve(MeshInstances[handle].size());
+				for(const MeshInstance& instance : MeshInstances[handle])
+				{
+					InstanceLocations[instance.Node].Index = UINT32_MAX;
+					instanceNodes.push_back(instance.Node);
+				}
+				Scene.DestroyNodes(instanceNodes.data(), static_cast<uint32_t>(instanceNodes.size()));
+				// its range is given back with the next layout
+				MeshInstances[handle].clear();
+				MarkInstancesChanged(handle);
+			}
+			MeshNodes[handle] = INVALID_SCENE_NODE;
+		}
 
-		VkFramebufferCreateInfo createInfo = {};
-		createInfo.sType = VK_STRUCTURE_TYPE_FRAMEBUFFER_CREATE_INFO;
-		createInfo.renderPass = RenderPass;
-		// attachments are 1:1 with the render pass attachments
-		createInfo.attachmentCount = static_cast<uint32_t>(attachments.size());
-		createInfo.pAttachments = attachments.data();
-		createInfo.width = SwapchainResolution.width;
-		createInfo.height = SwapchainResolution.height;
-		createInfo.layers = 1;
+		// frames submitted up to now may still draw the mesh (evicted ones have no buffers anymore)
+		if(MeshStates[handle] == MESH_STATE_READY)
+		{
+			UntrackMeshMemory(handle);
 
-		VkResult result = vkCreateFramebuffer(MainDevice.LogicalDevice, &createInfo, nullptr, &SwapchainFramebuffers[i]);
-		if(result != VK_SUCCESS)
+			Mesh removedMesh = MeshList[handle];
+			FrameDeletions.Push(SubmittedFrames, [removedMesh]() mutable
+			{
+				removedMesh.DestroyBuffers();
+			});
+			MeshList[handle] = Mesh();
+		}
+		if(handle < MeshLoaders.size())
 		{
-			throw std::runtime_error("failed to create a framebuffer!");
+			MeshLoaders[handle] = MeshLoadFunction();
 		}
+
+		MeshStates[handle] = MESH_STATE_REMOVED;
+		PendingMeshRemovals.erase(PendingMeshRemovals.begin() + i);
 	}
 }
 
-void VulkanRenderer::CreateCommandPool()
+void VulkanRenderer::UpdateMeshResidency()
 {
-	// get indices of queue families from device
-	QueueFamilyIndicies queueFamilyIndices = GetQueueFamilies(MainDevice.PhysicalDevice);
-
-	VkCommandPoolCreateInfo createInfo = {};
-	createInfo.sType = VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO;
-	createInfo.queueFamilyIndex = queueFamilyIndices.GraphicsFamily; 	//queue family type that buffers from this command pool will used
+	Memory.Update();
 
-	// create a GRAPHICS QUEUE FAMILY command pool
-	VkResult result = vkCreateCommandPool(MainDevice.LogicalDevice, &createInfo, nullptr, &GraphicsCommandPool);
-	if(result != VK_SUCCESS)
+	// drawn meshes are the most recently used ones, the evicted among them have to come back
+	ArenaVector<MeshHandle> restreams{ArenaAllocator<MeshHandle>(GetFrameArena())};
 	{
-		throw std::runtime_error("failed to create a command pool!");
+		std::lock_guard<std::mutex> lock(MeshUploadMutex);
+
+		for(uint32_t meshIndex : DrawList)
+		{
+			MeshResidencies[meshIndex].LastDrawnFrame = SubmittedFrames;
+
+			if(MeshStates[meshIndex] == MESH_STATE_EVICTED)
+			{
+				MeshStates[meshIndex] = MESH_STATE_LOADING;
+				restreams.push_back(meshIndex);
+			}
+		}
 	}
-}
 
-void VulkanRenderer::CreateCommandBuffers()
-{
-	// resize command buffer count to have onef or each frame buffer
-	CommandBuffers.resize(SwapchainFramebuffers.size());
+	for(MeshHandle handle : restreams)
+	{
+		// the loader is copied into a new job
+		FrameAllocationAllowance allowance;
 
-	// the command buffers exist in the command pool already, therefore allocate rather than create
-	VkCommandBufferAllocateInfo allocateInfo = {};
-	allocateInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
-	allocateInfo.commandPool = GraphicsCommandPool;
-	// Primary: directly called by queue. 	Secondary: can't be called by queue, but by other command buffer (i.e. by a primary)
-	//											-> called by "vkCmdExecuteCommands" from Primary cmd buffer
-	allocateInfo.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
-	// don't allocate cmd buffers in loop, as they all have the same setup. allocate all of them at once
-	allocateInfo.commandBufferCount = static_cast<uint32_t>(CommandBuffers.size());
+		MeshLoadFunction loader;
+		{
+			std::lock_guard<std::mutex> lock(MeshUploadMutex);
+			loader = MeshLoaders[handle];
+		}
+		StreamMesh(handle, loader, true);
+	}
 
-	// allocate command buffers and place handles in array of buffers
-	// since this is allocated rather than created, no destroy is needed
-	VkResult result = vkAllocateCommandBuffers(MainDevice.LogicalDevice, &allocateInfo, CommandBuffers.data());
-	if(result != VK_SUCCESS)
+	// with VK_EXT_memory_budget, the driver only sees evicted memory as freed once the deletions have run.
+	// don't evict again before that, or we'd evict far too much
+	VkDeviceSize overBudget = Memory.GetOverBudget(Memory.GetDeviceLocalHeap());
+	if(overBudget == 0)
 	{
-		throw std::runtime_error("failed to allocate command buffers!");
+		bReportedOverBudget = false;
+		return;
 	}
+	if(SubmittedFrames < NextEvictionFrame)
+	{
+		return;
+	}
+
+	EvictMeshes(overBudget);
+	NextEvictionFrame = SubmittedFrames + MAX_FRAME_DRAWS + 1;
 }
 
-void VulkanRenderer::CreateSynchronizationObjects()
+void VulkanRenderer::EvictMeshes(VkDeviceSize size)
 {
-	ImagesAvailable.resize(MAX_FRAME_DRAWS);
-	RendersFinished.resize(MAX_FRAME_DRAWS);
-	DrawFences.resize(MAX_FRAME_DRAWS);
-
-	// semaphore creation information
-	VkSemaphoreCreateInfo semaphoreCreateInfo = {};
-	semaphoreCreateInfo.sType = VK_STRUCTURE_TYPE_SEMAPHORE_CREATE_INFO;
+	std::lock_guard<std::mutex> lock(MeshUploadMutex);
 
-	VkFenceCreateInfo fenceCreateInfo = {};
-	fenceCreateInfo.sType = VK_STRUCTURE_TYPE_FENCE_CREATE_INFO;
-	// fence should be open before rendering (otherwise we block draw, since it waits for open)
-	fenceCreateInfo.flags = VK_FENCE_CREATE_SIGNALED_BIT;
+	// resident meshes that can be streamed again and weren't drawn this frame
+	ArenaVector<MeshHandle> candidates{ArenaAllocator<MeshHandle>(GetFrameArena())};
+	for(MeshHandle handle = 0; handle < static_cast<MeshHandle>(MeshList.size()); handle++)
+	{
+		if(MeshStates[handle] == MESH_STATE_READY && MeshList[handle].IsValid()
+			&& handle < MeshLoaders.size() && MeshLoaders[handle]
+			&& handle < MeshResidencies.size() && MeshResidencies[handle].LastDrawnFrame < SubmittedFrames)
+		{
+			candidates.push_back(handle);
+		}
+	}
 
-	for(uint32_t i = 0; i < MAX_FRAME_DRAWS; i++)
+	// lowest priority first, then least recently drawn
+	std::sort(candidates.begin(), candidates.end(), [this](MeshHandle a, MeshHandle b)
 	{
-		if(vkCreateSemaphore(MainDevice.LogicalDevice, &semaphoreCreateInfo, nullptr, &ImagesAvailable[i]) != VK_SUCCESS
-			|| vkCreateSemaphore(MainDevice.LogicalDevice, &semaphoreCreateInfo, nullptr, &RendersFinished[i]) != VK_SUCCESS)
+		const MeshResidency& residencyA = MeshResidencies[a];
+		const MeshResidency& residencyB = MeshResidencies[b];
+		if(residencyA.Priority != residencyB.Priority)
 		{
-			throw std::runtime_error("failed to create a semaphore!");
+			return residencyA.Priority < residencyB.Priority;
 		}
+		return residencyA.LastDrawnFrame < residencyB.LastDrawnFrame;
+	});
 
-		if(vkCreateFence(MainDevice.LogicalDevice, &fenceCreateInfo, nullptr, &DrawFences[i]) != VK_SUCCESS)
+	VkDeviceSize evicted = 0;
+	for(MeshHandle handle : candidates)
+	{
+		if(evicted >= size)
 		{
-			throw std::runtime_error("failed to create a fence!");
+			break;
 		}
-	}
-}
 
-void VulkanRenderer::CreateUniformBuffers()
-{
-	// buffer size will be size of all three matrices (will offset to access)
-	VkDeviceSize bufferSize = sizeof(MatrixSetup);
+		// queueing the deletion allocates
+		FrameAllocationAllowance allowance;
 
-	// one uniform buffer for each image (and by extension, command buffer)
-	UniformBuffer.resize(SwapchainImages.size());
-	UniformBufferMemory.resize(SwapchainImages.size());
+		evicted += MeshResidencies[handle].Size;
+		UntrackMeshMemory(handle);
 
-	// Create uniform buffers
-	for(size_t i = 0; i < UniformBuffer.size(); i++)
+		// it isn't in the draw list, but frames in flight may have drawn it
+		Mesh evictedMesh = MeshList[handle];
+		FrameDeletions.Push(SubmittedFrames, [evictedMesh]() mutable
+		{
+			evictedMesh.DestroyBuffers();
+		});
+		MeshList[handle] = Mesh();
+
+		MeshStates[handle] = MESH_STATE_EVICTED;
+	}
+
+	// everything that is left is drawn right now
+	if(evicted < size && !bReportedOverBudget)
 	{
-		CreateBufferAndAllocateMemory(MainDevice.PhysicalDevice, MainDevice.LogicalDevice, bufferSize,
-			VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
-			&UniformBuffer[i], &UniformBufferMemory[i]);
+		printf("WARNING: device memory over budget by %llu bytes, but all remaining meshes are in use\n",
+			static_cast<unsigned long long>(size - evicted));
+		bReportedOverBudget = true;
 	}
 }
 
-void VulkanRenderer::CreateDescriptorPool()
+void VulkanRenderer::TrackMeshMemory(MeshHandle handle)
 {
-	// type of descriptors + how many DESCRIPTORS (not Descr Sets!) -> combinde makes the pool size
-	VkDescriptorPoolSize poolSize = {};
-	poolSize.type = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER;
-	// TODO: is this still UniformBufferSize, if the number of matrices changes?
-	// 		his explanation suggests, this is the number of matrices
-	poolSize.descriptorCount = static_cast<uint32_t>(UniformBuffer.size());
-
-	// data to create descriptor pool
-	VkDescriptorPoolCreateInfo createInfo = {};
-	createInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO;
-	createInfo.maxSets = static_cast<uint32_t>(UniformBuffer.size());
-	createInfo.poolSizeCount = 1;
-	createInfo.pPoolSizes = &poolSize;
-
-	// create descriptor pool
-	VkResult result = vkCreateDescriptorPool(MainDevice.LogicalDevice, &createInfo, nullptr, &DescriptorPool);
-	if(result != VK_SUCCESS)
+	if(handle >= MeshResidencies.size())
 	{
-		throw std::runtime_error("failed to create a descriptor pool!");
+		MeshResidencies.resize(handle + 1);
 	}
+
+	// only the mesh buffers are tracked without VK_EXT_memory_budget, they're the bulk of the memory
+	// (and the only thing that can be evicted)
+	MeshResidency& residency = MeshResidencies[handle];
+	residency.Size = MeshList[handle].GetMemorySize();
+	residency.LastDrawnFrame = SubmittedFrames;
+	Memory.TrackAllocation(Memory.GetDeviceLocalHeap(), residency.Size);
 }
 
-void VulkanRenderer::CreateDescriptorSets()
+void VulkanRenderer::UntrackMeshMemory(MeshHandle handle)
 {
-	// resize descriptor set list to one for every buffer
-	DescriptorSets.resize(UniformBuffer.size());
-
-	std::vector<VkDescriptorSetLayout> setLayouts(UniformBuffer.size(), DescriptorSetLayout);
-
-	// descriptor set allocation
-	VkDescriptorSetAllocateInfo allocInfo = {};
-	allocInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO;
-	allocInfo.descriptorPool = DescriptorPool;
-	allocInfo.descriptorSetCount = static_cast<uint32_t>(UniformBuffer.size());
-	// although all sets have the same layout, we need to give one layout for every descriptor set
-	allocInfo.pSetLayouts = setLayouts.data();
-
-	// actually allocate descriptor sets (multiple)
-	VkResult result = vkAllocateDescriptorSets(MainDevice.LogicalDevice, &allocInfo, DescriptorSets.data());
-	if(result != VK_SUCCESS)
-	{
-		throw std::runtime_error("could not allocate descriptor sets");
-	}
+	MeshResidency& residency = MeshResidencies[handle];
+	Memory.TrackFree(Memory.GetDeviceLocalHeap(), residency.Size);
+	residency.Size = 0;
+}
 
-	// the descriptor sets don't hold any information used by the shader themselves.
-	// the actual data will be stored in uniform buffers, which the descripor sets then use.
-	// -> update all of descriptor set buffer bindings
-	for(size_t i = 0; i < DescriptorSets.size(); i++)
+void VulkanRenderer::DestroyMeshUpload(MeshUpload& upload)
+{
+	// only the temporary upload resources, the mesh buffers themselves are kept
+	vkDestroyBuffer(MainDevice.LogicalDevice, upload.StagingBuffer, Allocator);
+	vkFreeMemory(MainDevice.LogicalDevice, upload.StagingBufferMemory, Allocator);
+	if(upload.CommandBuffer != VK_NULL_HANDLE)
 	{
-		// buffer info and data offset info
-		VkDescriptorBufferInfo mvpBufferInfo = {};
-		// the buffer to get data from
-		mvpBufferInfo.buffer = UniformBuffer[i];
-		// offset in data (e.g. if we only wanted to bind second half of data)
-		mvpBufferInfo.offset = 0;
-		//
-		mvpBufferInfo.range = sizeof(MatrixSetup);
-
-		// data about connection between binding and buffer
-		VkWriteDescriptorSet mvpSetWrite = {};
-		mvpSetWrite.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
-		// here is the connection between descriptor set and uniform buffer:
-		mvpSetWrite.dstSet = DescriptorSets[i];
-		// the binding as specified in the shader
-		mvpSetWrite.dstBinding = 0;
-		// if we had an array of data, we could update at a certain index here
-		mvpSetWrite.dstArrayElement = 0;
-		// the type, which should match the type in the descriptor set
-		mvpSetWrite.descriptorType = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER;
-		// amount to update
-		mvpSetWrite.descriptorCount = 1;
-		// we want "generic" data, therefore fill pBufferInfo, not pImageInfo or pTexelBufferView
-		// information about buffer data to bind
-		mvpSetWrite.pBufferInfo = &mvpBufferInfo;
-
-		// update the descriptor sets with new buffer/binding info
-		vkUpdateDescriptorSets(MainDevice.LogicalDevice, 1, &mvpSetWrite, 0, nullptr);
+		vkFreeCommandBuffers(MainDevice.LogicalDevice, GraphicsCommandPool, 1, &upload.CommandBuffer);
 	}
+	vkDestroyFence(MainDevice.LogicalDevice, upload.Fence, Allocator);
 }
 
-void VulkanRenderer::UpdateUniformBuffer(const uint32_t& imageIndex)
+void VulkanRenderer::RecordCommands()
 {
-	void* data = nullptr;
-	vkMapMemory(MainDevice.LogicalDevice, UniformBufferMemory[imageIndex], 0, sizeof(MatrixSetup), 0, &data);
-	memcpy(data, &ModelViewProjectMatrix, sizeof(MatrixSetup));
-	vkUnmapMemory(MainDevice.LogicalDevice, UniformBufferMemory[imageIndex]);
+	for(uint32_t i = 0; i < static_cast<uint32_t>(CommandBuffers.size()); i++)
+	{
+		RecordCommandBuffer(i);
+	}
 }
 
-void VulkanRenderer::RecordCommands()
+void VulkanRenderer::RecordCommandBuffer(uint32_t imageIndex)
 {
-	// information about how to begin _each_ command buffer (for our use case, this can be shared)
+	// information about how to begin the command buffer
 	VkCommandBufferBeginInfo bufferBeginInfo = {};
 	bufferBeginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
 	// SIMULTANEOUS_USE_BIT: buffer can be resubmitted when it has already been submitted and is awaiting execution
@@ -1030,75 +2745,228 @@ void VulkanRenderer::RecordCommands()
 	renderPassBeginInfo.renderArea.offset = {0, 0};
 	renderPassBeginInfo.renderArea.extent = SwapchainResolution;
 	// the load op means a clear at the start, therefore clear values are needed
-	VkClearValue clearValues[] = {
-		{0.6f, 0.65f, 0.4f, 1.0f}
-	};
+	// (one per attachment, the resolve attachment isn't cleared)
+	VkClearValue clearValues[2] = {};
+	clearValues[0].color = {0.6f, 0.65f, 0.4f, 1.0f};
+	clearValues[1].depthStencil.depth = 1.0f;
 	renderPassBeginInfo.pClearValues = clearValues;
-	renderPassBeginInfo.clearValueCount = 1;
+	renderPassBeginInfo.clearValueCount = 2;
+	renderPassBeginInfo.framebuffer = bDynamicRendering ? VK_NULL_HANDLE : SwapchainFramebuffers[imageIndex];
+
+	VkCommandBuffer commandBuffer = CommandBuffers[imageIndex];
 
-	for(size_t i = 0; i < CommandBuffers.size(); i++)
+	// start recording commands to command buffer
+	VkResult result = vkBeginCommandBuffer(commandBuffer, &bufferBeginInfo);
+	if(result != VK_SUCCESS)
 	{
-		renderPassBeginInfo.framebuffer = SwapchainFramebuffers[i];
+		throw std::runtime_error("failed to start recording a command buffer!");
+	}
+	{	// command buffer
 
-		// start recording commands to command buffer
-		VkResult result = vkBeginCommandBuffer(CommandBuffers[i], &bufferBeginInfo);
-		if(result != VK_SUCCESS)
+		// compute work the draws depend on (the compute system adds the barriers)
+		Compute.RecordDispatches(commandBuffer, imageIndex, COMPUTE_STAGE_BEFORE_RENDER_PASS);
+
+		// begin render pass
+		// VK_SUBPASS_CONTENTS_INLINE: all commands are contained in this cmd buffer (no secondary cmd buffers)
+		if(bDynamicRendering)
 		{
-			throw std::runtime_error("failed to start recording a command buffer!");
+			RecordBeginRendering(commandBuffer, imageIndex);
 		}
-		{	// command buffer
-
-			// begin render pass
-			// VK_SUBPASS_CONTENTS_INLINE: all commands are contained in this cmd buffer (no secondary cmd buffers)
-			vkCmdBeginRenderPass(CommandBuffers[i], &renderPassBeginInfo, VK_SUBPASS_CONTENTS_INLINE);
-			//begin render pass will "excute" render pass' load op
-			//and go to the first subpass
+		else
+		{
+			vkCmdBeginRenderPass(commandBuffer, &renderPassBeginInfo, VK_SUBPASS_CONTENTS_INLINE);
+		}
+		//begin render pass will "excute" render pass' load op
+		//and go to the first subpass
+		{
+			//if you have multiple objects to render, you would have different command buffers to bind
+			//and loop through those here:
+			//for(auto object : objectList){...
+			//		(changing the object list -> rerecord the command buffer. recording this is not expensive!)
+			// meshes can use different pipelines, only rebind when it changes
+			VkPipeline boundPipeline = VK_NULL_HANDLE;
+
+			// bind descriptor sets: frame, view and object data are the same for all meshes, so they're bound once
+			// and stay bound across the pipeline changes (all mesh pipeline layouts start with these sets)
+			vkCmdBindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, PipelineLayout,
+				0, UNIFORM_SET_COUNT, DescriptorSets[imageIndex].data(), 0, nullptr);
+
+			for(uint32_t meshIndex : DrawList)
 			{
-				//if you have multiple objects to render, you would have different command buffers to bind
-				//and loop through those here:
-				//for(auto object : objectList){...
-				//		(changing the object list -> rerecord the command buffer. recording this is not expensive!)
-				vkCmdBindPipeline(CommandBuffers[i], VK_PIPELINE_BIND_POINT_GRAPHICS, GraphicsPipeline);
-
-				for(size_t j = 0; j < MeshList.size(); j++)
+				// evicted (and still streaming back in) meshes are left out
+				const Mesh& mesh = MeshList[meshIndex];
+				if(!mesh.IsValid())
 				{
-					// buffers to bind for drawing
-					VkBuffer vertexBuffers[] = { MeshList[j].GetVertexBuffer() };
+					continue;
+				}
 
-					// offsets into buffers being bound
-					VkDeviceSize offsets[] = { 0 };
+				// nothing compatible is built yet, the mesh shows up once it is
+				VkPipeline pipeline = GetGraphicsPipeline(GetMeshPipelineState(meshIndex));
+				if(pipeline == VK_NULL_HANDLE)
+				{
+					continue;
+				}
+				if(pipeline != boundPipeline)
+				{
+					vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, pipeline);
+					boundPipeline = pipeline;
+				}
 
-					// command to bind vertex buffer before drawing with them
-					vkCmdBindVertexBuffers(CommandBuffers[i], 0, 1, vertexBuffers, offsets);
+				// buffers to bind for drawing: the mesh's vertices and its range of the instances
+				VkBuffer vertexBuffers[] = { mesh.GetVertexBuffer(), InstanceBuffer[imageIndex] };
 
-					// command to bind index buffer with 0 offset and using the uint32 type
-					vkCmdBindIndexBuffer(CommandBuffers[i], MeshList[j].GetIndexBuffer(), 0, VK_INDEX_TYPE_UINT32);
+				// offsets into buffers being bound
+				VkDeviceSize offsets[] = { 0, sizeof(MeshInstance) * MeshInstanceRanges[meshIndex].First };
 
-					// execute pipeline
+				// command to bind vertex buffer before drawing with them
+				vkCmdBindVertexBuffers(commandBuffer, 0, 2, vertexBuffers, offsets);
 
-					// draw vertices directly (without index buffer):
-					// vkCmdDraw(CommandBuffers[i], static_cast<uint32_t>(MeshList[j].GetVertexCount()), 1, 0, 0);
+				// command to bind index buffer with 0 offset and using the uint32 type
+				vkCmdBindIndexBuffer(commandBuffer, mesh.GetIndexBuffer(), 0, VK_INDEX_TYPE_UINT32);
 
-					// bin descriptor sets
-					vkCmdBindDescriptorSets(CommandBuffers[i], VK_PIPELINE_BIND_POINT_GRAPHICS, PipelineLayout,
-						0, 1, &DescriptorSets[i], 0, nullptr);
+				// execute pipeline
 
-					// draw vertices with index buffer:
-					vkCmdDrawIndexed(CommandBuffers[i], MeshList[j].GetIndexCount(), 1, 0, 0, 0);
-				}
+				// draw vertices directly (without index buffer):
+				// vkCmdDraw(commandBuffer, static_cast<uint32_t>(mesh.GetVertexCount()), 1, 0, 0);
 
+				// draw vertices with index buffer, once per instance:
+				// every instance holds its scene node, which the shader uses to look up its matrix.
+				// the counts come from the draw command buffer, adding or removing instances doesn't re-record
+				vkCmdDrawIndexedIndirect(commandBuffer, DrawCommandBuffer[imageIndex],
+					sizeof(VkDrawIndexedIndirectCommand) * meshIndex, 1, sizeof(VkDrawIndexedIndirectCommand));
 			}
-			// end render pass (will "execute" render pass' store op)
-			vkCmdEndRenderPass(CommandBuffers[i]);
+
+			// all particles in one instanced draw, after the opaque meshes
+			Particles.RecordDraw(commandBuffer, imageIndex);
 
 		}
-		// stop recording to command buffer
-		result = vkEndCommandBuffer(CommandBuffers[i]);
-		if(result != VK_SUCCESS)
+		// end render pass (will "execute" render pass' store op)
+		if(bDynamicRendering)
+		{
+			RecordEndRendering(commandBuffer, imageIndex);
+		}
+		else
 		{
-			throw std::runtime_error("failed to end recording a command buffer!");
+			vkCmdEndRenderPass(commandBuffer);
 		}
+
+		// compute work on the results of the render pass
+		Compute.RecordDispatches(commandBuffer, imageIndex, COMPUTE_STAGE_AFTER_RENDER_PASS);
+
+	}
+	// stop recording to command buffer
+	result = vkEndCommandBuffer(commandBuffer);
+	if(result != VK_SUCCESS)
+	{
+		throw std::runtime_error("failed to end recording a command buffer!");
 	}
+
+	CommandBufferVersions[imageIndex] = DrawListVersion + Compute.GetVersion();
+}
+
+void VulkanRenderer::RecordBeginRendering(VkCommandBuffer commandBuffer, uint32_t imageIndex)
+{
+	const bool bMultisampled = MsaaSamples != VK_SAMPLE_COUNT_1_BIT;
+	VkImage swapchainImage = SwapchainImages[imageIndex].Image;
+
+	// the transitions the render pass does with its first subpass dependency:
+	// contents are cleared, so all images start out UNDEFINED. the colour and depth images are shared by all
+	// frames in flight, so the previous frame has to be done with them
+	std::array<VkImageMemoryBarrier, 3> barriers = {};
+	uint32_t barrierCount = 0;
+
+	VkImageMemoryBarrier& swapchainBarrier = barriers[barrierCount++];
+	swapchainBarrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
+	swapchainBarrier.srcAccessMask = 0;
+	swapchainBarrier.dstAccessMask = VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT;
+	swapchainBarrier.oldLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+	swapchainBarrier.newLayout = VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL;
+	swapchainBarrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+	swapchainBarrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+	swapchainBarrier.image = swapchainImage;
+	swapchainBarrier.subresourceRange = { VK_IMAGE_ASPECT_COLOR_BIT, 0, 1, 0, 1 };
+
+	if(bMultisampled)
+	{
+		VkImageMemoryBarrier& colourBarrier = barriers[barrierCount++];
+		colourBarrier = swapchainBarrier;
+		colourBarrier.srcAccessMask = VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT;
+		colourBarrier.dstAccessMask = VK_ACCESS_COLOR_ATTACHMENT_READ_BIT | VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT;
+		colourBarrier.image = ColourImage;
+	}
+
+	VkImageMemoryBarrier& depthBarrier = barriers[barrierCount++];
+	depthBarrier = swapchainBarrier;
+	depthBarrier.srcAccessMask = VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT;
+	depthBarrier.dstAccessMask = VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_READ_BIT | VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT;
+	depthBarrier.newLayout = VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL;
+	depthBarrier.image = DepthImage;
+	depthBarrier.subresourceRange.aspectMask = VK_IMAGE_ASPECT_DEPTH_BIT;
+	if(DepthFormat == VK_FORMAT_D24_UNORM_S8_UINT || DepthFormat == VK_FORMAT_D32_SFLOAT_S8_UINT)
+	{
+		// layouts of combined formats always cover both aspects
+		depthBarrier.subresourceRange.aspectMask |= VK_IMAGE_ASPECT_STENCIL_BIT;
+	}
+
+	vkCmdPipelineBarrier(commandBuffer,
+		VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT | VK_PIPELINE_STAGE_LATE_FRAGMENT_TESTS_BIT,
+		VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT | VK_PIPELINE_STAGE_EARLY_FRAGMENT_TESTS_BIT, 0,
+		0, nullptr, 0, nullptr, barrierCount, barriers.data());
+
+	// same load and store ops as the render pass attachments
+	VkRenderingAttachmentInfo colourAttachment = {};
+	colourAttachment.sType = VK_STRUCTURE_TYPE_RENDERING_ATTACHMENT_INFO;
+	colourAttachment.imageView = bMultisampled ? ColourImageView : SwapchainImages[imageIndex].ImageView;
+	colourAttachment.imageLayout = VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL;
+	colourAttachment.loadOp = VK_ATTACHMENT_LOAD_OP_CLEAR;
+	colourAttachment.storeOp = bMultisampled ? VK_ATTACHMENT_STORE_OP_DONT_CARE : VK_ATTACHMENT_STORE_OP_STORE;
+	colourAttachment.clearValue.color = {0.6f, 0.65f, 0.4f, 1.0f};
+	if(bMultisampled)
+	{
+		// resolve the samples into the swapchain image at the end of rendering
+		colourAttachment.resolveMode = VK_RESOLVE_MODE_AVERAGE_BIT;
+		colourAttachment.resolveImageView = SwapchainImages[imageIndex].ImageView;
+		colourAttachment.resolveImageLayout = VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL;
+	}
+
+	VkRenderingAttachmentInfo depthAttachment = {};
+	depthAttachment.sType = VK_STRUCTURE_TYPE_RENDERING_ATTACHMENT_INFO;
+	depthAttachment.imageView = DepthImageView;
+	depthAttachment.imageLayout = VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL;
+	depthAttachment.loadOp = VK_ATTACHMENT_LOAD_OP_CLEAR;
+	depthAttachment.storeOp = VK_ATTACHMENT_STORE_OP_DONT_CARE;
+	depthAttachment.clearValue.depthStencil.depth = 1.0f;
+
+	VkRenderingInfo renderingInfo = {};
+	renderingInfo.sType = VK_STRUCTURE_TYPE_RENDERING_INFO;
+	renderingInfo.renderArea.offset = {0, 0};
+	renderingInfo.renderArea.extent = SwapchainResolution;
+	renderingInfo.layerCount = 1;
+	renderingInfo.colorAttachmentCount = 1;
+	renderingInfo.pColorAttachments = &colourAttachment;
+	renderingInfo.pDepthAttachment = &depthAttachment;
+
+	CmdBeginRendering(commandBuffer, &renderingInfo);
+}
+
+void VulkanRenderer::RecordEndRendering(VkCommandBuffer commandBuffer, uint32_t imageIndex)
+{
+	CmdEndRendering(commandBuffer);
+
+	// what the render pass' final layout and last subpass dependency did: hand the image over to presentation
+	VkImageMemoryBarrier presentBarrier = {};
+	presentBarrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
+	presentBarrier.srcAccessMask = VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT;
+	presentBarrier.dstAccessMask = VK_ACCESS_MEMORY_READ_BIT;
+	presentBarrier.oldLayout = VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL;
+	presentBarrier.newLayout = VK_IMAGE_LAYOUT_PRESENT_SRC_KHR;
+	presentBarrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+	presentBarrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+	presentBarrier.image = SwapchainImages[imageIndex].Image;
+	presentBarrier.subresourceRange = { VK_IMAGE_ASPECT_COLOR_BIT, 0, 1, 0, 1 };
+
+	vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT, VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT, 0,
+		0, nullptr, 0, nullptr, 1, &presentBarrier);
 }
 
 void VulkanRenderer::GetPhysicalDevice()
@@ -1197,6 +3065,103 @@ bool VulkanRenderer::CheckDeviceExtensionSupport(VkPhysicalDevice physicalDevice
 	return true;
 }
 
+bool VulkanRenderer::CheckDynamicRenderingSupport(VkPhysicalDevice physicalDevice)
+{
+	// dynamic rendering is core in 1.3, 1.2 devices can have it through VK_KHR_dynamic_rendering
+	// (its other dependencies, depth stencil resolve and features2, are core in 1.2)
+	VkPhysicalDeviceProperties deviceProperties;
+	vkGetPhysicalDeviceProperties(physicalDevice, &deviceProperties);
+
+	uint32_t apiMinor = std::min(VK_API_VERSION_MINOR(InstanceApiVersion), VK_API_VERSION_MINOR(deviceProperties.apiVersion));
+	if(apiMinor < 2)
+	{
+		return false;
+	}
+
+	bDynamicRenderingExtension = apiMinor < 3;
+	if(bDynamicRenderingExtension)
+	{
+		uint32_t extensionCount = 0;
+		vkEnumerateDeviceExtensionProperties(physicalDevice, nullptr, &extensionCount, nullptr);
+		std::vector<VkExtensionProperties> extensions(extensionCount);
+		vkEnumerateDeviceExtensionProperties(physicalDevice, nullptr, &extensionCount, extensions.data());
+
+		bool hasExtension = false;
+		for(const auto& extension : extensions)
+		{
+			if(strcmp(extension.extensionName, VK_KHR_DYNAMIC_RENDERING_EXTENSION_NAME) == 0)
+			{
+				hasExtension = true;
+				break;
+			}
+		}
+
+		if(!hasExtension)
+		{
+			bDynamicRenderingExtension = false;
+			return false;
+		}
+	}
+
+	auto getFeatures2 = (PFN_vkGetPhysicalDeviceFeatures2) vkGetInstanceProcAddr(Instance, "vkGetPhysicalDeviceFeatures2");
+	if(getFeatures2 == nullptr)
+	{
+		return false;
+	}
+
+	VkPhysicalDeviceDynamicRenderingFeatures dynamicRenderingFeatures = {};
+	dynamicRenderingFeatures.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_DYNAMIC_RENDERING_FEATURES;
+
+	VkPhysicalDeviceFeatures2 features = {};
+	features.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_FEATURES_2;
+	features.pNext = &dynamicRenderingFeatures;
+	getFeatures2(physicalDevice, &features);
+
+	if(dynamicRenderingFeatures.dynamicRendering != VK_TRUE)
+	{
+		bDynamicRenderingExtension = false;
+		return false;
+	}
+
+	return true;
+}
+
+bool VulkanRenderer::CheckMemoryBudgetSupport(VkPhysicalDevice physicalDevice)
+{
+	// the budget is queried through vkGetPhysicalDeviceMemoryProperties2, which is core in 1.1
+	VkPhysicalDeviceProperties deviceProperties;
+	vkGetPhysicalDeviceProperties(physicalDevice, &deviceProperties);
+
+	if(VK_API_VERSION_MINOR(InstanceApiVersion) < 1 || VK_API_VERSION_MINOR(deviceProperties.apiVersion) < 1)
+	{
+		return false;
+	}
+
+	uint32_t extensionCount = 0;
+	vkEnumerateDeviceExtensionProperties(physicalDevice, nullptr, &extensionCount, nullptr);
+	std::vector<VkExtensionProperties> extensions(extensionCount);
+	vkEnumerateDeviceExtensionProperties(physicalDevice, nullptr, &extensionCount, extensions.data());
+
+	for(const auto& extension : extensions)
+	{
+		if(strcmp(extension.extensionName, VK_EXT_MEMORY_BUDGET_EXTENSION_NAME) == 0)
+		{
+			return true;
+		}
+	}
+
+	return false;
+}
+
+bool VulkanRenderer::CheckDescriptorUpdateTemplateSupport(VkPhysicalDevice physicalDevice)
+{
+	// update templates are core in 1.1
+	VkPhysicalDeviceProperties deviceProperties;
+	vkGetPhysicalDeviceProperties(physicalDevice, &deviceProperties);
+
+	return VK_API_VERSION_MINOR(InstanceApiVersion) >= 1 && VK_API_VERSION_MINOR(deviceProperties.apiVersion) >= 1;
+}
+
 bool VulkanRenderer::CheckPhysicalDeviceSuitable(const VkPhysicalDevice& device)
 {
 	//information about the device itself (ID, name, type, vendor, etc)
@@ -1372,6 +3337,101 @@ VkExtent2D VulkanRenderer::ChooseSwapChainExtent(const VkSurfaceCapabilitiesKHR
 	}
 }
 
+VkSampleCountFlagBits VulkanRenderer::GetMaxUsableSampleCount(uint32_t requestedSamples)
+{
+	VkPhysicalDeviceProperties deviceProperties;
+	vkGetPhysicalDeviceProperties(MainDevice.PhysicalDevice, &deviceProperties);
+
+	// colour and depth are multisampled, so both have to support the count
+	VkSampleCountFlags supportedCounts = deviceProperties.limits.framebufferColorSampleCounts
+		& deviceProperties.limits.framebufferDepthSampleCounts;
+
+	const VkSampleCountFlagBits sampleCounts[] = {
+		VK_SAMPLE_COUNT_8_BIT, VK_SAMPLE_COUNT_4_BIT, VK_SAMPLE_COUNT_2_BIT
+	};
+	for(VkSampleCountFlagBits sampleCount : sampleCounts)
+	{
+		// the flag bits are the sample counts themselves
+		if(static_cast<uint32_t>(sampleCount) <= requestedSamples && (supportedCounts & sampleCount))
+		{
+			return sampleCount;
+		}
+	}
+
+	return VK_SAMPLE_COUNT_1_BIT;
+}
+
+VkFormat VulkanRenderer::GetDepthFormat()
+{
+	// depth only, the stencil isn't used
+	const VkFormat candidates[] = {
+		VK_FORMAT_D32_SFLOAT, VK_FORMAT_D24_UNORM_S8_UINT, VK_FORMAT_D32_SFLOAT_S8_UINT, VK_FORMAT_D16_UNORM
+	};
+	for(VkFormat format : candidates)
+	{
+		VkFormatProperties properties;
+		vkGetPhysicalDeviceFormatProperties(MainDevice.PhysicalDevice, format, &properties);
+
+		if(properties.optimalTilingFeatures & VK_FORMAT_FEATURE_DEPTH_STENCIL_ATTACHMENT_BIT)
+		{
+			return format;
+		}
+	}
+
+	throw std::runtime_error("failed to find a supported depth format!");
+}
+
+VkImage VulkanRenderer::CreateTransientImage(const VkFormat& format, const VkImageUsageFlags& usage, VkDeviceMemory* imageMemory)
+{
+	VkImageCreateInfo createInfo = {};
+	createInfo.sType = VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO;
+	createInfo.imageType = VK_IMAGE_TYPE_2D;
+	createInfo.format = format;
+	createInfo.extent.width = SwapchainResolution.width;
+	createInfo.extent.height = SwapchainResolution.height;
+	createInfo.extent.depth = 1;
+	createInfo.mipLevels = 1;
+	createInfo.arrayLayers = 1;
+	createInfo.samples = MsaaSamples;
+	createInfo.tiling = VK_IMAGE_TILING_OPTIMAL;
+	createInfo.usage = usage;
+	createInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+	createInfo.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+
+	VkImage image;
+	VkResult result = vkCreateImage(MainDevice.LogicalDevice, &createInfo, Allocator, &image);
+	if(result != VK_SUCCESS)
+	{
+		throw std::runtime_error("failed to create an attachment image!");
+	}
+
+	VkMemoryRequirements memoryRequirements;
+	vkGetImageMemoryRequirements(MainDevice.LogicalDevice, image, &memoryRequirements);
+
+	// prefer lazily allocated memory (tile based gpus only commit it, if the attachment ever has to leave the tile)
+	VkMemoryPropertyFlags memoryProperties = VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT;
+	if(HasMemoryType(MainDevice.PhysicalDevice, memoryRequirements.memoryTypeBits, VK_MEMORY_PROPERTY_LAZILY_ALLOCATED_BIT))
+	{
+		memoryProperties = VK_MEMORY_PROPERTY_LAZILY_ALLOCATED_BIT;
+	}
+
+	VkMemoryAllocateInfo allocateInfo = {};
+	allocateInfo.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
+	allocateInfo.allocationSize = memoryRequirements.size;
+	allocateInfo.memoryTypeIndex = FindMemoryTypeIndex(MainDevice.PhysicalDevice, memoryRequirements.memoryTypeBits,
+		memoryProperties);
+
+	result = vkAllocateMemory(MainDevice.LogicalDevice, &allocateInfo, Allocator, imageMemory);
+	if(result != VK_SUCCESS)
+	{
+		throw std::runtime_error("failed to allocate attachment image memory!");
+	}
+
+	vkBindImageMemory(MainDevice.LogicalDevice, image, *imageMemory, 0);
+
+	return image;
+}
+
 VkImageView VulkanRenderer::CreateImageView(const VkImage& image, const VkFormat& format, const VkImageAspectFlags& aspectFlags)
 {
 	VkImageViewCreateInfo createInfo = {};
@@ -1397,7 +3457,7 @@ VkImageView VulkanRenderer::CreateImageView(const VkImage& image, const VkFormat
 	createInfo.subresourceRange.layerCount = 1;
 
 	VkImageView imageView;
-	VkResult result = vkCreateImageView(MainDevice.LogicalDevice, &createInfo, nullptr, &imageView);
+	VkResult result = vkCreateImageView(MainDevice.LogicalDevice, &createInfo, Allocator, &imageView);
 	if(result != VK_SUCCESS)
 	{
 		throw std::runtime_error("failed to create an image view!");
@@ -1406,15 +3466,15 @@ VkImageView VulkanRenderer::CreateImageView(const VkImage& image, const VkFormat
 	return imageView;
 }
 
-VkShaderModule VulkanRenderer::CreateShaderModule(const std::vector<char> &code)
+VkShaderModule VulkanRenderer::CreateShaderModule(const ShaderCode &code)
 {
 	VkShaderModuleCreateInfo createInfo = {};
 	createInfo.sType = VK_STRUCTURE_TYPE_SHADER_MODULE_CREATE_INFO;
-	createInfo.codeSize = code.size();
-	createInfo.pCode = reinterpret_cast<const uint32_t*>(code.data());
+	createInfo.codeSize = code.GetSize();
+	createInfo.pCode = code.GetCode();
 
 	VkShaderModule shaderModule;
-	VkResult result = vkCreateShaderModule(MainDevice.LogicalDevice, &createInfo, nullptr, &shaderModule);
+	VkResult result = vkCreateShaderModule(MainDevice.LogicalDevice, &createInfo, Allocator, &shaderModule);
 	if(result != VK_SUCCESS)
 	{
 		throw std::runtime_error("failed to create shader module!");
@@ -1469,7 +3529,7 @@ void VulkanRenderer::SetupDebugMessenger()
 	VkDebugUtilsMessengerCreateInfoEXT createInfo{};
 	PopulateDebugMessengerCreateInfo(createInfo);
 
-	if(CreateDebugUtilsMessenger(Instance, &createInfo, nullptr, &DebugMessenger) != VK_SUCCESS)
+	if(CreateDebugUtilsMessenger(Instance, &createInfo, Allocator, &DebugMessenger) != VK_SUCCESS)
 	{
 		throw std::runtime_error("failed to setup debug messenger!");
 	}
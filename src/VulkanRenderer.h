@@ -13,57 +13,302 @@
 
 #include <stdexcept>
 #include <vector>
+#include <array>
+#include <chrono>
 #include <set>
-
+#include <functional>
+#include <mutex>
+#include <unordered_map>
+
+#include "DeletionQueue.h"
+#include "DescriptorAllocator.h"
+#include "ComputeSystem.h"
+#include "FrameCapture.h"
+#include "FrameReadback.h"
+#include "HostAllocator.h"
+#include "ParticleSystem.h"
+#include "FrameAllocationCheck.h"
+#include "JobSystem.h"
+#include "LinearArena.h"
+#include "MemoryBudget.h"
 #include "Mesh.h"
+#include "PipelineCompiler.h"
+#include "PipelineRegistry.h"
+#include "PipelineState.h"
+#include "SceneGraph.h"
+#include "ShaderCompiler.h"
+#include "ShaderPermutation.h"
+#include "ShaderReloader.h"
+#include "StartupProfiler.h"
 #include "Utilities.h"
 
+// fills the vertices and indices of a mesh, e.g. by reading and decoding a file
+// runs on a worker thread and may throw a std::runtime_error to fail the load
+typedef std::function<void(std::vector<Vertex>& vertices, std::vector<uint32_t>& indices)> MeshLoadFunction;
+
 class VulkanRenderer
 {
 public:
 	VulkanRenderer();
 	~VulkanRenderer();
 
-	int32_t Init(GLFWwindow* newWindow);
+	// msaaSamples: 1 (off), 2, 4 or 8. capped to what the device supports
+	// readbackFrames: size of the ring rendered frames are copied back to host memory through, 0 disables readback
+	// dynamicRendering: render straight into the image views (vulkan 1.3) instead of through a render pass and
+	// framebuffers, if the device supports it
+	int32_t Init(GLFWwindow* newWindow, uint32_t msaaSamples = 4, uint32_t readbackFrames = 0, bool dynamicRendering = true);
 
+	// whether Init chose dynamic rendering (otherwise the classic render pass is used)
+	bool UsesDynamicRendering() const;
+
+	// set the transform of the scene root, which all meshes are attached to
 	void UpdateModel(const glm::mat4& modelMatrix);
 
+	// camera of the meshes and particles. the projection maps to vulkan's clip space (y pointing down)
+	// changing it rewrites the view uniforms and all object matrices, each only once per swapchain image
+	// (only from the thread that draws, or before the render thread is started)
+	void SetView(const glm::mat4& view, const glm::mat4& projection);
+
+	// colour the FOG permutation fades into between the two view distances
+	// (only from the thread that draws, or before the render thread is started)
+	void SetFog(const glm::vec3& colour, float start, float end);
+
+	// scene graph holding the transforms of all meshes
+	// (nodes created here are uploaded to the object buffer with each frame)
+	SceneGraph& GetScene();
+	SceneNode GetMeshNode(size_t meshIndex) const;
+	SceneNode GetSceneRoot() const;
+
+	// worker threads shared by all renderer subsystems (and available to the application)
+	JobSystem& GetJobSystem();
+
+	// scratch memory of the frame being drawn, valid until the frame is drawn again (MAX_FRAME_DRAWS frames later)
+	// (only from the thread that draws, e.g. ArenaVector<T> for transient lists)
+	LinearArena& GetFrameArena();
+
+	// size of the mesh list, i.e. an upper bound of the mesh handles (some of which may still be loading)
+	size_t GetMeshCount() const;
+
+	// load a mesh in the background and return its handle right away. the loader and the staging run on a worker,
+	// the upload is submitted by the next Draw and the mesh joins the draw list once its upload fence has signalled
+	// (can be called from any thread)
+	MeshHandle LoadMeshAsync(MeshLoadFunction loader);
+
+	// add a mesh while frames are in flight. the data is staged right away, the upload works like LoadMeshAsync
+	// (can be called from any thread)
+	MeshHandle AddMesh(std::vector<Vertex>* vertices, std::vector<uint32_t>* indices);
+
+	// take the mesh out of the draw list with the next Draw. its buffers are destroyed once
+	// no frame in flight uses them anymore. meshes that are still loading are removed once they're ready,
+	// meshes that failed to load can be removed as well (can be called from any thread)
+	void RemoveMesh(MeshHandle mesh);
+
+	// (can be called from any thread)
+	MeshState GetMeshState(MeshHandle mesh);
+
+	// draw the mesh once more: at a new node below the scene root, tinted with the colour. all instances of a mesh
+	// (its own node is the first one) are drawn with a single instanced draw call. the instance is moved through
+	// the returned node, like any other scene node. the mesh has to be ready (or evicted), meshes that are still
+	// loading can't get instances yet (only from the thread that draws, or before the render thread is started)
+	SceneNode AddMeshInstance(MeshHandle mesh, const glm::mat4& transform, const glm::vec4& colour = glm::vec4(1.0f));
+	void SetMeshInstanceColour(SceneNode instance, const glm::vec4& colour);
+	// destroys the instance's node. the mesh's own node can only be removed with the mesh
+	void RemoveMeshInstance(SceneNode instance);
+	uint32_t GetMeshInstanceCount(MeshHandle mesh) const;
+
+	// indices (into the mesh list) of the meshes to draw. all meshes are drawn by default, loaded meshes are appended
+	// the command buffers are re-recorded lazily, whenever the list changes
+	void SetDrawList(const std::vector<uint32_t>& drawList);
+
+	// shader features the mesh is drawn with (DefaultShaderPermutation unless set)
+	// the pipeline of a permutation is built on a worker the first time it is used,
+	// the mesh is drawn with the default permutation until it's ready
+	// (only from the thread that draws, or before the render thread is started)
+	void SetMeshPermutation(MeshHandle mesh, ShaderPermutationKey permutation);
+
+	// blend mode, cull mode and topology the mesh is drawn with (base variant unless set)
+	// variants are derived from the base variant of the mesh's permutation, which is drawn until they're ready
+	// (only from the thread that draws, or before the render thread is started)
+	void SetMeshVariant(MeshHandle mesh, const PipelineVariant& variant);
+
+	// start building pipelines that will be used later, all in parallel
+	// (only from the thread that draws, or before the render thread is started)
+	void PrecompilePipelines(const std::vector<PipelineStateDesc>& descs);
+
+	template<typename Permutation>
+	void SetMeshPermutation(MeshHandle mesh)
+	{
+		SetMeshPermutation(mesh, Permutation::Key);
+	}
+
+	// when the device local heap is over budget, the meshes that weren't drawn this frame are evicted:
+	// lowest priority first, then least recently drawn. evicted meshes are streamed in again once they're drawn,
+	// meshes added with AddMesh have nothing to be streamed from and are never evicted
+	// (only from the thread that draws, or before the render thread is started)
+	void SetMeshPriority(MeshHandle mesh, uint32_t priority);
+
+	// upper bound for the memory budget in bytes, 0 for the driver's budget (or 80% of the heap without
+	// VK_EXT_memory_budget). (only from the thread that draws, or before the render thread is started)
+	void SetMemoryBudget(VkDeviceSize limit);
+	const MemoryBudget& GetMemoryBudget() const;
+
+	// counts and bytes of the driver's host allocations, per allocation scope
+	const HostAllocator& GetHostAllocator() const;
+
+	// creation times of the graphics pipelines
+	const PipelineCompiler& GetPipelineCompiler() const;
+	// the unique pipelines and layouts
+	const PipelineRegistry& GetPipelineRegistry() const;
+
+	// print how long every step of Init took, and the jobs that ran meanwhile, once the first frame has been
+	// presented (call before Init)
+	void EnableStartupReport();
+	// timings of Init and the first frame
+	const StartupProfiler& GetStartupProfile() const;
+
+	// rendered frames copied back to host memory, oldest first (only if enabled in Init)
+	// the frame points into mapped memory and has to be released once it isn't needed anymore
+	// (can be called from any thread)
+	bool AcquireReadbackFrame(ReadbackFrame& frame);
+	void ReleaseReadbackFrame(const ReadbackFrame& frame);
+
+	// write all read back frames to disk on encoder threads, until StopCapture (needs readback)
+	// captured frames are taken from the readback, so don't acquire frames yourself at the same time
+	void StartCapture(const CaptureSettings& settings);
+	void StopCapture();
+	const FrameCapture& GetFrameCapture() const;
+	// the ring the capture takes its frames from, e.g. for its drop count (any thread)
+	const FrameReadback& GetFrameReadback() const;
+
+	// compute pipelines, storage buffers and dispatches recorded around the render pass
+	// (only from the thread that draws, or before the render thread is started)
+	ComputeSystem& GetCompute();
+
+	// simulate and draw particles on the gpu (before the render thread is started)
+	// needs the particle shaders to be compiled
+	int32_t EnableParticles(const ParticleSettings& settings = ParticleSettings());
+	ParticleSystem& GetParticles();
+
+	// rebuild the mesh pipelines on a worker whenever a file in the shader directory changes,
+	// and swap them in at the start of a frame (before the render thread is started)
+	void EnableShaderHotReload();
+
 	void Draw();
 
 	void CleanUp();
 
 private:
+	// mesh being loaded in the background
+	struct MeshUpload
+	{
+		MeshHandle Handle = INVALID_MESH_HANDLE;
+		Mesh UploadedMesh;
+		VkBuffer StagingBuffer = VK_NULL_HANDLE;
+		VkDeviceMemory StagingBufferMemory = VK_NULL_HANDLE;
+		VkCommandBuffer CommandBuffer = VK_NULL_HANDLE;
+		VkFence Fence = VK_NULL_HANDLE;			// signalled once the copy has executed
+		bool bRestream = false;					// evicted mesh coming back, it keeps its node and draw list entry
+	};
+
+	// what the memory budget needs to know about a mesh, indexed by handle
+	struct MeshResidency
+	{
+		uint32_t Priority = 0;
+		uint64_t LastDrawnFrame = 0;
+		VkDeviceSize Size = 0;					// device memory of its buffers while it's resident
+	};
+
 	//vulkan functions
 	// - vk create functions
 	void CreateInstance();
 	void CreateLogicalDevice();
 	void CreateSurface();
+	// format, resolution and image count, everything the render pass and the pipelines need
+	void ChooseSwapChainSettings();
 	void CreateSwapChain();
 	void CreateRenderPass();
 	void CreateDescriptorSetLayout();
-	void CreateGraphicsPipeline();
+	void CreatePipelineLayout();
+	// basePipeline: VK_NULL_HANDLE, or the base variant to derive from
+	VkPipeline CreateGraphicsPipeline(const PipelineStateDesc& desc, VkPipeline basePipeline);
+	void CreateAttachmentImages();
 	void CreateFramebuffers();
+	void CreateMeshes();
 	void CreateCommandPool();
 	void CreateCommandBuffers();
 	void CreateSynchronizationObjects();
 
 	void CreateUniformBuffers();
+	void CreateObjectBuffers();
 	void CreateDescriptorPool();
 	void CreateDescriptorSets();
 
+	// write what changed since the image was drawn last: frame data always, view data and object matrices
+	// only if the camera or the scene changed
 	void UpdateUniformBuffer(const uint32_t& imageIndex);
 
+	void CreateInstanceBuffers();
+	// the old buffers are destroyed once no frame in flight uses them anymore
+	void CreateDrawCommandBuffers(uint32_t capacity);
+	void DestroyDrawCommandBuffers();
+	void AddInstance(MeshHandle mesh, SceneNode node, const glm::vec4& colour);
+	// only this mesh's range and draw command are written again
+	void MarkInstancesChanged(MeshHandle mesh);
+	// give every mesh its range in the instance buffers, when one of them outgrew its capacity
+	void LayoutInstances();
+	// write the instances and draw commands of the meshes that changed since the image was drawn last
+	void UpdateInstanceBuffer(uint32_t imageIndex);
+
+	// submit staged mesh uploads and hand over the ones that finished on the gpu
+	void ProcessMeshUploads();
+	void ProcessMeshRemovals();
+	void DestroyMeshUpload(MeshUpload& upload);
+	// run the loader and stage the upload on a worker
+	void StreamMesh(MeshHandle handle, MeshLoadFunction loader, bool restream);
+
+	// keep the mesh memory within budget: evict meshes that aren't drawn and stream drawn ones back in
+	void UpdateMeshResidency();
+	void EvictMeshes(VkDeviceSize size);
+	void TrackMeshMemory(MeshHandle handle);
+	void UntrackMeshMemory(MeshHandle handle);
+
 	// -  record functions
 	void RecordCommands();
+	void RecordCommandBuffer(uint32_t imageIndex);
+	// dynamic rendering replacements for vkCmdBeginRenderPass / vkCmdEndRenderPass,
+	// including the layout transitions the render pass would do
+	void RecordBeginRendering(VkCommandBuffer commandBuffer, uint32_t imageIndex);
+	void RecordEndRendering(VkCommandBuffer commandBuffer, uint32_t imageIndex);
 
 	// - vk getter functions
 	void GetPhysicalDevice();
+	// the first use of a pipeline starts building it on a worker, until then its base variant is returned
+	// (or a pipeline with the same layout, if the base isn't ready either: VK_NULL_HANDLE if there is none,
+	// and the draw is skipped) (the description's layout has to be filled in, see ResolvePipelineState)
+	VkPipeline GetGraphicsPipeline(const PipelineStateDesc& desc);
+	// fill in the mesh layout if no layout is set
+	PipelineStateDesc ResolvePipelineState(const PipelineStateDesc& desc) const;
+	PipelineStateDesc GetMeshPipelineState(MeshHandle mesh) const;
+	void SetMeshPipelineState(MeshHandle mesh, const PipelineStateDesc& desc);
+	// replace the pipelines with the ones the shader reload rebuilt, if it finished
+	void SwapReloadedPipelines();
+	// take over the pipelines the workers finished building
+	void ProcessCompiledPipelines();
+	// destroyed once no frame in flight uses it anymore
+	void RetirePipeline(VkPipeline pipeline);
+	// a pipeline the registry replaced (VK_NULL_HANDLE is ignored), once nothing derives from it anymore either
+	void RetireReplacedPipeline(VkPipeline pipeline);
+	VkSampleCountFlagBits GetMaxUsableSampleCount(uint32_t requestedSamples);
+	VkFormat GetDepthFormat();
 
 	// - vk support functions
 	//	 - vk support checker functions
 	bool CheckInstanceExtensionSupport(std::vector<const char*>* checkExtensions);
 	bool CheckDeviceExtensionSupport(VkPhysicalDevice physicalDevice);
 	bool CheckPhysicalDeviceSuitable(const VkPhysicalDevice& device);
+	bool CheckDynamicRenderingSupport(VkPhysicalDevice physicalDevice);
+	bool CheckMemoryBudgetSupport(VkPhysicalDevice physicalDevice);
+	bool CheckDescriptorUpdateTemplateSupport(VkPhysicalDevice physicalDevice);
 
 	//	 - vk support getter functions
 	QueueFamilyIndicies GetQueueFamilies(VkPhysicalDevice physicalDevice);
@@ -76,7 +321,9 @@ private:
 
 	// - support create functions
 	VkImageView CreateImageView(const VkImage& image, const VkFormat& format, const VkImageAspectFlags& aspectFlags);
-	VkShaderModule CreateShaderModule(const std::vector<char> &code);
+	// image that only lives inside the render pass (multisampled colour, depth), lazily allocated where possible
+	VkImage CreateTransientImage(const VkFormat& format, const VkImageUsageFlags& usage, VkDeviceMemory* imageMemory);
+	VkShaderModule CreateShaderModule(const ShaderCode &code);
 
 	//adding required extensions
 	std::vector<const char*> GetRequiredExtensions();
@@ -105,17 +352,86 @@ private:
 private:
 	GLFWwindow* Window = nullptr;
 
+	// host memory of the driver, passed to every vulkan object the renderer creates itself
+	// (the subsystems keep using the default allocator). has to outlive all of them
+	HostAllocator HostMemory;
+	const VkAllocationCallbacks* Allocator = HostMemory.GetCallbacks();
+
+	JobSystem Jobs;
+
+	StartupProfiler Startup;
+	bool bStartupReport = false;
+
+	// glsl -> spir-v, through the on disk cache
+	ShaderCompiler Shaders;
+	// loaded in parallel to the device setup, the first pipeline takes them over if both of them loaded
+	ShaderCode StartupVertexShader;
+	ShaderCode StartupFragmentShader;
+
 	// Scene Objects
 	std::vector<Mesh> MeshList;
+	std::vector<SceneNode> MeshNodes;		// scene node of every mesh, 1:1 with MeshList
+
+	std::vector<uint32_t> DrawList;
+	uint64_t DrawListVersion = 0;
+
+	// the workers only ever touch MeshStates and StagedMeshUploads (guarded by MeshUploadMutex),
+	// everything else about the upload happens on the thread calling Draw
+	std::mutex MeshUploadMutex;
+	std::vector<MeshState> MeshStates;				// indexed by handle
+	std::vector<MeshUpload> StagedMeshUploads;		// staged by a worker, waiting to be submitted
+	std::vector<MeshUpload> SubmittedMeshUploads;	// waiting for their fence
+	std::vector<MeshHandle> PendingMeshRemovals;	// guarded by MeshUploadMutex as well
+	std::vector<MeshLoadFunction> MeshLoaders;		// indexed by handle, guarded as well. empty for added meshes
+	JobCounter MeshLoadJobs;
+
+	// - Memory budget
+	MemoryBudget Memory;
+	bool bMemoryBudgetExtension = false;
+	std::vector<MeshResidency> MeshResidencies;		// indexed by handle, only used by the thread that draws
+	uint64_t NextEvictionFrame = 0;					// evicted memory is only freed once the frames in flight are done
+	bool bReportedOverBudget = false;
+
+	// resources that are destroyed once the frames using them have finished
+	DeletionQueue FrameDeletions;
+
+	ShaderReloader ShaderReload;
+
+	SceneGraph Scene;
+	SceneNode SceneRoot = INVALID_SCENE_NODE;
 
 	// Scene Settings
-	struct MatrixSetup {
-		glm::mat4 Projection;
-		glm::mat4 View;
-		glm::mat4 Model;
-	} ModelViewProjectMatrix;
+	// the uniform data is split by how often it changes, every group is a descriptor set of its own.
+	// sets that change less often come first, so binding a later one leaves them bound
+	enum UniformSet
+	{
+		UNIFORM_SET_FRAME,			// FrameData, written every frame
+		UNIFORM_SET_VIEW,			// ViewData, written when the camera moves
+		UNIFORM_SET_OBJECT,			// model view projection matrix of every scene node, written when they change
+		UNIFORM_SET_COUNT
+	};
+
+	// std140 layouts, see the shaders
+	struct FrameData {
+		glm::vec4 FogColour;
+		float FogStart;
+		float FogEnd;
+		float Time_s;				// since Init
+		uint32_t FrameIndex;
+	} FrameUniforms;
+
+	struct ViewData {
+		glm::mat4 ViewProjection;	// premultiplied once, instead of per vertex
+		glm::mat4 View;				// for the camera axes, e.g. to face billboards
+	} ViewUniforms;
+
+	uint64_t ViewGeneration = 1;	// bumped by SetView
+	std::chrono::steady_clock::time_point InitTime;
 
 	uint32_t CurrentFrame = 0;
+	// reset once the frame's fence has signalled. init uses the first one, before any frame is drawn
+	LinearArena FrameArenas[MAX_FRAME_DRAWS];
+	uint64_t SubmittedFrames = 0;		// total number of frames submitted, keys the deletion queue
 
 	// vulkan components
 	// - Main
@@ -137,34 +453,130 @@ private:
 	//the following three are 1:1 connected. One framebuffer per image, one commandbuffer per framebuffer
 	std::vector<SwapchainImage> SwapchainImages;
 	std::vector<VkFramebuffer> SwapchainFramebuffers;		//one framebuffer per swapchain image
+
+	// - Attachments
+	// the multisampled colour and the depth image never leave the render pass (the colour is resolved into the
+	// swapchain image), so they are shared by all framebuffers and never stored
+	VkSampleCountFlagBits MsaaSamples = VK_SAMPLE_COUNT_1_BIT;
+	VkImage ColourImage = VK_NULL_HANDLE;		// only with msaa, otherwise we render to the swapchain image directly
+	VkDeviceMemory ColourImageMemory = VK_NULL_HANDLE;
+	VkImageView ColourImageView = VK_NULL_HANDLE;
+	VkFormat DepthFormat;
+	VkImage DepthImage;
+	VkDeviceMemory DepthImageMemory;
+	VkImageView DepthImageView;
 	std::vector<VkCommandBuffer> CommandBuffers;
+	std::vector<uint64_t> CommandBufferVersions;	// draw list + compute version each command buffer was recorded with
 
 	// - Descriptors
-	VkDescriptorSetLayout DescriptorSetLayout;
-
-	std::vector<VkDescriptorSet> DescriptorSets;
-
-	// one uniform buffer for every swapchain image
-	std::vector<VkBuffer> UniformBuffer;
-	std::vector<VkDeviceMemory> UniformBufferMemory;
+	DescriptorLayoutCache DescriptorLayouts;
+	// owned by the layout cache. every set has a single buffer at binding 0
+	std::array<VkDescriptorSetLayout, UNIFORM_SET_COUNT> DescriptorSetLayouts;
+
+	// the sets are written straight from a VkDescriptorBufferInfo, through the update templates
+	std::array<DescriptorUpdateTemplate, UNIFORM_SET_COUNT> DescriptorTemplates;
+	bool bDescriptorUpdateTemplates = false;
+
+	// all sets of a swapchain image, in set order
+	std::vector<std::array<VkDescriptorSet, UNIFORM_SET_COUNT>> DescriptorSets;
+
+	// one frame and one view uniform buffer for every swapchain image, mapped for their whole lifetime
+	std::vector<VkBuffer> FrameUniformBuffer;
+	std::vector<VkDeviceMemory> FrameUniformBufferMemory;
+	std::vector<FrameData*> FrameUniformBufferMapped;
+	std::vector<VkBuffer> ViewUniformBuffer;
+	std::vector<VkDeviceMemory> ViewUniformBufferMemory;
+	std::vector<ViewData*> ViewUniformBufferMapped;
+	std::vector<uint64_t> ViewUniformBufferGenerations;	// view generation last written to each buffer
+
+	// one object buffer (model view projection matrix of every scene node) for every swapchain image
+	// these stay mapped, so the scene graph can write into them directly
+	std::vector<VkBuffer> ObjectBuffer;
+	std::vector<VkDeviceMemory> ObjectBufferMemory;
+	std::vector<glm::mat4*> ObjectBufferMapped;
+	std::vector<uint64_t> ObjectBufferGenerations;		// scene generation last written to each buffer
+
+	// - Instances
+	// per mesh (indexed by handle), in the order they're laid out in the instance buffers
+	std::vector<std::vector<MeshInstance>> MeshInstances;
+	struct InstanceRange
+	{
+		uint32_t First;
+		uint32_t Capacity;								// instances can be added up to this without moving the range
+	};
+	std::vector<InstanceRange> MeshInstanceRanges;		// set by LayoutInstances
+	std::vector<uint64_t> MeshInstanceGenerations;		// instance generation the mesh's instances last changed in
+	struct InstanceLocation
+	{
+		MeshHandle Mesh;
+		uint32_t Index;									// into the mesh's instances, UINT32_MAX if not an instance
+	};
+	std::vector<InstanceLocation> InstanceLocations;	// indexed by scene node
+	uint64_t InstanceGeneration = 0;
+	bool bInstanceRangeOverflowed = false;
+
+	// one instance buffer (all instances of all meshes, every instance is a scene node) for every swapchain image
+	// mapped like the object buffers
+	std::vector<VkBuffer> InstanceBuffer;
+	std::vector<VkDeviceMemory> InstanceBufferMemory;
+	std::vector<MeshInstance*> InstanceBufferMapped;
+	std::vector<uint64_t> InstanceBufferGenerations;	// instance generation last written to each buffer (and draw command buffer)
+
+	// the indexed indirect draw of every mesh (indexed by handle) for every swapchain image, so the instance counts
+	// change without re-recording the command buffers. grows with the mesh list
+	std::vector<VkBuffer> DrawCommandBuffer;
+	std::vector<VkDeviceMemory> DrawCommandBufferMemory;
+	std::vector<VkDrawIndexedIndirectCommand*> DrawCommandBufferMapped;
+	uint32_t DrawCommandCapacity = 0;
 
 	// - Pipeline
-	VkPipeline GraphicsPipeline;
-	VkPipelineLayout PipelineLayout;
-	VkRenderPass RenderPass;
+	PipelineRegistry GraphicsPipelines;					// only the pipelines in use, and the layouts
+	PipelineCompiler Pipelines;							// builds the others. the default one is built in Init
+	std::vector<VkPipeline> RetiredBasePipelines;		// replaced by the shader reload, variants still derive from them
+	VkPipelineLayout PipelineLayout;					// of the mesh pipelines, owned by the registry
+	std::vector<PipelineStateDesc> MeshPipelineStates;	// indexed by handle, shorter if only defaults were set
+	VkRenderPass RenderPass = VK_NULL_HANDLE;			// stays null with dynamic rendering
+
+	// - Dynamic rendering
+	uint32_t InstanceApiVersion = VK_API_VERSION_1_0;
+	bool bDynamicRendering = false;
+	bool bDynamicRenderingExtension = false;	// 1.2 device, dynamic rendering through VK_KHR_dynamic_rendering
+	VkPipelineRenderingCreateInfo PipelineRenderingInfo = {};	// attachment formats the pipelines render to
+	// looked up at runtime, so that the renderer still loads with a vulkan 1.0 loader
+	PFN_vkCmdBeginRenderingKHR CmdBeginRendering = nullptr;
+	PFN_vkCmdEndRenderingKHR CmdEndRendering = nullptr;
+
+	// - Readback
+	uint32_t ReadbackFrameCount = 0;
+	FrameReadback Readback;
+	FrameCapture Capture;
+
+	// - Compute
+	ComputeSystem Compute;
+	ParticleSystem Particles;
 
 	// - Pools
 	VkCommandPool GraphicsCommandPool;
-	VkDescriptorPool DescriptorPool;
+	// sets that live as long as the renderer. there is no per frame allocator to Reset at the start of a frame:
+	// the command buffers are recorded once per swapchain image and replayed, so every set they bind has to
+	// outlive all frames drawn with them. per frame data is written into the mapped buffers instead
+	DescriptorAllocator Descriptors;
 
 	// - Utility
 	VkFormat SwapchainImageFormat;
 	VkExtent2D SwapchainResolution;
+	struct {
+		VkSurfaceFormatKHR SurfaceFormat;
+		VkPresentModeKHR PresentMode;
+		uint32_t ImageCount;
+		VkSurfaceCapabilitiesKHR SurfaceCapabilities;
+	} SwapchainSettings;
 
 	// - Synchronisation
 	std::vector<VkSemaphore> ImagesAvailable;
 	std::vector<VkSemaphore> RendersFinished;
 	std::vector<VkFence> DrawFences;
+	std::vector<VkFence> ImagesInFlight;		// draw fence of the frame currently using each swapchain image
 
 	//validation layers
 	VkDebugUtilsMessengerEXT DebugMessenger;